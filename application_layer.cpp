@@ -1,9 +1,10 @@
 
 #include "application_layer.hpp"
 #include "simulator.hpp"
+#include "state_checkpoint.hpp"
 
 ApplicationLayer::ApplicationLayer(NodePtr node)
-	: CommunicationLayer(node), m_isRunning(false)
+	: CommunicationLayer(node), m_isRunning(false), m_hasActivity(false)
 {
 
 }
@@ -18,9 +19,9 @@ void ApplicationLayer::start(const SimTime& startTime)
 	AppEpochEventPtr startEvent = AppEpochEvent::create(
 		AppEpochEvent::Epochs_Start, thisApplicationLayer());
 	SimTime scheduledTime = startTime - 
-		Simulator::instance()->currentTime();
+		getNode()->currentTime();
 	assert(scheduledTime >= 0.0);
-	Simulator::instance()->scheduleEvent(startEvent, scheduledTime);
+	getNode()->scheduleEvent(startEvent, scheduledTime);
 }
 
 void ApplicationLayer::stop(const SimTime& stopTime)
@@ -28,9 +29,9 @@ void ApplicationLayer::stop(const SimTime& stopTime)
 	AppEpochEventPtr stopEvent = AppEpochEvent::create(
 		AppEpochEvent::Epochs_Stop, thisApplicationLayer());
 	SimTime scheduledTime = stopTime - 
-		Simulator::instance()->currentTime();
+		getNode()->currentTime();
 	assert(scheduledTime >= 0.0);
-	Simulator::instance()->scheduleEvent(stopEvent, scheduledTime);
+	getNode()->scheduleEvent(stopEvent, scheduledTime);
 }
 
 bool ApplicationLayer::recvFromLayer(
@@ -40,8 +41,30 @@ bool ApplicationLayer::recvFromLayer(
 	// The app layer should not have an upper communication
 	// layer from which to receive.
 	assert(direction == CommunicationLayer::Directions_Lower);
+	recordActivity();
 	return handleRecvdPacket(packet, recvLayerIdx);
 
 }
 
+void ApplicationLayer::recordActivity()
+{
+	m_hasActivity = true;
+	m_lastActivityTime = getNode()->currentTime();
+}
+
+void ApplicationLayer::saveState(StateCheckpoint& checkpoint)
+{
+	CommunicationLayer::saveState(checkpoint);
+	checkpoint.save(m_isRunning);
+	checkpoint.save(m_hasActivity);
+	checkpoint.save(m_lastActivityTime);
+}
+
+void ApplicationLayer::resetState()
+{
+	CommunicationLayer::resetState();
+	m_isRunning = false;
+	m_hasActivity = false;
+	m_lastActivityTime = SimTime(0.0);
+}
 
@@ -60,6 +60,29 @@ public:
 	 */
 	inline CommunicationLayer::Types getLayerType() const;
 
+	/**
+	 * Get the last time that the application did something,
+	 * i.e., it started, stopped, received a packet, or sent
+	 * one that it records with recordActivity().
+	 * @param lastActivityTime set to the time of the last
+	 * activity.
+	 * @return false if the application has not done anything
+	 * yet, such as before it starts.
+	 * @see ApplicationIdleStopCondition
+	 */
+	inline bool getLastActivityTime(SimTime& lastActivityTime) const;
+
+	/**
+	 * Save the application's state in a checkpoint.
+	 * @param checkpoint the checkpoint being taken.
+	 */
+	virtual void saveState(StateCheckpoint& checkpoint);
+
+	/**
+	 * Put the application back to not having started.
+	 */
+	virtual void resetState();
+
 protected:
 
 	/// A constructor.
@@ -86,6 +109,14 @@ protected:
 	 */
 	virtual void stopHandler() = 0;
 
+	/**
+	 * Record that the application did something at the
+	 * current time.  Subclasses call this when they send
+	 * a packet.
+	 * @see getLastActivityTime()
+	 */
+	void recordActivity();
+
 	/// Keeps track of whether the application is running.
 	/// @see start()
 	/// @see stop()
@@ -93,6 +124,13 @@ protected:
 
 private: 
 
+	/// Whether the application has done anything yet.
+	/// @see getLastActivityTime()
+	bool m_hasActivity;
+
+	/// @see getLastActivityTime()
+	SimTime m_lastActivityTime;
+
 };
 typedef boost::shared_ptr<ApplicationLayer> ApplicationLayerPtr;
 
@@ -105,6 +143,13 @@ inline CommunicationLayer::Types ApplicationLayer::getLayerType() const
 	return CommunicationLayer::Types_Application;
 }
 
+inline bool ApplicationLayer::getLastActivityTime(
+	SimTime& lastActivityTime) const
+{
+	lastActivityTime = m_lastActivityTime;
+	return m_hasActivity;
+}
+
 ////////////////////////////////////////////////
 // Overloaded Operators
 /////////////////////////////////////////////////
@@ -122,7 +167,7 @@ inline CommunicationLayer::Types ApplicationLayer::getLayerType() const
 class AppEpochEvent : public Event {
 public:
 	/// Smart pointer that clients should use.
-	typedef boost::shared_ptr<AppEpochEvent> AppEpochEventPtr;
+	typedef boost::intrusive_ptr<AppEpochEvent> AppEpochEventPtr;
 
 	/**
 	 * Epochs enum.
@@ -149,11 +194,13 @@ public:
 		switch(m_epochType) {
 		case Epochs_Start:
 			m_appLayer->m_isRunning = true;
+			m_appLayer->recordActivity();
 			m_appLayer->startHandler();
 			break;
 		case Epochs_Stop:
 			m_appLayer->stopHandler();
 			m_appLayer->m_isRunning = false;
+			m_appLayer->recordActivity();
 			break;
 		default:
 			assert(0);
@@ -176,7 +223,7 @@ private:
 	ApplicationLayerPtr m_appLayer;
 
 };
-typedef boost::shared_ptr<AppEpochEvent> AppEpochEventPtr;
+typedef boost::intrusive_ptr<AppEpochEvent> AppEpochEventPtr;
 
 #endif // APPLICATION_LAYER_H
 
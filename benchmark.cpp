@@ -0,0 +1,1152 @@
+
+#include <ctime>
+#include <vector>
+#include <iomanip>
+#include <algorithm>
+using namespace std;
+#include <boost/shared_ptr.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#include "benchmark.hpp"
+#include "simulator.hpp"
+#include "event_queue.hpp"
+#include "rand_num_generator.hpp"
+#include "node.hpp"
+#include "timer.hpp"
+#include "bundle_dispatcher.hpp"
+#include "wireless_channel.hpp"
+#include "wireless_channel_manager.hpp"
+#include "wireless_comm_signal.hpp"
+#include "path_loss.hpp"
+#include "rfid_tag_phy.hpp"
+#include "packet.hpp"
+
+/////////////////////////////////////////////////
+// HoldModel Class
+/////////////////////////////////////////////////
+
+/**
+ * Drives the event queue with the classic "hold" workload:
+ * every executed event schedules itself again.
+ */
+class HoldModel : boost::noncopyable {
+public:
+	/// Smart pointer that clients should use.
+	typedef boost::shared_ptr<HoldModel> HoldModelPtr;
+
+	/**
+	 * DelayTypes enum.
+	 * How the delay of each rescheduled event is chosen.
+	 */
+	enum DelayTypes {
+		DelayTypes_Slot, /**< enum value DelayTypes_Slot. */
+		DelayTypes_Exponential /**< enum value DelayTypes_Exponential. */
+	};
+
+	/**
+	 * A factory method to ensure that all objects
+	 * are created via \c new since we are using smart pointers.
+	 * @param delayType the delay distribution.
+	 */
+	static inline HoldModelPtr create(DelayTypes delayType);
+
+	/**
+	 * Schedule the initial set of events.
+	 * @param numEvents the number of events to keep pending.
+	 */
+	void start(t_ulong numEvents);
+
+	/**
+	 * Called whenever one of the model's events executes.
+	 * @param eventIndex the index of the event that executed.
+	 */
+	void handleHold(t_ulong eventIndex);
+
+	/**
+	 * Get the number of events executed so far.
+	 * @return the number of executed events.
+	 */
+	inline t_ulong getNumExecuted() const;
+
+	/**
+	 * Get the delay between the executions of an event.
+	 * @return the delay.
+	 */
+	SimTime nextDelay() const;
+
+	/// The slot time used for the DelayTypes_Slot distribution.
+	static const double m_SLOT_TIME;
+
+private:
+
+	/// The delay distribution.
+	DelayTypes m_delayType;
+
+	/// The number of events executed so far.
+	t_ulong m_numExecuted;
+
+	/// The events of the model.
+	vector<EventPtr> m_events;
+
+	/// A constructor.
+	HoldModel(DelayTypes delayType);
+
+};
+typedef boost::shared_ptr<HoldModel> HoldModelPtr;
+
+/**
+ * The event used by the HoldModel.
+ */
+class HoldEvent : public Event {
+public:
+	/// Smart pointer that clients should use.
+	typedef boost::intrusive_ptr<HoldEvent> HoldEventPtr;
+
+	/**
+	 * A factory method to ensure that all objects
+	 * are created via \c new since we are using smart pointers.
+	 * @param model the model that owns the event.  A raw pointer
+	 * is used to avoid a cyclic reference.
+	 * @param eventIndex the index of the event in the model.
+	 */
+	static inline HoldEventPtr create(HoldModel* model, t_ulong eventIndex)
+	{
+		HoldEventPtr p(new HoldEvent(model, eventIndex));
+		return p;
+	}
+
+	void execute()
+	{
+		m_model->handleHold(m_eventIndex);
+	}
+
+protected:
+
+	/// A constructor.
+	HoldEvent(HoldModel* model, t_ulong eventIndex)
+		: Event(), m_model(model), m_eventIndex(eventIndex)
+	{
+
+	}
+
+private:
+
+	/// The model that owns the event.
+	HoldModel* m_model;
+
+	/// The index of the event in the model.
+	t_ulong m_eventIndex;
+
+};
+
+const double HoldModel::m_SLOT_TIME = 2e-3;
+
+inline HoldModelPtr HoldModel::create(DelayTypes delayType)
+{
+	HoldModelPtr p(new HoldModel(delayType));
+	return p;
+}
+
+inline t_ulong HoldModel::getNumExecuted() const
+{
+	return m_numExecuted;
+}
+
+HoldModel::HoldModel(DelayTypes delayType)
+	: m_delayType(delayType), m_numExecuted(0)
+{
+
+}
+
+void HoldModel::start(t_ulong numEvents)
+{
+	for(t_ulong i = 0; i < numEvents; ++i) {
+		m_events.push_back(HoldEvent::create(this, i));
+		Simulator::instance()->scheduleEvent(m_events[i], nextDelay());
+	}
+}
+
+void HoldModel::handleHold(t_ulong eventIndex)
+{
+	m_numExecuted++;
+	Simulator::instance()->scheduleEvent(m_events[eventIndex],
+		nextDelay());
+}
+
+SimTime HoldModel::nextDelay() const
+{
+	SimTime delay(m_SLOT_TIME);
+	if(m_delayType == DelayTypes_Exponential) {
+		delay.setTime(Simulator::instance()->getRandNumGenerator()->
+			exponential(1.0 / m_SLOT_TIME));
+	}
+	return delay;
+}
+
+/////////////////////////////////////////////////
+// TimerChurnModel Class
+/////////////////////////////////////////////////
+
+/**
+ * Drives the event queue with timers that are restarted
+ * long before they expire, like the timeouts that a MAC or
+ * transport protocol resets whenever it hears from its peer.
+ * Every step, a driver event restarts a few timers chosen at
+ * random; a timer that does expire simply starts again.
+ */
+class TimerChurnModel : boost::noncopyable {
+public:
+	/// Smart pointer that clients should use.
+	typedef boost::shared_ptr<TimerChurnModel> TimerChurnModelPtr;
+
+	/**
+	 * A factory method to ensure that all objects
+	 * are created via \c new since we are using smart pointers.
+	 */
+	static inline TimerChurnModelPtr create();
+
+	/**
+	 * Start the driver and the timers.  The driver restarts
+	 * each timer ten times per timeout on average.
+	 * @param numTimers the number of timers.
+	 */
+	void start(t_ulong numTimers);
+
+	/**
+	 * Called whenever one of the model's events executes.
+	 * @param eventIndex the index of the timer that expired,
+	 * or the number of timers for the driver.
+	 */
+	void handleEvent(t_ulong eventIndex);
+
+	/**
+	 * Get the number of timers restarted so far, including
+	 * those that expired.
+	 * @return the number of restarted timers.
+	 */
+	inline t_ulong getNumRestarts() const;
+
+	/**
+	 * Get the number of timers that expired so far.
+	 * @return the number of expired timers.
+	 */
+	inline t_ulong getNumExpired() const;
+
+	/// The time between the executions of the driver.
+	static const double m_STEP_TIME;
+
+	/// The mean timeout of the timers.
+	static const double m_TIMEOUT;
+
+	/// The number of times each timer is restarted per
+	/// timeout on average.
+	static const t_uint m_RESTARTS_PER_TIMEOUT;
+
+	/**
+	 * Get the number of timers the driver restarts per step.
+	 * @return the number of restarts per step.
+	 */
+	inline t_ulong getRestartsPerStep() const;
+
+private:
+
+	/// The number of timers restarted so far.
+	t_ulong m_numRestarts;
+
+	/// The number of timers that expired so far.
+	t_ulong m_numExpired;
+
+	/// The events of the timers.
+	vector<EventPtr> m_timerEvents;
+
+	/// The event of the driver.
+	EventPtr m_driverEvent;
+
+	/// The number of timers the driver restarts per step.
+	t_ulong m_restartsPerStep;
+
+	/// A constructor.
+	TimerChurnModel();
+
+	/**
+	 * Start a timer again with a random timeout.
+	 * @param timerIndex the index of the timer.
+	 */
+	void restartTimer(t_ulong timerIndex);
+
+};
+typedef boost::shared_ptr<TimerChurnModel> TimerChurnModelPtr;
+
+/**
+ * The event used by the TimerChurnModel.
+ */
+class TimerChurnEvent : public Event {
+public:
+	/// Smart pointer that clients should use.
+	typedef boost::intrusive_ptr<TimerChurnEvent> TimerChurnEventPtr;
+
+	/**
+	 * A factory method to ensure that all objects
+	 * are created via \c new since we are using smart pointers.
+	 * @param model the model that owns the event.  A raw pointer
+	 * is used to avoid a cyclic reference.
+	 * @param eventIndex the index of the event in the model.
+	 */
+	static inline TimerChurnEventPtr create(TimerChurnModel* model,
+		t_ulong eventIndex)
+	{
+		TimerChurnEventPtr p(new TimerChurnEvent(model, eventIndex));
+		return p;
+	}
+
+	void execute()
+	{
+		m_model->handleEvent(m_eventIndex);
+	}
+
+protected:
+
+	/// A constructor.
+	TimerChurnEvent(TimerChurnModel* model, t_ulong eventIndex)
+		: Event(), m_model(model), m_eventIndex(eventIndex)
+	{
+
+	}
+
+private:
+
+	/// The model that owns the event.
+	TimerChurnModel* m_model;
+
+	/// The index of the event in the model.
+	t_ulong m_eventIndex;
+
+};
+
+const double TimerChurnModel::m_STEP_TIME = 1e-4;
+const double TimerChurnModel::m_TIMEOUT = 50e-3;
+const t_uint TimerChurnModel::m_RESTARTS_PER_TIMEOUT = 10;
+
+inline TimerChurnModelPtr TimerChurnModel::create()
+{
+	TimerChurnModelPtr p(new TimerChurnModel());
+	return p;
+}
+
+inline t_ulong TimerChurnModel::getNumRestarts() const
+{
+	return m_numRestarts;
+}
+
+inline t_ulong TimerChurnModel::getNumExpired() const
+{
+	return m_numExpired;
+}
+
+inline t_ulong TimerChurnModel::getRestartsPerStep() const
+{
+	return m_restartsPerStep;
+}
+
+TimerChurnModel::TimerChurnModel()
+	: m_numRestarts(0), m_numExpired(0), m_restartsPerStep(0)
+{
+
+}
+
+void TimerChurnModel::start(t_ulong numTimers)
+{
+	for(t_ulong i = 0; i < numTimers; ++i) {
+		m_timerEvents.push_back(TimerChurnEvent::create(this, i));
+		restartTimer(i);
+	}
+	m_restartsPerStep = max(1UL, static_cast<t_ulong>(numTimers *
+		m_RESTARTS_PER_TIMEOUT * m_STEP_TIME / m_TIMEOUT + 0.5));
+	m_driverEvent = TimerChurnEvent::create(this, numTimers);
+	Simulator::instance()->scheduleEvent(m_driverEvent,
+		SimTime(m_STEP_TIME));
+}
+
+void TimerChurnModel::handleEvent(t_ulong eventIndex)
+{
+	SimulatorPtr simulator = Simulator::instance();
+	if(eventIndex < m_timerEvents.size()) {
+		m_numExpired++;
+		restartTimer(eventIndex);
+		return;
+	}
+
+	for(t_ulong i = 0; i < m_restartsPerStep; ++i) {
+		t_ulong timerIndex = simulator->getRandNumGenerator()->uniformInt(
+			0, m_timerEvents.size() - 1);
+		simulator->cancelEvent(m_timerEvents[timerIndex]);
+		restartTimer(timerIndex);
+	}
+	simulator->scheduleEvent(m_driverEvent, SimTime(m_STEP_TIME));
+}
+
+void TimerChurnModel::restartTimer(t_ulong timerIndex)
+{
+	SimulatorPtr simulator = Simulator::instance();
+	m_numRestarts++;
+	simulator->scheduleTimerEvent(m_timerEvents[timerIndex],
+		SimTime(simulator->getRandNumGenerator()->uniformReal(
+		0.5 * m_TIMEOUT, 1.5 * m_TIMEOUT)));
+}
+
+/////////////////////////////////////////////////
+// NodeWorkModel Class
+/////////////////////////////////////////////////
+
+/**
+ * Gives each of a set of nodes a periodic timer, all with the
+ * same phase, whose event does some work that only changes its
+ * node's state.  Every period is then a bundle of node-local
+ * events, one per node.
+ */
+class NodeWorkModel : boost::noncopyable {
+public:
+	/// Smart pointer that clients should use.
+	typedef boost::shared_ptr<NodeWorkModel> NodeWorkModelPtr;
+
+	/**
+	 * A factory method to ensure that all objects
+	 * are created via \c new since we are using smart pointers.
+	 */
+	static inline NodeWorkModelPtr create();
+
+	/**
+	 * Create the nodes and start their timers.
+	 * @param numNodes the number of nodes.
+	 * @param workPerEvent the number of iterations of work
+	 * done by each event.
+	 */
+	void start(t_ulong numNodes, t_ulong workPerEvent);
+
+	/**
+	 * Called whenever one of the model's events executes.
+	 * @param nodeIndex the index of the event's node.
+	 */
+	void handleWork(t_ulong nodeIndex);
+
+	/**
+	 * Get the node with the given index.
+	 * @param nodeIndex the index of the node.
+	 * @return the node.
+	 */
+	inline const Node* getNode(t_ulong nodeIndex) const;
+
+	/**
+	 * Get a value that combines the state of every node, which
+	 * must not depend on the number of threads.
+	 * @return the checksum.
+	 */
+	t_ulong getChecksum() const;
+
+	/// The period of the timers.
+	static const double m_PERIOD;
+
+private:
+
+	/// The number of iterations of work done by each event.
+	t_ulong m_workPerEvent;
+
+	/// The nodes of the model.
+	vector<NodePtr> m_nodes;
+
+	/// The timer of each node.
+	vector<PeriodicTimerPtr> m_timers;
+
+	/// The state of each node that the work changes.
+	vector<t_ulong> m_nodeStates;
+
+	/// A constructor.
+	NodeWorkModel();
+
+};
+typedef boost::shared_ptr<NodeWorkModel> NodeWorkModelPtr;
+
+/**
+ * The event used by the NodeWorkModel.
+ */
+class NodeWorkEvent : public Event {
+public:
+	/// Smart pointer that clients should use.
+	typedef boost::intrusive_ptr<NodeWorkEvent> NodeWorkEventPtr;
+
+	/**
+	 * A factory method to ensure that all objects
+	 * are created via \c new since we are using smart pointers.
+	 * @param model the model that owns the event.  A raw pointer
+	 * is used to avoid a cyclic reference.
+	 * @param nodeIndex the index of the event's node.
+	 */
+	static inline NodeWorkEventPtr create(NodeWorkModel* model,
+		t_ulong nodeIndex)
+	{
+		NodeWorkEventPtr p(new NodeWorkEvent(model, nodeIndex));
+		return p;
+	}
+
+	void execute()
+	{
+		m_model->handleWork(m_nodeIndex);
+	}
+
+	const Node* getLocalNode() const
+	{
+		return m_model->getNode(m_nodeIndex);
+	}
+
+protected:
+
+	/// A constructor.
+	NodeWorkEvent(NodeWorkModel* model, t_ulong nodeIndex)
+		: Event(), m_model(model), m_nodeIndex(nodeIndex)
+	{
+
+	}
+
+private:
+
+	/// The model that owns the event.
+	NodeWorkModel* m_model;
+
+	/// The index of the event's node.
+	t_ulong m_nodeIndex;
+
+};
+
+const double NodeWorkModel::m_PERIOD = 1e-3;
+
+inline NodeWorkModelPtr NodeWorkModel::create()
+{
+	NodeWorkModelPtr p(new NodeWorkModel());
+	return p;
+}
+
+inline const Node* NodeWorkModel::getNode(t_ulong nodeIndex) const
+{
+	return m_nodes[nodeIndex].get();
+}
+
+NodeWorkModel::NodeWorkModel()
+	: m_workPerEvent(0)
+{
+
+}
+
+void NodeWorkModel::start(t_ulong numNodes, t_ulong workPerEvent)
+{
+	m_workPerEvent = workPerEvent;
+	for(t_ulong i = 0; i < numNodes; ++i) {
+		NodePtr node = Node::create(Location(i, 0.0, 0.0), NodeId(i));
+		m_nodes.push_back(node);
+		m_nodeStates.push_back(i + 1);
+		PeriodicTimerPtr timer = PeriodicTimer::create(node,
+			NodeWorkEvent::create(this, i), SimTime(m_PERIOD));
+		m_timers.push_back(timer);
+		timer->start(SimTime(m_PERIOD));
+	}
+}
+
+void NodeWorkModel::handleWork(t_ulong nodeIndex)
+{
+	// An xorshift generator stands in for the computation
+	// of a node's event.
+	t_ulong state = m_nodeStates[nodeIndex];
+	for(t_ulong i = 0; i < m_workPerEvent; ++i) {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+	}
+	m_nodeStates[nodeIndex] = state;
+}
+
+t_ulong NodeWorkModel::getChecksum() const
+{
+	t_ulong checksum = 0;
+	for(t_ulong i = 0; i < m_nodeStates.size(); ++i) {
+		checksum = (checksum * 31) ^ m_nodeStates[i];
+	}
+	return checksum;
+}
+
+/////////////////////////////////////////////////
+// Benchmark Functions
+/////////////////////////////////////////////////
+
+void benchmarkEventQueues(ostream& s, t_ulong numPendingEvents,
+	t_ulong numOperations)
+{
+	SimulatorPtr simulator = Simulator::instance();
+
+	EventQueue::QueueTypes queueTypes[] = {
+		EventQueue::QueueTypes_Multiset,
+		EventQueue::QueueTypes_Heap,
+		EventQueue::QueueTypes_Calendar
+	};
+	HoldModel::DelayTypes delayTypes[] = {
+		HoldModel::DelayTypes_Slot,
+		HoldModel::DelayTypes_Exponential
+	};
+	const char* delayTypeNames[] = { "slot", "exponential" };
+
+	s << "Event queue hold benchmark: " << numPendingEvents <<
+		" pending events, " << numOperations << " operations\n";
+	for(t_uint i = 0; i < sizeof(delayTypes) / sizeof(delayTypes[0]);
+			++i) {
+		for(t_uint j = 0; j < sizeof(queueTypes) / sizeof(queueTypes[0]);
+				++j) {
+			simulator->reset();
+			simulator->seedRandNumGenerator(1);
+			simulator->setEventQueueType(queueTypes[j]);
+
+			HoldModelPtr model = HoldModel::create(delayTypes[i]);
+			model->start(numPendingEvents);
+
+			// The mean delay is one slot time, so this executes
+			// (approximately) the desired number of operations.
+			SimTime stopTime((static_cast<double>(numOperations) /
+				numPendingEvents) * HoldModel::m_SLOT_TIME);
+
+			clock_t startClock = clock();
+			simulator->runSimulation(stopTime);
+			double elapsed = static_cast<double>(clock() - startClock) /
+				CLOCKS_PER_SEC;
+
+			double opsPerSecond = 0.0;
+			if(elapsed > 0.0) {
+				opsPerSecond = model->getNumExecuted() / elapsed;
+			}
+			s << "  delay=" << setw(12) << left << delayTypeNames[i] <<
+				" queue=" << setw(9) << left <<
+				EventQueue::queueTypeName(queueTypes[j]) << right <<
+				" executed=" << setw(9) << model->getNumExecuted() <<
+				" seconds=" << setw(8) << fixed << setprecision(3) <<
+				elapsed << " events/s=" << setprecision(0) <<
+				opsPerSecond << "\n";
+			s.unsetf(ios::fixed);
+			s << setprecision(6);
+		}
+	}
+
+	simulator->reset();
+	simulator->setEventQueueType(EventQueue::QueueTypes_Multiset);
+}
+
+void benchmarkTimers(ostream& s, t_ulong numTimers, t_ulong numOperations)
+{
+	SimulatorPtr simulator = Simulator::instance();
+
+	EventQueue::QueueTypes queueTypes[] = {
+		EventQueue::QueueTypes_Multiset,
+		EventQueue::QueueTypes_Heap,
+		EventQueue::QueueTypes_Calendar
+	};
+	bool doTimerWheels[] = { false, true };
+
+	s << "Timer churn benchmark: " << numTimers << " timers, " <<
+		numOperations << " restarts\n";
+	for(t_uint i = 0; i < sizeof(queueTypes) / sizeof(queueTypes[0]);
+			++i) {
+		for(t_uint j = 0;
+				j < sizeof(doTimerWheels) / sizeof(doTimerWheels[0]); ++j) {
+			simulator->reset();
+			simulator->seedRandNumGenerator(1);
+			simulator->setDoTimerWheel(doTimerWheels[j]);
+			simulator->setEventQueueType(queueTypes[i]);
+
+			TimerChurnModelPtr model = TimerChurnModel::create();
+			model->start(numTimers);
+
+			SimTime stopTime((static_cast<double>(numOperations) /
+				model->getRestartsPerStep()) *
+				TimerChurnModel::m_STEP_TIME);
+
+			clock_t startClock = clock();
+			simulator->runSimulation(stopTime);
+			double elapsed = static_cast<double>(clock() - startClock) /
+				CLOCKS_PER_SEC;
+
+			double opsPerSecond = 0.0;
+			if(elapsed > 0.0) {
+				opsPerSecond = model->getNumRestarts() / elapsed;
+			}
+			s << "  queue=" << setw(9) << left <<
+				EventQueue::queueTypeName(queueTypes[i]) << " wheel=" <<
+				setw(4) << (doTimerWheels[j] ? "yes" : "no") << right <<
+				" restarts=" << setw(9) << model->getNumRestarts() <<
+				" expired=" << setw(7) << model->getNumExpired() <<
+				" seconds=" << setw(8) << fixed << setprecision(3) <<
+				elapsed << " restarts/s=" << setprecision(0) <<
+				opsPerSecond << "\n";
+			s.unsetf(ios::fixed);
+			s << setprecision(6);
+		}
+	}
+
+	simulator->reset();
+	simulator->setDoTimerWheel(true);
+	simulator->setEventQueueType(EventQueue::QueueTypes_Multiset);
+}
+
+void benchmarkEventHorizon(ostream& s, t_ulong numPendingEvents,
+	t_ulong numFarEvents, t_ulong numOperations)
+{
+	SimulatorPtr simulator = Simulator::instance();
+
+	EventQueue::QueueTypes queueTypes[] = {
+		EventQueue::QueueTypes_Multiset,
+		EventQueue::QueueTypes_Heap,
+		EventQueue::QueueTypes_Calendar
+	};
+	bool doEventHorizons[] = { false, true };
+
+	s << "Event horizon benchmark: " << numPendingEvents <<
+		" pending events, " << numFarEvents << " after the stop time, " <<
+		numOperations << " operations\n";
+	for(t_uint i = 0; i < sizeof(queueTypes) / sizeof(queueTypes[0]);
+			++i) {
+		for(t_uint j = 0;
+				j < sizeof(doEventHorizons) / sizeof(doEventHorizons[0]);
+				++j) {
+			simulator->reset();
+			simulator->seedRandNumGenerator(1);
+			simulator->setDoEventHorizon(doEventHorizons[j]);
+			simulator->setEventQueueType(queueTypes[i]);
+
+			HoldModelPtr model =
+				HoldModel::create(HoldModel::DelayTypes_Exponential);
+			model->start(numPendingEvents);
+
+			SimTime stopTime((static_cast<double>(numOperations) /
+				numPendingEvents) * HoldModel::m_SLOT_TIME);
+
+			// The far events are scheduled as the run begins,
+			// like the next firing of a long periodic timer.
+			clock_t startClock = clock();
+			for(t_ulong k = 0; k < numFarEvents; ++k) {
+				simulator->scheduleEventAt(DummyEvent::create(),
+					stopTime + SimTime((k + 1) * HoldModel::m_SLOT_TIME));
+			}
+			simulator->runSimulation(stopTime);
+			double elapsed = static_cast<double>(clock() - startClock) /
+				CLOCKS_PER_SEC;
+
+			double opsPerSecond = 0.0;
+			if(elapsed > 0.0) {
+				opsPerSecond = model->getNumExecuted() / elapsed;
+			}
+			s << "  queue=" << setw(9) << left <<
+				EventQueue::queueTypeName(queueTypes[i]) << " horizon=" <<
+				setw(4) << (doEventHorizons[j] ? "yes" : "no") << right <<
+				" executed=" << setw(9) << model->getNumExecuted() <<
+				" seconds=" << setw(8) << fixed << setprecision(3) <<
+				elapsed << " events/s=" << setprecision(0) <<
+				opsPerSecond << "\n";
+			s.unsetf(ios::fixed);
+			s << setprecision(6);
+		}
+	}
+
+	simulator->reset();
+	simulator->setDoEventHorizon(true);
+	simulator->setEventQueueType(EventQueue::QueueTypes_Multiset);
+}
+
+void benchmarkBundleThreads(ostream& s, t_ulong numNodes,
+	t_ulong workPerEvent, t_ulong numPeriods)
+{
+	SimulatorPtr simulator = Simulator::instance();
+
+	t_uint numThreads[] = { 1, 2, 4 };
+
+	s << "Bundle thread benchmark: " << numNodes << " nodes, " <<
+		workPerEvent << " work per event, " << numPeriods <<
+		" periods\n";
+	for(t_uint i = 0; i < sizeof(numThreads) / sizeof(numThreads[0]);
+			++i) {
+		simulator->reset();
+		simulator->seedRandNumGenerator(1);
+		simulator->setNumBundleThreads(numThreads[i]);
+
+		NodeWorkModelPtr model = NodeWorkModel::create();
+		model->start(numNodes, workPerEvent);
+
+		// Stop half a period after the last bundle.
+		SimTime stopTime((numPeriods + 0.5) * NodeWorkModel::m_PERIOD);
+
+		// The threads' CPU time adds up in clock(), so use
+		// the wall clock time.
+		boost::posix_time::ptime startTime =
+			boost::posix_time::microsec_clock::universal_time();
+		simulator->runSimulation(stopTime);
+		boost::posix_time::time_duration elapsedTime =
+			boost::posix_time::microsec_clock::universal_time() - startTime;
+		double elapsed = elapsedTime.total_microseconds() / 1e6;
+
+		double eventsPerSecond = 0.0;
+		if(elapsed > 0.0) {
+			eventsPerSecond = (numNodes * numPeriods) / elapsed;
+		}
+		t_ulong numParallelRuns = 0;
+		if(simulator->getBundleDispatcher().get() != 0) {
+			numParallelRuns =
+				simulator->getBundleDispatcher()->getNumParallelRuns();
+		}
+		s << "  threads=" << setw(2) << numThreads[i] <<
+			" parallel runs=" << setw(6) << numParallelRuns <<
+			" checksum=" << hex << model->getChecksum() << dec <<
+			" seconds=" << setw(8) << fixed << setprecision(3) <<
+			elapsed << " events/s=" << setprecision(0) <<
+			eventsPerSecond << "\n";
+		s.unsetf(ios::fixed);
+		s << setprecision(6);
+	}
+
+	simulator->reset();
+	simulator->setNumBundleThreads(1);
+}
+
+void benchmarkLinkCache(ostream& s, t_ulong numNodes, t_ulong numSweeps)
+{
+	SimulatorPtr simulator = Simulator::instance();
+	simulator->reset();
+	simulator->seedRandNumGenerator(1);
+	RandNumGeneratorPtr rand = simulator->getRandNumGenerator();
+
+	WirelessChannelManagerPtr channelManager =
+		WirelessChannelManager::create();
+	vector<PhysicalLayerPtr> physicalLayers;
+	for(t_ulong i = 0; i < numNodes; ++i) {
+		Location location(rand->uniformReal(0.0, 10.0),
+			rand->uniformReal(0.0, 10.0), 0.0);
+		NodePtr node = Node::create(location, NodeId(i));
+		physicalLayers.push_back(RfidTagPhy::create(node, channelManager));
+	}
+
+	const t_uint numPowerLevels = 5;
+	bool doLinkCaches[] = { false, true };
+	PacketPtr packet = Packet::create();
+
+	s << "Link cache benchmark: " << numNodes << " nodes, " <<
+		numSweeps << " sweeps of " << numPowerLevels << " power levels\n";
+	for(t_uint i = 0; i < sizeof(doLinkCaches) / sizeof(doLinkCaches[0]);
+			++i) {
+		WirelessChannelPtr channel = WirelessChannel::create(TwoRay::create());
+		channel->setDoLinkCache(doLinkCaches[i]);
+
+		double checksum = 0.0;
+		t_ulong numLinks = 0;
+		clock_t startClock = clock();
+		for(t_ulong sweep = 0; sweep < numSweeps; ++sweep) {
+			for(t_ulong j = 0; j < numNodes; ++j) {
+				const PhysicalLayer& sender = *physicalLayers[j];
+				for(t_uint level = 0; level < numPowerLevels; ++level) {
+					WirelessCommSignalPtr signal = WirelessCommSignal::create(
+						sender.getLocation(), powerToDecibels(
+						sender.getMaxTxPower() / (1 << level)),
+						sender.getWavelength(), sender.getGain(), packet);
+					signal->setLocationVersion(sender.getLocationVersion());
+					for(t_ulong k = 0; k < numNodes; ++k) {
+						if(k == j) {
+							continue;
+						}
+						const PhysicalLayer& receiver = *physicalLayers[k];
+						checksum += channel->getRecvdStrength(*signal,
+							receiver);
+						checksum += channel->propagationDelay(sender,
+							receiver).getTimeInSeconds();
+						numLinks++;
+					}
+				}
+			}
+		}
+		double elapsed = static_cast<double>(clock() - startClock) /
+			CLOCKS_PER_SEC;
+
+		double linksPerSecond = 0.0;
+		if(elapsed > 0.0) {
+			linksPerSecond = numLinks / elapsed;
+		}
+		s << "  cache=" << setw(4) << left <<
+			(doLinkCaches[i] ? "yes" : "no") << right <<
+			" checksum=" << setprecision(17) << checksum <<
+			setprecision(6) << " seconds=" << setw(8) << fixed <<
+			setprecision(3) << elapsed << " links/s=" <<
+			setprecision(0) << linksPerSecond << "\n";
+		s.unsetf(ios::fixed);
+		s << setprecision(6);
+	}
+
+	simulator->reset();
+}
+
+void benchmarkRecvdStrengths(ostream& s, t_ulong numReceivers,
+	t_ulong numSignals)
+{
+	SimulatorPtr simulator = Simulator::instance();
+	simulator->reset();
+	simulator->seedRandNumGenerator(1);
+	RandNumGeneratorPtr rand = simulator->getRandNumGenerator();
+
+	// The reader is in the middle of the tags, some of which
+	// are past the Two Ray crossover distance.
+	WirelessChannelManagerPtr channelManager =
+		WirelessChannelManager::create();
+	NodePtr readerNode = Node::create(Location(200.0, 200.0, 0.0), NodeId(0));
+	PhysicalLayerPtr reader = RfidTagPhy::create(readerNode, channelManager);
+	vector<PhysicalLayerPtr> receivers;
+	vector<float> x, y, z;
+	vector<double> gains;
+	for(t_ulong i = 0; i < numReceivers; ++i) {
+		Location location(rand->uniformReal(0.0, 400.0),
+			rand->uniformReal(0.0, 400.0), rand->uniformReal(0.0, 2.0));
+		NodePtr node = Node::create(location, NodeId(i + 1));
+		receivers.push_back(RfidTagPhy::create(node, channelManager));
+		x.push_back(location.getX());
+		y.push_back(location.getY());
+		z.push_back(location.getZ());
+		gains.push_back(receivers.back()->getGain());
+	}
+	PathLoss::ReceiverArrays receiverArrays;
+	receiverArrays.m_x = span<const float>(x);
+	receiverArrays.m_y = span<const float>(y);
+	receiverArrays.m_z = span<const float>(z);
+	receiverArrays.m_gains = span<const double>(gains);
+
+	PathLossPtr pathLossModels[] = { FreeSpace::create(), TwoRay::create() };
+	const char* pathLossNames[] = { "FreeSpace", "TwoRay" };
+	PacketPtr packet = Packet::create();
+	bool doVectorKernels = PathLoss::getDoVectorKernels();
+
+	s << "Received strength benchmark: " << numReceivers <<
+		" receivers, " << numSignals << " signals\n";
+	for(t_uint i = 0;
+			i < sizeof(pathLossModels) / sizeof(pathLossModels[0]); ++i) {
+		PathLossPtr pathLoss = pathLossModels[i];
+		vector<double> expected(numReceivers);
+		vector<double> strengths(numReceivers);
+		// 0: one at a time, 1: batch, 2: batch with vector kernels
+		for(t_uint method = 0; method < 3; ++method) {
+			if(method == 2 && !doVectorKernels) {
+				continue;
+			}
+			PathLoss::setDoVectorKernels(method == 2);
+
+			clock_t startClock = clock();
+			for(t_ulong j = 0; j < numSignals; ++j) {
+				WirelessCommSignalPtr signal = WirelessCommSignal::create(
+					reader->getLocation(), powerToDecibels(
+					reader->getMaxTxPower() / (j + 1)),
+					reader->getWavelength(), reader->getGain(), packet);
+				if(method == 0) {
+					for(t_ulong k = 0; k < numReceivers; ++k) {
+						expected[k] = pathLoss->getRecvdStrength(*signal,
+							*receivers[k]);
+					}
+				} else {
+					pathLoss->getRecvdStrengths(*signal, receiverArrays,
+						span<double>(strengths));
+				}
+			}
+			double elapsed = static_cast<double>(clock() - startClock) /
+				CLOCKS_PER_SEC;
+
+			// The last signal's strengths are compared.
+			t_ulong numDifferent = 0;
+			if(method != 0) {
+				for(t_ulong k = 0; k < numReceivers; ++k) {
+					if(strengths[k] != expected[k]) {
+						numDifferent++;
+					}
+				}
+			}
+			const char* methodNames[] = { "each", "batch", "vector" };
+			s << "  model=" << setw(9) << left << pathLossNames[i] <<
+				" method=" << setw(6) << methodNames[method] << right <<
+				" different=" << setw(6) << numDifferent <<
+				" seconds=" << setw(8) << fixed << setprecision(3) <<
+				elapsed << " ns/receiver=" << setprecision(2) <<
+				(elapsed * 1e9 / (numSignals * numReceivers)) << "\n";
+			s.unsetf(ios::fixed);
+			s << setprecision(6);
+		}
+	}
+
+	PathLoss::setDoVectorKernels(true);
+	simulator->reset();
+}
+
+void benchmarkChannelFanOut(ostream& s, t_ulong numListeners,
+	t_ulong numSignals)
+{
+	SimulatorPtr simulator = Simulator::instance();
+	simulator->reset();
+	simulator->seedRandNumGenerator(1);
+	RandNumGeneratorPtr rand = simulator->getRandNumGenerator();
+
+	const t_uint channelId = 0;
+	WirelessChannelManagerPtr channelManager =
+		WirelessChannelManager::create();
+	channelManager->addChannel(channelId,
+		WirelessChannel::create(FreeSpace::create()));
+
+	NodePtr senderNode = Node::create(Location(50.0, 50.0, 0.0), NodeId(0));
+	PhysicalLayerPtr sender = RfidTagPhy::create(senderNode, channelManager);
+	channelManager->attachAsSender(sender, channelId);
+
+	// The listeners sense every signal but capture none, so
+	// no packet is passed up.
+	vector<PhysicalLayerPtr> listeners;
+	for(t_ulong i = 0; i < numListeners; ++i) {
+		Location location(rand->uniformReal(0.0, 100.0),
+			rand->uniformReal(0.0, 100.0), 0.0);
+		NodePtr node = Node::create(location, NodeId(i + 1));
+		listeners.push_back(RfidTagPhy::create(node, channelManager));
+		listeners.back()->setRxThreshold(sender->getMaxTxPower());
+		channelManager->attachAsListener(listeners.back(), channelId);
+	}
+
+	bool doListenerCullings[] = { false, true };
+	PacketPtr packet = Packet::create();
+
+	s << "Channel fan-out benchmark: " << numListeners <<
+		" listeners, " << numSignals << " signals\n";
+	for(t_uint i = 0;
+			i < sizeof(doListenerCullings) / sizeof(doListenerCullings[0]);
+			++i) {
+		channelManager->setDoListenerCulling(doListenerCullings[i]);
+
+		double checksum = 0.0;
+		clock_t elapsedClocks = 0;
+		for(t_ulong j = 0; j < numSignals; ++j) {
+			WirelessCommSignalPtr signal = WirelessCommSignal::create(
+				sender->getLocation(), powerToDecibels(
+				sender->getMaxTxPower() / (j + 1)),
+				sender->getWavelength(), sender->getGain(), packet);
+			signal->setLocationVersion(sender->getLocationVersion());
+
+			clock_t startClock = clock();
+			channelManager->recvSignal(sender, signal);
+			elapsedClocks += clock() - startClock;
+
+			// End the signal at the listeners without running
+			// its end events.
+			for(t_ulong k = 0; k < numListeners; ++k) {
+				checksum += listeners[k]->getCulmulativeSignalStrength();
+				listeners[k]->removeSignal(signal);
+			}
+			simulator->reset();
+		}
+		double elapsed = static_cast<double>(elapsedClocks) /
+			CLOCKS_PER_SEC;
+
+		s << "  culling=" << setw(4) << left <<
+			(doListenerCullings[i] ? "yes" : "no") << right <<
+			" checksum=" << setprecision(17) << checksum <<
+			setprecision(6) << " seconds=" << setw(8) << fixed <<
+			setprecision(3) << elapsed << " ns/listener=" <<
+			setprecision(2) << (elapsed * 1e9 / (numSignals * numListeners)) <<
+			"\n";
+		s.unsetf(ios::fixed);
+		s << setprecision(6);
+	}
+
+	simulator->reset();
+}
+
+void benchmarkSignalEnds(ostream& s, t_ulong numListeners,
+	t_ulong numSignals)
+{
+	SimulatorPtr simulator = Simulator::instance();
+	simulator->reset();
+	simulator->seedRandNumGenerator(1);
+	RandNumGeneratorPtr rand = simulator->getRandNumGenerator();
+
+	const t_uint channelId = 0;
+	WirelessChannelManagerPtr channelManager =
+		WirelessChannelManager::create();
+	channelManager->addChannel(channelId,
+		WirelessChannel::create(FreeSpace::create()));
+
+	NodePtr senderNode = Node::create(Location(50.0, 50.0, 0.0), NodeId(0));
+	PhysicalLayerPtr sender = RfidTagPhy::create(senderNode, channelManager);
+	channelManager->attachAsSender(sender, channelId);
+
+	// The listeners sense every signal but capture none, so
+	// no packet is passed up.
+	vector<PhysicalLayerPtr> listeners;
+	for(t_ulong i = 0; i < numListeners; ++i) {
+		Location location(rand->uniformReal(0.0, 100.0),
+			rand->uniformReal(0.0, 100.0), 0.0);
+		NodePtr node = Node::create(location, NodeId(i + 1));
+		listeners.push_back(RfidTagPhy::create(node, channelManager));
+		listeners.back()->setRxThreshold(sender->getMaxTxPower());
+		channelManager->attachAsListener(listeners.back(), channelId);
+	}
+
+	bool doAggregateSignalEnds[] = { false, true };
+	PacketPtr packet = Packet::create();
+
+	s << "Signal end benchmark: " << numListeners << " listeners, " <<
+		numSignals << " signals\n";
+	for(t_uint i = 0;
+			i < sizeof(doAggregateSignalEnds) /
+			sizeof(doAggregateSignalEnds[0]); ++i) {
+		channelManager->setDoAggregateSignalEnds(doAggregateSignalEnds[i]);
+
+		double checksum = 0.0;
+		t_ulong numQueuedEvents = 0;
+		clock_t elapsedClocks = 0;
+		for(t_ulong j = 0; j < numSignals; ++j) {
+			WirelessCommSignalPtr signal = WirelessCommSignal::create(
+				sender->getLocation(), powerToDecibels(
+				sender->getMaxTxPower() / (j + 1)),
+				sender->getWavelength(), sender->getGain(), packet);
+			signal->setLocationVersion(sender->getLocationVersion());
+
+			clock_t startClock = clock();
+			channelManager->recvSignal(sender, signal);
+			numQueuedEvents += simulator->numPendingEvents();
+			simulator->runSimulation(simulator->currentTime() + 1.0);
+			elapsedClocks += clock() - startClock;
+
+			// Every listener should have heard the end of the signal.
+			for(t_ulong k = 0; k < numListeners; ++k) {
+				checksum += listeners[k]->getCulmulativeSignalStrength();
+			}
+		}
+		double elapsed = static_cast<double>(elapsedClocks) /
+			CLOCKS_PER_SEC;
+
+		s << "  aggregate=" << setw(4) << left <<
+			(doAggregateSignalEnds[i] ? "yes" : "no") << right <<
+			" events/signal=" << setw(7) << (numQueuedEvents / numSignals) <<
+			" checksum=" << checksum << " seconds=" << setw(8) << fixed <<
+			setprecision(3) << elapsed << " ns/listener=" <<
+			setprecision(2) << (elapsed * 1e9 / (numSignals * numListeners)) <<
+			"\n";
+		s.unsetf(ios::fixed);
+		s << setprecision(6);
+	}
+
+	simulator->reset();
+}
+
+void runBenchmarks(ostream& s)
+{
+	benchmarkEventQueues(s, 1000, 2000000);
+	benchmarkEventQueues(s, 100000, 2000000);
+	benchmarkTimers(s, 1000, 2000000);
+	benchmarkTimers(s, 100000, 2000000);
+	benchmarkEventHorizon(s, 1000, 100000, 2000000);
+	benchmarkBundleThreads(s, 1000, 2000, 500);
+	benchmarkBundleThreads(s, 10000, 200, 500);
+	benchmarkLinkCache(s, 50, 320);
+	benchmarkRecvdStrengths(s, 100000, 100);
+	benchmarkChannelFanOut(s, 100000, 20);
+	benchmarkSignalEnds(s, 100000, 20);
+}
+
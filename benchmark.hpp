@@ -0,0 +1,144 @@
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <iostream>
+using namespace std;
+
+#include "utility.hpp"
+
+/**
+ * \file benchmark.hpp
+ * Micro-benchmarks for the simulator's core data structures.
+ * These are run from the command line with the \c -benchmark
+ * option (see main.cpp).  Build with optimization (e.g.,
+ * <tt>make CXXFLAGS="-O2 -Wall"</tt>) to get meaningful numbers.
+ */
+
+/**
+ * Compare the throughput of each of the event queue
+ * implementations.
+ * Each implementation is driven through the Simulator with a
+ * "hold" model in which a fixed number of events are pending
+ * and each executed event schedules itself again.  Two delay
+ * distributions are used: a fixed slot time, which causes many
+ * events to share a timestamp as with a slotted MAC, and an
+ * exponential delay.
+ * @param s the stream to which the results are written.
+ * @param numPendingEvents the number of events kept in the queue.
+ * @param numOperations the number of events executed per run.
+ */
+void benchmarkEventQueues(ostream& s, t_ulong numPendingEvents,
+	t_ulong numOperations);
+
+/**
+ * Compare the cost of starting and stopping timers with and
+ * without the timer wheel in front of each of the event queue
+ * implementations.
+ * Timers are restarted at random long before they expire, so
+ * most of them never fire.
+ * @param s the stream to which the results are written.
+ * @param numTimers the number of running timers.
+ * @param numOperations the number of timer restarts per run.
+ */
+void benchmarkTimers(ostream& s, t_ulong numTimers, t_ulong numOperations);
+
+/**
+ * Compare the throughput of each of the event queue
+ * implementations with and without the events after the stop
+ * time kept apart from the queue (see
+ * Simulator::setDoEventHorizon()).
+ * The "hold" model of benchmarkEventQueues() with exponential
+ * delays is run alongside events that are scheduled to fire
+ * after the stop time, so they are never executed.
+ * @param s the stream to which the results are written.
+ * @param numPendingEvents the number of events kept in the queue.
+ * @param numFarEvents the number of events after the stop time.
+ * @param numOperations the number of events executed per run.
+ */
+void benchmarkEventHorizon(ostream& s, t_ulong numPendingEvents,
+	t_ulong numFarEvents, t_ulong numOperations);
+
+/**
+ * Compare executing bundles of node-local events with
+ * different numbers of threads (see
+ * Simulator::setNumBundleThreads()).
+ * Each node has a periodic timer whose event does a fixed
+ * amount of work, and the timers share a phase, so each period
+ * is one bundle with an event per node.  The checksum of the
+ * nodes' state must be the same for every number of threads.
+ * @param s the stream to which the results are written.
+ * @param numNodes the number of nodes.
+ * @param workPerEvent the number of iterations of work done by
+ * each event.
+ * @param numPeriods the number of bundles executed per run.
+ */
+void benchmarkBundleThreads(ostream& s, t_ulong numNodes,
+	t_ulong workPerEvent, t_ulong numPeriods);
+
+/**
+ * Compare computing the strength and propagation delay of
+ * every link between tags with and without the link cache of
+ * WirelessChannel (see WirelessChannel::setDoLinkCache()).
+ * Each tag sends a signal at each of several power levels,
+ * like a reader sweeping its power, and it is received by
+ * every other tag.  The checksum of the strengths and delays
+ * must be the same with and without the cache.
+ * @param s the stream to which the results are written.
+ * @param numNodes the number of tags.
+ * @param numSweeps the number of times that every tag sends
+ * at every power level.
+ */
+void benchmarkLinkCache(ostream& s, t_ulong numNodes, t_ulong numSweeps);
+
+/**
+ * Compare the cost per receiver of computing the strength of a
+ * signal one receiver at a time (see
+ * PathLoss::getRecvdStrength()) with computing it for a batch
+ * of receivers, with and without the vector kernels (see
+ * PathLoss::getRecvdStrengths()).  The number of strengths
+ * that differ from those computed one at a time must be zero.
+ * @param s the stream to which the results are written.
+ * @param numReceivers the number of tags receiving each signal.
+ * @param numSignals the number of signals sent by a reader.
+ */
+void benchmarkRecvdStrengths(ostream& s, t_ulong numReceivers,
+	t_ulong numSignals);
+
+/**
+ * Measure the cost per listener of sending a signal on a channel
+ * with many listeners (see WirelessChannelManager::recvSignal()),
+ * with and without listener culling.  All of the listeners are in
+ * range, so the checksum of the strengths that they sense must be
+ * the same either way.
+ * @param s the stream to which the results are written.
+ * @param numListeners the number of tags listening on the channel.
+ * @param numSignals the number of signals sent on the channel.
+ */
+void benchmarkChannelFanOut(ostream& s, t_ulong numListeners,
+	t_ulong numSignals);
+
+/**
+ * Compare the cost per listener of sending a signal on a channel
+ * with many listeners and then running the signal's end at each
+ * of them, with a SignalEndEvent per listener and with one
+ * TransmissionEndEvent (see
+ * WirelessChannelManager::setDoAggregateSignalEnds()).  The
+ * number of events queued per signal is reported, and the
+ * checksum of the strengths that the listeners still sense
+ * afterwards must be zero either way.
+ * @param s the stream to which the results are written.
+ * @param numListeners the number of tags listening on the channel.
+ * @param numSignals the number of signals sent on the channel.
+ */
+void benchmarkSignalEnds(ostream& s, t_ulong numListeners,
+	t_ulong numSignals);
+
+/**
+ * Run all of the benchmarks with their default parameters.
+ * @param s the stream to which the results are written.
+ */
+void runBenchmarks(ostream& s);
+
+#endif // BENCHMARK_H
+
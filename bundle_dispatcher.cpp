@@ -0,0 +1,223 @@
+
+#include <algorithm>
+#include <stdint.h>
+#include <boost/bind/bind.hpp>
+#include <boost/thread/locks.hpp>
+
+#include "bundle_dispatcher.hpp"
+#include "simulator.hpp"
+
+const t_ulong BundleDispatcher::m_DEFAULT_MIN_PARALLEL_EVENTS = 256;
+thread_local BundleDispatcher::Worker* BundleDispatcher::m_currentWorker = 0;
+
+BundleDispatcher::BundleDispatcher(SimulatorPtr simulator,
+	t_uint numThreads)
+	: m_simulator(simulator),
+	m_minParallelEvents(m_DEFAULT_MIN_PARALLEL_EVENTS),
+	m_numParallelRuns(0), m_runNumber(0), m_numBusyThreads(0),
+	m_isStopping(false)
+{
+	assert(m_simulator != 0);
+	assert(numThreads > 0);
+	for(t_uint i = 0; i < numThreads; ++i) {
+		WorkerPtr worker(new Worker());
+		m_workers.push_back(worker);
+	}
+	for(t_uint i = 1; i < numThreads; ++i) {
+		m_threads.create_thread(boost::bind(&BundleDispatcher::threadLoop,
+			this, i));
+	}
+}
+
+BundleDispatcher::~BundleDispatcher()
+{
+	{
+		boost::lock_guard<boost::mutex> lock(m_mutex);
+		m_isStopping = true;
+	}
+	m_runCondition.notify_all();
+	m_threads.join_all();
+}
+
+void BundleDispatcher::dispatch(EventBundle& bundle)
+{
+	t_ulong numEvents = bundle.m_events.size();
+	t_ulong index = bundle.m_nextIndex;
+	while(index < numEvents) {
+		// Find the run of node-local events that starts here.
+		// Cancelled events are skipped, so they have no node.
+		m_localNodes.clear();
+		t_ulong runEnd = index;
+		while(runEnd < numEvents) {
+			Event* event = bundle.m_events[runEnd].get();
+			const Node* node = 0;
+			if(event->inEventBundle()) {
+				node = event->getLocalNode();
+				if(node == 0) {
+					break;
+				}
+			}
+			m_localNodes.push_back(node);
+			runEnd++;
+		}
+
+		if((runEnd - index) >= m_minParallelEvents) {
+			dispatchRun(bundle, index, runEnd);
+			index = runEnd;
+		} else {
+			// Execute the short run and the event that ended it
+			// sequentially.
+			t_ulong end = min(runEnd + 1, numEvents);
+			bundle.m_nextIndex = index;
+			bundle.m_endIndex = end;
+			bundle.m_events[index]->executeBundle(bundle);
+			index = end;
+		}
+	}
+	bundle.m_nextIndex = numEvents;
+	bundle.m_endIndex = numEvents;
+}
+
+void BundleDispatcher::bufferEvent(EventPtr event, bool isTimer)
+{
+	Worker* worker = m_currentWorker;
+	assert(worker != 0);
+	// The event being executed is the last one that the
+	// worker's bundle gave.
+	BufferedEvent bufferedEvent;
+	bufferedEvent.m_event = event;
+	bufferedEvent.m_bundleIndex =
+		worker->m_bundleIndices[worker->m_bundle.m_nextIndex - 1];
+	bufferedEvent.m_isTimer = isTimer;
+	worker->m_bufferedEvents.push_back(bufferedEvent);
+}
+
+bool BundleDispatcher::cancelEvent(EventPtr event)
+{
+	Worker* worker = m_currentWorker;
+	if(worker != 0) {
+		vector<BufferedEvent>& bufferedEvents = worker->m_bufferedEvents;
+		for(t_ulong i = bufferedEvents.size(); i > 0; --i) {
+			if(bufferedEvents[i - 1].m_event == event) {
+				bufferedEvents.erase(bufferedEvents.begin() + (i - 1));
+				return true;
+			}
+		}
+	}
+
+	boost::lock_guard<boost::mutex> lock(m_mutex);
+	return m_simulator->removeEvent(event);
+}
+
+void BundleDispatcher::threadLoop(t_uint workerIndex)
+{
+	Simulator::setInstance(m_simulator);
+	t_ulong runNumber = 0;
+	while(true) {
+		{
+			boost::unique_lock<boost::mutex> lock(m_mutex);
+			while(m_runNumber == runNumber && !m_isStopping) {
+				m_runCondition.wait(lock);
+			}
+			if(m_isStopping) {
+				return;
+			}
+			runNumber = m_runNumber;
+		}
+
+		runWorker(*m_workers[workerIndex]);
+
+		{
+			boost::lock_guard<boost::mutex> lock(m_mutex);
+			if(--m_numBusyThreads == 0) {
+				m_doneCondition.notify_one();
+			}
+		}
+	}
+}
+
+void BundleDispatcher::runWorker(Worker& worker)
+{
+	m_currentWorker = &worker;
+	if(!worker.m_bundle.m_events.empty()) {
+		worker.m_bundle.m_events[0]->executeBundle(worker.m_bundle);
+	}
+	m_currentWorker = 0;
+}
+
+void BundleDispatcher::dispatchRun(EventBundle& bundle, t_ulong begin,
+	t_ulong end)
+{
+	t_uint numWorkers = m_workers.size();
+	for(t_ulong i = begin; i < end; ++i) {
+		const Node* node = m_localNodes[i - begin];
+		if(node == 0) {
+			continue;
+		}
+		// Hash the node so that its events stay on one thread.
+		uintptr_t address = reinterpret_cast<uintptr_t>(node);
+		t_uint workerIndex = ((address >> 4) ^ (address >> 12)) % numWorkers;
+		Worker& worker = *m_workers[workerIndex];
+		worker.m_bundle.add(bundle.m_events[i]);
+		worker.m_bundleIndices.push_back(i);
+	}
+
+	{
+		boost::lock_guard<boost::mutex> lock(m_mutex);
+		m_simulator->m_isDispatchingInParallel = true;
+		m_numBusyThreads = numWorkers - 1;
+		m_runNumber++;
+	}
+	m_runCondition.notify_all();
+	runWorker(*m_workers[0]);
+	{
+		boost::unique_lock<boost::mutex> lock(m_mutex);
+		while(m_numBusyThreads > 0) {
+			m_doneCondition.wait(lock);
+		}
+		m_simulator->m_isDispatchingInParallel = false;
+	}
+
+	scheduleBufferedEvents();
+	for(t_uint i = 0; i < numWorkers; ++i) {
+		m_workers[i]->m_bundle.clear();
+		m_workers[i]->m_bundleIndices.clear();
+	}
+	m_numParallelRuns++;
+}
+
+void BundleDispatcher::scheduleBufferedEvents()
+{
+	t_uint numWorkers = m_workers.size();
+	vector<t_ulong> positions(numWorkers, 0);
+	while(true) {
+		// Each worker's events are already in order, so
+		// take the earliest of their first events.
+		t_uint nextWorkerIndex = numWorkers;
+		t_ulong nextBundleIndex = 0;
+		for(t_uint i = 0; i < numWorkers; ++i) {
+			const vector<BufferedEvent>& bufferedEvents =
+				m_workers[i]->m_bufferedEvents;
+			if(positions[i] < bufferedEvents.size() &&
+					(nextWorkerIndex == numWorkers ||
+					bufferedEvents[positions[i]].m_bundleIndex <
+					nextBundleIndex)) {
+				nextWorkerIndex = i;
+				nextBundleIndex = bufferedEvents[positions[i]].m_bundleIndex;
+			}
+		}
+		if(nextWorkerIndex == numWorkers) {
+			break;
+		}
+
+		BufferedEvent& bufferedEvent = m_workers[nextWorkerIndex]->
+			m_bufferedEvents[positions[nextWorkerIndex]++];
+		m_simulator->queueEvent(bufferedEvent.m_event,
+			bufferedEvent.m_isTimer);
+	}
+
+	for(t_uint i = 0; i < numWorkers; ++i) {
+		m_workers[i]->m_bufferedEvents.clear();
+	}
+}
+
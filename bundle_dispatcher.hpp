@@ -0,0 +1,252 @@
+
+#ifndef BUNDLE_DISPATCHER_H
+#define BUNDLE_DISPATCHER_H
+
+#include <vector>
+using namespace std;
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include "utility.hpp"
+#include "event.hpp"
+
+class Simulator;
+typedef Simulator* SimulatorPtr;
+
+/////////////////////////////////////////////////
+// BundleDispatcher Class
+/////////////////////////////////////////////////
+
+/**
+ * Executes the node-local events of an EventBundle on a pool
+ * of threads.
+ * The bundle is executed in order, but each run of consecutive
+ * node-local events (see Event::getLocalNode()) that is long
+ * enough is split between the threads by node, so the events
+ * of a node stay on one thread in their order.  While a run
+ * executes, the events that it schedules are buffered by each
+ * thread along with the position in the bundle of the event
+ * that scheduled them.  Once every thread is done, they are
+ * scheduled in the order of those positions, which is the
+ * order in which the bundle would have scheduled them
+ * sequentially, so they get the same sequence numbers and the
+ * results do not depend on the number of threads.  Events
+ * that are not node-local and short runs are executed
+ * sequentially in between.
+ * @see Simulator::setNumBundleThreads()
+ */
+class BundleDispatcher : boost::noncopyable {
+public:
+	/// Smart pointer that clients should use.
+	typedef boost::shared_ptr<BundleDispatcher> BundleDispatcherPtr;
+
+	/// The default shortest run of node-local events that
+	/// is executed in parallel.
+	static const t_ulong m_DEFAULT_MIN_PARALLEL_EVENTS;
+
+	/// A destructor, which stops the threads.
+	~BundleDispatcher();
+
+	/**
+	 * A factory method to ensure that all objects
+	 * are created via \c new since we are using smart pointers.
+	 * @param simulator the simulator whose bundles are
+	 * executed.
+	 * @param numThreads the number of threads, including the
+	 * simulator's own thread.
+	 */
+	static inline BundleDispatcherPtr create(SimulatorPtr simulator,
+		t_uint numThreads);
+
+	/**
+	 * Get the number of threads, including the simulator's
+	 * own thread.
+	 * @return the number of threads.
+	 */
+	inline t_uint getNumThreads() const;
+
+	/**
+	 * Set the shortest run of node-local events that is
+	 * executed in parallel.  Shorter runs are not worth
+	 * waking the threads for.
+	 * @param minParallelEvents the number of events.
+	 */
+	inline void setMinParallelEvents(t_ulong minParallelEvents);
+
+	/**
+	 * Get the shortest run of node-local events that is
+	 * executed in parallel.
+	 * @return the number of events.
+	 */
+	inline t_ulong getMinParallelEvents() const;
+
+	/**
+	 * Get the number of runs that were executed in parallel.
+	 * @return the number of runs.
+	 */
+	inline t_ulong getNumParallelRuns() const;
+
+	/**
+	 * Execute the pending events of a bundle.
+	 * @param bundle the bundle.
+	 */
+	void dispatch(EventBundle& bundle);
+
+	/**
+	 * Buffer an event scheduled by the calling thread while
+	 * a run executes.
+	 * @param event the event, whose fire time is set.
+	 * @param isTimer true if the event belongs to a timer.
+	 */
+	static void bufferEvent(EventPtr event, bool isTimer);
+
+	/**
+	 * Cancel an event while a run executes.
+	 * @param event the event, which is pending.
+	 * @return true if the event was found and removed.
+	 */
+	bool cancelEvent(EventPtr event);
+
+private:
+
+	/**
+	 * An event scheduled while a run executes.
+	 */
+	struct BufferedEvent {
+		/// The event.
+		EventPtr m_event;
+		/// The position in the bundle of the event that
+		/// scheduled it.
+		t_ulong m_bundleIndex;
+		/// Whether the event belongs to a timer.
+		bool m_isTimer;
+	};
+
+	/**
+	 * The part of a run that a thread executes.
+	 */
+	struct Worker {
+		/// The thread's events of the run.
+		EventBundle m_bundle;
+		/// The position in the original bundle of each of
+		/// the events in m_bundle.
+		vector<t_ulong> m_bundleIndices;
+		/// The events that the thread scheduled.
+		vector<BufferedEvent> m_bufferedEvents;
+	};
+	typedef boost::shared_ptr<Worker> WorkerPtr;
+
+	/// The part of the run of the calling thread, if any.
+	static thread_local Worker* m_currentWorker;
+
+	/// The simulator whose bundles are executed.
+	SimulatorPtr m_simulator;
+
+	/// The part of the run of each thread.  The first is
+	/// executed by the simulator's own thread.
+	vector<WorkerPtr> m_workers;
+
+	/// The threads other than the simulator's own.
+	boost::thread_group m_threads;
+
+	/// @see getMinParallelEvents()
+	t_ulong m_minParallelEvents;
+
+	/// @see getNumParallelRuns()
+	t_ulong m_numParallelRuns;
+
+	/// The node of each event of the run being split.
+	vector<const Node*> m_localNodes;
+
+	/// Protects the fields below and the event queue when
+	/// an event is cancelled during a run.
+	boost::mutex m_mutex;
+
+	/// Signals the threads that a run is ready.
+	boost::condition_variable m_runCondition;
+
+	/// Signals the simulator's thread that the other
+	/// threads are done.
+	boost::condition_variable m_doneCondition;
+
+	/// The number of runs given to the threads so far.
+	t_ulong m_runNumber;
+
+	/// The number of threads still executing the run.
+	t_uint m_numBusyThreads;
+
+	/// True when the threads should exit.
+	bool m_isStopping;
+
+	/// A constructor.
+	BundleDispatcher(SimulatorPtr simulator, t_uint numThreads);
+
+	/**
+	 * Wait for runs and execute the thread's part of them.
+	 * This is the body of each thread other than the
+	 * simulator's own.
+	 * @param workerIndex the index of the thread's worker.
+	 */
+	void threadLoop(t_uint workerIndex);
+
+	/**
+	 * Execute a worker's part of a run.
+	 * @param worker the worker.
+	 */
+	void runWorker(Worker& worker);
+
+	/**
+	 * Split a run of node-local events between the threads,
+	 * execute it, and schedule the events that it buffered.
+	 * @param bundle the bundle.
+	 * @param begin the position of the first event of the run.
+	 * @param end the position after the last event of the run.
+	 */
+	void dispatchRun(EventBundle& bundle, t_ulong begin, t_ulong end);
+
+	/**
+	 * Schedule the buffered events of every worker in the
+	 * order of the positions in the bundle of the events
+	 * that scheduled them.
+	 */
+	void scheduleBufferedEvents();
+
+};
+typedef boost::shared_ptr<BundleDispatcher> BundleDispatcherPtr;
+
+/////////////////////////////////////////////////
+// Inline Functions
+/////////////////////////////////////////////////
+
+inline BundleDispatcherPtr BundleDispatcher::create(SimulatorPtr simulator,
+	t_uint numThreads)
+{
+	BundleDispatcherPtr p(new BundleDispatcher(simulator, numThreads));
+	return p;
+}
+
+inline t_uint BundleDispatcher::getNumThreads() const
+{
+	return m_workers.size();
+}
+
+inline void BundleDispatcher::setMinParallelEvents(t_ulong minParallelEvents)
+{
+	m_minParallelEvents = minParallelEvents;
+}
+
+inline t_ulong BundleDispatcher::getMinParallelEvents() const
+{
+	return m_minParallelEvents;
+}
+
+inline t_ulong BundleDispatcher::getNumParallelRuns() const
+{
+	return m_numParallelRuns;
+}
+
+#endif // BUNDLE_DISPATCHER_H
+
@@ -3,6 +3,7 @@
 #include "node.hpp"
 #include "log_stream_manager.hpp"
 #include "packet.hpp"
+#include "state_checkpoint.hpp"
 
 const t_uint CommunicationLayer::m_DEFAULT_MAX_QUEUE_LENGTH = 50;
 
@@ -36,6 +37,28 @@ void CommunicationLayer::unblockUpperQueues()
 	}
 }
 
+bool CommunicationLayer::upperQueuesAreEmpty() const
+{
+	for(t_uint i = 0; i < m_upperLayers.size(); ++i) {
+		if(!m_upperLayers[i]->m_packetQueue.empty() ||
+				!m_upperLayers[i]->upperQueuesAreEmpty()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool CommunicationLayer::upperQueuesAreUnblocked() const
+{
+	for(t_uint i = 0; i < m_upperLayers.size(); ++i) {
+		if(m_upperLayers[i]->m_queueIsBlocked ||
+				!m_upperLayers[i]->upperQueuesAreUnblocked()) {
+			return false;
+		}
+	}
+	return true;
+}
+
 void CommunicationLayer::sendFromQueue()
 {
 	while(!m_lowerLayerRecvEventPending && !m_queueIsBlocked && 
@@ -195,6 +218,20 @@ NodeId CommunicationLayer::getNodeId() const
 	return owner->getNodeId();
 }
 
+void CommunicationLayer::saveState(StateCheckpoint& checkpoint)
+{
+	checkpoint.save(m_lowerLayerRecvEventPending);
+	checkpoint.save(m_packetQueue);
+	checkpoint.save(m_queueIsBlocked);
+}
+
+void CommunicationLayer::resetState()
+{
+	m_lowerLayerRecvEventPending = false;
+	m_packetQueue.clear();
+	m_queueIsBlocked = false;
+}
+
 void CommunicationLayer::removeLayerData(PacketPtr packet) const
 {
 	switch(getLayerType()) {
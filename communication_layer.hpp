@@ -14,6 +14,7 @@ using namespace std;
 #include "utility.hpp"
 #include "sim_time.hpp"
 #include "simulation_end_listener.hpp"
+#include "state_saver.hpp"
 
 class Node;
 typedef boost::shared_ptr<Node> NodePtr;
@@ -34,6 +35,7 @@ typedef boost::shared_ptr<Packet> PacketPtr;
  */
 class CommunicationLayer : 
 	public SimulationEndListener,
+	public StateSaver,
 	boost::noncopyable, 
 	public boost::enable_shared_from_this<CommunicationLayer> {
 	// Only node can call setNode()
@@ -252,6 +254,17 @@ public:
 	 */
 	NodeId getNodeId() const;
 
+	/**
+	 * Save the layer's queue in a checkpoint.
+	 * @param checkpoint the checkpoint being taken.
+	 */
+	virtual void saveState(StateCheckpoint& checkpoint);
+
+	/**
+	 * Empty the layer's queue and unblock it.
+	 */
+	virtual void resetState();
+
 protected:
 
 	/** 
@@ -287,6 +300,22 @@ protected:
 	 */
 	void unblockUpperQueues();
 
+	/**
+	 * Determine whether the packet queues of the upper layers,
+	 * and of their upper layers, are all empty, in which case
+	 * unblocking them sends no packets.
+	 * @return true if the upper queues are empty.
+	 */
+	bool upperQueuesAreEmpty() const;
+
+	/**
+	 * Determine whether the packet queues of the upper layers,
+	 * and of their upper layers, are all unblocked, in which
+	 * case unblocking them changes nothing.
+	 * @return true if none of the upper queues is blocked.
+	 */
+	bool upperQueuesAreUnblocked() const;
+
 	/**
 	 * Send a packets from the queue while it is not empty
 	 * and not blocked.
@@ -649,7 +678,7 @@ inline ostream& operator<< (ostream& s,
 class LayerRecvEvent : public Event {
 public:
 	/// Smart pointer that clients should use.
-	typedef boost::shared_ptr<LayerRecvEvent> LayerRecvEventPtr;
+	typedef boost::intrusive_ptr<LayerRecvEvent> LayerRecvEventPtr;
 
 	/**
 	 * A factory method to ensure that all objects
@@ -695,6 +724,12 @@ public:
 		}
 	}
 
+	/// Packets move between layers after the signals.
+	PriorityClasses getPriorityClass() const
+	{
+		return PriorityClasses_LayerRecv;
+	}
+
 protected:
 	/// A constructor.
 	LayerRecvEvent(CommunicationLayer::Directions sendDirection,
@@ -715,7 +750,7 @@ private:
 	CommunicationLayerPtr m_recvingLayer;
 	CommunicationLayerPtr m_sendingLayer;
 };
-typedef boost::shared_ptr<LayerRecvEvent> LayerRecvEventPtr;
+typedef boost::intrusive_ptr<LayerRecvEvent> LayerRecvEventPtr;
 
 #endif // COMMUNICATION_LAYER_H
 
@@ -4,6 +4,10 @@
 Event::Event() 
 {
 	m_inEventQueue = false;
+	m_inEventBundle = false;
+	m_orderKey = 0;
+	m_queueHandle = 0;
+	m_referenceCount = 0;
 }
 
 Event::~Event() 
@@ -11,4 +15,57 @@ Event::~Event()
 
 }
 
+bool Event::isBundled() const
+{
+	return false;
+}
+
+const Node* Event::getLocalNode() const
+{
+	return 0;
+}
+
+bool Event::isIdleTick() const
+{
+	return false;
+}
+
+void Event::skipIdleTicks(const SimTime& resumeTime)
+{
+	// Only idle ticks can be skipped.
+	assert(false);
+}
+
+Event::PriorityClasses Event::getPriorityClass() const
+{
+	return PriorityClasses_Default;
+}
+
+void Event::executeBundle(EventBundle& bundle)
+{
+	EventPtr event;
+	while(bundle.next(event)) {
+		event->execute();
+	}
+}
+
+EventBundle::EventBundle()
+	: m_nextIndex(0), m_endIndex(0)
+{
+
+}
+
+void EventBundle::clear()
+{
+	// Events that were not executed are dropped.
+	for(t_ulong i = m_nextIndex; i < m_events.size(); ++i) {
+		if(m_events[i]->inEventBundle()) {
+			m_events[i]->setInEventBundle(false);
+			m_events[i]->setInEventQueue(false);
+		}
+	}
+	m_events.clear();
+	m_nextIndex = 0;
+	m_endIndex = 0;
+}
 
@@ -3,31 +3,91 @@
 #define EVENT_H
 
 #include <iostream>
+#include <vector>
 using namespace std;
-#include <boost/shared_ptr.hpp>
+#include <boost/intrusive_ptr.hpp>
+#include <boost/function.hpp>
 #include <boost/utility.hpp>
 
 #include "sim_time.hpp"
 #include "utility.hpp"
+#include "event_pool.hpp"
+
+class EventBundle;
+class Node;
 
 /**
  * The interface for events which are scheduled in the simulator's
  * event queue.
  * Individual sublcasses will override the execute function
  * to do their scheduled action.
+ *
+ * Since events are created at a very high rate, they are
+ * allocated from the EventPool and are reference counted
+ * intrusively (i.e., with \c boost::intrusive_ptr rather than
+ * \c boost::shared_ptr), so creating an event does not require
+ * a separate allocation for the reference count.  The reference
+ * count is not atomic, so an event must only be used by one
+ * thread at a time.
  */
 class Event : boost::noncopyable {
 	// Only Simulator can set the event time.
 	friend class Simulator;
+	// The event queue keeps track of where the event is stored.
+	friend class EventQueue;
+	// A bundle keeps track of which of its events are pending.
+	friend class EventBundle;
+	// The dispatcher skips cancelled events of a bundle.
+	friend class BundleDispatcher;
+	// Reference counting for boost::intrusive_ptr.
+	friend inline void intrusive_ptr_add_ref(const Event* event);
+	friend inline void intrusive_ptr_release(const Event* event);
 public:
 	/// Smart pointer that clients should use.
-	typedef boost::shared_ptr<Event> EventPtr;
+	typedef boost::intrusive_ptr<Event> EventPtr;
+
+	/**
+	 * PriorityClasses enum.
+	 * The kinds of events whose order at the same time can be
+	 * set with Simulator::setPriorityClassRank().  They are
+	 * listed in the order that Simulator::usePriorityClasses()
+	 * gives them (e.g., a signal ends before a new one starts
+	 * and before a MAC's slot begins).
+	 */
+	enum PriorityClasses {
+		PriorityClasses_SignalEnd, /**< enum value PriorityClasses_SignalEnd. */
+		PriorityClasses_SignalStart, /**< enum value PriorityClasses_SignalStart. */
+		PriorityClasses_LayerRecv, /**< enum value PriorityClasses_LayerRecv. */
+		PriorityClasses_Default, /**< enum value PriorityClasses_Default. */
+		PriorityClasses_SlotStart /**< enum value PriorityClasses_SlotStart. */
+	};
+
+	/// The number of priority classes.
+	static const t_uint m_NUM_PRIORITY_CLASSES = 5;
+
+	/// The number of ranks that priority classes can be given.
+	static const t_uint m_NUM_PRIORITY_RANKS = 256;
 
 	/// A destructor.
 	/// A virtual destructor is recommended since the
 	/// class has virtual functions.
 	virtual ~Event();
 
+	/**
+	 * Allocate memory for an event from the EventPool.
+	 * This is used for all subclasses of Event.
+	 * @param sizeInBytes the size of the object.
+	 * @return a pointer to the memory.
+	 */
+	static inline void* operator new(size_t sizeInBytes);
+
+	/**
+	 * Return the memory of an event to the EventPool.
+	 * @param block the memory of the object.
+	 * @param sizeInBytes the size of the object.
+	 */
+	static inline void operator delete(void* block, size_t sizeInBytes);
+
 	/**
 	 * The code that gets executed for the event.
 	 * Subclasses can override this to define their
@@ -35,6 +95,76 @@ public:
 	 */
 	virtual void execute() = 0;
 
+	/**
+	 * Whether events of this type that fire at the same time
+	 * may be dispatched together as an EventBundle.
+	 * Subclasses that override executeBundle() should return
+	 * true.
+	 * @return true if the event can be bundled.
+	 */
+	virtual bool isBundled() const;
+
+	/**
+	 * Execute a bundle of events of the same type as this one
+	 * that all fire at the current time, in the order in
+	 * which they would be executed one at a time.  This is
+	 * called on the first event of the bundle.  Subclasses
+	 * can override this to process the whole bundle in one
+	 * loop, which must take every event from the bundle with
+	 * EventBundle::next().  By default, execute() is called
+	 * on each event.
+	 * @param bundle the bundle, which includes this event.
+	 * @see isBundled()
+	 */
+	virtual void executeBundle(EventBundle& bundle);
+
+	/**
+	 * Get the node whose state is the only state that
+	 * executing the event reads or changes, if any.  Such an
+	 * event may schedule events but must not cancel events
+	 * of other nodes, create packets, log, draw random
+	 * numbers, or touch a channel.  Node-local events of a
+	 * bundle may be executed in parallel by the simulator
+	 * (see Simulator::setNumBundleThreads()).  This is called
+	 * just before the event would be executed.
+	 * @return the node or zero if the event is not node-local,
+	 * which is the default.
+	 */
+	virtual const Node* getLocalNode() const;
+
+	/**
+	 * Determine whether executing the event now would only
+	 * move a periodic clock along (e.g., the slot number of
+	 * an idle MAC).  When nothing but idle ticks is pending
+	 * before some time, the simulator may skip them with
+	 * skipIdleTicks() (see Simulator::setDoSkipIdleTicks()).
+	 * @return true if the event is an idle tick.  By default,
+	 * it is not.
+	 */
+	virtual bool isIdleTick() const;
+
+	/**
+	 * Account for the ticks of the event's clock before the
+	 * given time as if each had been executed while idle.
+	 * An event taken out of the event queue must also schedule
+	 * itself for its first tick at or after the time, while
+	 * an event fired by a PeriodicTimer only updates its own
+	 * state.  This is only called when isIdleTick() is true.
+	 * @param resumeTime the time of the first pending event
+	 * that is not an idle tick.
+	 */
+	virtual void skipIdleTicks(const SimTime& resumeTime);
+
+	/**
+	 * Get the kind of event for ordering events that fire
+	 * at the same time.  This is called when the event is
+	 * scheduled.
+	 * @return the event's priority class.  By default, it is
+	 * PriorityClasses_Default.
+	 * @see getOrderKey()
+	 */
+	virtual PriorityClasses getPriorityClass() const;
+
 	/**
 	 * Get the time at which the event will fire.
 	 * @return The time at which the event will fire.
@@ -47,6 +177,36 @@ public:
 	 */
 	inline bool inEventQueue() const;
 
+	/**
+	 * Get the sequence number that the event was scheduled with.
+	 * @return the event's sequence number.
+	 * @see getOrderKey()
+	 */
+	inline t_ulong getSequenceNumber() const;
+
+	/**
+	 * Get the key that orders the event among those with the
+	 * same fire time.  The rank of the event's priority class
+	 * is in the top bits and its sequence number in the rest,
+	 * so events with the same fire time are executed in
+	 * ascending order of rank and then in the order in which
+	 * they were scheduled.
+	 * @return the event's order key.
+	 */
+	inline t_ulong getOrderKey() const;
+
+	/**
+	 * Make an order key.
+	 * @param priorityRank the rank of the event's priority
+	 * class, which must be less than m_NUM_PRIORITY_RANKS.
+	 * @param sequenceNumber the order in which the event
+	 * was scheduled.
+	 * @return the order key.
+	 * @see getOrderKey()
+	 */
+	static inline t_ulong makeOrderKey(t_uint priorityRank,
+		t_ulong sequenceNumber);
+
 	// Needed for insertion in a priority_queue
 	/// One event is less than another event if its fire time
 	/// is smaller.
@@ -69,6 +229,28 @@ private:
 	/// @see setInEventQueue()
 	bool m_inEventQueue;
 
+	/// True if the event was taken from the event queue as
+	/// part of a bundle but has not been executed yet.
+	/// @see inEventBundle()
+	bool m_inEventBundle;
+
+	/// The number of low bits of the order key that hold
+	/// the sequence number.
+	static const t_uint m_SEQUENCE_NUMBER_BITS = 56;
+
+	/// The rank of the event's priority class and the order
+	/// in which the event was scheduled.
+	/// @see getOrderKey()
+	/// @see setOrderKey()
+	t_ulong m_orderKey;
+
+	/// Where the event is stored in the event queue, which
+	/// the queue uses to find the event when it is cancelled.
+	t_ulong m_queueHandle;
+
+	/// The number of smart pointers that refer to the event.
+	mutable t_ulong m_referenceCount;
+
 	/**
 	 * Set the time at which the event will fire.
 	 * This can only be set by simulator, which is a
@@ -86,14 +268,121 @@ private:
 	 */
 	inline void setInEventQueue(const bool inEventQueue);
 
+	/**
+	 * Whether the event is pending in the bundle being
+	 * dispatched.  Such an event is still considered to be
+	 * in the event queue, so it can be cancelled.
+	 * @return true if the event is pending in a bundle.
+	 */
+	inline bool inEventBundle() const;
+
+	/**
+	 * Set whether the event is pending in the bundle being
+	 * dispatched.
+	 * @param inEventBundle true if the event is in a bundle.
+	 */
+	inline void setInEventBundle(const bool inEventBundle);
+
+	/**
+	 * Set the order key of the event.
+	 * This can only be set by simulator, which is a
+	 * friend for this function.
+	 * @param orderKey the event's order key.
+	 * @see getOrderKey()
+	 */
+	inline void setOrderKey(t_ulong orderKey);
+
+};
+typedef boost::intrusive_ptr<Event> EventPtr;
+typedef boost::intrusive_ptr<Event const> ConstEventPtr;
+
+/**
+ * Events of the same type that fire at the same time and
+ * are next to each other in the event queue, which the
+ * simulator dispatches together.
+ * The events are executed in the same order as they would be
+ * one at a time.  An event of the bundle that has not been
+ * executed yet is still pending, so an earlier event of the
+ * bundle can cancel it, in which case next() skips it.
+ * @see Event::executeBundle()
+ */
+class EventBundle : boost::noncopyable {
+	// Only Simulator can fill the bundle.
+	friend class Simulator;
+	// The dispatcher splits the bundle between threads.
+	friend class BundleDispatcher;
+public:
+
+	/**
+	 * Get the next pending event of the bundle, which is
+	 * then no longer pending and should be executed.
+	 * @param event is set to the next event.
+	 * @return false if no events are left.
+	 */
+	inline bool next(EventPtr& event);
+
+	/**
+	 * Get the number of events that were put in the bundle.
+	 * @return the number of events.
+	 */
+	inline t_ulong size() const;
+
+private:
+
+	/// The events of the bundle.
+	vector<EventPtr> m_events;
+
+	/// The position of the next event to execute.
+	t_ulong m_nextIndex;
+
+	/// The position after the last event that next() gives,
+	/// which limits a thread to its part of the bundle.
+	t_ulong m_endIndex;
+
+	/// A constructor.
+	EventBundle();
+
+	/**
+	 * Add an event that was taken from the event queue.
+	 * @param event the event.
+	 */
+	inline void add(EventPtr event);
+
+	/**
+	 * Remove all the events.  Any that were not executed
+	 * are no longer pending.
+	 */
+	void clear();
+
 };
-typedef boost::shared_ptr<Event> EventPtr;
-typedef boost::shared_ptr<Event const> ConstEventPtr;
 
 /////////////////////////////////////////////////
 // Inline Functions
 /////////////////////////////////////////////////
 
+inline void* Event::operator new(size_t sizeInBytes)
+{
+	return EventPool::instance()->allocate(sizeInBytes);
+}
+
+inline void Event::operator delete(void* block, size_t sizeInBytes)
+{
+	EventPool::instance()->deallocate(block, sizeInBytes);
+}
+
+inline void intrusive_ptr_add_ref(const Event* event)
+{
+	event->m_referenceCount++;
+}
+
+inline void intrusive_ptr_release(const Event* event)
+{
+	assert(event->m_referenceCount > 0);
+	if(--event->m_referenceCount == 0) {
+		delete event;
+	}
+}
+
 inline void Event::setFireTime(const SimTime& newFireTime) 
 {
 	m_timeToFire = newFireTime;
@@ -114,6 +403,69 @@ inline void Event::setInEventQueue(const bool inEventQueue)
 	m_inEventQueue = inEventQueue;
 }
 
+inline bool Event::inEventBundle() const
+{
+	return m_inEventBundle;
+}
+
+inline void Event::setInEventBundle(const bool inEventBundle)
+{
+	m_inEventBundle = inEventBundle;
+}
+
+inline t_ulong Event::getSequenceNumber() const
+{
+	return (m_orderKey & ((1UL << m_SEQUENCE_NUMBER_BITS) - 1));
+}
+
+inline t_ulong Event::getOrderKey() const
+{
+	return m_orderKey;
+}
+
+inline t_ulong Event::makeOrderKey(t_uint priorityRank,
+	t_ulong sequenceNumber)
+{
+	assert(priorityRank < m_NUM_PRIORITY_RANKS);
+	assert(sequenceNumber < (1UL << m_SEQUENCE_NUMBER_BITS));
+	return ((static_cast<t_ulong>(priorityRank) << m_SEQUENCE_NUMBER_BITS) |
+		sequenceNumber);
+}
+
+inline void Event::setOrderKey(t_ulong orderKey)
+{
+	m_orderKey = orderKey;
+}
+
+inline bool EventBundle::next(EventPtr& event)
+{
+	while(m_nextIndex < m_endIndex) {
+		Event* nextEvent = m_events[m_nextIndex++].get();
+		// Skip the events that were cancelled.
+		if(nextEvent->inEventBundle()) {
+			nextEvent->setInEventBundle(false);
+			nextEvent->setInEventQueue(false);
+			event = nextEvent;
+			return true;
+		}
+	}
+	return false;
+}
+
+inline t_ulong EventBundle::size() const
+{
+	return m_events.size();
+}
+
+inline void EventBundle::add(EventPtr event)
+{
+	assert(event.get() != 0);
+	event->setInEventBundle(true);
+	event->setInEventQueue(true);
+	m_events.push_back(event);
+	m_endIndex = m_events.size();
+}
+
 /////////////////////////////////////////////////
 // Overloaded Operators
 /////////////////////////////////////////////////
@@ -141,7 +493,7 @@ inline ostream& operator<< (ostream& s, const Event& event)
 class DummyEvent : public Event {
 public:
 	/// Smart pointer that clients should use.
-	typedef boost::shared_ptr<DummyEvent> DummyEventPtr;
+	typedef boost::intrusive_ptr<DummyEvent> DummyEventPtr;
 
 	/**
 	 * A factory method to ensure that all objects
@@ -173,7 +525,58 @@ protected:
 	
 	}
 };
-typedef boost::shared_ptr<DummyEvent> DummyEventPtr;
+typedef boost::intrusive_ptr<DummyEvent> DummyEventPtr;
+
+/**
+ * An event that executes an arbitrary function object.
+ * This is used to deliver work from one partition of a
+ * ParallelSimulator to another.
+ */
+class ActionEvent : public Event {
+public:
+	/// Smart pointer that clients should use.
+	typedef boost::intrusive_ptr<ActionEvent> ActionEventPtr;
+
+	/// The function executed by the event.
+	typedef boost::function<void ()> Action;
+
+	/**
+	 * A factory method to ensure that all objects
+	 * are created via \c new since we are using smart pointers. 
+	 * @param action the function to execute.
+	 */
+	static inline ActionEventPtr create(const Action& action)
+	{
+		ActionEventPtr p(new ActionEvent(action));
+		return p;
+	}
+
+	/**
+	 * The code that gets executed for the event.
+	 * Calls the action.
+	 */
+	void execute()
+	{
+		m_action();
+	}
+
+protected:
+
+	/// A constructor.
+	/// @param action the function to execute.
+	ActionEvent(const Action& action) 
+		: Event(), m_action(action)
+	{
+		assert(!m_action.empty());
+	}
+
+private:
+
+	/// The function to execute.
+	Action m_action;
+
+};
+typedef boost::intrusive_ptr<ActionEvent> ActionEventPtr;
 
 #endif // EVENT_H
 
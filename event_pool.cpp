@@ -0,0 +1,72 @@
+
+#include <iomanip>
+
+#include "event_pool.hpp"
+
+thread_local EventPoolPtr EventPool::m_instance;
+
+EventPool::EventPool()
+	: m_chunkPosition(0), m_chunkBytesLeft(0), m_numAllocations(0),
+	m_numLiveEvents(0), m_numSystemAllocations(0)
+{
+	for(size_t i = 0; i < m_NUM_SIZE_CLASSES; ++i) {
+		m_freeLists[i] = 0;
+	}
+}
+
+EventPool::~EventPool()
+{
+	for(t_ulong i = 0; i < m_chunks.size(); ++i) {
+		delete [] m_chunks[i];
+	}
+}
+
+void* EventPool::allocateFromChunk(size_t sizeClass)
+{
+	size_t blockBytes = (sizeClass + 1) * m_SIZE_CLASS_BYTES;
+	if(m_chunkBytesLeft < blockBytes) {
+		// Whatever is left of the current chunk is too small
+		// for this size class, so give it to the free list
+		// of the largest class that fits.
+		if(m_chunkBytesLeft >= m_SIZE_CLASS_BYTES) {
+			size_t leftoverClass =
+				(m_chunkBytesLeft / m_SIZE_CLASS_BYTES) - 1;
+			FreeBlock* leftover =
+				reinterpret_cast<FreeBlock*>(m_chunkPosition);
+			leftover->m_next = m_freeLists[leftoverClass];
+			m_freeLists[leftoverClass] = leftover;
+		}
+		m_numSystemAllocations++;
+		char* chunk = new char[m_CHUNK_BYTES];
+		m_chunks.push_back(chunk);
+		m_chunkPosition = chunk;
+		m_chunkBytesLeft = m_CHUNK_BYTES;
+	}
+
+	void* block = m_chunkPosition;
+	m_chunkPosition += blockBytes;
+	m_chunkBytesLeft -= blockBytes;
+	return block;
+}
+
+void EventPool::printStats(ostream& s, double simulatedSeconds) const
+{
+	// Without the pool, each event took two system allocations:
+	// one for the object and one for the shared_ptr's
+	// reference count.
+	s << "Event allocation statistics:\n";
+	s << "  events allocated: " << m_numAllocations << "\n";
+	s << "  events still live: " << m_numLiveEvents << "\n";
+	s << "  system allocations: " << m_numSystemAllocations <<
+		" (" << (2 * m_numAllocations) << " without pooling)\n";
+	if(simulatedSeconds > 0.0) {
+		s << "  system allocations per simulated second: " <<
+			fixed << setprecision(1) <<
+			(m_numSystemAllocations / simulatedSeconds) << " (" <<
+			((2 * m_numAllocations) / simulatedSeconds) <<
+			" without pooling)\n";
+		s.unsetf(ios::fixed);
+		s << setprecision(6);
+	}
+}
+
@@ -0,0 +1,227 @@
+
+#ifndef EVENT_POOL_H
+#define EVENT_POOL_H
+
+#include <cstddef>
+#include <iostream>
+#include <vector>
+using namespace std;
+#include <boost/utility.hpp>
+
+#include "utility.hpp"
+
+/**
+ * A free-list allocator for Event objects.
+ * Events are small, short-lived, and created at a very high
+ * rate, so rather than going to the system allocator for each
+ * one, memory is carved out of large chunks and blocks are
+ * recycled through a free list per size class.  Objects that
+ * are larger than the largest size class are passed through
+ * to the system allocator.
+ *
+ * The pool also keeps counters of how many events were
+ * allocated and how many times the system allocator was
+ * called, which can be printed with printStats().
+ *
+ * There is one pool per thread so that simulators running
+ * on different threads do not contend for it.  An event may
+ * be released on a different thread than the one that
+ * allocated it (e.g., events scheduled while a ParallelSimulator
+ * is set up), in which case its block joins the releasing
+ * thread's pool.  Pools (and their chunks) are never freed, so
+ * this is safe, but the live event count of a single pool may
+ * then be off (or even negative); only the sum over all
+ * threads is meaningful.
+ */
+class EventPool : boost::noncopyable {
+public:
+	/// Pointer that clients should use.
+	typedef EventPool* EventPoolPtr;
+
+	/**
+	 * The class uses the Singleton design pattern with
+	 * one instance per thread.
+	 * @return pointer to the calling thread's EventPool.
+	 */
+	static inline EventPoolPtr instance();
+
+	/**
+	 * Get a block of memory for an event.
+	 * @param sizeInBytes the size of the event.
+	 * @return a pointer to the block.
+	 */
+	inline void* allocate(size_t sizeInBytes);
+
+	/**
+	 * Return a block of memory to the pool.
+	 * @param block the block previously returned by allocate().
+	 * @param sizeInBytes the size passed to allocate().
+	 */
+	inline void deallocate(void* block, size_t sizeInBytes);
+
+	/**
+	 * Get the number of events that have been allocated.
+	 * @return the number of calls to allocate().
+	 */
+	inline t_ulong getNumAllocations() const;
+
+	/**
+	 * Get the number of events allocated by this pool's thread
+	 * less the number released by it.
+	 * @return the number of live events.
+	 */
+	inline long getNumLiveEvents() const;
+
+	/**
+	 * Get the number of times the system allocator was called,
+	 * either for a new chunk or for an event too large for
+	 * the pool.
+	 * @return the number of system allocations.
+	 */
+	inline t_ulong getNumSystemAllocations() const;
+
+	/**
+	 * Print the pool's counters.
+	 * @param s the stream to print to.
+	 * @param simulatedSeconds if positive, the counters are
+	 * also given per simulated second.
+	 */
+	void printStats(ostream& s, double simulatedSeconds) const;
+
+private:
+
+	/// A block on a free list.
+	struct FreeBlock {
+		/// The next block on the list.
+		FreeBlock* m_next;
+	};
+
+	/// The granularity of the size classes in bytes.
+	static const size_t m_SIZE_CLASS_BYTES = 16;
+
+	/// The number of size classes.  Larger objects
+	/// bypass the pool.
+	static const size_t m_NUM_SIZE_CLASSES = 16;
+
+	/// The size of each chunk obtained from the system.
+	static const size_t m_CHUNK_BYTES = 64 * 1024;
+
+	/// The pool of each thread.
+	/// @see instance()
+	static thread_local EventPoolPtr m_instance;
+
+	/// The free list of each size class.
+	FreeBlock* m_freeLists[m_NUM_SIZE_CLASSES];
+
+	/// The chunks obtained from the system.
+	vector<char*> m_chunks;
+
+	/// The next unused byte of the current chunk.
+	char* m_chunkPosition;
+
+	/// The number of unused bytes left in the current chunk.
+	size_t m_chunkBytesLeft;
+
+	/// @see getNumAllocations()
+	t_ulong m_numAllocations;
+
+	/// @see getNumLiveEvents()
+	long m_numLiveEvents;
+
+	/// @see getNumSystemAllocations()
+	t_ulong m_numSystemAllocations;
+
+	/// A constructor.
+	EventPool();
+
+	/// A destructor.
+	/// This is private since the class is a Singleton.
+	~EventPool();
+
+	/**
+	 * Get the size class for an object size.
+	 * @param sizeInBytes the object size.
+	 * @return the index of the size class.
+	 */
+	inline size_t sizeClassOf(size_t sizeInBytes) const;
+
+	/**
+	 * Carve a new block out of the current chunk, getting
+	 * a new chunk from the system if necessary.
+	 * @param sizeClass the size class of the block.
+	 * @return a pointer to the block.
+	 */
+	void* allocateFromChunk(size_t sizeClass);
+
+};
+typedef EventPool* EventPoolPtr;
+
+/////////////////////////////////////////////////
+// Inline Functions
+/////////////////////////////////////////////////
+
+inline EventPoolPtr EventPool::instance()
+{
+	// See the Singleton design pattern for an explanation.
+	if(m_instance == 0) {
+		m_instance = new EventPool();
+	}
+	return m_instance;
+}
+
+inline size_t EventPool::sizeClassOf(size_t sizeInBytes) const
+{
+	return ((sizeInBytes + m_SIZE_CLASS_BYTES - 1) / m_SIZE_CLASS_BYTES) - 1;
+}
+
+inline void* EventPool::allocate(size_t sizeInBytes)
+{
+	m_numAllocations++;
+	m_numLiveEvents++;
+
+	size_t sizeClass = sizeClassOf(sizeInBytes);
+	if(sizeClass >= m_NUM_SIZE_CLASSES) {
+		m_numSystemAllocations++;
+		return ::operator new(sizeInBytes);
+	}
+
+	FreeBlock* block = m_freeLists[sizeClass];
+	if(block != 0) {
+		m_freeLists[sizeClass] = block->m_next;
+		return block;
+	}
+	return allocateFromChunk(sizeClass);
+}
+
+inline void EventPool::deallocate(void* block, size_t sizeInBytes)
+{
+	m_numLiveEvents--;
+
+	size_t sizeClass = sizeClassOf(sizeInBytes);
+	if(sizeClass >= m_NUM_SIZE_CLASSES) {
+		::operator delete(block);
+		return;
+	}
+
+	FreeBlock* freeBlock = static_cast<FreeBlock*>(block);
+	freeBlock->m_next = m_freeLists[sizeClass];
+	m_freeLists[sizeClass] = freeBlock;
+}
+
+inline t_ulong EventPool::getNumAllocations() const
+{
+	return m_numAllocations;
+}
+
+inline long EventPool::getNumLiveEvents() const
+{
+	return m_numLiveEvents;
+}
+
+inline t_ulong EventPool::getNumSystemAllocations() const
+{
+	return m_numSystemAllocations;
+}
+
+#endif // EVENT_POOL_H
+
@@ -0,0 +1,130 @@
+
+#ifdef RFIDSIM_PROFILING
+
+#include <iomanip>
+#include <algorithm>
+#include <boost/core/demangle.hpp>
+
+#include "event_profiler.hpp"
+#include "simulator.hpp"
+
+/**
+ * Orders event type counters by decreasing time.
+ */
+struct EventTypeTicksGreater {
+	/// @return true if \c lhs took more time than \c rhs.
+	template<class T>
+	bool operator() (const T& lhs, const T& rhs) const
+	{
+		return lhs.m_ticks > rhs.m_ticks;
+	}
+};
+
+EventProfiler::EventProfiler(ostreamPtr outputStream)
+	: m_lastEventTypeIndex(0), m_maxQueueDepth(0), m_startTicks(0),
+	m_ticksPerSecond(0.0), m_elapsedSeconds(0.0),
+	m_outputStream(outputStream)
+{
+	start();
+}
+
+EventProfilerPtr EventProfiler::create(SimulatorPtr simulator,
+	ostreamPtr outputStream)
+{
+	assert(simulator != 0);
+	EventProfilerPtr p(new EventProfiler(outputStream));
+	simulator->setEventProfiler(p);
+	simulator->addSimulationEndListener(p);
+	return p;
+}
+
+void EventProfiler::start()
+{
+	m_startTime = boost::posix_time::microsec_clock::universal_time();
+	m_startTicks = readTicks();
+}
+
+t_uint EventProfiler::addEventType(const type_info& eventType)
+{
+	EventTypeStats stats;
+	stats.m_eventType = &eventType;
+	stats.m_numDispatches = 0;
+	stats.m_ticks = 0;
+	m_eventTypeStats.push_back(stats);
+	return m_eventTypeStats.size() - 1;
+}
+
+t_ulong EventProfiler::getNumDispatches() const
+{
+	t_ulong numDispatches = 0;
+	for(t_uint i = 0; i < m_eventTypeStats.size(); ++i) {
+		numDispatches += m_eventTypeStats[i].m_numDispatches;
+	}
+	return numDispatches;
+}
+
+void EventProfiler::simulationEndHandler()
+{
+	t_ulong elapsedTicks = readTicks() - m_startTicks;
+	boost::posix_time::time_duration elapsed =
+		boost::posix_time::microsec_clock::universal_time() - m_startTime;
+	m_elapsedSeconds = elapsed.total_microseconds() / 1e6;
+	if(m_elapsedSeconds > 0.0) {
+		m_ticksPerSecond = elapsedTicks / m_elapsedSeconds;
+	}
+
+	if(m_outputStream.get() != 0) {
+		printStats(*m_outputStream);
+	}
+}
+
+void EventProfiler::printStats(ostream& s) const
+{
+	vector<EventTypeStats> eventTypeStats = m_eventTypeStats;
+	sort(eventTypeStats.begin(), eventTypeStats.end(),
+		EventTypeTicksGreater());
+
+	t_ulong numDispatches = getNumDispatches();
+	t_ulong totalTicks = 0;
+	for(t_uint i = 0; i < eventTypeStats.size(); ++i) {
+		totalTicks += eventTypeStats[i].m_ticks;
+	}
+
+	s << "Event profile:\n";
+	s << "  events dispatched: " << numDispatches << "\n";
+	s << "  event queue high-water mark: " << m_maxQueueDepth << "\n";
+	if(m_elapsedSeconds > 0.0) {
+		s << fixed << setprecision(3);
+		s << "  wall-clock seconds: " << m_elapsedSeconds << "\n";
+		s << setprecision(1);
+		s << "  events per second: " <<
+			(numDispatches / m_elapsedSeconds) << "\n";
+		s << "  ticks per second: " << m_ticksPerSecond << "\n";
+	}
+
+	s << "  " << left << setw(28) << "event type" << right <<
+		setw(12) << "dispatches" << setw(8) << "%" <<
+		setw(14) << "seconds" << setw(8) << "%" <<
+		setw(12) << "ns/event" << "\n";
+	for(t_uint i = 0; i < eventTypeStats.size(); ++i) {
+		const EventTypeStats& stats = eventTypeStats[i];
+		double seconds = 0.0;
+		if(m_ticksPerSecond > 0.0) {
+			seconds = stats.m_ticks / m_ticksPerSecond;
+		}
+		s << "  " << left << setw(28) <<
+			boost::core::demangle(stats.m_eventType->name()) << right <<
+			setw(12) << stats.m_numDispatches << fixed << setprecision(1) <<
+			setw(8) << (100.0 * stats.m_numDispatches /
+				max(numDispatches, 1UL)) <<
+			setprecision(6) << setw(14) << seconds << setprecision(1) <<
+			setw(8) << (100.0 * stats.m_ticks / max(totalTicks, 1UL)) <<
+			setw(12) << (1e9 * seconds / max(stats.m_numDispatches, 1UL)) <<
+			"\n";
+	}
+	s.unsetf(ios::fixed);
+	s << setprecision(6);
+}
+
+#endif // RFIDSIM_PROFILING
+
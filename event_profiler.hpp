@@ -0,0 +1,214 @@
+
+#ifndef EVENT_PROFILER_H
+#define EVENT_PROFILER_H
+
+// The profiler is only compiled in when RFIDSIM_PROFILING is
+// defined so that the simulator's dispatch loop is untouched
+// otherwise.
+#ifdef RFIDSIM_PROFILING
+
+#include <iostream>
+#include <vector>
+#include <typeinfo>
+using namespace std;
+#include <boost/shared_ptr.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#else
+#include <ctime>
+#endif
+
+#include "utility.hpp"
+#include "simulation_end_listener.hpp"
+
+class Simulator;
+typedef Simulator* SimulatorPtr;
+
+/////////////////////////////////////////////////
+// EventProfiler Class
+/////////////////////////////////////////////////
+
+/**
+ * Profiles the events dispatched by a simulator.
+ * For each concrete event type, the profiler counts the
+ * dispatches and accumulates the time spent executing them,
+ * measured with the CPU's time stamp counter.  It also keeps
+ * the high-water mark of the event queue and the overall rate
+ * of events per second of wall-clock time.  The report is
+ * printed when the simulation ends.
+ *
+ * The profiler only exists when the code is compiled with
+ * \c RFIDSIM_PROFILING defined.  It is then enabled for a
+ * simulator by creating one for it.
+ * @see Simulator::setEventProfiler()
+ */
+class EventProfiler : public SimulationEndListener {
+public:
+	/// Smart pointer that clients should use.
+	typedef boost::shared_ptr<EventProfiler> EventProfilerPtr;
+
+	/**
+	 * A factory method to ensure that all objects
+	 * are created via \c new since we are using smart pointers.
+	 * The profiler attaches itself to the simulator.
+	 * @param simulator the simulator whose events are profiled.
+	 * @param outputStream the stream to which the report is
+	 * printed when the simulation ends.
+	 */
+	static EventProfilerPtr create(SimulatorPtr simulator,
+		ostreamPtr outputStream);
+
+	/**
+	 * Read the time stamp counter.
+	 * @return the current number of ticks.
+	 */
+	static inline t_ulong readTicks();
+
+	/**
+	 * Start measuring the wall-clock time of the run.
+	 * This is called when the simulation starts running.
+	 */
+	void start();
+
+	/**
+	 * Record the dispatch of an event.
+	 * @param eventType the concrete type of the event.
+	 * @param ticks the number of ticks spent executing it.
+	 * @param queueDepth the number of events that were pending,
+	 * including this one, when it was dispatched.
+	 * @param numEvents the number of events dispatched
+	 * together as a bundle.
+	 */
+	inline void recordDispatch(const type_info& eventType, t_ulong ticks,
+		t_ulong queueDepth, t_ulong numEvents = 1);
+
+	/**
+	 * Get the total number of events dispatched.
+	 * @return the number of dispatches.
+	 */
+	t_ulong getNumDispatches() const;
+
+	/**
+	 * Get the largest number of events that were pending
+	 * when an event was dispatched.
+	 * @return the high-water mark of the event queue.
+	 */
+	inline t_ulong getMaxQueueDepth() const;
+
+	/**
+	 * The function called when the simulation ends, which
+	 * prints the report.
+	 */
+	virtual void simulationEndHandler();
+
+	/**
+	 * Print the profile, with the event types in decreasing
+	 * order of the time spent in them.
+	 * @param s the stream to print to.
+	 */
+	void printStats(ostream& s) const;
+
+private:
+
+	/// The counters of one event type.
+	struct EventTypeStats {
+		/// The event type.
+		const type_info* m_eventType;
+
+		/// The number of events of the type dispatched.
+		t_ulong m_numDispatches;
+
+		/// The ticks spent executing them.
+		t_ulong m_ticks;
+	};
+
+	/// The counters of each event type in the order in which
+	/// the types were first dispatched.  There are only a few
+	/// types, so they are searched linearly.
+	vector<EventTypeStats> m_eventTypeStats;
+
+	/// The index in m_eventTypeStats of the last type
+	/// dispatched, which is checked first.
+	t_uint m_lastEventTypeIndex;
+
+	/// @see getMaxQueueDepth()
+	t_ulong m_maxQueueDepth;
+
+	/// The time stamp counter when the run started.
+	t_ulong m_startTicks;
+
+	/// The wall-clock time when the run started.
+	boost::posix_time::ptime m_startTime;
+
+	/// The number of ticks per second of wall-clock time,
+	/// which is measured over the run.
+	double m_ticksPerSecond;
+
+	/// The wall-clock time of the run in seconds.
+	double m_elapsedSeconds;
+
+	/// The stream to which the report is printed.
+	ostreamPtr m_outputStream;
+
+	/// A constructor.
+	/// @param outputStream the stream for the report.
+	EventProfiler(ostreamPtr outputStream);
+
+	/**
+	 * Add the counters for a new event type.
+	 * @param eventType the event type.
+	 * @return the index of its counters.
+	 */
+	t_uint addEventType(const type_info& eventType);
+
+};
+typedef boost::shared_ptr<EventProfiler> EventProfilerPtr;
+
+/////////////////////////////////////////////////
+// Inline Functions
+/////////////////////////////////////////////////
+
+inline t_ulong EventProfiler::readTicks()
+{
+#if defined(__i386__) || defined(__x86_64__)
+	return __rdtsc();
+#else
+	return clock();
+#endif
+}
+
+inline void EventProfiler::recordDispatch(const type_info& eventType,
+	t_ulong ticks, t_ulong queueDepth, t_ulong numEvents)
+{
+	t_uint index = m_lastEventTypeIndex;
+	if(index >= m_eventTypeStats.size() ||
+			*m_eventTypeStats[index].m_eventType != eventType) {
+		index = 0;
+		while(index < m_eventTypeStats.size() &&
+				*m_eventTypeStats[index].m_eventType != eventType) {
+			++index;
+		}
+		if(index == m_eventTypeStats.size()) {
+			index = addEventType(eventType);
+		}
+		m_lastEventTypeIndex = index;
+	}
+
+	EventTypeStats& stats = m_eventTypeStats[index];
+	stats.m_numDispatches += numEvents;
+	stats.m_ticks += ticks;
+	if(queueDepth > m_maxQueueDepth) {
+		m_maxQueueDepth = queueDepth;
+	}
+}
+
+inline t_ulong EventProfiler::getMaxQueueDepth() const
+{
+	return m_maxQueueDepth;
+}
+
+#endif // RFIDSIM_PROFILING
+
+#endif // EVENT_PROFILER_H
+
@@ -0,0 +1,872 @@
+
+#include <algorithm>
+
+#include "event_queue.hpp"
+
+/////////////////////////////////////////////////
+// EventQueueEntry Class
+/////////////////////////////////////////////////
+
+EventQueueEntry::EventQueueEntry()
+	: m_timeKey(0), m_orderKey(0)
+{
+
+}
+
+EventQueueEntry::EventQueueEntry(EventPtr event)
+	: m_timeKey(event->getFireTime().getOrderingKey()),
+	m_orderKey(event->getOrderKey()), m_event(event)
+{
+
+}
+
+/////////////////////////////////////////////////
+// EventQueue Class
+/////////////////////////////////////////////////
+
+EventQueue::EventQueue()
+{
+
+}
+
+EventQueue::~EventQueue()
+{
+
+}
+
+EventQueuePtr EventQueue::create(QueueTypes queueType)
+{
+	EventQueuePtr eventQueue;
+	switch(queueType) {
+	case QueueTypes_Multiset:
+		eventQueue = MultisetEventQueue::create();
+		break;
+	case QueueTypes_Heap:
+		eventQueue = HeapEventQueue::create();
+		break;
+	case QueueTypes_Calendar:
+		eventQueue = CalendarEventQueue::create();
+		break;
+	default:
+		assert(false);
+	}
+	return eventQueue;
+}
+
+bool EventQueue::parseQueueType(const string& name, QueueTypes& queueType)
+{
+	bool isValid = true;
+	if(name == "multiset") {
+		queueType = QueueTypes_Multiset;
+	} else if(name == "heap") {
+		queueType = QueueTypes_Heap;
+	} else if(name == "calendar") {
+		queueType = QueueTypes_Calendar;
+	} else {
+		isValid = false;
+	}
+	return isValid;
+}
+
+string EventQueue::queueTypeName(QueueTypes queueType)
+{
+	string name;
+	switch(queueType) {
+	case QueueTypes_Multiset:
+		name = "multiset";
+		break;
+	case QueueTypes_Heap:
+		name = "heap";
+		break;
+	case QueueTypes_Calendar:
+		name = "calendar";
+		break;
+	default:
+		assert(false);
+	}
+	return name;
+}
+
+void EventQueue::insertTimer(EventPtr event)
+{
+	insert(event);
+}
+
+void EventQueue::setHorizon(const SimTime& horizon)
+{
+
+}
+
+/////////////////////////////////////////////////
+// MultisetEventQueue Class
+/////////////////////////////////////////////////
+
+MultisetEventQueue::MultisetEventQueue()
+	: EventQueue()
+{
+
+}
+
+EventQueue::QueueTypes MultisetEventQueue::getQueueType() const
+{
+	return QueueTypes_Multiset;
+}
+
+void MultisetEventQueue::insert(EventPtr event)
+{
+	m_events.insert(EventQueueEntry(event));
+}
+
+bool MultisetEventQueue::remove(EventPtr event)
+{
+	// The key is unique, so find() locates the event
+	// without scanning the other events that have the
+	// same fire time.
+	multiset<EventQueueEntry>::iterator entryIterator =
+		m_events.find(EventQueueEntry(event));
+
+	bool didErase = false;
+	if(entryIterator != m_events.end() &&
+			entryIterator->m_event == event) {
+		m_events.erase(entryIterator);
+		didErase = true;
+	}
+
+	return didErase;
+}
+
+EventPtr MultisetEventQueue::top()
+{
+	assert(!m_events.empty());
+	return m_events.begin()->m_event;
+}
+
+EventPtr MultisetEventQueue::pop()
+{
+	assert(!m_events.empty());
+	EventPtr nextEvent(m_events.begin()->m_event);
+	m_events.erase(m_events.begin());
+	return nextEvent;
+}
+
+bool MultisetEventQueue::empty() const
+{
+	return m_events.empty();
+}
+
+t_ulong MultisetEventQueue::size() const
+{
+	return m_events.size();
+}
+
+void MultisetEventQueue::clear()
+{
+	m_events.clear();
+}
+
+void MultisetEventQueue::getEntries(vector<EventQueueEntry>& entries) const
+{
+	entries.insert(entries.end(), m_events.begin(), m_events.end());
+}
+
+/////////////////////////////////////////////////
+// HeapEventQueue Class
+/////////////////////////////////////////////////
+
+const t_ulong HeapEventQueue::m_ARITY = 4;
+
+HeapEventQueue::HeapEventQueue()
+	: EventQueue()
+{
+
+}
+
+EventQueue::QueueTypes HeapEventQueue::getQueueType() const
+{
+	return QueueTypes_Heap;
+}
+
+void HeapEventQueue::insert(EventPtr event)
+{
+	m_heap.push_back(EventQueueEntry(event));
+	siftUp(m_heap.size() - 1);
+}
+
+bool HeapEventQueue::remove(EventPtr event)
+{
+	t_ulong index = getQueueHandle(*event);
+
+	bool didErase = false;
+	if(index < m_heap.size() && m_heap[index].m_event == event) {
+		removeAt(index);
+		didErase = true;
+	}
+	return didErase;
+}
+
+EventPtr HeapEventQueue::top()
+{
+	assert(!m_heap.empty());
+	return m_heap[0].m_event;
+}
+
+EventPtr HeapEventQueue::pop()
+{
+	assert(!m_heap.empty());
+	EventPtr nextEvent = m_heap[0].m_event;
+	removeAt(0);
+	return nextEvent;
+}
+
+bool HeapEventQueue::empty() const
+{
+	return m_heap.empty();
+}
+
+t_ulong HeapEventQueue::size() const
+{
+	return m_heap.size();
+}
+
+void HeapEventQueue::clear()
+{
+	m_heap.clear();
+}
+
+void HeapEventQueue::getEntries(vector<EventQueueEntry>& entries) const
+{
+	entries.insert(entries.end(), m_heap.begin(), m_heap.end());
+}
+
+void HeapEventQueue::removeAt(t_ulong index)
+{
+	assert(index < m_heap.size());
+	t_ulong lastIndex = m_heap.size() - 1;
+	if(index != lastIndex) {
+		place(index, m_heap[lastIndex]);
+		m_heap.pop_back();
+		// The entry moved from the end may belong either
+		// above or below its new position.
+		if(index > 0 && m_heap[index] < m_heap[(index - 1) / m_ARITY]) {
+			siftUp(index);
+		} else {
+			siftDown(index);
+		}
+	} else {
+		m_heap.pop_back();
+	}
+}
+
+void HeapEventQueue::siftUp(t_ulong index)
+{
+	EventQueueEntry entry = m_heap[index];
+	while(index > 0) {
+		t_ulong parentIndex = (index - 1) / m_ARITY;
+		if(!(entry < m_heap[parentIndex])) {
+			break;
+		}
+		place(index, m_heap[parentIndex]);
+		index = parentIndex;
+	}
+	place(index, entry);
+}
+
+void HeapEventQueue::siftDown(t_ulong index)
+{
+	t_ulong heapSize = m_heap.size();
+	EventQueueEntry entry = m_heap[index];
+	while(true) {
+		t_ulong firstChild = (index * m_ARITY) + 1;
+		if(firstChild >= heapSize) {
+			break;
+		}
+		t_ulong lastChild = min(firstChild + m_ARITY, heapSize);
+		t_ulong minChild = firstChild;
+		for(t_ulong child = firstChild + 1; child < lastChild; ++child) {
+			if(m_heap[child] < m_heap[minChild]) {
+				minChild = child;
+			}
+		}
+		if(!(m_heap[minChild] < entry)) {
+			break;
+		}
+		place(index, m_heap[minChild]);
+		index = minChild;
+	}
+	place(index, entry);
+}
+
+/////////////////////////////////////////////////
+// CalendarEventQueue Class
+/////////////////////////////////////////////////
+
+const t_ulong CalendarEventQueue::m_MIN_NUM_BUCKETS = 16;
+const double CalendarEventQueue::m_DEFAULT_BUCKET_WIDTH = 1e-3;
+const t_ulong CalendarEventQueue::m_MAX_WIDTH_SAMPLES = 32;
+
+CalendarEventQueue::CalendarEventQueue()
+	: EventQueue(), m_buckets(m_MIN_NUM_BUCKETS),
+	m_bucketWidth(m_DEFAULT_BUCKET_WIDTH), m_currentDay(0), m_size(0)
+{
+
+}
+
+EventQueue::QueueTypes CalendarEventQueue::getQueueType() const
+{
+	return QueueTypes_Calendar;
+}
+
+void CalendarEventQueue::insert(EventPtr event)
+{
+	EventQueueEntry entry(event);
+	t_ulong day = dayOf(entry.getFireTime());
+	// An event may be scheduled before the first event
+	// that was last looked up with top().
+	if(day < m_currentDay) {
+		m_currentDay = day;
+	}
+
+	// Events are usually scheduled later than everything
+	// else in their bucket, so check the back first.
+	Bucket& bucket = m_buckets[bucketOf(day)];
+	if(bucket.empty() || bucket.back() < entry) {
+		bucket.push_back(entry);
+	} else {
+		bucket.insert(upper_bound(bucket.begin(), bucket.end(), entry),
+			entry);
+	}
+	m_size++;
+
+	if(m_size > (2 * m_buckets.size())) {
+		resize(2 * m_buckets.size());
+	}
+}
+
+bool CalendarEventQueue::remove(EventPtr event)
+{
+	EventQueueEntry entry(event);
+	Bucket& bucket = m_buckets[bucketOf(dayOf(entry.getFireTime()))];
+
+	// The (fire time, sequence number) key is unique, so
+	// a binary search finds the event directly.
+	Bucket::iterator entryIterator =
+		lower_bound(bucket.begin(), bucket.end(), entry);
+
+	// Rather than shifting the rest of the bucket, leave
+	// a tombstone in place of the event.
+	bool didErase = false;
+	if(entryIterator != bucket.end() && entryIterator->m_event == event) {
+		entryIterator->m_event.reset();
+		m_size--;
+		didErase = true;
+		popTombstones(bucket);
+	}
+
+	return didErase;
+}
+
+EventPtr CalendarEventQueue::top()
+{
+	assert(m_size > 0);
+	return m_buckets[findFirstBucket()].front().m_event;
+}
+
+EventPtr CalendarEventQueue::pop()
+{
+	assert(m_size > 0);
+	Bucket& bucket = m_buckets[findFirstBucket()];
+	EventPtr nextEvent = bucket.front().m_event;
+	bucket.pop_front();
+	m_size--;
+	popTombstones(bucket);
+
+	if(m_buckets.size() > m_MIN_NUM_BUCKETS &&
+			m_size < (m_buckets.size() / 2)) {
+		resize(m_buckets.size() / 2);
+	}
+
+	return nextEvent;
+}
+
+bool CalendarEventQueue::empty() const
+{
+	return (m_size == 0);
+}
+
+t_ulong CalendarEventQueue::size() const
+{
+	return m_size;
+}
+
+void CalendarEventQueue::clear()
+{
+	m_buckets.assign(m_MIN_NUM_BUCKETS, Bucket());
+	m_bucketWidth = m_DEFAULT_BUCKET_WIDTH;
+	m_currentDay = 0;
+	m_size = 0;
+}
+
+void CalendarEventQueue::getEntries(vector<EventQueueEntry>& entries) const
+{
+	for(t_ulong i = 0; i < m_buckets.size(); ++i) {
+		const Bucket& bucket = m_buckets[i];
+		for(Bucket::const_iterator p = bucket.begin(); p != bucket.end();
+				++p) {
+			// Skip the tombstones of cancelled events.
+			if(p->m_event != 0) {
+				entries.push_back(*p);
+			}
+		}
+	}
+}
+
+t_ulong CalendarEventQueue::findFirstBucket()
+{
+	assert(m_size > 0);
+
+	// Walk through one year of days starting at the current
+	// day.  Since no event falls before the current day, the
+	// first bucket whose earliest event falls on the day
+	// being checked holds the first event.
+	t_ulong numBuckets = m_buckets.size();
+	for(t_ulong i = 0; i < numBuckets; ++i) {
+		t_ulong day = m_currentDay + i;
+		t_ulong bucketIndex = bucketOf(day);
+		const Bucket& bucket = m_buckets[bucketIndex];
+		if(!bucket.empty() && dayOf(bucket.front().getFireTime()) <= day) {
+			m_currentDay = day;
+			return bucketIndex;
+		}
+	}
+
+	// The next event is more than a year away, so fall back
+	// to a direct search of the earliest event in each bucket.
+	t_ulong firstBucketIndex = numBuckets;
+	for(t_ulong i = 0; i < numBuckets; ++i) {
+		const Bucket& bucket = m_buckets[i];
+		if(!bucket.empty() && (firstBucketIndex == numBuckets ||
+				bucket.front() < m_buckets[firstBucketIndex].front())) {
+			firstBucketIndex = i;
+		}
+	}
+	assert(firstBucketIndex < numBuckets);
+	m_currentDay = dayOf(m_buckets[firstBucketIndex].front().getFireTime());
+	return firstBucketIndex;
+}
+
+void CalendarEventQueue::resize(t_ulong numBuckets)
+{
+	vector<EventQueueEntry> entries;
+	entries.reserve(m_size);
+	for(t_ulong i = 0; i < m_buckets.size(); ++i) {
+		for(Bucket::const_iterator entryIterator = m_buckets[i].begin();
+				entryIterator != m_buckets[i].end(); ++entryIterator) {
+			if(entryIterator->m_event != 0) {
+				entries.push_back(*entryIterator);
+			}
+		}
+	}
+	sort(entries.begin(), entries.end());
+
+	// Estimate the width of a day from the average separation
+	// between the earliest distinct fire times, ignoring
+	// separations that are much larger than the average.
+	vector<double> separations;
+	for(t_ulong i = 1; i < entries.size() &&
+			separations.size() < m_MAX_WIDTH_SAMPLES; ++i) {
+		double separation = entries[i].getFireTime().getTimeInSeconds() -
+			entries[i - 1].getFireTime().getTimeInSeconds();
+		if(separation > 0.0) {
+			separations.push_back(separation);
+		}
+	}
+	if(!separations.empty()) {
+		double totalSeparation = 0.0;
+		for(t_ulong i = 0; i < separations.size(); ++i) {
+			totalSeparation += separations[i];
+		}
+		double averageSeparation = totalSeparation / separations.size();
+
+		double totalTypicalSeparation = 0.0;
+		t_ulong numTypicalSeparations = 0;
+		for(t_ulong i = 0; i < separations.size(); ++i) {
+			if(separations[i] <= (2.0 * averageSeparation)) {
+				totalTypicalSeparation += separations[i];
+				numTypicalSeparations++;
+			}
+		}
+		assert(numTypicalSeparations > 0);
+		m_bucketWidth = 3.0 *
+			(totalTypicalSeparation / numTypicalSeparations);
+	}
+
+	m_buckets.assign(numBuckets, Bucket());
+	// Since the entries are sorted, appending them keeps
+	// each bucket sorted.
+	for(t_ulong i = 0; i < entries.size(); ++i) {
+		m_buckets[bucketOf(dayOf(entries[i].getFireTime()))].push_back(
+			entries[i]);
+	}
+	if(!entries.empty()) {
+		m_currentDay = dayOf(entries[0].getFireTime());
+	} else {
+		m_currentDay = 0;
+	}
+}
+
+
+/////////////////////////////////////////////////
+// TimerWheelEventQueue Class
+/////////////////////////////////////////////////
+
+const double TimerWheelEventQueue::m_DEFAULT_TICK_TIME = 1e-4;
+
+TimerWheelEventQueue::TimerWheelEventQueue(EventQueuePtr eventQueue,
+	double tickTime)
+	: EventQueue(), m_eventQueue(eventQueue), m_tickTime(tickTime),
+	m_nonEmptySlots(0), m_currentTick(0), m_size(0)
+{
+	assert(m_eventQueue.get() != 0);
+	assert(m_eventQueue->empty());
+	assert(m_tickTime > 0.0);
+}
+
+EventQueue::QueueTypes TimerWheelEventQueue::getQueueType() const
+{
+	return m_eventQueue->getQueueType();
+}
+
+void TimerWheelEventQueue::insert(EventPtr event)
+{
+	m_eventQueue->insert(event);
+}
+
+void TimerWheelEventQueue::insertTimer(EventPtr event)
+{
+	if(!place(event)) {
+		m_eventQueue->insert(event);
+	}
+}
+
+bool TimerWheelEventQueue::remove(EventPtr event)
+{
+	t_ulong handle = getQueueHandle(*event);
+	if((handle & m_IN_WHEEL_HANDLE_BIT) == 0) {
+		return m_eventQueue->remove(event);
+	}
+
+	t_uint level = static_cast<t_uint>((handle >> 40) & 0xff);
+	t_uint slot = static_cast<t_uint>((handle >> 32) & 0xff);
+	t_ulong index = (handle & 0xffffffffUL);
+	assert(level < m_NUM_LEVELS && slot < m_NUM_SLOTS);
+
+	bool didErase = false;
+	Slot& events = m_slots[level][slot];
+	if(index < events.size() && events[index] == event) {
+		removeAt(level, slot, index);
+		didErase = true;
+	}
+	return didErase;
+}
+
+EventPtr TimerWheelEventQueue::top()
+{
+	moveDueEvents();
+	return m_eventQueue->top();
+}
+
+EventPtr TimerWheelEventQueue::pop()
+{
+	moveDueEvents();
+	return m_eventQueue->pop();
+}
+
+bool TimerWheelEventQueue::empty() const
+{
+	return (m_size == 0 && m_eventQueue->empty());
+}
+
+t_ulong TimerWheelEventQueue::size() const
+{
+	return (m_size + m_eventQueue->size());
+}
+
+void TimerWheelEventQueue::clear()
+{
+	for(t_uint level = 0; level < m_NUM_LEVELS; ++level) {
+		for(t_uint slot = 0; slot < m_NUM_SLOTS; ++slot) {
+			Slot& events = m_slots[level][slot];
+			for(t_ulong i = 0; i < events.size(); ++i) {
+				setQueueHandle(*events[i], 0);
+			}
+			events.clear();
+		}
+	}
+	m_nonEmptySlots = 0;
+	m_currentTick = 0;
+	m_size = 0;
+	m_eventQueue->clear();
+}
+
+void TimerWheelEventQueue::getEntries(vector<EventQueueEntry>& entries) const
+{
+	m_eventQueue->getEntries(entries);
+	for(t_uint level = 0; level < m_NUM_LEVELS; ++level) {
+		for(t_uint slot = 0; slot < m_NUM_SLOTS; ++slot) {
+			const Slot& events = m_slots[level][slot];
+			for(t_ulong i = 0; i < events.size(); ++i) {
+				entries.push_back(EventQueueEntry(events[i]));
+			}
+		}
+	}
+}
+
+bool TimerWheelEventQueue::place(EventPtr event)
+{
+	t_ulong tick = tickOf(event->getFireTime());
+	if(tick < m_currentTick) {
+		if(m_size > 0) {
+			return false;
+		}
+		// An empty wheel can start over from any tick
+		// (e.g., after the simulator is reset or restored).
+		m_currentTick = tick;
+	}
+
+	// Each level holds the events that fire before the
+	// whole level below it comes around again.
+	t_ulong ticksAhead = tick - m_currentTick;
+	t_uint level = 0;
+	while(level < m_NUM_LEVELS &&
+			(ticksAhead >> (m_SLOT_BITS * (level + 1))) != 0) {
+		level++;
+	}
+	if(level == m_NUM_LEVELS) {
+		return false;
+	}
+
+	t_uint slot = static_cast<t_uint>(
+		(tick >> (m_SLOT_BITS * level)) & m_SLOT_MASK);
+	Slot& events = m_slots[level][slot];
+	setQueueHandle(*event, wheelHandle(level, slot, events.size()));
+	events.push_back(event);
+	if(level == 0) {
+		m_nonEmptySlots |= (1UL << slot);
+	}
+	m_size++;
+	return true;
+}
+
+void TimerWheelEventQueue::removeAt(t_uint level, t_uint slot,
+	t_ulong index)
+{
+	Slot& events = m_slots[level][slot];
+	assert(index < events.size());
+	setQueueHandle(*events[index], 0);
+	// Fill the hole with the last event of the slot.
+	if((index + 1) < events.size()) {
+		events[index] = events.back();
+		setQueueHandle(*events[index], wheelHandle(level, slot, index));
+	}
+	events.pop_back();
+	if(level == 0 && events.empty()) {
+		m_nonEmptySlots &= ~(1UL << slot);
+	}
+	m_size--;
+}
+
+void TimerWheelEventQueue::advance(t_ulong lastTick)
+{
+	while(m_size > 0 && m_currentTick <= lastTick) {
+		t_uint slot = static_cast<t_uint>(m_currentTick & m_SLOT_MASK);
+		if(slot == 0) {
+			cascade();
+		}
+
+		t_ulong laterSlots = (m_nonEmptySlots >> slot);
+		if(laterSlots == 0) {
+			// Nothing else fires in this rotation of the
+			// first level.
+			m_currentTick += (m_NUM_SLOTS - slot);
+			continue;
+		}
+
+		t_ulong tick = m_currentTick + __builtin_ctzl(laterSlots);
+		if(tick > lastTick) {
+			m_currentTick = lastTick + 1;
+			break;
+		}
+
+		// Every event in a first-level slot fires in the
+		// same tick.
+		t_uint tickSlot = static_cast<t_uint>(tick & m_SLOT_MASK);
+		Slot& events = m_slots[0][tickSlot];
+		for(t_ulong i = 0; i < events.size(); ++i) {
+			assert(tickOf(events[i]->getFireTime()) == tick);
+			setQueueHandle(*events[i], 0);
+			m_eventQueue->insert(events[i]);
+		}
+		m_size -= events.size();
+		events.clear();
+		m_nonEmptySlots &= ~(1UL << tickSlot);
+		m_currentTick = tick + 1;
+		break;
+	}
+}
+
+void TimerWheelEventQueue::cascade()
+{
+	// A level's slot is only reached when the level below it
+	// comes around to its first slot.
+	for(t_uint level = 1; level < m_NUM_LEVELS; ++level) {
+		t_uint slot = static_cast<t_uint>(
+			(m_currentTick >> (m_SLOT_BITS * level)) & m_SLOT_MASK);
+		Slot events;
+		events.swap(m_slots[level][slot]);
+		m_size -= events.size();
+		for(t_ulong i = 0; i < events.size(); ++i) {
+			bool didPlace = place(events[i]);
+			assert(didPlace);
+		}
+		if(slot != 0) {
+			break;
+		}
+	}
+}
+
+/////////////////////////////////////////////////
+// HorizonEventQueue Class
+/////////////////////////////////////////////////
+
+HorizonEventQueue::HorizonEventQueue(EventQueuePtr eventQueue)
+	: EventQueue(), m_eventQueue(eventQueue), m_hasHorizon(false)
+{
+	assert(m_eventQueue.get() != 0);
+	assert(m_eventQueue->empty());
+}
+
+EventQueue::QueueTypes HorizonEventQueue::getQueueType() const
+{
+	return m_eventQueue->getQueueType();
+}
+
+void HorizonEventQueue::insert(EventPtr event)
+{
+	place(event, false);
+}
+
+void HorizonEventQueue::insertTimer(EventPtr event)
+{
+	place(event, true);
+}
+
+void HorizonEventQueue::setHorizon(const SimTime& horizon)
+{
+	bool isExtended = (m_hasHorizon && horizon > m_horizon);
+	bool isReduced = (!m_hasHorizon || horizon < m_horizon);
+	m_hasHorizon = true;
+	m_horizon = horizon;
+	if(isExtended) {
+		moveOverflowEvents(false);
+	} else if(isReduced) {
+		parkLateEvents();
+	}
+}
+
+bool HorizonEventQueue::remove(EventPtr event)
+{
+	t_ulong handle = getQueueHandle(*event);
+	if((handle & m_IN_OVERFLOW_HANDLE_BIT) == 0) {
+		return m_eventQueue->remove(event);
+	}
+
+	t_ulong index = (handle & ~m_IN_OVERFLOW_HANDLE_BIT);
+	bool didErase = false;
+	if(index < m_overflow.size() && m_overflow[index].m_event == event) {
+		// Fill the hole with the last event of the bucket.
+		if(index != (m_overflow.size() - 1)) {
+			m_overflow[index] = m_overflow.back();
+			setQueueHandle(*m_overflow[index].m_event,
+				m_IN_OVERFLOW_HANDLE_BIT | index);
+		}
+		m_overflow.pop_back();
+		setQueueHandle(*event, 0);
+		didErase = true;
+	}
+	return didErase;
+}
+
+EventPtr HorizonEventQueue::top()
+{
+	moveDueEvents();
+	return m_eventQueue->top();
+}
+
+EventPtr HorizonEventQueue::pop()
+{
+	moveDueEvents();
+	return m_eventQueue->pop();
+}
+
+bool HorizonEventQueue::empty() const
+{
+	return (m_overflow.empty() && m_eventQueue->empty());
+}
+
+t_ulong HorizonEventQueue::size() const
+{
+	return (m_overflow.size() + m_eventQueue->size());
+}
+
+void HorizonEventQueue::clear()
+{
+	for(t_ulong i = 0; i < m_overflow.size(); ++i) {
+		setQueueHandle(*m_overflow[i].m_event, 0);
+	}
+	m_overflow.clear();
+	m_eventQueue->clear();
+}
+
+void HorizonEventQueue::getEntries(vector<EventQueueEntry>& entries) const
+{
+	m_eventQueue->getEntries(entries);
+	for(t_ulong i = 0; i < m_overflow.size(); ++i) {
+		entries.push_back(EventQueueEntry(m_overflow[i].m_event));
+	}
+}
+
+void HorizonEventQueue::moveOverflowEvents(bool doMoveAll)
+{
+	t_ulong numKept = 0;
+	for(t_ulong i = 0; i < m_overflow.size(); ++i) {
+		OverflowEntry& entry = m_overflow[i];
+		if(doMoveAll || !(entry.m_event->getFireTime() > m_horizon)) {
+			if(entry.m_isTimer) {
+				m_eventQueue->insertTimer(entry.m_event);
+			} else {
+				m_eventQueue->insert(entry.m_event);
+			}
+		} else {
+			setQueueHandle(*entry.m_event,
+				m_IN_OVERFLOW_HANDLE_BIT | numKept);
+			m_overflow[numKept++] = entry;
+		}
+	}
+	m_overflow.resize(numKept);
+}
+
+void HorizonEventQueue::parkLateEvents()
+{
+	vector<EventQueueEntry> entries;
+	m_eventQueue->getEntries(entries);
+	for(t_ulong i = 0; i < entries.size(); ++i) {
+		if(entries[i].getFireTime() > m_horizon) {
+			EventPtr event = entries[i].m_event;
+			bool didErase = m_eventQueue->remove(event);
+			assert(didErase);
+			// Whether it was a timer event is not known, so
+			// it is moved back as a plain event.
+			place(event, false);
+		}
+	}
+}
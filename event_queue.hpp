@@ -0,0 +1,910 @@
+
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include <vector>
+#include <deque>
+#include <set>
+#include <string>
+#include <climits>
+using namespace std;
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+
+#include "utility.hpp"
+#include "sim_time.hpp"
+#include "event.hpp"
+
+/////////////////////////////////////////////////
+// EventQueueEntry Class
+/////////////////////////////////////////////////
+
+/**
+ * An element stored by the event queues.
+ * The ordering key (fire time, order key) is copied into the
+ * entry when the event is inserted so that comparisons do not
+ * have to dereference the event pointer.  Both halves of the
+ * key are 64-bit integers (see SimTime::getOrderingKey() and
+ * Event::getOrderKey()), so comparing entries is two integer
+ * comparisons.  Since sequence numbers are unique, the key
+ * identifies exactly one event.
+ */
+class EventQueueEntry {
+public:
+
+	/// A constructor.
+	EventQueueEntry();
+
+	/**
+	 * A constructor.
+	 * Copies the ordering key out of the event.
+	 * @param event the event held by this entry.
+	 */
+	EventQueueEntry(EventPtr event);
+
+	/// The ordering key of the time at which the event
+	/// will fire.
+	/// @see getFireTime()
+	uint64_t m_timeKey;
+
+	/// The order key the event was scheduled with, which
+	/// breaks ties between equal fire times.
+	t_ulong m_orderKey;
+
+	/// The event held by this entry.
+	EventPtr m_event;
+
+	/**
+	 * Get the time at which the event will fire.
+	 * @return the fire time.
+	 */
+	inline SimTime getFireTime() const;
+
+	/// One entry is less than another if its fire time is smaller
+	/// or, for equal fire times, if its order key is smaller.
+	inline bool operator< (const EventQueueEntry& rhs) const;
+
+};
+
+/////////////////////////////////////////////////
+// EventQueue Class
+/////////////////////////////////////////////////
+
+/**
+ * The interface for the priority queue that holds the Simulator's
+ * pending events.
+ * Events must have their fire time and sequence number set
+ * before they are inserted.  Every implementation returns
+ * events in ascending order of fire time and, for equal fire
+ * times, in the order in which they were scheduled, so
+ * the choice of implementation does not affect the results
+ * of a simulation.
+ */
+class EventQueue : boost::noncopyable {
+public:
+	/// Smart pointer that clients should use.
+	typedef boost::shared_ptr<EventQueue> EventQueuePtr;
+
+	/**
+	 * QueueTypes enum.
+	 * The available event queue implementations.
+	 */
+	enum QueueTypes {
+		QueueTypes_Multiset, /**< enum value QueueTypes_Multiset. */
+		QueueTypes_Heap, /**< enum value QueueTypes_Heap. */
+		QueueTypes_Calendar /**< enum value QueueTypes_Calendar. */
+	};
+
+	/// A destructor.
+	virtual ~EventQueue();
+
+	/**
+	 * A factory method that creates an event queue of
+	 * the given type.
+	 * @param queueType the implementation to create.
+	 * @return a pointer to the new, empty event queue.
+	 */
+	static EventQueuePtr create(QueueTypes queueType);
+
+	/**
+	 * Convert the name of an event queue type to the
+	 * corresponding enum value.
+	 * @param name the name of the type (i.e., "multiset",
+	 * "heap", or "calendar").
+	 * @param queueType the value corresponding to name.
+	 * @return true if name is a valid queue type.
+	 */
+	static bool parseQueueType(const string& name,
+		QueueTypes& queueType);
+
+	/**
+	 * Get the name of an event queue type.
+	 * @param queueType the type of queue.
+	 * @return the name of the type.
+	 */
+	static string queueTypeName(QueueTypes queueType);
+
+	/**
+	 * Get the type of this queue.
+	 * @return the type of this queue.
+	 */
+	virtual QueueTypes getQueueType() const = 0;
+
+	/**
+	 * Add an event to the queue.
+	 * @param event the event to add, whose fire time and
+	 * sequence number have already been set.
+	 */
+	virtual void insert(EventPtr event) = 0;
+
+	/**
+	 * Add the event of a Timer to the queue.
+	 * Timer events are started, stopped, and restarted far
+	 * more often than other events, so a queue may store them
+	 * separately (see TimerWheelEventQueue).  By default,
+	 * they are simply inserted.
+	 * @param event the event to add, whose fire time and
+	 * sequence number have already been set.
+	 */
+	virtual void insertTimer(EventPtr event);
+
+	/**
+	 * Tell the queue the time after which its events will not
+	 * be executed, e.g., the stop time of the run.  A queue may
+	 * set aside the events that fire after it (see
+	 * HorizonEventQueue).  By default, it is ignored.
+	 * @param horizon the last time at which events are executed.
+	 */
+	virtual void setHorizon(const SimTime& horizon);
+
+	/**
+	 * Remove an event from the queue.
+	 * The event is located directly from its ordering key or
+	 * queue handle, so this does not degrade when many events
+	 * share the same fire time.
+	 * @param event the event to remove.
+	 * @return true if the event was found and removed.
+	 */
+	virtual bool remove(EventPtr event) = 0;
+
+	/**
+	 * Get the next event without removing it.
+	 * The queue must not be empty.
+	 * @return the event that will fire next.
+	 */
+	virtual EventPtr top() = 0;
+
+	/**
+	 * Remove and return the next event.
+	 * The queue must not be empty.
+	 * @return the event that will fire next.
+	 */
+	virtual EventPtr pop() = 0;
+
+	/**
+	 * Check whether there are any events in the queue.
+	 * @return true if the queue is empty.
+	 */
+	virtual bool empty() const = 0;
+
+	/**
+	 * Get the number of events in the queue.
+	 * @return the number of events in the queue.
+	 */
+	virtual t_ulong size() const = 0;
+
+	/**
+	 * Remove all the events from the queue.
+	 */
+	virtual void clear() = 0;
+
+	/**
+	 * Get the entries of all the events in the queue.
+	 * @param entries the vector to which the entries are
+	 * appended, in no particular order.
+	 */
+	virtual void getEntries(vector<EventQueueEntry>& entries) const = 0;
+
+protected:
+
+	/// A constructor.
+	EventQueue();
+
+	/**
+	 * Get the handle that the queue stored in an event.
+	 * @param event the event.
+	 * @return the event's queue handle.
+	 */
+	static inline t_ulong getQueueHandle(const Event& event);
+
+	/**
+	 * Store a handle in an event that lets the queue find
+	 * the event later.
+	 * @param event the event.
+	 * @param queueHandle the new queue handle.
+	 */
+	static inline void setQueueHandle(Event& event, t_ulong queueHandle);
+
+};
+typedef boost::shared_ptr<EventQueue> EventQueuePtr;
+
+/////////////////////////////////////////////////
+// MultisetEventQueue Class
+/////////////////////////////////////////////////
+
+/**
+ * An event queue built on the STL's \c multiset.
+ * This is the original implementation of the Simulator's event
+ * queue.  Insertion, cancellation, and removal of the first
+ * event are O(log n), but each insertion allocates a tree node.
+ */
+class MultisetEventQueue : public EventQueue {
+public:
+	/// Smart pointer that clients should use.
+	typedef boost::shared_ptr<MultisetEventQueue> MultisetEventQueuePtr;
+
+	/**
+	 * A factory method to ensure that all objects
+	 * are created via \c new since we are using smart pointers.
+	 */
+	static inline MultisetEventQueuePtr create();
+
+	QueueTypes getQueueType() const;
+	void insert(EventPtr event);
+	bool remove(EventPtr event);
+	EventPtr top();
+	EventPtr pop();
+	bool empty() const;
+	t_ulong size() const;
+	void clear();
+	void getEntries(vector<EventQueueEntry>& entries) const;
+
+protected:
+
+	/// A constructor.
+	MultisetEventQueue();
+
+private:
+
+	/// The events ordered by their fire time and sequence number.
+	multiset<EventQueueEntry> m_events;
+
+};
+typedef boost::shared_ptr<MultisetEventQueue> MultisetEventQueuePtr;
+
+/////////////////////////////////////////////////
+// HeapEventQueue Class
+/////////////////////////////////////////////////
+
+/**
+ * An event queue built on an implicit 4-ary heap.
+ * The heap is stored in a contiguous vector, so insertion
+ * does not allocate (beyond the vector's amortized growth)
+ * and the wider nodes make the tree half as deep as a
+ * binary heap.  Each event's queue handle holds its index
+ * in the heap, so cancellation is O(log n).
+ */
+class HeapEventQueue : public EventQueue {
+public:
+	/// Smart pointer that clients should use.
+	typedef boost::shared_ptr<HeapEventQueue> HeapEventQueuePtr;
+
+	/**
+	 * A factory method to ensure that all objects
+	 * are created via \c new since we are using smart pointers.
+	 */
+	static inline HeapEventQueuePtr create();
+
+	QueueTypes getQueueType() const;
+	void insert(EventPtr event);
+	bool remove(EventPtr event);
+	EventPtr top();
+	EventPtr pop();
+	bool empty() const;
+	t_ulong size() const;
+	void clear();
+	void getEntries(vector<EventQueueEntry>& entries) const;
+
+protected:
+
+	/// A constructor.
+	HeapEventQueue();
+
+private:
+
+	/// The number of children of each node in the heap.
+	static const t_ulong m_ARITY;
+
+	/// The heap of entries.  The first event is at index zero.
+	vector<EventQueueEntry> m_heap;
+
+	/**
+	 * Store an entry at a position of the heap and update
+	 * the queue handle of its event.
+	 * @param index the position.
+	 * @param entry the entry to store.
+	 */
+	inline void place(t_ulong index, const EventQueueEntry& entry);
+
+	/**
+	 * Remove the entry at the given position of the heap.
+	 * @param index the position of the entry to remove.
+	 */
+	void removeAt(t_ulong index);
+
+	/**
+	 * Move an entry toward the root until the heap
+	 * property is restored.
+	 * @param index the current position of the entry.
+	 */
+	void siftUp(t_ulong index);
+
+	/**
+	 * Move an entry toward the leaves until the heap
+	 * property is restored.
+	 * @param index the current position of the entry.
+	 */
+	void siftDown(t_ulong index);
+
+};
+typedef boost::shared_ptr<HeapEventQueue> HeapEventQueuePtr;
+
+/////////////////////////////////////////////////
+// CalendarEventQueue Class
+/////////////////////////////////////////////////
+
+/**
+ * An event queue built on a calendar queue (R. Brown, "Calendar
+ * Queues: A Fast O(1) Priority Queue Implementation for the
+ * Simulation Event Set Problem," Communications of the ACM, 1988).
+ * Time is divided into "days" of a fixed width and each day
+ * maps to a bucket in a circular "year".  When the events are
+ * spread roughly uniformly in time (e.g., the slot boundaries
+ * of a slotted MAC), both insertion and removal of the first
+ * event are O(1) amortized.  The number of buckets and the
+ * width of a day are recomputed as the queue grows and shrinks.
+ * Cancelled events are found with a binary search of their
+ * bucket and left in place as tombstones (i.e., entries without
+ * an event) which are discarded when they reach the front
+ * of the bucket or when the calendar is resized.
+ */
+class CalendarEventQueue : public EventQueue {
+public:
+	/// Smart pointer that clients should use.
+	typedef boost::shared_ptr<CalendarEventQueue> CalendarEventQueuePtr;
+
+	/**
+	 * A factory method to ensure that all objects
+	 * are created via \c new since we are using smart pointers.
+	 */
+	static inline CalendarEventQueuePtr create();
+
+	QueueTypes getQueueType() const;
+	void insert(EventPtr event);
+	bool remove(EventPtr event);
+	EventPtr top();
+	EventPtr pop();
+	bool empty() const;
+	t_ulong size() const;
+	void clear();
+	void getEntries(vector<EventQueueEntry>& entries) const;
+
+protected:
+
+	/// A constructor.
+	CalendarEventQueue();
+
+private:
+
+	/// Each bucket is kept sorted in ascending order.
+	typedef deque<EventQueueEntry> Bucket;
+
+	/// The number of buckets when the queue is empty.
+	static const t_ulong m_MIN_NUM_BUCKETS;
+
+	/// The width of a day (in seconds) before any events
+	/// have been sampled.
+	static const double m_DEFAULT_BUCKET_WIDTH;
+
+	/// The maximum number of distinct fire times sampled
+	/// when the bucket width is recomputed.
+	static const t_ulong m_MAX_WIDTH_SAMPLES;
+
+	/// The buckets of the calendar.  The size is always a
+	/// power of two.
+	vector<Bucket> m_buckets;
+
+	/// The width of a day in seconds.
+	double m_bucketWidth;
+
+	/// The day that contains the most recently
+	/// removed event.  Days are numbered from time zero.
+	t_ulong m_currentDay;
+
+	/// The number of events in the queue, not counting
+	/// tombstones.
+	t_ulong m_size;
+
+	/**
+	 * Get the day in which a time falls.
+	 * @param time the time.
+	 * @return the day number.
+	 */
+	inline t_ulong dayOf(const SimTime& time) const;
+
+	/**
+	 * Get the bucket for a given day.
+	 * @param day the day number.
+	 * @return the index of the bucket.
+	 */
+	inline t_ulong bucketOf(t_ulong day) const;
+
+	/**
+	 * Discard the tombstones at the front of a bucket.
+	 * @param bucket the bucket.
+	 */
+	inline void popTombstones(Bucket& bucket);
+
+	/**
+	 * Find the bucket that holds the first event and
+	 * advance the current day to it.
+	 * The queue must not be empty.
+	 * @return the index of the bucket.
+	 */
+	t_ulong findFirstBucket();
+
+	/**
+	 * Rebuild the calendar with a new number of buckets.
+	 * The bucket width is recomputed from the separation
+	 * of the earliest events.
+	 * @param numBuckets the new number of buckets.
+	 */
+	void resize(t_ulong numBuckets);
+
+};
+typedef boost::shared_ptr<CalendarEventQueue> CalendarEventQueuePtr;
+
+/////////////////////////////////////////////////
+// TimerWheelEventQueue Class
+/////////////////////////////////////////////////
+
+/**
+ * An event queue that keeps Timer events in a hierarchical
+ * timing wheel (G. Varghese and T. Lauck, "Hashed and
+ * Hierarchical Timing Wheels," SOSP, 1987) in front of another
+ * event queue, which holds all the other events.
+ * Time is divided into ticks of a fixed width.  The first level
+ * of the wheel has one slot per tick for the next few ticks and
+ * each higher level has slots that are as wide as the whole
+ * level below it.  Starting, stopping, and restarting a timer
+ * only adds an event to or removes it from a slot, which is
+ * O(1).  Only when the other queue's first event reaches a
+ * tick are the timer events of that tick moved into the other
+ * queue, and the slots of the higher levels are spread into
+ * the lower ones as time reaches them.  Thus, timers that are
+ * stopped or restarted before they fire never touch the
+ * other queue.
+ *
+ * Timer events that fire before the current tick or beyond
+ * the range of the wheel are inserted into the other queue
+ * directly.  Since events keep their fire time and sequence
+ * number, they are executed in exactly the same order as with
+ * the other queue alone.
+ */
+class TimerWheelEventQueue : public EventQueue {
+public:
+	/// Smart pointer that clients should use.
+	typedef boost::shared_ptr<TimerWheelEventQueue>
+		TimerWheelEventQueuePtr;
+
+	/// The default width of a tick in seconds.
+	static const double m_DEFAULT_TICK_TIME;
+
+	/**
+	 * A factory method to ensure that all objects
+	 * are created via \c new since we are using smart pointers.
+	 * @param eventQueue the queue that holds the events which
+	 * are not in the wheel, which must be empty.
+	 * @param tickTime the width of a tick in seconds.
+	 */
+	static inline TimerWheelEventQueuePtr create(EventQueuePtr eventQueue,
+		double tickTime = m_DEFAULT_TICK_TIME);
+
+	/// @return the type of the queue that holds the other events.
+	QueueTypes getQueueType() const;
+	void insert(EventPtr event);
+	void insertTimer(EventPtr event);
+	bool remove(EventPtr event);
+	EventPtr top();
+	EventPtr pop();
+	bool empty() const;
+	t_ulong size() const;
+	void clear();
+	void getEntries(vector<EventQueueEntry>& entries) const;
+
+protected:
+
+	/// A constructor.
+	TimerWheelEventQueue(EventQueuePtr eventQueue, double tickTime);
+
+private:
+
+	/// The number of levels in the wheel.
+	static const t_uint m_NUM_LEVELS = 4;
+
+	/// The base two logarithm of the number of slots per level.
+	static const t_uint m_SLOT_BITS = 6;
+
+	/// The number of slots per level.
+	static const t_uint m_NUM_SLOTS = (1 << m_SLOT_BITS);
+
+	/// The mask that gives a slot from a tick.
+	static const t_ulong m_SLOT_MASK = (m_NUM_SLOTS - 1);
+
+	/// The bit set in the queue handle of the events that are
+	/// in the wheel.  The rest of the handle holds the event's
+	/// level, slot, and index in the slot.
+	static const t_ulong m_IN_WHEEL_HANDLE_BIT = (1UL << 63);
+
+	/// The events of a slot, in no particular order.
+	typedef vector<EventPtr> Slot;
+
+	/// The queue that holds the events which are not in
+	/// the wheel.
+	EventQueuePtr m_eventQueue;
+
+	/// The width of a tick in seconds.
+	double m_tickTime;
+
+	/// The slots of each level.
+	Slot m_slots[m_NUM_LEVELS][m_NUM_SLOTS];
+
+	/// The first level's non-empty slots, one bit per slot.
+	t_ulong m_nonEmptySlots;
+
+	/// The tick up to which the timer events have been moved
+	/// into m_eventQueue.  All the events in the wheel fire
+	/// at or after it.
+	t_ulong m_currentTick;
+
+	/// The number of events in the wheel.
+	t_ulong m_size;
+
+	/**
+	 * Get the tick in which a time falls.
+	 * @param time the time.
+	 * @return the tick number.
+	 */
+	inline t_ulong tickOf(const SimTime& time) const;
+
+	/**
+	 * Get the queue handle of an event in the wheel.
+	 * @param level the level of the event's slot.
+	 * @param slot the event's slot.
+	 * @param index the position of the event in the slot.
+	 * @return the queue handle.
+	 */
+	static inline t_ulong wheelHandle(t_uint level, t_uint slot,
+		t_ulong index);
+
+	/**
+	 * Add an event to the slot where it belongs given
+	 * the current tick.
+	 * @param event the event.
+	 * @return false if the event fires before the current
+	 * tick or beyond the range of the wheel.
+	 */
+	bool place(EventPtr event);
+
+	/**
+	 * Remove the event at a position of a slot.
+	 * @param level the level of the slot.
+	 * @param slot the slot.
+	 * @param index the position of the event in the slot.
+	 */
+	void removeAt(t_uint level, t_uint slot, t_ulong index);
+
+	/**
+	 * Move the timer events of the wheel's first non-empty
+	 * tick into m_eventQueue if they fire no later than the
+	 * tick of its first event, so that its first event is
+	 * the first of all the events.
+	 */
+	inline void moveDueEvents();
+
+	/**
+	 * Advance the current tick to the first non-empty tick,
+	 * moving its events into m_eventQueue, and spread the
+	 * higher levels into the lower ones as they are reached.
+	 * @param lastTick the last tick whose events may be moved.
+	 * If the first non-empty tick is after it, the current
+	 * tick stops just after it instead.
+	 */
+	void advance(t_ulong lastTick);
+
+	/**
+	 * Spread the events of the slots that the current tick
+	 * has reached into the lower levels.  This is done when
+	 * the current tick reaches the start of a first-level
+	 * rotation.
+	 */
+	void cascade();
+
+};
+typedef boost::shared_ptr<TimerWheelEventQueue> TimerWheelEventQueuePtr;
+
+/////////////////////////////////////////////////
+// HorizonEventQueue Class
+/////////////////////////////////////////////////
+
+/**
+ * An event queue that keeps the events which fire after the
+ * horizon (see setHorizon()) in an unsorted overflow bucket in
+ * front of another event queue, which holds the events that
+ * fire up to the horizon.  Since a run never executes the
+ * events after its stop time, e.g., the next firing of a
+ * periodic timer, inserting, cancelling, and removing events
+ * only costs as much as the other queue's working set.
+ * Adding an event to or removing it from the bucket is O(1).
+ * The events already in the other queue are moved into the
+ * bucket when the horizon is first set or brought forward.
+ * The bucket's events are only sorted, by inserting them into
+ * the other queue, once the horizon is extended past them or,
+ * should events be looked up past the horizon, once the other
+ * queue has no event up to it.  So, events are executed in
+ * exactly the same order as with the other queue alone.
+ */
+class HorizonEventQueue : public EventQueue {
+public:
+	/// Smart pointer that clients should use.
+	typedef boost::shared_ptr<HorizonEventQueue> HorizonEventQueuePtr;
+
+	/**
+	 * A factory method to ensure that all objects
+	 * are created via \c new since we are using smart pointers.
+	 * @param eventQueue the queue that holds the events up to
+	 * the horizon, which must be empty.
+	 */
+	static inline HorizonEventQueuePtr create(EventQueuePtr eventQueue);
+
+	/// @return the type of the queue that holds the other events.
+	QueueTypes getQueueType() const;
+	void insert(EventPtr event);
+	void insertTimer(EventPtr event);
+	void setHorizon(const SimTime& horizon);
+	bool remove(EventPtr event);
+	EventPtr top();
+	EventPtr pop();
+	bool empty() const;
+	t_ulong size() const;
+	void clear();
+	void getEntries(vector<EventQueueEntry>& entries) const;
+
+	/**
+	 * Get the number of events in the overflow bucket.
+	 * @return the number of events after the horizon.
+	 */
+	inline t_ulong numOverflowEvents() const;
+
+protected:
+
+	/// A constructor.
+	HorizonEventQueue(EventQueuePtr eventQueue);
+
+private:
+
+	/// The bit set in the queue handle of the events that are
+	/// in the overflow bucket.  The rest of the handle holds
+	/// the event's index in the bucket.  It differs from the
+	/// bit used by TimerWheelEventQueue, which may be the
+	/// other queue.
+	static const t_ulong m_IN_OVERFLOW_HANDLE_BIT = (1UL << 62);
+
+	/**
+	 * An event in the overflow bucket.
+	 */
+	struct OverflowEntry {
+		/// The event.
+		EventPtr m_event;
+
+		/// Whether the event was inserted as a timer event.
+		bool m_isTimer;
+	};
+
+	/// The queue that holds the events up to the horizon.
+	EventQueuePtr m_eventQueue;
+
+	/// Whether a horizon has been set.
+	bool m_hasHorizon;
+
+	/// @see setHorizon()
+	SimTime m_horizon;
+
+	/// The events that fire after the horizon, in no
+	/// particular order.
+	vector<OverflowEntry> m_overflow;
+
+	/**
+	 * Add an event to the queue where it belongs given
+	 * the horizon.
+	 * @param event the event.
+	 * @param isTimer whether it is a timer event.
+	 */
+	inline void place(EventPtr event, bool isTimer);
+
+	/**
+	 * Move the events of the overflow bucket that fire up to
+	 * the horizon into the other queue, or all of them if the
+	 * other queue has no event up to the horizon, so that the
+	 * other queue's first event is the first of all the events.
+	 * @param doMoveAll true if all the events are moved.
+	 */
+	void moveOverflowEvents(bool doMoveAll);
+
+	/**
+	 * Move the events of the other queue that fire after the
+	 * horizon into the overflow bucket.  This is done when the
+	 * horizon is first set or brought forward, since the
+	 * events that were inserted before then may be after it.
+	 */
+	void parkLateEvents();
+
+	/**
+	 * Move the events of the overflow bucket into the other
+	 * queue if its first event is after the horizon.
+	 */
+	inline void moveDueEvents();
+
+};
+typedef boost::shared_ptr<HorizonEventQueue> HorizonEventQueuePtr;
+
+/////////////////////////////////////////////////
+// Inline Functions
+/////////////////////////////////////////////////
+
+inline SimTime EventQueueEntry::getFireTime() const
+{
+	return SimTime::fromOrderingKey(m_timeKey);
+}
+
+inline bool EventQueueEntry::operator< (const EventQueueEntry& rhs) const
+{
+	if(m_timeKey != rhs.m_timeKey) {
+		return (m_timeKey < rhs.m_timeKey);
+	}
+	return (m_orderKey < rhs.m_orderKey);
+}
+
+inline t_ulong EventQueue::getQueueHandle(const Event& event)
+{
+	return event.m_queueHandle;
+}
+
+inline void EventQueue::setQueueHandle(Event& event, t_ulong queueHandle)
+{
+	event.m_queueHandle = queueHandle;
+}
+
+inline MultisetEventQueuePtr MultisetEventQueue::create()
+{
+	MultisetEventQueuePtr p(new MultisetEventQueue());
+	return p;
+}
+
+inline HeapEventQueuePtr HeapEventQueue::create()
+{
+	HeapEventQueuePtr p(new HeapEventQueue());
+	return p;
+}
+
+inline void HeapEventQueue::place(t_ulong index,
+	const EventQueueEntry& entry)
+{
+	m_heap[index] = entry;
+	setQueueHandle(*entry.m_event, index);
+}
+
+inline CalendarEventQueuePtr CalendarEventQueue::create()
+{
+	CalendarEventQueuePtr p(new CalendarEventQueue());
+	return p;
+}
+
+inline t_ulong CalendarEventQueue::dayOf(const SimTime& time) const
+{
+	return static_cast<t_ulong>(time.getTimeInSeconds() / m_bucketWidth);
+}
+
+inline t_ulong CalendarEventQueue::bucketOf(t_ulong day) const
+{
+	return (day & (m_buckets.size() - 1));
+}
+
+inline void CalendarEventQueue::popTombstones(Bucket& bucket)
+{
+	while(!bucket.empty() && bucket.front().m_event == 0) {
+		bucket.pop_front();
+	}
+}
+
+inline TimerWheelEventQueuePtr TimerWheelEventQueue::create(
+	EventQueuePtr eventQueue, double tickTime)
+{
+	TimerWheelEventQueuePtr p(new TimerWheelEventQueue(eventQueue,
+		tickTime));
+	return p;
+}
+
+inline t_ulong TimerWheelEventQueue::tickOf(const SimTime& time) const
+{
+	double tick = time.getTimeInSeconds() / m_tickTime;
+	if(tick >= static_cast<double>(LONG_MAX)) {
+		return LONG_MAX;
+	}
+	return static_cast<t_ulong>(tick);
+}
+
+inline t_ulong TimerWheelEventQueue::wheelHandle(t_uint level, t_uint slot,
+	t_ulong index)
+{
+	return (m_IN_WHEEL_HANDLE_BIT | (static_cast<t_ulong>(level) << 40) |
+		(static_cast<t_ulong>(slot) << 32) | index);
+}
+
+inline void TimerWheelEventQueue::moveDueEvents()
+{
+	if(m_size == 0) {
+		return;
+	}
+
+	// Once the first tick of the wheel is moved, the other
+	// queue's first event fires before all the events that
+	// are still in the wheel.
+	t_ulong lastTick = ULONG_MAX;
+	if(!m_eventQueue->empty()) {
+		lastTick = tickOf(m_eventQueue->top()->getFireTime());
+	}
+	if(lastTick >= m_currentTick) {
+		advance(lastTick);
+	}
+}
+
+inline HorizonEventQueuePtr HorizonEventQueue::create(
+	EventQueuePtr eventQueue)
+{
+	HorizonEventQueuePtr p(new HorizonEventQueue(eventQueue));
+	return p;
+}
+
+inline t_ulong HorizonEventQueue::numOverflowEvents() const
+{
+	return m_overflow.size();
+}
+
+inline void HorizonEventQueue::place(EventPtr event, bool isTimer)
+{
+	if(m_hasHorizon && event->getFireTime() > m_horizon) {
+		OverflowEntry entry;
+		entry.m_event = event;
+		entry.m_isTimer = isTimer;
+		setQueueHandle(*event, m_IN_OVERFLOW_HANDLE_BIT | m_overflow.size());
+		m_overflow.push_back(entry);
+	} else if(isTimer) {
+		m_eventQueue->insertTimer(event);
+	} else {
+		m_eventQueue->insert(event);
+	}
+}
+
+inline void HorizonEventQueue::moveDueEvents()
+{
+	// The other queue's first event is only the first of all
+	// the events if it is not after the horizon.
+	if(!m_overflow.empty() && (m_eventQueue->empty() ||
+			m_eventQueue->top()->getFireTime() > m_horizon)) {
+		moveOverflowEvents(true);
+	}
+}
+
+#endif // EVENT_QUEUE_H
+
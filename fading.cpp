@@ -12,11 +12,13 @@ const double Ricean::m_MAX_DOPPLER_FREQUENCY = 30.0;
 const double Ricean::m_MAX_SAMPLE_RATE = 1000.0;
 
 Fading::Fading()
+	: m_simulator(Simulator::instance())
 {
 
 }
 
 Fading::Fading(const Fading& rhs)
+	: m_simulator(rhs.m_simulator)
 {
 
 }
@@ -73,7 +75,7 @@ double Ricean::fadingFactor(const WirelessCommSignal& signal,
 	// fading factor globally for a given time instance.
 	
 	double maxFrequency = m_maxVelocity / signal.getWavelength();
-	SimTime currentTime = Simulator::instance()->currentTime();
+	SimTime currentTime = m_simulator->currentTime();
 	double timeIndex = (currentTime.getTimeInSeconds() * 
 		m_MAX_SAMPLE_RATE * (maxFrequency / m_MAX_DOPPLER_FREQUENCY));
 	timeIndex = timeIndex - (m_NUMBER_OF_POINTS * 
@@ -85,8 +87,7 @@ double Ricean::fadingFactor(const WirelessCommSignal& signal,
 
 	map<NodeId,int>::const_iterator p = m_nodeOffset.find(nodeId);
 	if(p == m_nodeOffset.end()) {
-		RandNumGeneratorPtr rand = 
-			Simulator::instance()->getRandNumGenerator();
+		RandNumGeneratorPtr rand = m_simulator->getRandNumGenerator();
 		m_nodeOffset[nodeId] = 
 			rand->uniformInt(0, (m_NUMBER_OF_POINTS - 1));;
 	}
@@ -12,6 +12,8 @@ using namespace std;
 class WirelessCommSignal;
 class PhysicalLayer;
 class NodeId;
+class Simulator;
+typedef Simulator* SimulatorPtr;
 
 /**
  * This computes the fading for a given signal at a receiver.
@@ -40,6 +42,11 @@ protected:
 	/// a randomly choosen offset for each receiver.
 	map<NodeId,int> m_nodeOffset;
 
+	/// The simulator whose clock and random number generator
+	/// are used.  This is the current simulator when the
+	/// object is created.
+	SimulatorPtr m_simulator;
+
 	/// A constructor
 	Fading();
 
@@ -129,8 +129,9 @@ inline LinkLayerPtr LinkLayer::create(NodePtr node,
 	// been set.
 	assert(p->m_macProtocol.get() != 0);
 	p->m_macProtocol->setLinkLayer(p->thisLinkLayer());
-	Simulator::instance()->addSimulationEndListener(
+	p->getNode()->getSimulator()->addSimulationEndListener(
 		p->thisSimulationEndListener());
+	p->getNode()->getSimulator()->addStateSaver(p);
 	return p;
 }
 
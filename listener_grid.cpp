@@ -0,0 +1,149 @@
+
+#include <algorithm>
+#include <limits>
+using namespace std;
+
+#include "listener_grid.hpp"
+#include "physical_layer.hpp"
+
+const double ListenerGrid::m_DEFAULT_CELL_SIZE = 10.0;
+
+ListenerGrid::ListenerGrid(double cellSize)
+	: m_cellSize(cellSize), m_size(0), m_nextOrder(0), m_maxGain(0.0),
+	m_minSensitivity(numeric_limits<double>::infinity())
+{
+	assert(m_cellSize > 0.0);
+}
+
+void ListenerGrid::add(PhysicalLayerPtr listener)
+{
+	assert(listener.get() != 0);
+	Entry entry;
+	entry.m_listener = listener;
+	entry.m_order = m_nextOrder++;
+	m_cells[cellOf(listener->getLocation())].push_back(entry);
+	m_size++;
+
+	// A signal is only seen by a listener if it is stronger
+	// than either threshold.
+	m_maxGain = max(m_maxGain, listener->getGain());
+	m_minSensitivity = min(m_minSensitivity,
+		min(listener->getMinimumSignalStrength(),
+		listener->getRxThreshold()));
+}
+
+bool ListenerGrid::remove(PhysicalLayerPtr listener)
+{
+	assert(listener.get() != 0);
+	Entry entry;
+	if(!takeEntry(listener, entry)) {
+		return false;
+	}
+	m_size--;
+	// The gain and sensitivity are left as they are, which
+	// can only make the range that is searched larger.
+	return true;
+}
+
+bool ListenerGrid::update(PhysicalLayerPtr listener)
+{
+	assert(listener.get() != 0);
+	Entry entry;
+	if(!takeEntry(listener, entry)) {
+		return false;
+	}
+	vector<Entry>& entries = m_cells[cellOf(listener->getLocation())];
+	entries.insert(upper_bound(entries.begin(), entries.end(), entry),
+		entry);
+	return true;
+}
+
+bool ListenerGrid::takeEntry(PhysicalLayerPtr listener, Entry& entry)
+{
+	CellMap::iterator cell = m_cells.find(cellOf(listener->getLocation()));
+	if(cell != m_cells.end() && takeEntryFromCell(cell, listener, entry)) {
+		return true;
+	}
+
+	// The listener moved since it was put in its cell.
+	for(cell = m_cells.begin(); cell != m_cells.end(); ++cell) {
+		if(takeEntryFromCell(cell, listener, entry)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ListenerGrid::takeEntryFromCell(CellMap::iterator cell,
+	PhysicalLayerPtr listener, Entry& entry)
+{
+	vector<Entry>& entries = cell->second;
+	for(t_ulong i = 0; i < entries.size(); ++i) {
+		if(entries[i].m_listener == listener) {
+			// The entries are kept in the order in which
+			// they were added.
+			entry = entries[i];
+			entries.erase(entries.begin() + i);
+			if(entries.empty()) {
+				m_cells.erase(cell);
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+void ListenerGrid::getListeners(const Location& center, double range,
+	vector<PhysicalLayerPtr>& listeners) const
+{
+	if(m_size == 0) {
+		return;
+	}
+
+	vector<Entry> found;
+	// The number of cells that the range covers along each axis.
+	double cellsPerAxis = floor(2.0 * range / m_cellSize) + 2.0;
+	if(!(cellsPerAxis * cellsPerAxis * cellsPerAxis <
+			static_cast<double>(m_cells.size()))) {
+		// Visiting each non-empty cell is cheaper than looking
+		// up each cell in the range.
+		CellMap::const_iterator cell;
+		for(cell = m_cells.begin(); cell != m_cells.end(); ++cell) {
+			addNearEntries(cell->second, center, range, found);
+		}
+	} else {
+		CellKey low = cellOf(Location(center.getX() - range,
+			center.getY() - range, center.getZ() - range));
+		CellKey high = cellOf(Location(center.getX() + range,
+			center.getY() + range, center.getZ() + range));
+		CellKey key;
+		for(key.m_x = low.m_x; key.m_x <= high.m_x; ++key.m_x) {
+			for(key.m_y = low.m_y; key.m_y <= high.m_y; ++key.m_y) {
+				for(key.m_z = low.m_z; key.m_z <= high.m_z; ++key.m_z) {
+					CellMap::const_iterator cell = m_cells.find(key);
+					if(cell != m_cells.end()) {
+						addNearEntries(cell->second, center, range,
+							found);
+					}
+				}
+			}
+		}
+	}
+
+	sort(found.begin(), found.end());
+	for(t_ulong i = 0; i < found.size(); ++i) {
+		listeners.push_back(found[i].m_listener);
+	}
+}
+
+void ListenerGrid::addNearEntries(const vector<Entry>& entries,
+	const Location& center, double range, vector<Entry>& found) const
+{
+	for(t_ulong i = 0; i < entries.size(); ++i) {
+		if(Location::distance(center,
+				entries[i].m_listener->getLocation()) <= range) {
+			found.push_back(entries[i]);
+		}
+	}
+}
+
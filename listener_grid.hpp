@@ -0,0 +1,270 @@
+
+#ifndef LISTENER_GRID_H
+#define LISTENER_GRID_H
+
+#include <cmath>
+#include <vector>
+#include <map>
+using namespace std;
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+
+#include "utility.hpp"
+#include "location.hpp"
+
+class PhysicalLayer;
+typedef boost::shared_ptr<PhysicalLayer> PhysicalLayerPtr;
+
+/////////////////////////////////////////////////
+// ListenerGrid Class
+/////////////////////////////////////////////////
+
+/**
+ * A uniform grid of the physical layers listening on a channel,
+ * which finds the listeners within a distance of a sender
+ * without visiting the others.
+ * Space is divided into cubic cells and each listener is kept
+ * in the cell of its location when it was added or last
+ * updated, so a listener that moves must be updated with
+ * update() before the grid is searched again.  The listeners
+ * that are found are returned in the order in which they were
+ * added, which is the order in which the channel's listeners
+ * are visited when no grid is used.
+ * The grid also keeps the highest antenna gain and the lowest
+ * sensitivity (i.e., the weakest signal that changes a
+ * listener's state) of the listeners that have been added,
+ * which bound the range at which any of them can sense a
+ * signal.
+ */
+class ListenerGrid : boost::noncopyable {
+public:
+	/// Smart pointer that clients should use.
+	typedef boost::shared_ptr<ListenerGrid> ListenerGridPtr;
+
+	/// The default width of a cell in meters.
+	static const double m_DEFAULT_CELL_SIZE;
+
+	/**
+	 * A factory method to ensure that all objects
+	 * are created via \c new since we are using smart pointers.
+	 * @param cellSize the width of a cell in meters.
+	 */
+	static inline ListenerGridPtr create(
+		double cellSize = m_DEFAULT_CELL_SIZE);
+
+	/**
+	 * Add a listener at its current location.
+	 * Its gain and thresholds must already be set.
+	 * @param listener the listener.
+	 */
+	void add(PhysicalLayerPtr listener);
+
+	/**
+	 * Remove a listener.
+	 * @param listener the listener.
+	 * @return true if the listener was in the grid.
+	 */
+	bool remove(PhysicalLayerPtr listener);
+
+	/**
+	 * Move a listener to the cell of its current location.
+	 * It keeps the order in which it was added.
+	 * @param listener the listener.
+	 * @return true if the listener was in the grid.
+	 */
+	bool update(PhysicalLayerPtr listener);
+
+	/**
+	 * Get the listeners within a distance of a location.
+	 * Some listeners that are a little farther away may also
+	 * be returned.
+	 * @param center the location.
+	 * @param range the distance in meters, which may be
+	 * infinite.
+	 * @param listeners the vector to which the listeners are
+	 * appended, in the order in which they were added.
+	 */
+	void getListeners(const Location& center, double range,
+		vector<PhysicalLayerPtr>& listeners) const;
+
+	/**
+	 * Get the number of listeners in the grid.
+	 * @return the number of listeners.
+	 */
+	inline t_ulong size() const;
+
+	/**
+	 * Get the highest antenna gain of the listeners that
+	 * have been added.
+	 * @return the gain.
+	 */
+	inline double getMaxGain() const;
+
+	/**
+	 * Get the lowest sensitivity of the listeners that have
+	 * been added.  A signal that is no stronger than it at a
+	 * listener is neither captured nor added to the listener's
+	 * interference.
+	 * @return the sensitivity in Watts.
+	 */
+	inline double getMinSensitivity() const;
+
+protected:
+
+	/// A constructor.
+	ListenerGrid(double cellSize);
+
+private:
+
+	/**
+	 * A listener in a cell.
+	 */
+	struct Entry {
+		/// The listener.
+		PhysicalLayerPtr m_listener;
+
+		/// The order in which the listener was added.
+		t_ulong m_order;
+
+		/// Entries are sorted in the order in which they were
+		/// added.
+		inline bool operator< (const Entry& rhs) const
+		{
+			return (m_order < rhs.m_order);
+		}
+	};
+
+	/// The index of a cell along each axis.
+	typedef long CellCoordinate;
+
+	/// The coordinates of a cell.
+	struct CellKey {
+		/// The index along each axis.
+		CellCoordinate m_x, m_y, m_z;
+
+		/// Cells are ordered by x, then y, then z.
+		inline bool operator< (const CellKey& rhs) const
+		{
+			if(m_x != rhs.m_x)
+				return (m_x < rhs.m_x);
+			if(m_y != rhs.m_y)
+				return (m_y < rhs.m_y);
+			return (m_z < rhs.m_z);
+		}
+	};
+
+	/// The listeners of each non-empty cell.
+	typedef map<CellKey,vector<Entry> > CellMap;
+
+	/// The width of a cell in meters.
+	double m_cellSize;
+
+	/// The non-empty cells.
+	CellMap m_cells;
+
+	/// The number of listeners in the grid.
+	t_ulong m_size;
+
+	/// The order that the next listener added is given.
+	t_ulong m_nextOrder;
+
+	/// @see getMaxGain()
+	double m_maxGain;
+
+	/// @see getMinSensitivity()
+	double m_minSensitivity;
+
+	/**
+	 * Get the index of the cell along an axis in which a
+	 * coordinate falls.
+	 * @param coordinate the coordinate in meters.
+	 * @return the index.
+	 */
+	inline CellCoordinate cellOf(double coordinate) const;
+
+	/**
+	 * Get the cell in which a location falls.
+	 * @param location the location.
+	 * @return the cell's key.
+	 */
+	inline CellKey cellOf(const Location& location) const;
+
+	/**
+	 * Append the listeners of a cell that are within a
+	 * distance of a location.
+	 * @param entries the listeners of the cell.
+	 * @param center the location.
+	 * @param range the distance in meters.
+	 * @param found the vector to which the listeners are
+	 * appended.
+	 */
+	void addNearEntries(const vector<Entry>& entries,
+		const Location& center, double range,
+		vector<Entry>& found) const;
+
+	/**
+	 * Take a listener's entry out of its cell.  The cell of
+	 * its current location is tried first, since it has
+	 * usually not moved.
+	 * @param listener the listener.
+	 * @param entry set to the listener's entry.
+	 * @return true if the listener was in the grid.
+	 */
+	bool takeEntry(PhysicalLayerPtr listener, Entry& entry);
+
+	/**
+	 * Take a listener's entry out of a cell.
+	 * @param cell the cell.
+	 * @param listener the listener.
+	 * @param entry set to the listener's entry.
+	 * @return true if the listener was in the cell.
+	 */
+	bool takeEntryFromCell(CellMap::iterator cell,
+		PhysicalLayerPtr listener, Entry& entry);
+
+};
+typedef boost::shared_ptr<ListenerGrid> ListenerGridPtr;
+
+/////////////////////////////////////////////////
+// Inline Functions
+/////////////////////////////////////////////////
+
+inline ListenerGridPtr ListenerGrid::create(double cellSize)
+{
+	ListenerGridPtr p(new ListenerGrid(cellSize));
+	return p;
+}
+
+inline t_ulong ListenerGrid::size() const
+{
+	return m_size;
+}
+
+inline double ListenerGrid::getMaxGain() const
+{
+	return m_maxGain;
+}
+
+inline double ListenerGrid::getMinSensitivity() const
+{
+	return m_minSensitivity;
+}
+
+inline ListenerGrid::CellCoordinate ListenerGrid::cellOf(
+	double coordinate) const
+{
+	return static_cast<CellCoordinate>(floor(coordinate / m_cellSize));
+}
+
+inline ListenerGrid::CellKey ListenerGrid::cellOf(
+	const Location& location) const
+{
+	CellKey key;
+	key.m_x = cellOf(location.getX());
+	key.m_y = cellOf(location.getY());
+	key.m_z = cellOf(location.getZ());
+	return key;
+}
+
+#endif // LISTENER_GRID_H
+
@@ -4,10 +4,10 @@
 #include "packet.hpp"
 #include "node.hpp"
 
-LogStreamManagerPtr LogStreamManager::m_instance;
-
-LogStreamManager::LogStreamManager()
+LogStreamManager::LogStreamManager(SimulatorPtr simulator)
+	: m_simulator(simulator), m_doRecordStats(false)
 {
+	assert(m_simulator != 0);
 
 	// NOTE: You must open the streams to write to cout in this manner.
 	// Using the form: 
@@ -29,10 +29,18 @@ LogStreamManager::~LogStreamManager()
 
 }
 
+LogStreamManagerPtr LogStreamManager::instance()
+{
+	return Simulator::instance()->getLogStreamManager();
+}
+
 void LogStreamManager::logPktSendItem(const NodeId& nodeId,
 	const CommunicationLayer::Types& layer, const Packet& sendPkt)
 {
 	assert(m_pktSendStream != 0);
+	if(isDiscarded(m_pktSendStream)) {
+		return;
+	}
 	*m_pktSendStream << 
 		eventString(LogStreamManager::LogEvents_PktSend) <<
 		" " << currentTimeString() << " " <<
@@ -44,6 +52,9 @@ void LogStreamManager::logPktRecvItem(const NodeId& nodeId,
 	const CommunicationLayer::Types& layer, const Packet& recvPkt)
 {
 	assert(m_pktRecvStream != 0);
+	if(isDiscarded(m_pktRecvStream)) {
+		return;
+	}
 	*m_pktRecvStream << 
 		eventString(LogStreamManager::LogEvents_PktRecv) <<
 		" " << currentTimeString() << " " <<
@@ -55,6 +66,10 @@ void LogStreamManager::logStatsItem(const string& statsKeyString,
 	const string& statsValueString)
 {
 	assert(m_statsStream != 0);
+	recordStatsItem("", statsKeyString, statsValueString);
+	if(isDiscarded(m_statsStream)) {
+		return;
+	}
 	*m_statsStream << 
 		eventString(LogStreamManager::LogEvents_Stats) <<
 		" " << currentTimeString() << " " << 
@@ -66,6 +81,15 @@ void LogStreamManager::logStatsItem(const NodeId& nodeId,
 	const string& statsKeyString, const string& statsValueString)
 {
 	assert(m_statsStream != 0);
+	if(m_doRecordStats) {
+		ostringstream nodeIdStream;
+		nodeIdStream << nodeId;
+		recordStatsItem(nodeIdStream.str(), statsKeyString,
+			statsValueString);
+	}
+	if(isDiscarded(m_statsStream)) {
+		return;
+	}
 	*m_statsStream << 
 		eventString(LogStreamManager::LogEvents_Stats) <<
 		" " << currentTimeString() << " " << 
@@ -76,6 +100,9 @@ void LogStreamManager::logStatsItem(const NodeId& nodeId,
 void LogStreamManager::logUserDefinedItem(const string& userString)
 {
 	assert(m_userDefinedStream != 0);
+	if(isDiscarded(m_userDefinedStream)) {
+		return;
+	}
 	*m_userDefinedStream << 
 		eventString(LogStreamManager::LogEvents_UserDefined) <<
 		" " << currentTimeString() << " " << 
@@ -85,6 +112,9 @@ void LogStreamManager::logUserDefinedItem(const string& userString)
 void LogStreamManager::logDebugItem(const string& debugString)
 {
 	assert(m_debugStream != 0);
+	if(isDiscarded(m_debugStream)) {
+		return;
+	}
 	*m_debugStream << 
 		eventString(LogStreamManager::LogEvents_Debug) <<
 		" " << currentTimeString() << " " << 
@@ -103,7 +133,7 @@ string LogStreamManager::currentTimeString() const
 {
 	ostringstream curTimeStream;
 	curTimeStream << "-time " << setprecision(12) << fixed <<
-		Simulator::instance()->currentTime();
+		m_simulator->currentTime();
 	return curTimeStream.str();
 }
 
@@ -7,6 +7,7 @@
 #include <sstream>
 #include <string>
 #include <iomanip>
+#include <vector>
 using namespace std;
 #include <boost/shared_ptr.hpp>
 #include <boost/utility.hpp>
@@ -17,12 +18,39 @@ using namespace std;
 class Packet;
 typedef boost::shared_ptr<Packet> PacketPtr;
 class NodeId;
+class Simulator;
+typedef Simulator* SimulatorPtr;
+
+/**
+ * A statistic that was logged through
+ * LogStreamManager::logStatsItem().
+ * @see LogStreamManager::setDoRecordStats()
+ */
+struct LoggedStat {
+	/// The ID of the node that logged the stat or the empty
+	/// string for a global stat.
+	string m_nodeId;
+
+	/// The key of the stat.
+	string m_key;
+
+	/// The value of the stat.
+	string m_value;
+};
 
 /**
  * Keeps track of which stream should be used for logging
  * various types of events.
+ * Each Simulator owns one log stream manager.
+ *
+ * A stream without a buffer (i.e., <tt>new ostream(0)</tt>)
+ * discards its output, and the items logged to it are not
+ * formatted at all, which is useful when many runs are made
+ * and only the statistics are of interest.
  */
 class LogStreamManager : boost::noncopyable {
+	// The simulator creates and destroys its log stream manager.
+	friend class Simulator;
 private:
 
 	/**
@@ -43,10 +71,12 @@ public:
 	typedef LogStreamManager* LogStreamManagerPtr;
 
 	/**
-	 * The class uses the Singleton design pattern.
-	 * @return Pointer to the single instance of LogStreamManager
+	 * Get the log stream manager of the calling thread's
+	 * current simulator.
+	 * @return Pointer to the current log stream manager.
+	 * @see Simulator::instance()
 	 */
-	static inline LogStreamManagerPtr instance();
+	static LogStreamManagerPtr instance();
 
 	/**
 	 * Log the packet being sent to the appropriate stream.
@@ -175,11 +205,27 @@ public:
 	 */
 	inline void setDebugStream(ostreamPtr newStream);
 
+	/**
+	 * Set whether stats items are also kept in memory, in
+	 * addition to being written to the stats stream.
+	 * @param doRecordStats true if the stats should be kept.
+	 * @see getRecordedStats()
+	 */
+	inline void setDoRecordStats(bool doRecordStats);
+
+	/**
+	 * Get the stats items that have been kept in memory, in
+	 * the order in which they were logged.
+	 * @return the recorded stats items.
+	 * @see setDoRecordStats()
+	 */
+	inline const vector<LoggedStat>& getRecordedStats() const;
+
 private:
 
-	/// The lone instance of the log stream manager class.
-	/// @see instance()
-	static LogStreamManagerPtr m_instance;
+	/// The simulator that owns this log stream manager.
+	/// @see currentTimeString()
+	SimulatorPtr m_simulator;
 
 	/// The stream used for packet sending events.
 	/// @see setPktSendStream()
@@ -229,12 +275,21 @@ private:
 	/// @see setAllStreams()
 	ostreamPtr m_debugStream;
 
+	/// Whether stats items are kept in memory.
+	/// @see setDoRecordStats()
+	bool m_doRecordStats;
+
+	/// The stats items kept in memory.
+	/// @see getRecordedStats()
+	vector<LoggedStat> m_recordedStats;
+
 	/// A constructor.
-	LogStreamManager();
+	/// @param simulator the simulator that owns this object.
+	LogStreamManager(SimulatorPtr simulator);
 
 	/// A destructor.
 	/// This is private to avoid smart pointers to this
-	/// class since it is a Singleton.
+	/// class since it is owned by its Simulator.
 	~LogStreamManager();
 
 	/**
@@ -269,6 +324,31 @@ private:
 	 */
 	string nodeIdString(const NodeId& nodeId) const;
 
+	/**
+	 * Keep a stats item in memory if recording is enabled.
+	 * @param nodeId the ID of the node logging the item or
+	 * the empty string for a global stat.
+	 * @param statsKeyString the key for the stat.
+	 * @param statsValueString the value of the stat.
+	 */
+	inline void recordStatsItem(const string& nodeId,
+		const string& statsKeyString, const string& statsValueString);
+
+	/**
+	 * Discard the stats items kept after the first few.
+	 * This is used when the simulator rolls back; items already
+	 * written to the streams cannot be taken back.
+	 * @param numStats the number of items to keep.
+	 */
+	inline void truncateRecordedStats(t_ulong numStats);
+
+	/**
+	 * Whether items logged to a stream are discarded.
+	 * @param stream the stream to check.
+	 * @return true if the stream has no buffer.
+	 */
+	static inline bool isDiscarded(const ostreamPtr& stream);
+
 };
 typedef LogStreamManager* LogStreamManagerPtr;
 
@@ -276,15 +356,6 @@ typedef LogStreamManager* LogStreamManagerPtr;
 // Inline Functions
 /////////////////////////////////////////////////
 
-inline LogStreamManagerPtr LogStreamManager::instance()
-{
-	// See the Singleton design pattern for an explanation.
-	if(m_instance == 0) {
-		m_instance = new LogStreamManager();
-	}
-	return m_instance;
-}
-
 inline void LogStreamManager::setAllStreams(ostreamPtr newStream)
 {
 	assert(newStream != 0);
@@ -347,6 +418,39 @@ inline void LogStreamManager::setDebugStream(ostreamPtr newStream)
 	m_debugStream = newStream;
 }
 
+inline void LogStreamManager::setDoRecordStats(bool doRecordStats)
+{
+	m_doRecordStats = doRecordStats;
+}
+
+inline const vector<LoggedStat>& LogStreamManager::getRecordedStats() const
+{
+	return m_recordedStats;
+}
+
+inline void LogStreamManager::recordStatsItem(const string& nodeId,
+	const string& statsKeyString, const string& statsValueString)
+{
+	if(m_doRecordStats) {
+		LoggedStat stat;
+		stat.m_nodeId = nodeId;
+		stat.m_key = statsKeyString;
+		stat.m_value = statsValueString;
+		m_recordedStats.push_back(stat);
+	}
+}
+
+inline void LogStreamManager::truncateRecordedStats(t_ulong numStats)
+{
+	assert(numStats <= m_recordedStats.size());
+	m_recordedStats.resize(numStats);
+}
+
+inline bool LogStreamManager::isDiscarded(const ostreamPtr& stream)
+{
+	return (stream->rdbuf() == 0);
+}
+
 ////////////////////////////////////////////////
 // Overloaded Operators
 /////////////////////////////////////////////////
@@ -2,6 +2,7 @@
 #include "mac_protocol.hpp"
 #include "packet.hpp"
 #include "link_layer.hpp"
+#include "state_checkpoint.hpp"
 
 const double SlottedMac::m_DEFAULT_SLOT_TIME = 2.0e-3;
 
@@ -34,6 +35,18 @@ void MacProtocol::unblockUpperQueues()
 	sharedLinkLayer->unblockUpperQueues();
 }
 
+bool MacProtocol::upperQueuesAreEmpty() const
+{
+	LinkLayerPtr sharedLinkLayer = m_linkLayer.lock();
+	return sharedLinkLayer->upperQueuesAreEmpty();
+}
+
+bool MacProtocol::upperQueuesAreUnblocked() const
+{
+	LinkLayerPtr sharedLinkLayer = m_linkLayer.lock();
+	return sharedLinkLayer->upperQueuesAreUnblocked();
+}
+
 bool MacProtocol::getQueueIsBlocked() const
 {
 	LinkLayerPtr sharedLinkLayer = m_linkLayer.lock();
@@ -49,11 +62,31 @@ bool MacProtocol::startSendTimer(
 
 	SendToLinkLayerEventPtr sendEvent = 
 		SendToLinkLayerEvent::create(thisMacProtocol(), direction, packet);
-	m_sendTimer = Timer::create(getNode(), sendEvent);
+	// Reuse the timer rather than creating a new one per packet.
+	if(m_sendTimer.get() == 0) {
+		m_sendTimer = Timer::create(getNode(), sendEvent);
+	} else {
+		m_sendTimer->setEvent(sendEvent);
+	}
 	bool wasSuccessful = m_sendTimer->start(delay);
 	return wasSuccessful;
 }
 
+void MacProtocol::saveState(StateCheckpoint& checkpoint)
+{
+	// The send timer changes its event for each packet.
+	checkpoint.save(m_sendTimer);
+	if(m_sendTimer.get() != 0) {
+		m_sendTimer->saveState(checkpoint);
+	}
+}
+
+void MacProtocol::resetState()
+{
+	// The timer is created again for the first packet.
+	m_sendTimer.reset();
+}
+
 bool MacProtocol::sendToLinkLayer(
 	CommunicationLayer::Directions direction, PacketPtr packet)
 {
@@ -102,4 +135,50 @@ bool MacProtocol::recvFromLinkLayer(
 	return wasSuccessful;
 }
 
+void SlottedMac::skipIdleSlots(const SimTime& resumeTime)
+{
+	t_ulong numSlots = m_slotTimer->getNumFiringsBefore(resumeTime);
+
+	// An idle slot is either the transmission slot, which
+	// just moves the slot number along, or ends the empty
+	// contention cycle, which sets it to one.  From the
+	// second idle slot on, the slot number repeats every
+	// other slot, so only the last few need to be stepped
+	// through.
+	if(numSlots > 3) {
+		numSlots = 2 + (numSlots % 2);
+	}
+	for(t_ulong i = 0; i < numSlots; ++i) {
+		if(m_currentSlotNumber == m_txSlotNumber) {
+			m_currentSlotNumber++;
+		} else {
+			m_currentSlotNumber = 1;
+		}
+	}
+}
+
+void SlottedMac::saveState(StateCheckpoint& checkpoint)
+{
+	MacProtocol::saveState(checkpoint);
+	checkpoint.save(m_currentSlotNumber);
+	checkpoint.save(m_txSlotNumber);
+	checkpoint.save(m_numberOfSlots);
+	checkpoint.save(m_packetToTransmit);
+	checkpoint.save(m_slotTime);
+	if(m_slotTimer.get() != 0) {
+		m_slotTimer->saveState(checkpoint);
+	}
+}
+
+void SlottedMac::resetState()
+{
+	MacProtocol::resetState();
+	m_currentSlotNumber = 0;
+	m_txSlotNumber = 0;
+	m_numberOfSlots = 0;
+	m_packetToTransmit.reset();
+	if(m_slotTimer.get() != 0) {
+		m_slotTimer->resetState();
+	}
+}
 
@@ -6,6 +6,7 @@
 
 #include "timer.hpp"
 #include "simulation_end_listener.hpp"
+#include "state_saver.hpp"
 
 class LinkLayer;
 typedef boost::shared_ptr<LinkLayer> LinkLayerPtr;
@@ -14,7 +15,7 @@ typedef boost::shared_ptr<LinkLayer> LinkLayerPtr;
  * The class for handling medium access control (MAC)
  * on a channel.
  */
-class MacProtocol : public SimulationEndListener {
+class MacProtocol : public SimulationEndListener, public StateSaver {
 friend class SendToLinkLayerEvent;
 public:
 	/// Smart pointer that clients should use.
@@ -53,6 +54,17 @@ public:
 		CommunicationLayer::Directions direction, PacketPtr packet,
 		const SimTime& delay);
 
+	/**
+	 * Save the MAC's send timer in a checkpoint.
+	 * @param checkpoint the checkpoint being taken.
+	 */
+	virtual void saveState(StateCheckpoint& checkpoint);
+
+	/**
+	 * Drop the MAC's send timer.
+	 */
+	virtual void resetState();
+
 	/**
 	 * Receives a packet from a sending layer.
 	 * @param direction the direction the packet was sent.
@@ -147,6 +159,20 @@ protected:
 	 */
 	void unblockUpperQueues();
 
+	/**
+	 * Determine whether the incoming queues from upper layers
+	 * are all empty.
+	 * @return true if they are empty.
+	 */
+	bool upperQueuesAreEmpty() const;
+
+	/**
+	 * Determine whether the incoming queues from upper layers
+	 * are all unblocked.
+	 * @return true if none of them is blocked.
+	 */
+	bool upperQueuesAreUnblocked() const;
+
 	/**
 	 * Determine whether incoming queues are currently blocked.
 	 * @return true if the are blocked.
@@ -188,13 +214,25 @@ public:
 	/// A destructor.
 	virtual ~SlottedMac() {};
 
+	/**
+	 * Save the MAC's contention cycle in a checkpoint.
+	 * @param checkpoint the checkpoint being taken.
+	 */
+	virtual void saveState(StateCheckpoint& checkpoint);
+
+	/**
+	 * Put the MAC back to before its first contention cycle.
+	 * The slot timer keeps its firing from the pending events.
+	 */
+	virtual void resetState();
+
 protected:
 
 	/// The default time per slot.
 	static const double m_DEFAULT_SLOT_TIME;
 
 	/// A timer for when each slot begins.
-	TimerPtr m_slotTimer;
+	PeriodicTimerPtr m_slotTimer;
 
 	/// The current slot number in the cycle.
 	t_uint m_currentSlotNumber;
@@ -221,6 +259,42 @@ protected:
 	 */
 	virtual void beginSlotEvent() = 0;
 
+	/**
+	 * Determine whether beginning the current slot only
+	 * changes the state of this node, so that it can be done
+	 * in parallel with the slots of other nodes.
+	 * @return true if beginSlotEvent() will be node-local.
+	 * By default, it is not.
+	 * @see Event::getLocalNode()
+	 */
+	virtual bool isSlotNodeLocal() const
+	{
+		return false;
+	}
+
+	/**
+	 * Determine whether beginning the current slot would only
+	 * move the slot number along, e.g., because the node is
+	 * not in a contention cycle and has nothing to send.
+	 * Such slots may be skipped by the simulator (see
+	 * Simulator::setDoSkipIdleTicks()).
+	 * @return true if beginSlotEvent() will be idle.
+	 * By default, it is not.
+	 * @see Event::isIdleTick()
+	 */
+	virtual bool isSlotIdle() const
+	{
+		return false;
+	}
+
+	/**
+	 * Move the slot number along as if each slot that begins
+	 * before a given time had been idle.
+	 * @param resumeTime the time from which slots begin again.
+	 * @see isSlotIdle()
+	 */
+	void skipIdleSlots(const SimTime& resumeTime);
+
 	/**
 	 * Set the time per slot.
 	 * @param slotTime the new time per slot.
@@ -228,6 +302,9 @@ protected:
 	inline void setSlotTime(const SimTime& slotTime)
 	{
 		m_slotTime = slotTime;
+		if(m_slotTimer.get() != 0) {
+			m_slotTimer->setPeriod(slotTime);
+		}
 	}
 
 	/**
@@ -279,7 +356,7 @@ typedef boost::shared_ptr<SlottedMac> SlottedMacPtr;
 class SlottedMacSlotEvent : public Event {
 public:
 	/// Smart pointer that clients should use.
-	typedef boost::shared_ptr<SlottedMacSlotEvent> SlottedMacSlotEventPtr;
+	typedef boost::intrusive_ptr<SlottedMacSlotEvent> SlottedMacSlotEventPtr;
 
 	/**
 	 * A factory method to ensure that all objects
@@ -297,6 +374,34 @@ public:
 		m_slottedMac->beginSlotEvent();
 	}
 
+	/// The slot is node-local if the MAC says so.
+	const Node* getLocalNode() const
+	{
+		const Node* node = 0;
+		if(m_slottedMac->isSlotNodeLocal()) {
+			node = m_slottedMac->getNode().get();
+		}
+		return node;
+	}
+
+	/// The slot is an idle tick if the MAC says so.
+	bool isIdleTick() const
+	{
+		return m_slottedMac->isSlotIdle();
+	}
+
+	/// Skip the MAC's idle slots.
+	void skipIdleTicks(const SimTime& resumeTime)
+	{
+		m_slottedMac->skipIdleSlots(resumeTime);
+	}
+
+	/// A slot begins once everything else at the time is done.
+	PriorityClasses getPriorityClass() const
+	{
+		return PriorityClasses_SlotStart;
+	}
+
 protected:
 
 	/// A constructor.
@@ -308,7 +413,7 @@ protected:
 private:
 	SlottedMacPtr m_slottedMac;
 };
-typedef boost::shared_ptr<SlottedMacSlotEvent> SlottedMacSlotEventPtr;
+typedef boost::intrusive_ptr<SlottedMacSlotEvent> SlottedMacSlotEventPtr;
 
 /**
  * The event for when a packet gets passed from a MAC
@@ -317,7 +422,7 @@ typedef boost::shared_ptr<SlottedMacSlotEvent> SlottedMacSlotEventPtr;
 class SendToLinkLayerEvent : public Event {
 public:
 	/// Smart pointer that clients should use.
-	typedef boost::shared_ptr<SendToLinkLayerEvent> 
+	typedef boost::intrusive_ptr<SendToLinkLayerEvent> 
 		SendToLinkLayerEventPtr;
 
 	/**
@@ -352,6 +457,6 @@ private:
 	CommunicationLayer::Directions m_direction;
 	PacketPtr m_packet;
 };
-typedef boost::shared_ptr<SendToLinkLayerEvent> SendToLinkLayerEventPtr;
+typedef boost::intrusive_ptr<SendToLinkLayerEvent> SendToLinkLayerEventPtr;
 
 #endif // MAC_PROTOCOL_H
@@ -5,9 +5,13 @@ using namespace std;
 #include <boost/random.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/weak_ptr.hpp>
+#include <boost/bind/bind.hpp>
 
 #include "simulator.hpp"
 #include "utility.hpp"
+#include "benchmark.hpp"
+#include "replication_runner.hpp"
+#include "parallel_simulator.hpp"
 
 #include "fading.hpp"
 #include "path_loss.hpp"
@@ -18,6 +22,7 @@ using namespace std;
 #include "rfid_reader_app.hpp"
 #include "rfid_tag_phy.hpp"
 #include "rfid_tag_mac.hpp"
+#include "rfid_tag_process_mac.hpp"
 #include "rfid_tag_app.hpp"
 #include "packet.hpp"
 #include "rand_num_generator.hpp"
@@ -28,7 +33,26 @@ using namespace std;
 
 void unitTestEventQueue(SimulatorPtr sim);
 
-void packetSendTest();
+void packetSendTest(double stopIdleTime, bool doStopWhenAllRead,
+	bool doStopEarly, bool doProcessTags);
+
+void packetSendScenario(SimulatorPtr simulator, t_uint currentPowerLevel,
+	ParallelSimulatorPtr parallelSimulator);
+
+void buildPacketSendScenario(SimulatorPtr simulator,
+	t_uint currentPowerLevel, ParallelSimulatorPtr parallelSimulator,
+	vector<RfidReaderAppPtr>& readerAppVector,
+	vector<RfidTagAppPtr>& tagAppVector, bool doProcessTags);
+
+void packetSendParallelTest(t_uint numPartitions, t_uint numThreads,
+	t_uint seed, double optimisticWindow);
+
+void packetSendForkTest(double warmUpTime, t_uint numVariants,
+	t_uint seed);
+
+void packetSendRerunTest(t_uint numRuns, t_uint seed);
+
+void printRecordedStats(vector<LoggedStat> stats);
 
 void randomTest();
 
@@ -60,34 +84,151 @@ typedef boost::shared_ptr<Foo> FooPtr;
 int main(int argc, char *argv[])
 {
 	SimulatorPtr s = Simulator::instance();
+	bool doPrintEventStats = false;
+	t_uint numReplications = 0;
+	t_uint numThreads = 0;
+	t_uint firstSeed = 1;
+	t_uint numPartitions = 0;
+	double optimisticWindow = 0.0;
+	double warmUpTime = 0.0;
+	t_uint numVariants = 2;
+	t_uint numReruns = 0;
+	double stopIdleTime = 0.0;
+	bool doStopWhenAllRead = false;
+	bool doStopEarly = true;
+	bool doProcessTags = false;
+
+	// Parse the command line options.
+	for(int i = 1; i < argc; ++i) {
+		string option(argv[i]);
+		if(option == "-eventQueue" && (i + 1) < argc) {
+			EventQueue::QueueTypes queueType;
+			if(!EventQueue::parseQueueType(argv[++i], queueType)) {
+				cerr << "Unknown event queue type: " << argv[i] << "\n";
+				return 1;
+			}
+			s->setEventQueueType(queueType);
+		} else if(option == "-noTimerWheel") {
+			s->setDoTimerWheel(false);
+		} else if(option == "-noEventHorizon") {
+			s->setDoEventHorizon(false);
+		} else if(option == "-priorityClasses") {
+			s->usePriorityClasses();
+		} else if(option == "-bundleThreads" && (i + 1) < argc) {
+			s->setNumBundleThreads(atoi(argv[++i]));
+		} else if(option == "-eventStats") {
+			doPrintEventStats = true;
+		} else if(option == "-profile") {
+#ifdef RFIDSIM_PROFILING
+			ostreamPtr profileStream(new ostream(cout.rdbuf()));
+			EventProfiler::create(s, profileStream);
+#else
+			cerr << "Profiling requires building with " <<
+				"-DRFIDSIM_PROFILING\n";
+			return 1;
+#endif
+		} else if(option == "-benchmark") {
+			runBenchmarks(cout);
+			return 0;
+		} else if(option == "-replications" && (i + 1) < argc) {
+			numReplications = atoi(argv[++i]);
+		} else if(option == "-threads" && (i + 1) < argc) {
+			numThreads = atoi(argv[++i]);
+		} else if(option == "-seed" && (i + 1) < argc) {
+			firstSeed = atoi(argv[++i]);
+		} else if(option == "-partitions" && (i + 1) < argc) {
+			numPartitions = atoi(argv[++i]);
+		} else if(option == "-optimisticWindow" && (i + 1) < argc) {
+			optimisticWindow = atof(argv[++i]);
+		} else if(option == "-warmUp" && (i + 1) < argc) {
+			warmUpTime = atof(argv[++i]);
+		} else if(option == "-variants" && (i + 1) < argc) {
+			numVariants = atoi(argv[++i]);
+		} else if(option == "-reruns" && (i + 1) < argc) {
+			numReruns = atoi(argv[++i]);
+		} else if(option == "-stopWhenIdle" && (i + 1) < argc) {
+			stopIdleTime = atof(argv[++i]);
+		} else if(option == "-stopWhenAllRead") {
+			doStopWhenAllRead = true;
+		} else if(option == "-reportStopOnly") {
+			doStopEarly = false;
+		} else if(option == "-skipIdleTicks") {
+			s->setDoSkipIdleTicks(true);
+		} else if(option == "-processTags") {
+			doProcessTags = true;
+		} else {
+			cerr << "Usage: " << argv[0] <<
+				" [-eventQueue multiset|heap|calendar] [-eventStats]" <<
+				" [-noTimerWheel] [-noEventHorizon] [-profile]" <<
+				" [-benchmark]\n" <<
+				"       [-bundleThreads n]\n" <<
+				"       [-replications n [-threads n] [-seed n]]\n" <<
+				"       [-partitions n [-threads n] [-seed n]" <<
+				" [-optimisticWindow s]]\n" <<
+				"       [-warmUp s [-variants n] [-seed n]]\n" <<
+				"       [-reruns n [-seed n]]\n" <<
+				"       [-stopWhenIdle s] [-stopWhenAllRead]" <<
+				" [-reportStopOnly] [-skipIdleTicks]\n" <<
+				"       [-processTags] [-priorityClasses]\n";
+			return 1;
+		}
+	}
+
+	if(numReplications > 0) {
+		t_uint currentPowerLevel = 2;
+		ReplicationRunnerPtr runner = ReplicationRunner::create(
+			boost::bind(&packetSendScenario, boost::placeholders::_1,
+			currentPowerLevel, ParallelSimulatorPtr()));
+		runner->setNumReplications(numReplications);
+		runner->setNumThreads(numThreads);
+		runner->setFirstSeed(firstSeed);
+		runner->run();
+		runner->printResults(cout);
+		return 0;
+	}
+
+	if(numPartitions > 0) {
+		packetSendParallelTest(numPartitions, numThreads, firstSeed,
+			optimisticWindow);
+		return 0;
+	}
+
+	if(warmUpTime > 0.0) {
+		packetSendForkTest(warmUpTime, numVariants, firstSeed);
+		return 0;
+	}
+
+	if(numReruns > 0) {
+		packetSendRerunTest(numReruns, firstSeed);
+		return 0;
+	}
+
 	DummyEventPtr e1 = DummyEvent::create();
 	SimTime st(2.0);
 	s->scheduleEvent(e1, st);
 	//s->runSimulation();
 	s->reset();
 
-	packetSendTest();
+	packetSendTest(stopIdleTime, doStopWhenAllRead, doStopEarly,
+		doProcessTags);
 	//randomTest();
 
+	if(doPrintEventStats) {
+		EventPool::instance()->printStats(cout,
+			s->currentTime().getTimeInSeconds());
+	}
+
 	/*
 	unitTestEventQueue(s);
 	*/
 
 }
 
-void packetSendTest()
+void packetSendTest(double stopIdleTime, bool doStopWhenAllRead,
+	bool doStopEarly, bool doProcessTags)
 {
 
 	t_uint currentPowerLevel = 2;
-	t_uint numTags = 50;
-	t_uint numReaders = 1;
-	t_uint numChannels = (numReaders + 1);
-	bool doCollocation = false;
-	t_uint allChannelId = 0;
-	WirelessChannelPtr channels[numChannels];
-
-	if(doCollocation)
-		numReaders *= 2;
 
 	ostringstream outputFileName;
 	outputFileName << "out" << currentPowerLevel << ".txt";
@@ -99,8 +240,237 @@ void packetSendTest()
 	ostreamPtr statsStream(new ofstream(statsFileName.str().c_str()));
 	LogStreamManager::instance()->setStatsStream(statsStream);
 
+	SimulatorPtr simulator = Simulator::instance();
+	vector<RfidReaderAppPtr> readerAppVector;
+	vector<RfidTagAppPtr> tagAppVector;
+	buildPacketSendScenario(simulator, currentPowerLevel,
+		ParallelSimulatorPtr(), readerAppVector, tagAppVector,
+		doProcessTags);
+
+	// Optionally end the run once it has nothing left to do.
+	if(doStopWhenAllRead) {
+		TagsReadStopConditionPtr tagsReadCondition =
+			TagsReadStopCondition::create(tagAppVector.size());
+		for(t_uint i = 0; i < readerAppVector.size(); ++i) {
+			tagsReadCondition->addReader(readerAppVector[i]);
+		}
+		simulator->addStopCondition(tagsReadCondition);
+	}
+	if(stopIdleTime > 0.0) {
+		ApplicationIdleStopConditionPtr idleCondition =
+			ApplicationIdleStopCondition::create(SimTime(stopIdleTime));
+		for(t_uint i = 0; i < readerAppVector.size(); ++i) {
+			idleCondition->addApplication(readerAppVector[i]);
+		}
+		for(t_uint i = 0; i < tagAppVector.size(); ++i) {
+			idleCondition->addApplication(tagAppVector[i]);
+		}
+		simulator->addStopCondition(idleCondition);
+	}
+	simulator->setDoStopEarly(doStopEarly);
+
+	simulator->runSimulation(SimTime(20.0));
+
+	SimTime stopConditionTime;
+	if(simulator->getStopConditionTime(stopConditionTime)) {
+		cout << "Stop condition met at " << stopConditionTime <<
+			" (wasted time " << simulator->getWastedTime() << ")\n";
+	}
+
+}
+
+/**
+ * Orders stats items by node ID so that the output of a
+ * parallel run does not depend on the partitioning.
+ */
+struct LoggedStatNodeIdLess {
+	/// @return true if \c lhs belongs before \c rhs.
+	bool operator() (const LoggedStat& lhs, const LoggedStat& rhs) const
+	{
+		if(lhs.m_nodeId.size() != rhs.m_nodeId.size()) {
+			return lhs.m_nodeId.size() < rhs.m_nodeId.size();
+		}
+		return lhs.m_nodeId < rhs.m_nodeId;
+	}
+};
+
+void packetSendParallelTest(t_uint numPartitions, t_uint numThreads,
+	t_uint seed, double optimisticWindow)
+{
+
+	t_uint currentPowerLevel = 2;
+
+	ParallelSimulatorPtr parallelSimulator =
+		ParallelSimulator::create(numPartitions);
+	parallelSimulator->setNumThreads(numThreads);
+	parallelSimulator->setOptimisticWindow(SimTime(optimisticWindow));
+	parallelSimulator->seedRandNumGenerators(seed);
+	// The tags are spread over a few meters, so use small
+	// regions to give each partition some of them.
+	parallelSimulator->setRegionSize(1.0);
+
+	// The partitions log concurrently, so their stats are
+	// kept in memory and printed in a fixed order afterwards.
+	ostreamPtr discardStream(new ostream(0));
+	for(t_uint i = 0; i < numPartitions; ++i) {
+		LogStreamManagerPtr logStreamManager =
+			parallelSimulator->getPartition(i)->getLogStreamManager();
+		logStreamManager->setAllStreams(discardStream);
+		logStreamManager->setDoRecordStats(true);
+	}
+
+	packetSendScenario(parallelSimulator->getPartition(0),
+		currentPowerLevel, parallelSimulator);
+
+	vector<LoggedStat> stats;
+	for(t_uint i = 0; i < numPartitions; ++i) {
+		const vector<LoggedStat>& partitionStats = parallelSimulator->
+			getPartition(i)->getLogStreamManager()->getRecordedStats();
+		stats.insert(stats.end(), partitionStats.begin(),
+			partitionStats.end());
+	}
+
+	cout << "Partitions: " << numPartitions << " (threads " <<
+		parallelSimulator->getNumThreads() << ", lookahead " <<
+		parallelSimulator->getLookahead() << ", windows " <<
+		parallelSimulator->getNumWindows() << ", remote actions " <<
+		parallelSimulator->getNumRemoteActions() << ", rollbacks " <<
+		parallelSimulator->getNumRollbacks() << ")\n";
+	printRecordedStats(stats);
+
+}
+
+void packetSendForkTest(double warmUpTime, t_uint numVariants,
+	t_uint seed)
+{
+
+	t_uint currentPowerLevel = 2;
+	SimulatorPtr simulator = Simulator::instance();
+	simulator->seedRandNumGenerator(seed);
+
+	// Each variant's stats are kept in memory so that they
+	// are rolled back along with the rest of the state.
+	ostreamPtr discardStream(new ostream(0));
+	LogStreamManagerPtr logStreamManager =
+		simulator->getLogStreamManager();
+	logStreamManager->setAllStreams(discardStream);
+	logStreamManager->setDoRecordStats(true);
+
+	vector<RfidReaderAppPtr> readerAppVector;
+	vector<RfidTagAppPtr> tagAppVector;
+	buildPacketSendScenario(simulator, currentPowerLevel,
+		ParallelSimulatorPtr(), readerAppVector, tagAppVector, false);
+
+	// Run the shared warm-up once and fork each variant
+	// from its end.
+	simulator->runEvents(SimTime(warmUpTime), false);
+	simulator->saveState();
+	for(t_uint i = 0; i < numVariants; ++i) {
+		// The first variant continues the warm-up unchanged,
+		// the others draw different random numbers from there.
+		t_uint variantSeed = seed + i;
+		if(i > 0) {
+			simulator->seedRandNumGenerator(variantSeed);
+		}
+		simulator->runSimulation(SimTime(20.0));
+
+		cout << "Variant: " << i << " (warm-up " << warmUpTime <<
+			", seed " << variantSeed << ")\n";
+		printRecordedStats(logStreamManager->getRecordedStats());
+		simulator->restoreState();
+	}
+	simulator->commitState();
+
+}
+
+void packetSendRerunTest(t_uint numRuns, t_uint seed)
+{
+
+	t_uint currentPowerLevel = 2;
+	SimulatorPtr simulator = Simulator::instance();
+	simulator->seedRandNumGenerator(seed);
+
+	ostreamPtr discardStream(new ostream(0));
+	LogStreamManagerPtr logStreamManager =
+		simulator->getLogStreamManager();
+	logStreamManager->setAllStreams(discardStream);
+	logStreamManager->setDoRecordStats(true);
+
+	// The scenario is built once and each run after the
+	// first resets it rather than building it again.
+	vector<RfidReaderAppPtr> readerAppVector;
+	vector<RfidTagAppPtr> tagAppVector;
+	buildPacketSendScenario(simulator, currentPowerLevel,
+		ParallelSimulatorPtr(), readerAppVector, tagAppVector, false);
+
+	for(t_uint i = 0; i < numRuns; ++i) {
+		t_uint runSeed = seed + i;
+		if(i > 0) {
+			simulator->resetState();
+			simulator->seedRandNumGenerator(runSeed);
+		}
+		simulator->runSimulation(SimTime(20.0));
+
+		cout << "Run: " << i << " (seed " << runSeed << ")\n";
+		printRecordedStats(logStreamManager->getRecordedStats());
+	}
+
+}
+
+void printRecordedStats(vector<LoggedStat> stats)
+{
+
+	stable_sort(stats.begin(), stats.end(), LoggedStatNodeIdLess());
+	for(t_uint i = 0; i < stats.size(); ++i) {
+		string nodeId = stats[i].m_nodeId;
+		if(nodeId.empty()) {
+			nodeId = "global";
+		}
+		cout << nodeId << " -" << stats[i].m_key << " " <<
+			stats[i].m_value << "\n";
+	}
+
+}
+
+void packetSendScenario(SimulatorPtr simulator, t_uint currentPowerLevel,
+	ParallelSimulatorPtr parallelSimulator)
+{
+
+	vector<RfidReaderAppPtr> readerAppVector;
+	vector<RfidTagAppPtr> tagAppVector;
+	buildPacketSendScenario(simulator, currentPowerLevel,
+		parallelSimulator, readerAppVector, tagAppVector, false);
+	if(parallelSimulator.get() != 0) {
+		parallelSimulator->runSimulation(SimTime(20.0));
+	} else {
+		simulator->runSimulation(SimTime(20.0));
+	}
+
+}
+
+void buildPacketSendScenario(SimulatorPtr simulator,
+	t_uint currentPowerLevel, ParallelSimulatorPtr parallelSimulator,
+	vector<RfidReaderAppPtr>& readerAppVector,
+	vector<RfidTagAppPtr>& tagAppVector, bool doProcessTags)
+{
+
+	t_uint numTags = 50;
+	t_uint numReaders = 1;
+	t_uint numChannels = (numReaders + 1);
+	bool doCollocation = false;
+	t_uint allChannelId = 0;
+	WirelessChannelPtr channels[numChannels];
+
+	if(doCollocation)
+		numReaders *= 2;
+
 	WirelessChannelManagerPtr channelManager = 
 		WirelessChannelManager::create();
+	// Signals reaching another partition must be delayed by
+	// their propagation delay to give the partitions lookahead.
+	if(parallelSimulator.get() != 0) {
+		channelManager->setDoPropagateSignalStart(true);
+	}
 	for(t_uint i = 0; i < numChannels; ++i) {
 		TwoRayPtr twoRay = TwoRay::create();
 		RiceanPtr ricean = Ricean::create();
@@ -109,10 +479,8 @@ void packetSendTest()
 		channelManager->addChannel(i, channels[i]);
 	}
 
-	RandNumGeneratorPtr rand = 
-		Simulator::instance()->getRandNumGenerator();
+	RandNumGeneratorPtr rand = simulator->getRandNumGenerator();
 
-	vector<RfidReaderAppPtr> readerAppVector;
 	for(t_uint i = 0; i < numReaders; ++i) {
 		double locationStep = 4.8;
 		// Nodes cannot be collocated exactly or else the path loss
@@ -124,22 +492,28 @@ void packetSendTest()
 			location.setCoordinates(
 				(epsilon * i) + (locationStep * floor(i / 2.0)),0,0);
 		}
-		NodePtr readerNode = Node::create(location, NodeId(i));
+		t_uint channelId = (i + 1);
+		// Keep the same channel id for collocated nodes.
+		if(doCollocation)
+			channelId = static_cast<t_uint>(floor(i / 2.0) + 1);
+		assert(channelId < numChannels);
+		SimulatorPtr nodeSimulator = simulator;
+		if(parallelSimulator.get() != 0) {
+			nodeSimulator = parallelSimulator->partitionFor(location,
+				channelId);
+		}
+		NodePtr readerNode = Node::create(location, NodeId(i),
+			nodeSimulator);
 
 		ostringstream userDefinedStream;
 		userDefinedStream << "Reader ID: " << readerNode->getNodeId() <<
 			" Location: " << readerNode->getLocation();
-		LogStreamManager::instance()->logUserDefinedItem(
+		simulator->getLogStreamManager()->logUserDefinedItem(
 			userDefinedStream.str());
 	
 		RfidReaderPhyPtr readerPhy = 
 			RfidReaderPhy::create(readerNode, channelManager);
 		readerPhy->setAllSendersChannel(allChannelId);
-		t_uint channelId = (i + 1);
-		// Keep the same channel id for collocated nodes.
-		if(doCollocation)
-			channelId = static_cast<t_uint>(floor(i / 2.0) + 1);
-		assert(channelId < numChannels);
 		readerPhy->setRegularChannel(channelId);
 	
 		RfidReaderAppPtr readerApp = RfidReaderApp::create(
@@ -170,9 +544,9 @@ void packetSendTest()
 				(staggerStep * startTime));
 		}
 		readerApp->start(readerAppStartTime);
+		readerAppVector.push_back(readerApp);
 	}
 
-	vector<RfidTagAppPtr> tagAppVector;
 	for(t_uint i = 0; i < numTags; ++i) {
 		double locationFactor = numReaders;
 		if(doCollocation)
@@ -183,12 +557,18 @@ void packetSendTest()
 		if(i == 1)
 			location.setCoordinates(0,0,0.1);
 		*/
-		NodePtr tagNode = Node::create(location, NodeId(numReaders+i));
+		SimulatorPtr nodeSimulator = simulator;
+		if(parallelSimulator.get() != 0) {
+			nodeSimulator = parallelSimulator->partitionFor(location,
+				allChannelId);
+		}
+		NodePtr tagNode = Node::create(location, NodeId(numReaders+i),
+			nodeSimulator);
 
 		ostringstream userDefinedStream;
 		userDefinedStream << "Tag ID: " << tagNode->getNodeId() <<
 			" Location: " << tagNode->getLocation();
-		LogStreamManager::instance()->logUserDefinedItem(
+		simulator->getLogStreamManager()->logUserDefinedItem(
 			userDefinedStream.str());
 
 		RfidTagPhyPtr tagPhy = RfidTagPhy::create(tagNode, channelManager);
@@ -196,16 +576,29 @@ void packetSendTest()
 	
 		RfidTagAppPtr tagApp = RfidTagApp::create(tagNode);
 	
-		RfidTagMacPtr tagMac = RfidTagMac::create(tagNode, tagApp);
+		// The process variant cannot be rolled back, so it
+		// is only used for plain runs.
+		RfidTagMacPtr tagMac;
+		if(doProcessTags) {
+			tagMac = RfidTagProcessMac::create(tagNode, tagApp);
+		} else {
+			tagMac = RfidTagMac::create(tagNode, tagApp);
+		}
 		LinkLayerPtr tagLink = LinkLayer::create(tagNode, tagMac);
 	
 		tagApp->insertLowerLayer(tagLink);
 		tagLink->insertLowerLayer(tagPhy);
 	
 		tagApp->start(SimTime(0.0));
+		tagAppVector.push_back(tagApp);
 	}
 
-	Simulator::instance()->runSimulation(SimTime(20.0));
+	if(parallelSimulator.get() != 0) {
+		SimTime lookahead;
+		if(channelManager->getMinRemotePropagationDelay(lookahead)) {
+			parallelSimulator->setLookahead(lookahead);
+		}
+	}
 
 }
 
@@ -1,11 +1,22 @@
 
 #include "node.hpp"
 #include "simulator.hpp"
+#include "rand_num_generator.hpp"
 
-Node::Node(const Location& location, const NodeId& nodeId)
-	: m_location(location), m_nodeId(nodeId)
-{
+const t_uint Node::m_SEED_MULTIPLIER = 2654435761u;
+boost::atomic<t_ulong> Node::m_nextLocationVersion(1);
 
+Node::Node(const Location& location, const NodeId& nodeId,
+	SimulatorPtr simulator)
+	: m_location(location), m_locationVersion(m_nextLocationVersion++),
+	m_nodeId(nodeId), m_simulator(simulator),
+	m_randNumGeneratorCheckpointId(0), m_randNumGeneratorResetNumber(0)
+{
+	// Without an explicit simulator, the node lives in the
+	// one that is current when it is created.
+	if(m_simulator == 0) {
+		m_simulator = Simulator::instance();
+	}
 }
 
 /*
@@ -33,19 +44,70 @@ SimTime Node::currentTime() const
 {
 	// If local clock drift is desired, it could be added
 	// here.
-	return Simulator::instance()->currentTime();
+	return m_simulator->currentTime();
 }
 
 bool Node::scheduleEvent(EventPtr eventToSchedule,
 	const SimTime& eventDelay)
 {
-	return Simulator::instance()->scheduleEvent(
-		eventToSchedule, eventDelay);
+	return m_simulator->scheduleEvent(eventToSchedule, eventDelay);
+}
+
+bool Node::scheduleEventAt(EventPtr eventToSchedule,
+	const SimTime& fireTime)
+{
+	return m_simulator->scheduleEventAt(eventToSchedule, fireTime);
+}
+
+bool Node::scheduleTimerEvent(EventPtr eventToSchedule,
+	const SimTime& eventDelay)
+{
+	return m_simulator->scheduleTimerEvent(eventToSchedule, eventDelay);
 }
 
 bool Node::cancelEvent(EventPtr eventToCancel)
 {
-	return Simulator::instance()->cancelEvent(eventToCancel);
+	return m_simulator->cancelEvent(eventToCancel);
 }
 
+void Node::setLocation(const Location& location)
+{
+	m_location = location;
+	m_locationVersion = m_nextLocationVersion++;
+}
+
+RandNumGeneratorPtr Node::getRandNumGenerator()
+{
+	if(!m_simulator->getDoNodeRandomStreams()) {
+		return m_simulator->getRandNumGenerator();
+	}
+
+	// The stream is saved incrementally: only the nodes that
+	// draw numbers after a checkpoint is taken pay for saving
+	// their generator.
+	StateCheckpointPtr checkpoint = m_simulator->getStateCheckpoint();
+	if(checkpoint.get() != 0 &&
+			checkpoint->getId() != m_randNumGeneratorCheckpointId) {
+		checkpoint->save(m_randNumGenerator);
+		if(m_randNumGenerator.get() != 0) {
+			m_randNumGenerator->saveState(*checkpoint);
+		}
+		m_randNumGeneratorCheckpointId = checkpoint->getId();
+	}
+
+	// The simulator was reset, so the stream starts again
+	// from the simulator's seed.
+	if(m_randNumGeneratorResetNumber != m_simulator->getNumStateResets()) {
+		m_randNumGenerator.reset();
+		m_randNumGeneratorResetNumber = m_simulator->getNumStateResets();
+	}
+
+	if(m_randNumGenerator.get() == 0) {
+		m_randNumGenerator = RandNumGenerator::create();
+		t_uint seed = m_simulator->getRandNumGenerator()->getSeed() ^
+			(m_nodeId.getNumericValue() * m_SEED_MULTIPLIER);
+		m_randNumGenerator->setSeed(seed);
+	}
+	return m_randNumGenerator;
+}
 
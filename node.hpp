@@ -8,13 +8,19 @@
 using namespace std;
 #include <boost/shared_ptr.hpp>
 #include <boost/enable_shared_from_this.hpp>
+#include <boost/atomic.hpp>
 
 #include "sim_time.hpp"
 #include "communication_layer.hpp"
 #include "location.hpp"
 
-class Event;
-typedef boost::shared_ptr<Event> EventPtr;
+#include "event.hpp"
+#include "process.hpp"
+
+class Simulator;
+typedef Simulator* SimulatorPtr;
+class RandNumGenerator;
+typedef boost::shared_ptr<RandNumGenerator> RandNumGeneratorPtr;
 
 ////////////////////////////////////////////////
 // Node Id Class
@@ -172,12 +178,49 @@ public:
 	static inline NodePtr create(const Location& location, 
 		const NodeId& nodeId);
 
+	/**
+	 * A factory method to ensure that all objects
+	 * are created via \c new since we are using smart pointers. 
+	 * @param location the location object for this node.
+	 * @param nodeId the ID of this node.
+	 * @param simulator the simulator in which the node lives.
+	 */
+	static inline NodePtr create(const Location& location, 
+		const NodeId& nodeId, SimulatorPtr simulator);
+
+	/**
+	 * Get the simulator in which this node lives.
+	 * @return a pointer to the node's simulator.
+	 */
+	inline SimulatorPtr getSimulator() const;
+
 	/**
 	 * Get a copy of the location of this node.
 	 * @return a copy of the location of this node.
 	 */
 	inline Location getLocation() const;
 
+	/**
+	 * Move the node.  The physical layers of the node that
+	 * listen on a channel must then be moved in their
+	 * WirelessChannelManager with
+	 * WirelessChannelManager::updateListenerLocation().
+	 * The location is not part of the simulator's checkpoints.
+	 * @param location the new location of the node.
+	 * @see getLocationVersion()
+	 */
+	void setLocation(const Location& location);
+
+	/**
+	 * Get the version of the node's location, which changes
+	 * each time that the node moves.  No two nodes share a
+	 * version, so the version identifies both the node and its
+	 * location, e.g., for caching the gain of a link between
+	 * two nodes.
+	 * @return the version of the location.
+	 */
+	inline t_ulong getLocationVersion() const;
+
 	/**
 	 * Get a copy of the ID of this node.
 	 * @return a copy of the ID of this node.
@@ -203,6 +246,29 @@ public:
 	bool scheduleEvent(EventPtr eventToSchedule,
 		const SimTime& eventDelay);
 
+	/**
+	 * Add an event to the simulator's event queue at an
+	 * absolute time.
+	 * @param eventToSchedule a pointer to the event being scheduled.
+	 * @param fireTime the time at which the event will fire,
+	 * which cannot be before currentTime().
+	 * @return true if the event was successfully scheduled.
+	 * @see scheduleEvent()
+	 */
+	bool scheduleEventAt(EventPtr eventToSchedule,
+		const SimTime& fireTime);
+
+	/**
+	 * Add the event of a timer to the simulator's event queue.
+	 * @param eventToSchedule a pointer to the event being scheduled.
+	 * @param eventDelay how far in the future (from the node's local
+	 * time) the event should be scheduled.
+	 * @return true if the event was successfully scheduled.
+	 * @see Simulator::scheduleTimerEvent()
+	 */
+	bool scheduleTimerEvent(EventPtr eventToSchedule,
+		const SimTime& eventDelay);
+
 	/**
 	 * Cancel an event from the event queue.
 	 * @param eventToCancel a pointer to the event being cancelled.
@@ -211,12 +277,50 @@ public:
 	 */
 	bool cancelEvent(EventPtr eventToCancel);
 
+	/**
+	 * Get the random number generator the node should use.
+	 * This is the simulator's generator unless the simulator
+	 * gives each node its own stream.
+	 * @return pointer to the node's random number generator.
+	 * @see Simulator::setDoNodeRandomStreams()
+	 */
+	RandNumGeneratorPtr getRandNumGenerator();
+
+	/**
+	 * Wait for a time in a Process running on this node,
+	 * i.e., <tt>co_await node->sleep(delay)</tt>.
+	 * @param delay how far in the future the process resumes.
+	 * @return the awaitable.
+	 */
+	inline ProcessSleep sleep(const SimTime& delay) const;
+
+	/**
+	 * Wait for a packet in a Process running on this node,
+	 * i.e., <tt>PacketPtr packet = co_await node->recvPacket()</tt>.
+	 * @return the awaitable, which gives the next packet
+	 * delivered to the process.
+	 * @see Process::deliverPacket()
+	 */
+	inline ProcessRecv recvPacket() const;
+
+	/**
+	 * Wait for a packet for at most a given time in a Process
+	 * running on this node.
+	 * @param timeout the longest time to wait.
+	 * @return the awaitable, which gives the next packet
+	 * delivered to the process or an empty pointer if none
+	 * was delivered in time.
+	 */
+	inline ProcessRecv recvPacket(const SimTime& timeout) const;
+
 protected:
 
 	/// A constructor.
 	/// @param location the location object for this node.
 	/// @param nodeId the ID for this node.
-	Node(const Location& location, const NodeId& nodeId);
+	/// @param simulator the simulator in which the node lives.
+	Node(const Location& location, const NodeId& nodeId,
+		SimulatorPtr simulator);
 
 private:
 
@@ -224,10 +328,41 @@ private:
 	/// @see getLocation()
 	Location m_location;
 
+	/// The version of the node's location.
+	/// @see getLocationVersion()
+	t_ulong m_locationVersion;
+
 	/// The ID of this node.
 	/// @see getNodeId()
 	NodeId m_nodeId;
 
+	/// The simulator in which the node lives.
+	/// @see getSimulator()
+	SimulatorPtr m_simulator;
+
+	/// The node's own random number stream, which is created
+	/// the first time that it is needed.
+	/// @see getRandNumGenerator()
+	RandNumGeneratorPtr m_randNumGenerator;
+
+	/// The ID of the last checkpoint in which the random
+	/// number stream was saved.
+	/// @see Simulator::getStateCheckpoint()
+	t_ulong m_randNumGeneratorCheckpointId;
+
+	/// The number of simulator resets when the random number
+	/// stream was created.
+	/// @see Simulator::getNumStateResets()
+	t_ulong m_randNumGeneratorResetNumber;
+
+	/// Multiplier used to spread node IDs over the seed space.
+	static const t_uint m_SEED_MULTIPLIER;
+
+	/// The next version given to a location.  Nodes may be
+	/// created on several threads, e.g., by a ReplicationRunner.
+	/// Zero is never given.
+	static boost::atomic<t_ulong> m_nextLocationVersion;
+
 };
 typedef boost::shared_ptr<Node> NodePtr;
 
@@ -238,20 +373,53 @@ typedef boost::shared_ptr<Node> NodePtr;
 inline NodePtr Node::create(const Location& location, 
 	const NodeId& nodeId)
 {
-	NodePtr p(new Node(location, nodeId));
+	NodePtr p(new Node(location, nodeId, 0));
 	return p;
 }
 
+inline NodePtr Node::create(const Location& location, 
+	const NodeId& nodeId, SimulatorPtr simulator)
+{
+	assert(simulator != 0);
+	NodePtr p(new Node(location, nodeId, simulator));
+	return p;
+}
+
+inline SimulatorPtr Node::getSimulator() const
+{
+	return m_simulator;
+}
+
 inline Location Node::getLocation() const
 {
 	return m_location;
 }
 
+inline t_ulong Node::getLocationVersion() const
+{
+	return m_locationVersion;
+}
+
 inline NodeId Node::getNodeId() const
 {
 	return m_nodeId;
 }
 
+inline ProcessSleep Node::sleep(const SimTime& delay) const
+{
+	return ProcessSleep(this, delay);
+}
+
+inline ProcessRecv Node::recvPacket() const
+{
+	return ProcessRecv(this, false, SimTime(0.0));
+}
+
+inline ProcessRecv Node::recvPacket(const SimTime& timeout) const
+{
+	return ProcessRecv(this, true, timeout);
+}
+
 ////////////////////////////////////////////////
 // Overloaded Operators
 /////////////////////////////////////////////////
@@ -1,16 +1,16 @@
 
 #include "packet.hpp"
+#include "simulator.hpp"
 
 const t_uint Packet::m_DEFAULT_SIZE_IN_BYTES = 512;
 const double Packet::m_DEFAULT_DATA_RATE = 1e6;
 const t_uint Packet::m_DEFAULT_DESTINATION = 0;
 
-t_ulong Packet::m_nextUniqueId = 1;
-
 Packet::Packet()
 	: m_dataRate(m_DEFAULT_DATA_RATE),
 	m_txPower(0.0), m_doMaxTxPower(false), m_hasError(false),
-	m_destination(m_DEFAULT_DESTINATION), m_uniqueId(0)
+	m_destination(m_DEFAULT_DESTINATION), m_uniqueId(0),
+	m_checkpointId(Simulator::instance()->getStateCheckpointId())
 {
 
 }
@@ -20,10 +20,19 @@ Packet::~Packet()
 
 }
 
+PacketPtr Packet::create()
+{
+	PacketPtr p(new Packet());
+	p->m_uniqueId = Simulator::instance()->nextPacketUniqueId();
+	return p;
+}
+
 Packet::Packet(const Packet& rhs)
-	: m_dataRate(rhs.m_dataRate), m_txPower(rhs.m_txPower), 
+	: m_dataRate(rhs.m_dataRate), m_txPower(rhs.m_txPower),
+	m_doMaxTxPower(rhs.m_doMaxTxPower),
 	m_hasError(rhs.m_hasError),
-	m_destination(rhs.m_destination), m_uniqueId(rhs.m_uniqueId)
+	m_destination(rhs.m_destination), m_uniqueId(rhs.m_uniqueId),
+	m_checkpointId(Simulator::instance()->getStateCheckpointId())
 {
 	// Create a deep copy of the packet's data
 	if(rhs.m_data.begin() != rhs.m_data.end()) {
@@ -42,6 +51,7 @@ PacketPtr Packet::clone() const
 
 void Packet::addData(Packet::DataTypes dataType, const PacketData& data)
 {
+	saveState();
 	PacketDataPtr deepCopy = PacketData::create(data);
 	m_data[dataType] = deepCopy;
 }
@@ -62,6 +72,7 @@ PacketDataPtr Packet::getData(Packet::DataTypes dataType)
 
 bool Packet::removeData(Packet::DataTypes dataType)
 {
+	saveState();
 	int numRemoved = m_data.erase(dataType);
 	bool wasSuccessful = (numRemoved > 0);
 	return wasSuccessful;
@@ -113,4 +124,22 @@ SimTime Packet::getDuration() const
 	return packetDuration;
 }
 
+void Packet::saveState()
+{
+	StateCheckpointPtr checkpoint =
+		Simulator::instance()->getStateCheckpoint();
+	if(checkpoint.get() != 0 && checkpoint->getId() != m_checkpointId) {
+		// The checkpoint holds a reference so that the packet
+		// outlives it.
+		checkpoint->saveAction(boost::bind(&Packet::restoreState,
+			shared_from_this(), m_hasError, m_data));
+		m_checkpointId = checkpoint->getId();
+	}
+}
+
+void Packet::restoreState(bool hasError, const DataTypeMap& data)
+{
+	m_hasError = hasError;
+	m_data = data;
+}
 
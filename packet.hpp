@@ -7,6 +7,7 @@
 #include <iomanip>
 using namespace std;
 #include <boost/shared_ptr.hpp>
+#include <boost/enable_shared_from_this.hpp>
 
 #include "utility.hpp"
 #include "sim_time.hpp"
@@ -94,7 +95,7 @@ typedef boost::shared_ptr<PacketData> PacketDataPtr;
  * Defines a representation of the packets that are exchanged between
  * nodes.
  */
-class Packet {
+class Packet : public boost::enable_shared_from_this<Packet> {
 friend ostream& operator<< (ostream& s, const Packet& packet);
 public:
 	/// Smart pointer that clients should use.
@@ -121,8 +122,11 @@ public:
 	/**
 	 * A factory method to ensure that all objects
 	 * are created via \c new since we are using smart pointers. 
+	 * The packet's unique ID is taken from the current
+	 * simulator.
+	 * @see Simulator::nextPacketUniqueId()
 	 */
-	static inline PacketPtr create();
+	static PacketPtr create();
 
 	/**
 	 * A factory method to ensure that all objects
@@ -331,10 +335,6 @@ private:
 	/// Default destination for packets.
 	static const t_uint m_DEFAULT_DESTINATION;
 
-	/// A counter to give each packet a unique ID
-	/// for debugging purposes.
-	static t_ulong m_nextUniqueId;
-
 	/// The data rate of the packet in bps.
 	/// @see getDataRate()
 	/// @see setDataRate()
@@ -379,9 +379,33 @@ private:
 	/// @see getUniqueId()
 	t_ulong m_uniqueId;
 
+	/// The ID of the checkpoint in which the packet last
+	/// saved its state.  A packet created after a checkpoint
+	/// was taken starts out with its ID, since there is
+	/// nothing to roll back.
+	/// @see saveState()
+	t_ulong m_checkpointId;
+
 	/// Delared private to restrict use.
 	Packet& operator= (const Packet& rhs);
 
+	/**
+	 * Save the state that receivers change in the current
+	 * simulator's checkpoint, if it has not yet been saved
+	 * there.  A packet is shared by every node that receives
+	 * it, so it saves itself just before it is first changed
+	 * rather than when the checkpoint is taken.
+	 * @see Simulator::getStateCheckpoint()
+	 */
+	void saveState();
+
+	/**
+	 * Write back the state saved by saveState().
+	 * @param hasError the saved error flag.
+	 * @param data the saved data.
+	 */
+	void restoreState(bool hasError, const DataTypeMap& data);
+
 };
 
 typedef boost::shared_ptr<Packet> PacketPtr;
@@ -391,13 +415,6 @@ typedef boost::shared_ptr<Packet const> ConstPacketPtr;
 // Inline Functions
 /////////////////////////////////////////////////
 
-inline PacketPtr Packet::create()
-{
-	PacketPtr p(new Packet());
-	p->m_uniqueId = Packet::m_nextUniqueId++;
-	return p;
-}
-
 inline PacketPtr Packet::create(const Packet& rhs)
 {
 	return rhs.clone();
@@ -445,6 +462,7 @@ inline bool Packet::getHasError() const
 
 inline void Packet::setHasError(bool hasError)
 {
+	saveState();
 	m_hasError = hasError;
 }
 
@@ -0,0 +1,482 @@
+
+#include <cmath>
+#include <algorithm>
+#include <boost/thread/thread.hpp>
+#include <boost/bind/bind.hpp>
+
+#include "parallel_simulator.hpp"
+
+const double ParallelSimulator::m_DEFAULT_REGION_SIZE = 10.0;
+const t_uint ParallelSimulator::m_QUEUE_CAPACITY = 1024;
+
+/**
+ * Orders remote actions by their fire time.
+ */
+struct RemoteActionTimeLess {
+	/// @return true if \c lhs fires before \c rhs.
+	template<class T>
+	bool operator() (const T* lhs, const T* rhs) const
+	{
+		return lhs->m_fireTime < rhs->m_fireTime;
+	}
+};
+
+/**
+ * Determine whether a time falls within a window.
+ * @param time the time.
+ * @param windowEnd the end of the window.
+ * @param isEndInclusive true if the window includes its end.
+ * @return true if the time is before the end of the window.
+ */
+static inline bool isInWindow(const SimTime& time,
+	const SimTime& windowEnd, bool isEndInclusive)
+{
+	return isEndInclusive ? (time <= windowEnd) : (time < windowEnd);
+}
+
+ParallelSimulator::ParallelSimulator(t_uint numPartitions)
+	: m_regionSize(m_DEFAULT_REGION_SIZE), m_numThreads(0),
+	m_lookahead(0.0), m_optimisticWindow(0.0), m_stopTime(0.0),
+	m_numWindows(0)
+{
+	assert(numPartitions > 0);
+	for(t_uint i = 0; i < numPartitions; ++i) {
+		SimulatorOwnerPtr partition = Simulator::create();
+		partition->m_parallelSimulator = this;
+		partition->m_partitionIndex = i;
+		partition->setDoNodeRandomStreams(true);
+		m_partitions.push_back(partition);
+	}
+
+	for(t_uint i = 0; i < (numPartitions * numPartitions); ++i) {
+		boost::shared_ptr<ActionQueue> queue(
+			new ActionQueue(m_QUEUE_CAPACITY));
+		m_queues.push_back(queue);
+	}
+	m_overflows.resize(numPartitions * numPartitions);
+	m_windowActions.resize(numPartitions * numPartitions);
+	m_partitionStates.resize(numPartitions);
+}
+
+ParallelSimulator::~ParallelSimulator()
+{
+	// Free the actions that were never delivered.
+	RemoteAction* remoteAction;
+	for(t_uint i = 0; i < m_queues.size(); ++i) {
+		while(m_queues[i]->pop(remoteAction)) {
+			delete remoteAction;
+		}
+		for(t_uint j = 0; j < m_overflows[i].size(); ++j) {
+			delete m_overflows[i][j];
+		}
+		for(t_uint j = 0; j < m_windowActions[i].size(); ++j) {
+			delete m_windowActions[i][j];
+		}
+	}
+}
+
+ParallelSimulatorPtr ParallelSimulator::create(t_uint numPartitions)
+{
+	ParallelSimulatorPtr p(new ParallelSimulator(numPartitions));
+	Simulator::setInstance(p->getPartition(0));
+	return p;
+}
+
+SimulatorPtr ParallelSimulator::partitionFor(const Location& location,
+	t_uint channelId) const
+{
+	long cellX = static_cast<long>(floor(location.getX() / m_regionSize));
+	long cellY = static_cast<long>(floor(location.getY() / m_regionSize));
+	long cellZ = static_cast<long>(floor(location.getZ() / m_regionSize));
+	// Spread the cells and channels over the partitions.
+	t_ulong hash = (static_cast<t_ulong>(cellX) * 73856093UL) ^
+		(static_cast<t_ulong>(cellY) * 19349663UL) ^
+		(static_cast<t_ulong>(cellZ) * 83492791UL) ^
+		(static_cast<t_ulong>(channelId) * 2654435761UL);
+	return getPartition(hash % m_partitions.size());
+}
+
+t_uint ParallelSimulator::getNumThreads() const
+{
+	t_uint numThreads = m_numThreads;
+	if(numThreads == 0) {
+		numThreads = max(boost::thread::hardware_concurrency(), 1u);
+	}
+	return min(numThreads, getNumPartitions());
+}
+
+void ParallelSimulator::seedRandNumGenerators(t_uint seed)
+{
+	for(t_uint i = 0; i < m_partitions.size(); ++i) {
+		m_partitions[i]->seedRandNumGenerator(seed);
+	}
+}
+
+void ParallelSimulator::runSimulation(const SimTime& stopTime)
+{
+	m_numWindows = 0;
+
+	// A single partition is simply a sequential simulation.
+	if(m_partitions.size() == 1) {
+		m_partitions[0]->runSimulation(stopTime);
+		return;
+	}
+
+	assert(m_lookahead > 0.0);
+	m_stopTime = stopTime;
+	for(t_uint i = 0; i < m_partitions.size(); ++i) {
+		publishNextEventTime(i);
+	}
+
+	t_uint numWorkers = getNumThreads();
+	m_barrier.reset(new boost::barrier(numWorkers));
+	boost::thread_group workers;
+	for(t_uint i = 1; i < numWorkers; ++i) {
+		workers.create_thread(boost::bind(&ParallelSimulator::workerLoop,
+			this, i, numWorkers));
+	}
+	workerLoop(0, numWorkers);
+	workers.join_all();
+
+	for(t_uint i = 0; i < m_partitions.size(); ++i) {
+		Simulator::setInstance(getPartition(i));
+		m_partitions[i]->endSimulation(stopTime);
+	}
+	Simulator::setInstance(getPartition(0));
+}
+
+void ParallelSimulator::workerLoop(t_uint workerIndex, t_uint numWorkers)
+{
+	t_uint numPartitions = getNumPartitions();
+	while(true) {
+		// Every worker sees the same published times, so they
+		// all agree on the window and on when to stop.
+		SimTime windowStart;
+		if(!getWindowStart(windowStart) || windowStart > m_stopTime) {
+			break;
+		}
+		bool isOptimistic = (m_optimisticWindow > m_lookahead);
+		SimTime windowEnd = windowStart +
+			(isOptimistic ? m_optimisticWindow : m_lookahead);
+		bool isLastWindow = (windowEnd > m_stopTime);
+		if(isLastWindow) {
+			windowEnd = m_stopTime;
+		}
+
+		if(isOptimistic) {
+			runOptimisticWindow(workerIndex, numWorkers, windowStart,
+				windowEnd, isLastWindow);
+		} else {
+			for(t_uint i = workerIndex; i < numPartitions;
+					i += numWorkers) {
+				m_partitions[i]->runEvents(windowEnd, isLastWindow);
+			}
+
+			// Wait until every partition has sent its actions.
+			m_barrier->wait();
+
+			for(t_uint i = workerIndex; i < numPartitions;
+					i += numWorkers) {
+				deliverActions(i);
+			}
+		}
+
+		for(t_uint i = workerIndex; i < numPartitions; i += numWorkers) {
+			publishNextEventTime(i);
+		}
+		if(workerIndex == 0) {
+			m_numWindows++;
+		}
+
+		// Wait until every partition has published its next event.
+		m_barrier->wait();
+	}
+}
+
+void ParallelSimulator::runOptimisticWindow(t_uint workerIndex,
+	t_uint numWorkers, const SimTime& windowStart,
+	const SimTime& windowEnd, bool isLastWindow)
+{
+	t_uint numPartitions = getNumPartitions();
+	for(t_uint i = workerIndex; i < numPartitions; i += numWorkers) {
+		m_partitions[i]->saveState();
+		m_partitionStates[i].m_didRun = false;
+	}
+
+	// Every run is correct up to the horizon and so are the
+	// actions sent before it.  A run only receives these final
+	// actions, so it never reacts to an action that is later
+	// taken back, and beyond the horizon it only speculates that
+	// no more actions arrive.
+	SimTime horizon = windowStart;
+	SimTime nextHorizon = windowStart;
+	bool isFirstIteration = true;
+	while(true) {
+		for(t_uint i = workerIndex; i < numPartitions; i += numWorkers) {
+			PartitionState& state = m_partitionStates[i];
+			state.m_didRunIteration = isFirstIteration ||
+				hasWindowActions(i, horizon, nextHorizon, windowEnd,
+				isLastWindow);
+			if(!state.m_didRunIteration) {
+				continue;
+			}
+			if(state.m_didRun) {
+				m_partitions[i]->restoreState();
+				state.m_numRollbacks++;
+			}
+			scheduleFinalWindowActions(i, nextHorizon, windowEnd,
+				isLastWindow);
+			m_partitions[i]->runEvents(windowEnd, isLastWindow);
+			state.m_didRun = true;
+		}
+
+		// Wait until every partition that ran has sent its actions.
+		m_barrier->wait();
+
+		for(t_uint i = workerIndex; i < numPartitions; i += numWorkers) {
+			collectWindowActions(i, nextHorizon, windowEnd, isLastWindow);
+		}
+
+		// Wait until every partition has collected its actions,
+		// so that all workers agree on the next horizon.
+		m_barrier->wait();
+
+		// The earliest action that is not yet final is the first
+		// point at which any run may still change.
+		bool wasFound = false;
+		SimTime pendingFireTime;
+		for(t_uint i = 0; i < numPartitions; ++i) {
+			const PartitionState& state = m_partitionStates[i];
+			if(state.m_hasPendingAction && (!wasFound ||
+					state.m_pendingFireTime < pendingFireTime)) {
+				pendingFireTime = state.m_pendingFireTime;
+				wasFound = true;
+			}
+		}
+		if(!wasFound) {
+			break;
+		}
+		horizon = nextHorizon;
+		nextHorizon = pendingFireTime;
+		isFirstIteration = false;
+	}
+
+	for(t_uint i = workerIndex; i < numPartitions; i += numWorkers) {
+		m_partitions[i]->commitState();
+		commitWindowActions(i, windowEnd, isLastWindow);
+	}
+}
+
+void ParallelSimulator::collectWindowActions(t_uint destinationIndex,
+	const SimTime& horizon, const SimTime& windowEnd, bool isLastWindow)
+{
+	t_uint numPartitions = getNumPartitions();
+	PartitionState& state = m_partitionStates[destinationIndex];
+	state.m_hasPendingAction = false;
+	for(t_uint i = 0; i < numPartitions; ++i) {
+		if(i == destinationIndex) {
+			continue;
+		}
+
+		// The actions of a partition that ran again replace
+		// those of its last run.  Its new run is the same as
+		// the last one up to the horizon.
+		t_uint queueIndex = (i * numPartitions) + destinationIndex;
+		vector<RemoteAction*>& windowActions = m_windowActions[queueIndex];
+		if(m_partitionStates[i].m_didRunIteration) {
+			for(t_uint j = 0; j < windowActions.size(); ++j) {
+				delete windowActions[j];
+			}
+			windowActions.clear();
+			RemoteAction* remoteAction;
+			while(m_queues[queueIndex]->pop(remoteAction)) {
+				windowActions.push_back(remoteAction);
+			}
+			vector<RemoteAction*>& overflow = m_overflows[queueIndex];
+			windowActions.insert(windowActions.end(), overflow.begin(),
+				overflow.end());
+			overflow.clear();
+		}
+
+		for(t_uint j = 0; j < windowActions.size(); ++j) {
+			RemoteAction* windowAction = windowActions[j];
+			bool isPending = (windowAction->m_sendTime >= horizon) &&
+				isInWindow(windowAction->m_fireTime, windowEnd, isLastWindow);
+			if(isPending && (!state.m_hasPendingAction ||
+					windowAction->m_fireTime < state.m_pendingFireTime)) {
+				state.m_pendingFireTime = windowAction->m_fireTime;
+				state.m_hasPendingAction = true;
+			}
+		}
+	}
+}
+
+bool ParallelSimulator::hasWindowActions(t_uint destinationIndex,
+	const SimTime& sendStart, const SimTime& sendEnd,
+	const SimTime& windowEnd, bool isLastWindow) const
+{
+	t_uint numPartitions = getNumPartitions();
+	for(t_uint i = 0; i < numPartitions; ++i) {
+		const vector<RemoteAction*>& windowActions =
+			m_windowActions[(i * numPartitions) + destinationIndex];
+		for(t_uint j = 0; j < windowActions.size(); ++j) {
+			const RemoteAction* windowAction = windowActions[j];
+			if(windowAction->m_sendTime >= sendStart &&
+					windowAction->m_sendTime < sendEnd &&
+					isInWindow(windowAction->m_fireTime, windowEnd,
+					isLastWindow)) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void ParallelSimulator::scheduleFinalWindowActions(t_uint destinationIndex,
+	const SimTime& horizon, const SimTime& windowEnd, bool isLastWindow)
+{
+	t_uint numPartitions = getNumPartitions();
+	vector<RemoteAction*> remoteActions;
+	for(t_uint i = 0; i < numPartitions; ++i) {
+		const vector<RemoteAction*>& windowActions =
+			m_windowActions[(i * numPartitions) + destinationIndex];
+		for(t_uint j = 0; j < windowActions.size(); ++j) {
+			if(windowActions[j]->m_sendTime < horizon &&
+					isInWindow(windowActions[j]->m_fireTime, windowEnd,
+					isLastWindow)) {
+				remoteActions.push_back(windowActions[j]);
+			}
+		}
+	}
+	// The actions are kept until the window commits, in case
+	// the partition rolls back.
+	scheduleRemoteActions(destinationIndex, remoteActions);
+}
+
+void ParallelSimulator::commitWindowActions(t_uint destinationIndex,
+	const SimTime& windowEnd, bool isLastWindow)
+{
+	t_uint numPartitions = getNumPartitions();
+	vector<RemoteAction*> remoteActions;
+	for(t_uint i = 0; i < numPartitions; ++i) {
+		vector<RemoteAction*>& windowActions =
+			m_windowActions[(i * numPartitions) + destinationIndex];
+		for(t_uint j = 0; j < windowActions.size(); ++j) {
+			if(isInWindow(windowActions[j]->m_fireTime, windowEnd,
+					isLastWindow)) {
+				delete windowActions[j];
+			} else {
+				remoteActions.push_back(windowActions[j]);
+			}
+		}
+		windowActions.clear();
+	}
+	scheduleRemoteActions(destinationIndex, remoteActions);
+	for(t_uint i = 0; i < remoteActions.size(); ++i) {
+		delete remoteActions[i];
+	}
+}
+
+void ParallelSimulator::scheduleRemoteActions(t_uint destinationIndex,
+	vector<RemoteAction*>& remoteActions)
+{
+	// The actions are in order of sending partition and then
+	// sending order, which the stable sort preserves for
+	// actions with the same fire time.
+	stable_sort(remoteActions.begin(), remoteActions.end(),
+		RemoteActionTimeLess());
+
+	SimulatorPtr destination = getPartition(destinationIndex);
+	for(t_uint i = 0; i < remoteActions.size(); ++i) {
+		destination->scheduleEventAt(
+			ActionEvent::create(remoteActions[i]->m_action),
+			remoteActions[i]->m_fireTime);
+	}
+}
+
+bool ParallelSimulator::getWindowStart(SimTime& windowStart) const
+{
+	bool wasFound = false;
+	for(t_uint i = 0; i < m_partitionStates.size(); ++i) {
+		const PartitionState& state = m_partitionStates[i];
+		if(state.m_hasNextEvent &&
+				(!wasFound || state.m_nextEventTime < windowStart)) {
+			windowStart = state.m_nextEventTime;
+			wasFound = true;
+		}
+	}
+	return wasFound;
+}
+
+void ParallelSimulator::publishNextEventTime(t_uint partitionIndex)
+{
+	PartitionState& state = m_partitionStates[partitionIndex];
+	state.m_hasNextEvent =
+		m_partitions[partitionIndex]->peekNextEventTime(
+		state.m_nextEventTime);
+}
+
+void ParallelSimulator::postAction(t_uint sourceIndex,
+	t_uint destinationIndex, const SimTime& fireTime,
+	const Action& action)
+{
+	assert(sourceIndex != destinationIndex);
+	assert(fireTime >= (m_partitions[sourceIndex]->currentTime() +
+		m_lookahead));
+
+	RemoteAction* remoteAction = new RemoteAction();
+	remoteAction->m_fireTime = fireTime;
+	remoteAction->m_sendTime = m_partitions[sourceIndex]->currentTime();
+	remoteAction->m_action = action;
+
+	t_uint queueIndex = (sourceIndex * getNumPartitions()) +
+		destinationIndex;
+	// The destination does not read the queue until the end of
+	// the window, so once the queue is full it stays full and
+	// the overflow list keeps the actions in order.
+	if(!m_queues[queueIndex]->push(remoteAction)) {
+		m_overflows[queueIndex].push_back(remoteAction);
+	}
+	m_partitionStates[sourceIndex].m_numRemoteActions++;
+}
+
+void ParallelSimulator::deliverActions(t_uint destinationIndex)
+{
+	t_uint numPartitions = getNumPartitions();
+	vector<RemoteAction*> remoteActions;
+	for(t_uint i = 0; i < numPartitions; ++i) {
+		t_uint queueIndex = (i * numPartitions) + destinationIndex;
+		RemoteAction* remoteAction;
+		while(m_queues[queueIndex]->pop(remoteAction)) {
+			remoteActions.push_back(remoteAction);
+		}
+		vector<RemoteAction*>& overflow = m_overflows[queueIndex];
+		remoteActions.insert(remoteActions.end(), overflow.begin(),
+			overflow.end());
+		overflow.clear();
+	}
+
+	scheduleRemoteActions(destinationIndex, remoteActions);
+	for(t_uint i = 0; i < remoteActions.size(); ++i) {
+		delete remoteActions[i];
+	}
+}
+
+t_ulong ParallelSimulator::getNumRemoteActions() const
+{
+	t_ulong numRemoteActions = 0;
+	for(t_uint i = 0; i < m_partitionStates.size(); ++i) {
+		numRemoteActions += m_partitionStates[i].m_numRemoteActions;
+	}
+	return numRemoteActions;
+}
+
+t_ulong ParallelSimulator::getNumRollbacks() const
+{
+	t_ulong numRollbacks = 0;
+	for(t_uint i = 0; i < m_partitionStates.size(); ++i) {
+		numRollbacks += m_partitionStates[i].m_numRollbacks;
+	}
+	return numRollbacks;
+}
+
@@ -0,0 +1,488 @@
+
+#ifndef PARALLEL_SIMULATOR_H
+#define PARALLEL_SIMULATOR_H
+
+#include <vector>
+using namespace std;
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+#include <boost/thread/barrier.hpp>
+#include <boost/lockfree/spsc_queue.hpp>
+
+#include "utility.hpp"
+#include "sim_time.hpp"
+#include "simulator.hpp"
+#include "location.hpp"
+
+/////////////////////////////////////////////////
+// ParallelSimulator Class
+/////////////////////////////////////////////////
+
+/**
+ * A conservative or optimistic parallel simulator.
+ * The nodes of a scenario are divided among a number of
+ * partitions (logical processes), each of which is a complete
+ * Simulator with its own clock and event queue.  Nodes are
+ * placed in a partition by creating them with that partition's
+ * simulator (see partitionFor()).
+ *
+ * Partitions only interact through actions that one partition
+ * schedules in another with Simulator::scheduleAction(), which
+ * must be at least the lookahead in the future.  For wireless
+ * nodes, the lookahead is the smallest propagation delay between
+ * partitions (see
+ * WirelessChannelManager::getMinRemotePropagationDelay()) and
+ * the channel manager must propagate the start of signals (see
+ * WirelessChannelManager::setDoPropagateSignalStart()).
+ *
+ * The simulation proceeds in windows (the YAWNS protocol): if
+ * the earliest pending event of any partition is at time T,
+ * no action can arrive in any partition before T + lookahead,
+ * so every partition executes its events before T + lookahead
+ * in parallel.  The actions sent during a window are passed
+ * through lock-free single-producer, single-consumer queues and
+ * are scheduled in their destination at the end of the window
+ * in a fixed order.  The results therefore depend only on the
+ * partitioning, not on the number of threads or how they are
+ * scheduled.
+ *
+ * Optionally, the windows can be made longer than the lookahead
+ * (see setOptimisticWindow()).  Each partition then saves its
+ * state at the start of a window (see Simulator::addStateSaver())
+ * and runs to the end of the window as if no actions will
+ * arrive.  The earliest fire time of the actions sent during
+ * these runs is a horizon up to which every run is correct, so
+ * the partitions that were sent actions before the horizon roll
+ * back to the start of the window and run again with them.
+ * Runs only ever receive actions sent before the horizon, which
+ * cannot change, so a partition never reacts to an action that
+ * is later taken back.  Each horizon is at least the lookahead
+ * past the previous one, so the window settles after a bounded
+ * number of iterations and is then committed.  This is a form
+ * of Time Warp in which the start of each window is the global
+ * virtual time and the saved states are discarded (fossil
+ * collected) when the window commits.
+ * Inputs that fire within a window are ordered before the
+ * events that the partition schedules itself, so events at
+ * exactly the same time may execute in a different order than
+ * in a conservative run.
+ *
+ * Nodes draw from their own random number streams (see
+ * Simulator::setDoNodeRandomStreams()), so with the same seed
+ * and signal propagation, the results match those of a
+ * sequential run with a single partition, except for the order
+ * of events in different partitions that fire at exactly the
+ * same time.  Fading models, which keep per-receiver state,
+ * should not be shared between partitions.
+ */
+class ParallelSimulator : boost::noncopyable {
+public:
+	/// Smart pointer that clients should use.
+	typedef boost::shared_ptr<ParallelSimulator> ParallelSimulatorPtr;
+
+	/// An action sent between partitions.
+	typedef Simulator::Action Action;
+
+	/**
+	 * A factory method to ensure that all objects
+	 * are created via \c new since we are using smart pointers.
+	 * The first partition is made current on the calling
+	 * thread so that the scenario can be built.
+	 * @param numPartitions the number of partitions.
+	 */
+	static ParallelSimulatorPtr create(t_uint numPartitions);
+
+	/// A destructor.
+	~ParallelSimulator();
+
+	/**
+	 * Get the number of partitions.
+	 * @return the number of partitions.
+	 */
+	inline t_uint getNumPartitions() const;
+
+	/**
+	 * Get the simulator of a partition.
+	 * @param partitionIndex the index of the partition.
+	 * @return the simulator of the partition.
+	 */
+	inline SimulatorPtr getPartition(t_uint partitionIndex) const;
+
+	/**
+	 * Get the partition in which a node should be placed.
+	 * Space is divided into square regions and nodes in the
+	 * same region that use the same channel are placed in the
+	 * same partition.
+	 * @param location the location of the node.
+	 * @param channelId the channel that the node mainly uses.
+	 * @return the simulator of the partition.
+	 * @see setRegionSize()
+	 */
+	SimulatorPtr partitionFor(const Location& location,
+		t_uint channelId) const;
+
+	/**
+	 * Set the side of the square regions used by partitionFor().
+	 * @param regionSize the size of a region in meters.
+	 */
+	inline void setRegionSize(double regionSize);
+
+	/**
+	 * Set the number of worker threads.
+	 * @param numThreads the number of threads or zero to use
+	 * one thread per hardware thread of the machine.
+	 */
+	inline void setNumThreads(t_uint numThreads);
+
+	/**
+	 * Get the number of worker threads that will be used.
+	 * @return the number of threads.
+	 */
+	t_uint getNumThreads() const;
+
+	/**
+	 * Set the lookahead between partitions.
+	 * @param lookahead the minimum delay of any action that
+	 * one partition schedules in another.
+	 */
+	inline void setLookahead(const SimTime& lookahead);
+
+	/**
+	 * Get the lookahead between partitions.
+	 * @return the lookahead.
+	 */
+	inline SimTime getLookahead() const;
+
+	/**
+	 * Set the length of the optimistic windows.
+	 * @param optimisticWindow the length of each window, which
+	 * is only used if it is longer than the lookahead.  Zero
+	 * (the default) runs conservatively.
+	 */
+	inline void setOptimisticWindow(const SimTime& optimisticWindow);
+
+	/**
+	 * Get the length of the optimistic windows.
+	 * @return the length of each window.
+	 */
+	inline SimTime getOptimisticWindow() const;
+
+	/**
+	 * Seed the random number generator of every partition.
+	 * @param seed the new seed.
+	 */
+	void seedRandNumGenerators(t_uint seed);
+
+	/**
+	 * Execute the events of all partitions up to the stop time
+	 * and then notify each partition's simulation end listeners,
+	 * in partition order.
+	 * @param stopTime the time at which the simulation stops.
+	 */
+	void runSimulation(const SimTime& stopTime);
+
+	/**
+	 * Schedule an action sent from one partition in another.
+	 * This is called by Simulator::scheduleAction().
+	 * @param sourceIndex the partition sending the action.
+	 * @param destinationIndex the partition receiving the action.
+	 * @param fireTime the time at which the action is executed.
+	 * @param action the action.
+	 */
+	void postAction(t_uint sourceIndex, t_uint destinationIndex,
+		const SimTime& fireTime, const Action& action);
+
+	/**
+	 * Get the number of windows executed by the last run.
+	 * @return the number of windows.
+	 */
+	inline t_ulong getNumWindows() const;
+
+	/**
+	 * Get the number of actions sent between partitions.
+	 * @return the number of actions.
+	 */
+	t_ulong getNumRemoteActions() const;
+
+	/**
+	 * Get the number of times that a partition was rolled back
+	 * during optimistic windows.
+	 * @return the number of rollbacks.
+	 */
+	t_ulong getNumRollbacks() const;
+
+private:
+
+	/// The default size of the regions used to partition space.
+	static const double m_DEFAULT_REGION_SIZE;
+
+	/// The capacity of each queue between two partitions.
+	/// Actions that do not fit wait in an overflow list.
+	static const t_uint m_QUEUE_CAPACITY;
+
+	/// An action in transit between two partitions.
+	struct RemoteAction {
+		/// The time at which the action is executed.
+		SimTime m_fireTime;
+
+		/// The time of the sending partition when the action
+		/// was sent.
+		SimTime m_sendTime;
+
+		/// The action.
+		Action m_action;
+	};
+
+	/// The queue from one partition to another.
+	typedef boost::lockfree::spsc_queue<RemoteAction*> ActionQueue;
+
+	/// The progress of a partition, which is published to the
+	/// other workers at the barriers of each window.
+	struct PartitionState {
+		/// A constructor.
+		PartitionState()
+			: m_hasNextEvent(false), m_numRemoteActions(0),
+			m_numRollbacks(0), m_didRun(false), m_didRunIteration(false),
+			m_hasPendingAction(false)
+		{ }
+
+		/// The time of the next event of the partition, which
+		/// is published at the end of each window.
+		SimTime m_nextEventTime;
+
+		/// Whether the partition has a pending event.
+		bool m_hasNextEvent;
+
+		/// The number of actions sent by the partition.
+		t_ulong m_numRemoteActions;
+
+		/// The number of times the partition was rolled back.
+		t_ulong m_numRollbacks;
+
+		/// Whether the partition has run during the current
+		/// optimistic window.
+		bool m_didRun;
+
+		/// Whether the partition ran during the current
+		/// iteration of the optimistic window.
+		bool m_didRunIteration;
+
+		/// Whether an action sent to the partition during the
+		/// current optimistic window, which fires within it, is
+		/// not yet final.
+		bool m_hasPendingAction;
+
+		/// The earliest fire time of those actions.
+		SimTime m_pendingFireTime;
+	};
+
+	/// The simulator of each partition.
+	vector<SimulatorOwnerPtr> m_partitions;
+
+	/// The queue from partition \e i to partition \e j is at
+	/// index <tt>i * numPartitions + j</tt>.
+	vector<boost::shared_ptr<ActionQueue> > m_queues;
+
+	/// Actions that did not fit in their queue, with the
+	/// same indexing as m_queues.
+	vector<vector<RemoteAction*> > m_overflows;
+
+	/// The actions sent during the current optimistic window
+	/// by the latest run of each partition, with the same
+	/// indexing as m_queues.
+	vector<vector<RemoteAction*> > m_windowActions;
+
+	/// The progress of each partition.
+	vector<PartitionState> m_partitionStates;
+
+	/// @see setRegionSize()
+	double m_regionSize;
+
+	/// @see setNumThreads()
+	t_uint m_numThreads;
+
+	/// @see setLookahead()
+	SimTime m_lookahead;
+
+	/// @see setOptimisticWindow()
+	SimTime m_optimisticWindow;
+
+	/// The stop time of the current run.
+	SimTime m_stopTime;
+
+	/// @see getNumWindows()
+	t_ulong m_numWindows;
+
+	/// Synchronizes the worker threads between the phases
+	/// of each window.
+	boost::shared_ptr<boost::barrier> m_barrier;
+
+	/// A constructor.
+	/// @param numPartitions the number of partitions.
+	ParallelSimulator(t_uint numPartitions);
+
+	/**
+	 * Execute windows until the stop time.
+	 * This is the body of each worker thread.  Worker \e w
+	 * owns the partitions with an index congruent to \e w
+	 * modulo the number of threads.
+	 * @param workerIndex the index of the worker.
+	 * @param numWorkers the number of workers.
+	 */
+	void workerLoop(t_uint workerIndex, t_uint numWorkers);
+
+	/**
+	 * Run an optimistic window until no partition needs to
+	 * roll back and then commit it.
+	 * @param workerIndex the index of the worker.
+	 * @param numWorkers the number of workers.
+	 * @param windowStart the start of the window.
+	 * @param windowEnd the end of the window.
+	 * @param isLastWindow true if the window ends at (and
+	 * includes) the stop time.
+	 */
+	void runOptimisticWindow(t_uint workerIndex, t_uint numWorkers,
+		const SimTime& windowStart, const SimTime& windowEnd,
+		bool isLastWindow);
+
+	/**
+	 * Replace the actions sent to a partition by each partition
+	 * that just ran and find the earliest of its actions that
+	 * is not yet final.
+	 * @param destinationIndex the receiving partition.
+	 * @param horizon the time before which actions are final.
+	 * @param windowEnd the end of the window.
+	 * @param isLastWindow true if the window includes its end.
+	 */
+	void collectWindowActions(t_uint destinationIndex,
+		const SimTime& horizon, const SimTime& windowEnd,
+		bool isLastWindow);
+
+	/**
+	 * Determine whether a partition was sent actions that fire
+	 * within the current optimistic window during a given time.
+	 * @param destinationIndex the receiving partition.
+	 * @param sendStart the start of the sending time.
+	 * @param sendEnd the end (excluded) of the sending time.
+	 * @param windowEnd the end of the window.
+	 * @param isLastWindow true if the window includes its end.
+	 * @return true if such an action was sent.
+	 */
+	bool hasWindowActions(t_uint destinationIndex,
+		const SimTime& sendStart, const SimTime& sendEnd,
+		const SimTime& windowEnd, bool isLastWindow) const;
+
+	/**
+	 * Schedule the final actions sent to a partition that fire
+	 * within the current optimistic window.
+	 * @param destinationIndex the receiving partition.
+	 * @param horizon the time before which actions are final.
+	 * @param windowEnd the end of the window.
+	 * @param isLastWindow true if the window includes its end.
+	 */
+	void scheduleFinalWindowActions(t_uint destinationIndex,
+		const SimTime& horizon, const SimTime& windowEnd,
+		bool isLastWindow);
+
+	/**
+	 * Schedule the actions sent to a partition during the
+	 * current optimistic window that fire after it and free
+	 * all of the window's actions.
+	 * @param destinationIndex the receiving partition.
+	 * @param windowEnd the end of the window.
+	 * @param isLastWindow true if the window includes its end.
+	 */
+	void commitWindowActions(t_uint destinationIndex,
+		const SimTime& windowEnd, bool isLastWindow);
+
+	/**
+	 * Schedule actions in a partition in order of their fire
+	 * time and then of their sending partition and the order
+	 * in which they were sent.
+	 * @param destinationIndex the receiving partition.
+	 * @param remoteActions the actions in order of sending
+	 * partition and sending order, which are sorted.
+	 */
+	void scheduleRemoteActions(t_uint destinationIndex,
+		vector<RemoteAction*>& remoteActions);
+
+	/**
+	 * Get the start of the next window.
+	 * @param windowStart set to the earliest pending event time.
+	 * @return false if no partition has a pending event.
+	 */
+	bool getWindowStart(SimTime& windowStart) const;
+
+	/**
+	 * Schedule the actions sent to a partition during the
+	 * last window, in order of their fire time and then of
+	 * their sending partition and the order in which they
+	 * were sent.
+	 * @param destinationIndex the receiving partition.
+	 */
+	void deliverActions(t_uint destinationIndex);
+
+	/**
+	 * Record the time of the next event of a partition.
+	 * @param partitionIndex the partition.
+	 */
+	void publishNextEventTime(t_uint partitionIndex);
+
+};
+typedef boost::shared_ptr<ParallelSimulator> ParallelSimulatorPtr;
+
+/////////////////////////////////////////////////
+// Inline Functions
+/////////////////////////////////////////////////
+
+inline t_uint ParallelSimulator::getNumPartitions() const
+{
+	return m_partitions.size();
+}
+
+inline SimulatorPtr ParallelSimulator::getPartition(
+	t_uint partitionIndex) const
+{
+	assert(partitionIndex < m_partitions.size());
+	return m_partitions[partitionIndex].get();
+}
+
+inline void ParallelSimulator::setRegionSize(double regionSize)
+{
+	assert(regionSize > 0.0);
+	m_regionSize = regionSize;
+}
+
+inline void ParallelSimulator::setNumThreads(t_uint numThreads)
+{
+	m_numThreads = numThreads;
+}
+
+inline void ParallelSimulator::setLookahead(const SimTime& lookahead)
+{
+	m_lookahead = lookahead;
+}
+
+inline SimTime ParallelSimulator::getLookahead() const
+{
+	return m_lookahead;
+}
+
+inline void ParallelSimulator::setOptimisticWindow(
+	const SimTime& optimisticWindow)
+{
+	m_optimisticWindow = optimisticWindow;
+}
+
+inline SimTime ParallelSimulator::getOptimisticWindow() const
+{
+	return m_optimisticWindow;
+}
+
+inline t_ulong ParallelSimulator::getNumWindows() const
+{
+	return m_numWindows;
+}
+
+#endif // PARALLEL_SIMULATOR_H
+
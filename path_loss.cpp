@@ -1,4 +1,15 @@
 
+#include <limits>
+using namespace std;
+
+// The vector kernels are written with the AVX2 intrinsics
+// of GCC-compatible compilers for x86-64 and are only used
+// if the processor has AVX2.
+#if defined(__GNUC__) && defined(__x86_64__)
+#define RFIDSIM_HAVE_AVX2
+#include <immintrin.h>
+#endif
+
 #include "path_loss.hpp"
 #include "utility.hpp"
 #include "wireless_comm_signal.hpp"
@@ -6,6 +17,166 @@
 
 const double FreeSpace::m_DEFAULT_LOSS_FACTOR = 1.0;
 const double TwoRay::m_DEFAULT_ANTENNA_HEIGHT = 1.5;
+bool PathLoss::m_doVectorKernels = true;
+
+/////////////////////////////////////////////////
+// Vector Kernels
+/////////////////////////////////////////////////
+
+/**
+ * The values of a FreeSpace or TwoRay model that are the
+ * same for every receiver of a batch.
+ */
+struct RecvdStrengthKernel {
+	/// The location of the transmitter.
+	float m_x, m_y, m_z;
+
+	/// The transmitted power times the transmitter's gain.
+	double m_transmitFactor;
+
+	/// The wavelength squared.
+	double m_freeSpaceFactor;
+
+	/// The (4 pi)^2 of the FreeSpace denominator.
+	double m_freeSpaceConstant;
+
+	/// The loss factor.
+	double m_lossFactor;
+
+	/// Whether the Two Ray equation is used past the
+	/// crossover distance.
+	bool m_hasTwoRay;
+
+	/// @see TwoRay::getLinkLoss()
+	double m_crossoverDistance;
+
+	/// The antenna height squared.
+	double m_twoRayFactor;
+};
+
+/**
+ * Fill in the FreeSpace part of a kernel.
+ * @param signal the signal being transmitted.
+ * @param lossFactor the loss factor of the model.
+ * @param kernel the kernel.
+ */
+static void setFreeSpaceKernel(const WirelessCommSignal& signal,
+	double lossFactor, RecvdStrengthKernel& kernel)
+{
+	Location location = signal.getLocation();
+	kernel.m_x = location.getX();
+	kernel.m_y = location.getY();
+	kernel.m_z = location.getZ();
+	kernel.m_transmitFactor = signal.getPower() *
+		signal.getTransmitterGain();
+	kernel.m_freeSpaceFactor = pow(signal.getWavelength(), 2);
+	kernel.m_freeSpaceConstant = pow((4.0 * PI), 2);
+	kernel.m_lossFactor = lossFactor;
+	kernel.m_hasTwoRay = false;
+	kernel.m_crossoverDistance = 0.0;
+	kernel.m_twoRayFactor = 0.0;
+}
+
+#ifdef RFIDSIM_HAVE_AVX2
+/**
+ * Compute the signal strength at four receivers at a time.
+ * Each operation is the one that Location::distance(),
+ * getLinkLoss(), and LinkLoss::getRecvdStrength() do for a
+ * single receiver, in the same order, so the strengths are
+ * the same to the last bit.
+ * @param kernel the values of the model.
+ * @param receivers the receivers.
+ * @param strengths set to the signal strength at each
+ * receiver.
+ * @return the number of receivers done, which is a multiple
+ * of four.
+ */
+__attribute__((target("avx2")))
+static t_ulong getRecvdStrengthsAvx2(const RecvdStrengthKernel& kernel,
+	const PathLoss::ReceiverArrays& receivers, span<double> strengths)
+{
+	const __m128 transmitterX = _mm_set1_ps(kernel.m_x);
+	const __m128 transmitterY = _mm_set1_ps(kernel.m_y);
+	const __m128 transmitterZ = _mm_set1_ps(kernel.m_z);
+	const __m256d transmitFactor = _mm256_set1_pd(kernel.m_transmitFactor);
+	const __m256d freeSpaceFactor =
+		_mm256_set1_pd(kernel.m_freeSpaceFactor);
+	const __m256d freeSpaceConstant =
+		_mm256_set1_pd(kernel.m_freeSpaceConstant);
+	const __m256d one = _mm256_set1_pd(1.0);
+	const __m256d lossFactor = _mm256_set1_pd(kernel.m_lossFactor);
+	const __m256d crossoverDistance =
+		_mm256_set1_pd(kernel.m_crossoverDistance);
+	const __m256d twoRayFactor = _mm256_set1_pd(kernel.m_twoRayFactor);
+
+	t_ulong numReceivers = strengths.size();
+	t_ulong i = 0;
+	for(; (i + 4) <= numReceivers; i += 4) {
+		// The differences are taken in single precision and
+		// squared and summed in double precision, and the
+		// distance is rounded to single precision.
+		__m256d xDiff = _mm256_cvtps_pd(_mm_sub_ps(transmitterX,
+			_mm_loadu_ps(&receivers.m_x[i])));
+		__m256d yDiff = _mm256_cvtps_pd(_mm_sub_ps(transmitterY,
+			_mm_loadu_ps(&receivers.m_y[i])));
+		__m256d zDiff = _mm256_cvtps_pd(_mm_sub_ps(transmitterZ,
+			_mm_loadu_ps(&receivers.m_z[i])));
+		__m256d sumOfSquares = _mm256_add_pd(
+			_mm256_add_pd(_mm256_mul_pd(xDiff, xDiff),
+			_mm256_mul_pd(yDiff, yDiff)), _mm256_mul_pd(zDiff, zDiff));
+		__m256d distance = _mm256_cvtps_pd(
+			_mm256_cvtpd_ps(_mm256_sqrt_pd(sumOfSquares)));
+		__m256d distanceSquared = _mm256_mul_pd(distance, distance);
+
+		__m256d gainFactor = _mm256_mul_pd(transmitFactor,
+			_mm256_loadu_pd(&receivers.m_gains[i]));
+		__m256d numerator = _mm256_mul_pd(
+			_mm256_mul_pd(gainFactor, freeSpaceFactor), one);
+		__m256d denominator = _mm256_mul_pd(
+			_mm256_mul_pd(freeSpaceConstant, distanceSquared), lossFactor);
+
+		if(kernel.m_hasTwoRay) {
+			__m256d isTwoRay = _mm256_cmp_pd(distance, crossoverDistance,
+				_CMP_GT_OQ);
+			__m256d twoRayNumerator = _mm256_mul_pd(
+				_mm256_mul_pd(gainFactor, twoRayFactor), twoRayFactor);
+			__m256d twoRayDenominator = _mm256_mul_pd(
+				_mm256_mul_pd(distanceSquared, distanceSquared), lossFactor);
+			numerator = _mm256_blendv_pd(numerator, twoRayNumerator,
+				isTwoRay);
+			denominator = _mm256_blendv_pd(denominator, twoRayDenominator,
+				isTwoRay);
+		}
+
+		_mm256_storeu_pd(&strengths[i],
+			_mm256_div_pd(numerator, denominator));
+	}
+	return i;
+}
+#endif
+
+/**
+ * Compute the signal strength at as many receivers as the
+ * vector kernel can do.
+ * @param kernel the values of the model.
+ * @param receivers the receivers.
+ * @param strengths set to the signal strength at each
+ * receiver that is done.
+ * @return the number of receivers done.
+ */
+static t_ulong getVectorRecvdStrengths(const RecvdStrengthKernel& kernel,
+	const PathLoss::ReceiverArrays& receivers, span<double> strengths)
+{
+#ifdef RFIDSIM_HAVE_AVX2
+	return getRecvdStrengthsAvx2(kernel, receivers, strengths);
+#else
+	return 0;
+#endif
+}
+
+/////////////////////////////////////////////////
+// Path Loss Implementation
+/////////////////////////////////////////////////
 
 PathLoss::PathLoss()
 {
@@ -17,6 +188,61 @@ PathLoss::~PathLoss()
 
 }
 
+bool PathLoss::getLinkLoss(const Location& transmitterLocation,
+	const Location& receiverLocation, double wavelength,
+	LinkLoss& linkLoss) const
+{
+	return false;
+}
+
+void PathLoss::getRecvdStrengths(const WirelessCommSignal& signal,
+	const ReceiverArrays& receivers, span<double> strengths) const
+{
+	getEachRecvdStrength(signal, receivers, strengths, 0);
+}
+
+void PathLoss::getEachRecvdStrength(const WirelessCommSignal& signal,
+	const ReceiverArrays& receivers, span<double> strengths,
+	t_ulong firstReceiver) const
+{
+	assert(receivers.m_x.size() == strengths.size());
+	assert(receivers.m_y.size() == strengths.size());
+	assert(receivers.m_z.size() == strengths.size());
+	assert(receivers.m_gains.size() == strengths.size());
+
+	Location transmitterLocation = signal.getLocation();
+	for(t_ulong i = firstReceiver; i < strengths.size(); ++i) {
+		LinkLoss linkLoss;
+		bool hasLinkLoss = getLinkLoss(transmitterLocation,
+			Location(receivers.m_x[i], receivers.m_y[i], receivers.m_z[i]),
+			signal.getWavelength(), linkLoss);
+		assert(hasLinkLoss);
+		strengths[i] = linkLoss.getRecvdStrength(signal.getPower(),
+			signal.getTransmitterGain(), receivers.m_gains[i]);
+	}
+}
+
+void PathLoss::setDoVectorKernels(bool doVectorKernels)
+{
+	m_doVectorKernels = doVectorKernels;
+}
+
+bool PathLoss::getDoVectorKernels()
+{
+#ifdef RFIDSIM_HAVE_AVX2
+	static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+	return (m_doVectorKernels && hasAvx2);
+#else
+	return false;
+#endif
+}
+
+double PathLoss::getMaxRange(const WirelessCommSignal& signal,
+	double receiverGain, double minStrength) const
+{
+	return numeric_limits<double>::infinity();
+}
+
 FreeSpace::FreeSpace()
 	: m_lossFactor(m_DEFAULT_LOSS_FACTOR)
 {
@@ -46,21 +272,56 @@ TwoRay::TwoRay(double lossFactor)
 double FreeSpace::getRecvdStrength(const WirelessCommSignal& signal,
 	const PhysicalLayer& receiver) const
 {
-	double numerator = decibelsToPower(signal.getDbStrength()) * 
-		signal.getTransmitterGain() * receiver.getGain() * 
-		pow(signal.getWavelength(), 2);
+	LinkLoss linkLoss;
+	getLinkLoss(signal.getLocation(), receiver.getLocation(),
+		signal.getWavelength(), linkLoss);
+	return linkLoss.getRecvdStrength(signal.getPower(),
+		signal.getTransmitterGain(), receiver.getGain());
+}
+
+bool FreeSpace::getLinkLoss(const Location& transmitterLocation,
+	const Location& receiverLocation, double wavelength,
+	LinkLoss& linkLoss) const
+{
 	double distance = Location::distance(
-		signal.getLocation(), receiver.getLocation());
-	double denominator = pow((4.0 * PI), 2) * 
+		transmitterLocation, receiverLocation);
+	linkLoss.m_firstFactor = pow(wavelength, 2);
+	linkLoss.m_secondFactor = 1.0;
+	linkLoss.m_denominator = pow((4.0 * PI), 2) * 
 		pow(distance, 2) * m_lossFactor;
+	return true;
+}
 
-	assert(denominator > 0.0);
+void FreeSpace::getRecvdStrengths(const WirelessCommSignal& signal,
+	const ReceiverArrays& receivers, span<double> strengths) const
+{
+	t_ulong numDone = 0;
+	if(getDoVectorKernels()) {
+		RecvdStrengthKernel kernel;
+		setFreeSpaceKernel(signal, m_lossFactor, kernel);
+		numDone = getVectorRecvdStrengths(kernel, receivers, strengths);
+	}
+	getEachRecvdStrength(signal, receivers, strengths, numDone);
+}
 
-	return (numerator / denominator);
+double FreeSpace::getMaxRange(const WirelessCommSignal& signal,
+	double receiverGain, double minStrength) const
+{
+	if(minStrength <= 0.0)
+		return numeric_limits<double>::infinity();
+
+	// Solve getRecvdStrength() for the distance.
+	double numerator = decibelsToPower(signal.getDbStrength()) * 
+		signal.getTransmitterGain() * receiverGain * 
+		pow(signal.getWavelength(), 2);
+	double denominator = pow((4.0 * PI), 2) * minStrength * m_lossFactor;
+
+	return sqrt(numerator / denominator);
 }
 
-double TwoRay::getRecvdStrength(const WirelessCommSignal& signal,
-	const PhysicalLayer& receiver) const
+bool TwoRay::getLinkLoss(const Location& transmitterLocation,
+	const Location& receiverLocation, double wavelength,
+	LinkLoss& linkLoss) const
 {
 
 	// These equations are largely from ns-2.  If the distance
@@ -68,31 +329,70 @@ double TwoRay::getRecvdStrength(const WirelessCommSignal& signal,
 	// model; otherwise use the TwoRay model.
 
 	double crossoverDistance = (4 * PI * 
-		m_antennaHeight * m_antennaHeight) / signal.getWavelength();
+		m_antennaHeight * m_antennaHeight) / wavelength;
 	double distance = Location::distance(
-		signal.getLocation(), receiver.getLocation());
-
-	double recvdStrength = FreeSpace::getRecvdStrength(signal, receiver);
+		transmitterLocation, receiverLocation);
 
 	if(m_DEBUG_SIGNAL_STRENGTH) {
 		ostringstream debugStream;
 		debugStream << __FUNCTION__ << " crossover: " <<
-			crossoverDistance << ", dist: " << distance <<
-			", FS SS: " << recvdStrength;
+			crossoverDistance << ", dist: " << distance;
 		LogStreamManager::instance()->logDebugItem(debugStream.str());
 	}
 
 	// If the distance is greater, use the Two Ray equation.
 	if(distance > crossoverDistance) {
-		double numerator = decibelsToPower(signal.getDbStrength()) *
-			signal.getTransmitterGain() * receiver.getGain() *
-			pow(m_antennaHeight, 2) * pow(m_antennaHeight, 2);
-		double denominator = pow(distance, 4) * m_lossFactor;
-		assert(denominator > 0.0);
-		recvdStrength = numerator / denominator;
+		linkLoss.m_firstFactor = pow(m_antennaHeight, 2);
+		linkLoss.m_secondFactor = pow(m_antennaHeight, 2);
+		// The fourth power is the square of the exact square
+		// (the distance has single precision), which the
+		// vector kernel also computes.
+		linkLoss.m_denominator = pow(distance, 2) * pow(distance, 2) *
+			m_lossFactor;
+		return true;
+	}
+
+	return FreeSpace::getLinkLoss(transmitterLocation, receiverLocation,
+		wavelength, linkLoss);
+}
+
+void TwoRay::getRecvdStrengths(const WirelessCommSignal& signal,
+	const ReceiverArrays& receivers, span<double> strengths) const
+{
+	t_ulong numDone = 0;
+	if(getDoVectorKernels()) {
+		RecvdStrengthKernel kernel;
+		setFreeSpaceKernel(signal, m_lossFactor, kernel);
+		kernel.m_hasTwoRay = true;
+		kernel.m_crossoverDistance = (4 * PI * 
+			m_antennaHeight * m_antennaHeight) / signal.getWavelength();
+		kernel.m_twoRayFactor = pow(m_antennaHeight, 2);
+		numDone = getVectorRecvdStrengths(kernel, receivers, strengths);
 	}
-	
-	return recvdStrength;
+	getEachRecvdStrength(signal, receivers, strengths, numDone);
 }
 
+double TwoRay::getMaxRange(const WirelessCommSignal& signal,
+	double receiverGain, double minStrength) const
+{
+	if(minStrength <= 0.0)
+		return numeric_limits<double>::infinity();
+
+	// The two models agree at the crossover distance and the
+	// strength falls with distance, so the range is the Two Ray
+	// range if it is past the crossover and is otherwise within
+	// the FreeSpace part of the model.
+	double crossoverDistance = (4 * PI * 
+		m_antennaHeight * m_antennaHeight) / signal.getWavelength();
+	double numerator = decibelsToPower(signal.getDbStrength()) *
+		signal.getTransmitterGain() * receiverGain *
+		pow(m_antennaHeight, 2) * pow(m_antennaHeight, 2);
+	double twoRayRange = 
+		pow(numerator / (minStrength * m_lossFactor), 0.25);
+
+	if(twoRayRange > crossoverDistance)
+		return twoRayRange;
+	return min(FreeSpace::getMaxRange(signal, receiverGain, minStrength),
+		crossoverDistance);
+}
 
@@ -3,11 +3,17 @@
 #define PATH_LOSS_H
 
 #include <math.h>
+#include <assert.h>
+#include <span>
+using namespace std;
 #include <boost/shared_ptr.hpp>
 #include <boost/utility.hpp>
 
+#include "utility.hpp"
+
 class WirelessCommSignal;
 class PhysicalLayer;
+class Location;
 
 /**
  * This computes the path loss for a given signal at a receiver.
@@ -17,6 +23,56 @@ public:
 	/// Smart pointer that clients should use.
 	typedef boost::shared_ptr<PathLoss> PathLossPtr;
 
+	/**
+	 * The part of the strength of a signal at a receiver that
+	 * only depends on the link, i.e., on where the transmitter
+	 * and receiver are and on the signal's wavelength.
+	 * The strength is \f$(P_t G_t G_r a b) / c\f$, where \f$a\f$
+	 * and \f$b\f$ are the factors and \f$c\f$ is the
+	 * denominator.  It is computed in the same order as the
+	 * models compute it, so it is the same to the last bit.
+	 */
+	struct LinkLoss {
+		/// The first factor of the numerator.
+		double m_firstFactor;
+
+		/// The second factor of the numerator.
+		double m_secondFactor;
+
+		/// The denominator.
+		double m_denominator;
+
+		/**
+		 * Compute the signal strength at the receiver.
+		 * @param transmitPower the transmitted power in Watts.
+		 * @param transmitterGain the gain of the transmitter.
+		 * @param receiverGain the gain of the receiver.
+		 * @return the signal strength in Watts.
+		 */
+		inline double getRecvdStrength(double transmitPower,
+			double transmitterGain, double receiverGain) const;
+	};
+
+	/**
+	 * The locations and antenna gains of a batch of receivers.
+	 * They are kept as a structure of arrays so that
+	 * getRecvdStrengths() can do several receivers with each
+	 * instruction.  The arrays must have the same size.
+	 */
+	struct ReceiverArrays {
+		/// The x coordinates in meters.
+		span<const float> m_x;
+
+		/// The y coordinates in meters.
+		span<const float> m_y;
+
+		/// The z coordinates in meters.
+		span<const float> m_z;
+
+		/// The gains of the receivers' antennas.
+		span<const double> m_gains;
+	};
+
 	/// A destructor.
 	virtual ~PathLoss();
 
@@ -28,6 +84,64 @@ public:
 	 */
 	virtual double getRecvdStrength(const WirelessCommSignal& signal,
 		const PhysicalLayer& receiver) const = 0;
+
+	/**
+	 * Get the distance beyond which the signal is no stronger
+	 * than a given strength at any receiver.  Models that do not
+	 * know it return infinity, so no receiver is ignored.
+	 * @param signal the signal being transmitted.
+	 * @param receiverGain the highest gain of the receivers.
+	 * @param minStrength the strength in Watts.
+	 * @return the distance in meters.
+	 */
+	virtual double getMaxRange(const WirelessCommSignal& signal,
+		double receiverGain, double minStrength) const;
+
+	/**
+	 * Compute the part of the signal strength that only depends
+	 * on the link, which can be kept while the transmitter and
+	 * receiver stay where they are.
+	 * @param transmitterLocation the location of the transmitter.
+	 * @param receiverLocation the location of the receiver.
+	 * @param wavelength the wavelength of the signal in meters.
+	 * @param linkLoss set to the loss of the link.
+	 * @return false if the model cannot split the strength this
+	 * way, which it cannot by default.
+	 */
+	virtual bool getLinkLoss(const Location& transmitterLocation,
+		const Location& receiverLocation, double wavelength,
+		LinkLoss& linkLoss) const;
+
+	/**
+	 * Compute the signal strength for the signal at each of
+	 * a batch of receivers.  The strengths are the same, to the
+	 * last bit, as those of getRecvdStrength().  By default, the
+	 * receivers are done one at a time with getLinkLoss(), which
+	 * the model must support.
+	 * @param signal the signal being transmitted.
+	 * @param receivers the receivers.
+	 * @param strengths set to the signal strength in Watts at
+	 * each receiver.  It must have a strength for each receiver.
+	 */
+	virtual void getRecvdStrengths(const WirelessCommSignal& signal,
+		const ReceiverArrays& receivers, span<double> strengths) const;
+
+	/**
+	 * Set whether getRecvdStrengths() uses the vector kernels
+	 * of the models, if the processor supports them (i.e., has
+	 * AVX2).  Otherwise, it does one receiver at a time.
+	 * This should only be changed while no simulation runs.
+	 * @param doVectorKernels true if the vector kernels should
+	 * be used.
+	 */
+	static void setDoVectorKernels(bool doVectorKernels);
+
+	/**
+	 * Get whether getRecvdStrengths() uses the vector kernels.
+	 * @return true if they are enabled and the processor
+	 * supports them.
+	 */
+	static bool getDoVectorKernels();
 	
 protected:
 
@@ -37,8 +151,25 @@ protected:
 	/// A constructor
 	PathLoss();
 
+	/**
+	 * Compute the signal strength at the receivers of a batch
+	 * one at a time with getLinkLoss().
+	 * @param signal the signal being transmitted.
+	 * @param receivers the receivers.
+	 * @param strengths set to the signal strength in Watts at
+	 * each receiver.
+	 * @param firstReceiver the index of the first receiver to
+	 * compute, e.g., after those done by a vector kernel.
+	 */
+	void getEachRecvdStrength(const WirelessCommSignal& signal,
+		const ReceiverArrays& receivers, span<double> strengths,
+		t_ulong firstReceiver) const;
+
 private:
 
+	/// @see setDoVectorKernels()
+	static bool m_doVectorKernels;
+
 };
 typedef boost::shared_ptr<PathLoss> PathLossPtr;
 
@@ -82,6 +213,43 @@ public:
 	 */
 	virtual double getRecvdStrength(const WirelessCommSignal& signal,
 		const PhysicalLayer& receiver) const;
+
+	/**
+	 * Get the distance beyond which the signal is no stronger
+	 * than a given strength at any receiver.
+	 * @param signal the signal being transmitted.
+	 * @param receiverGain the highest gain of the receivers.
+	 * @param minStrength the strength in Watts.
+	 * @return the distance in meters.
+	 */
+	virtual double getMaxRange(const WirelessCommSignal& signal,
+		double receiverGain, double minStrength) const;
+
+	/**
+	 * Compute the part of the signal strength that only depends
+	 * on the link.
+	 * @param transmitterLocation the location of the transmitter.
+	 * @param receiverLocation the location of the receiver.
+	 * @param wavelength the wavelength of the signal in meters.
+	 * @param linkLoss set to the loss of the link.
+	 * @return true, since the loss can always be computed.
+	 */
+	virtual bool getLinkLoss(const Location& transmitterLocation,
+		const Location& receiverLocation, double wavelength,
+		LinkLoss& linkLoss) const;
+
+	/**
+	 * Compute the signal strength for the signal at each of
+	 * a batch of receivers, with the vector kernel if it is
+	 * enabled.
+	 * @param signal the signal being transmitted.
+	 * @param receivers the receivers.
+	 * @param strengths set to the signal strength in Watts at
+	 * each receiver.
+	 * @see PathLoss::getRecvdStrengths()
+	 */
+	virtual void getRecvdStrengths(const WirelessCommSignal& signal,
+		const ReceiverArrays& receivers, span<double> strengths) const;
 	
 protected:
 
@@ -142,13 +310,41 @@ public:
 	static inline TwoRayPtr create(double lossFactor);
 
 	/**
-	 * Compute the signal strength for the signal at the receiver.
+	 * Get the distance beyond which the signal is no stronger
+	 * than a given strength at any receiver.
 	 * @param signal the signal being transmitted.
-	 * @param receiver the object receiving the signal.
-	 * @return the signal strength in Watts.
+	 * @param receiverGain the highest gain of the receivers.
+	 * @param minStrength the strength in Watts.
+	 * @return the distance in meters.
 	 */
-	virtual double getRecvdStrength(const WirelessCommSignal& signal,
-		const PhysicalLayer& receiver) const;
+	virtual double getMaxRange(const WirelessCommSignal& signal,
+		double receiverGain, double minStrength) const;
+
+	/**
+	 * Compute the part of the signal strength that only depends
+	 * on the link.
+	 * @param transmitterLocation the location of the transmitter.
+	 * @param receiverLocation the location of the receiver.
+	 * @param wavelength the wavelength of the signal in meters.
+	 * @param linkLoss set to the loss of the link.
+	 * @return true, since the loss can always be computed.
+	 */
+	virtual bool getLinkLoss(const Location& transmitterLocation,
+		const Location& receiverLocation, double wavelength,
+		LinkLoss& linkLoss) const;
+
+	/**
+	 * Compute the signal strength for the signal at each of
+	 * a batch of receivers, with the vector kernel if it is
+	 * enabled.
+	 * @param signal the signal being transmitted.
+	 * @param receivers the receivers.
+	 * @param strengths set to the signal strength in Watts at
+	 * each receiver.
+	 * @see PathLoss::getRecvdStrengths()
+	 */
+	virtual void getRecvdStrengths(const WirelessCommSignal& signal,
+		const ReceiverArrays& receivers, span<double> strengths) const;
 	
 protected:
 
@@ -175,6 +371,15 @@ typedef boost::shared_ptr<TwoRay> TwoRayPtr;
 // Inline Functions
 /////////////////////////////////////////////////
 
+inline double PathLoss::LinkLoss::getRecvdStrength(double transmitPower,
+	double transmitterGain, double receiverGain) const
+{
+	double numerator = transmitPower * transmitterGain * receiverGain *
+		m_firstFactor * m_secondFactor;
+	assert(m_denominator > 0.0);
+	return (numerator / m_denominator);
+}
+
 inline FreeSpacePtr FreeSpace::create()
 {
 	FreeSpacePtr p(new FreeSpace());
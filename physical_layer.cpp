@@ -1,7 +1,11 @@
 
+#include <limits>
+using namespace std;
+
 #include "physical_layer.hpp"
 #include "node.hpp"
 #include "packet.hpp"
+#include "state_checkpoint.hpp"
 
 // These values are from a variety of sources, most
 // notably Alien and EPCglobal.
@@ -35,6 +39,9 @@ const double PhysicalLayer::m_BOLTZMANNS_CONSTANT = 1.3806503e-23;
 
 const t_uint PhysicalLayer::m_PHYSICAL_QUEUE_LENGTH = 1;
 
+const t_uint PhysicalLayer::m_NO_CHANNEL_MANAGER_INDEX =
+	numeric_limits<t_uint>::max();
+
 PhysicalLayer::PhysicalLayer(NodePtr node)
 	: CommunicationLayer(node),
 	m_currentTxPower(m_DEFAULT_TX_POWER),
@@ -46,7 +53,8 @@ PhysicalLayer::PhysicalLayer(NodePtr node)
 	m_dataRate(m_DEFAULT_DATA_RATE),
 	m_bandwidth(m_DEFAULT_BANDWIDTH),
 	m_pendingRecvSignalError(false),
-	m_signalSendingDelay(0.0)
+	m_signalSendingDelay(0.0),
+	m_channelManagerIndex(m_NO_CHANNEL_MANAGER_INDEX)
 {
 	assert(m_dataRate > 0.0);
 	assert(m_bandwidth > 0.0);
@@ -117,9 +125,28 @@ bool PhysicalLayer::recvFromLayer(
 		WirelessCommSignal::create(myLocation, 
 		powerToDecibels(signalTxPower), 
 		getWavelength(), getGain(), packet);
+	signal->setLocationVersion(getLocationVersion());
 	return sendSignal(signal);
 }
 
+void PhysicalLayer::saveState(StateCheckpoint& checkpoint)
+{
+	CommunicationLayer::saveState(checkpoint);
+	checkpoint.save(m_currentTxPower);
+	checkpoint.save(m_pendingRecvSignalError);
+	checkpoint.save(m_signalStrengths);
+	checkpoint.save(m_pendingRecvSignal);
+}
+
+void PhysicalLayer::resetState()
+{
+	CommunicationLayer::resetState();
+	m_currentTxPower = min(m_DEFAULT_TX_POWER, m_maxTxPower);
+	m_pendingRecvSignalError = false;
+	m_signalStrengths.clear();
+	m_pendingRecvSignal.reset();
+}
+
 bool PhysicalLayer::isTransmitting() const
 {
 	assert(m_transmittingTimer.get() != 0);
@@ -292,3 +319,19 @@ Location PhysicalLayer::getLocation() const
 	return getNode()->getLocation();
 }
 
+t_ulong PhysicalLayer::getLocationVersion() const
+{
+	return getNode()->getLocationVersion();
+}
+
+bool PhysicalLayer::scheduleEvent(EventPtr eventToSchedule,
+	const SimTime& eventDelay)
+{
+	return getNode()->scheduleEvent(eventToSchedule, eventDelay);
+}
+
+SimulatorPtr PhysicalLayer::getSimulator() const
+{
+	return getNode()->getSimulator();
+}
+
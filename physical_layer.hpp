@@ -21,6 +21,7 @@ typedef map<WirelessCommSignalPtr,double> SignalStrengthMap;
  */
 class PhysicalLayer : public CommunicationLayer {
 friend class SignalRecvEvent;
+friend class WirelessChannelManager;
 public:
 	/// Smart pointer that clients should use.
 	typedef boost::shared_ptr<PhysicalLayer> PhysicalLayerPtr;
@@ -69,6 +70,19 @@ public:
 	 */
 	virtual bool sendSignal(WirelessCommSignalPtr signal);
 
+	/**
+	 * Save the layer's transmit power and the signals it is
+	 * receiving in a checkpoint.
+	 * @param checkpoint the checkpoint being taken.
+	 */
+	virtual void saveState(StateCheckpoint& checkpoint);
+
+	/**
+	 * Drop the signals being received and put the transmit
+	 * power back to its default, capped by the maximum.
+	 */
+	virtual void resetState();
+
 	/**
 	 * Determine if this layer is currently transmitting a
 	 * signal.
@@ -114,6 +128,34 @@ public:
 	 */
 	Location getLocation() const;
 
+	/**
+	 * Return the version of the location of this physical layer.
+	 * @return the location version of the node that owns this
+	 * physical layer.
+	 * @see Node::getLocationVersion()
+	 */
+	t_ulong getLocationVersion() const;
+
+	/**
+	 * Add an event to the event queue of the simulator in
+	 * which this physical layer's node lives.
+	 * This is needed to schedule the end of the signals
+	 * that it receives.
+	 * @param eventToSchedule a pointer to the event being scheduled.
+	 * @param eventDelay how far in the future the event should be
+	 * scheduled.
+	 * @return true if the event was successfully scheduled.
+	 */
+	bool scheduleEvent(EventPtr eventToSchedule,
+		const SimTime& eventDelay);
+
+	/**
+	 * Get the simulator in which this physical layer's node
+	 * lives.
+	 * @return a pointer to the simulator.
+	 */
+	SimulatorPtr getSimulator() const;
+
 	/**
 	 * Add a signal currently being received and its computed
 	 * signal strength.
@@ -439,6 +481,10 @@ private:
 	/// Queue length for physical layers.
 	static const t_uint m_PHYSICAL_QUEUE_LENGTH;
 
+	/// The value of m_channelManagerIndex before the layer
+	/// is attached to a channel.
+	static const t_uint m_NO_CHANNEL_MANAGER_INDEX;
+
 	/// Determine when debugging info gets printed.
 	static const bool m_DEBUG_SIGNAL_CAPTURE = true;
 	static const bool m_DEBUG_TRANSMIT_POWER = true;
@@ -516,6 +562,11 @@ private:
 	/// @see isTransmitting()
 	TimerPtr m_transmittingTimer;
 
+	/// The index of this object in the tables of its
+	/// WirelessChannelManager, which sets it when the
+	/// object is first attached to a channel.
+	t_uint m_channelManagerIndex;
+
 };
 typedef boost::shared_ptr<PhysicalLayer> PhysicalLayerPtr;
 
@@ -676,7 +727,7 @@ inline CommunicationLayer::Types PhysicalLayer::getLayerType() const
 class SignalRecvEvent : public Event {
 public:
 	/// Smart pointer that clients should use.
-	typedef boost::shared_ptr<SignalRecvEvent> SignalRecvEventPtr;
+	typedef boost::intrusive_ptr<SignalRecvEvent> SignalRecvEventPtr;
 
 	/// A constructor.
 	SignalRecvEvent(WirelessChannelManagerPtr channelManager,
@@ -701,12 +752,19 @@ public:
 		m_channelManager->recvSignal(m_sender, m_signal);
 	}
 
+	/// A signal starts once the signals that end at the
+	/// time have ended.
+	PriorityClasses getPriorityClass() const
+	{
+		return PriorityClasses_SignalStart;
+	}
+
 private:
 	WirelessChannelManagerPtr m_channelManager;
 	PhysicalLayerPtr m_sender;
 	WirelessCommSignalPtr m_signal;
 };
-typedef boost::shared_ptr<SignalRecvEvent> SignalRecvEventPtr;
+typedef boost::intrusive_ptr<SignalRecvEvent> SignalRecvEventPtr;
 
 #endif // PHYSICAL_LAYER_H
 
@@ -0,0 +1,79 @@
+
+#include "process.hpp"
+#include "node.hpp"
+#include "packet.hpp"
+
+Process::Process(NodePtr node, ProcessBody&& body)
+	: m_node(node), m_body(std::move(body)), m_isWaitingForPacket(false),
+	m_isResumed(false)
+{
+	assert(m_node.get() != 0);
+	assert(m_body.getHandle());
+	m_body.getHandle().promise().m_process = this;
+	m_resumeEvent = ProcessResumeEvent::create(this);
+}
+
+Process::~Process()
+{
+	// The event may outlive the process in the event queue.
+	m_resumeEvent->m_process = 0;
+}
+
+void Process::start(const SimTime& delay)
+{
+	assert(!m_resumeEvent->inEventQueue() && !isDone());
+	m_node->scheduleEvent(m_resumeEvent, delay);
+}
+
+void Process::deliverPacket(PacketPtr packet)
+{
+	m_mailbox.push_back(packet);
+	// A running coroutine takes the packet the next time
+	// that it waits for one.
+	if(m_isWaitingForPacket && !m_isResumed) {
+		resume();
+	}
+}
+
+void Process::waitFor(const SimTime& delay)
+{
+	assert(!m_resumeEvent->inEventQueue());
+	m_node->scheduleEvent(m_resumeEvent, delay);
+}
+
+bool Process::waitForPacket(bool hasTimeout, const SimTime& timeout)
+{
+	if(!m_mailbox.empty()) {
+		return false;
+	}
+
+	m_isWaitingForPacket = true;
+	if(hasTimeout) {
+		waitFor(timeout);
+	}
+	return true;
+}
+
+PacketPtr Process::takePacket()
+{
+	m_isWaitingForPacket = false;
+	PacketPtr packet;
+	if(!m_mailbox.empty()) {
+		packet = m_mailbox.front();
+		m_mailbox.pop_front();
+		// The packet came before the timeout.
+		if(m_resumeEvent->inEventQueue()) {
+			m_node->cancelEvent(m_resumeEvent);
+		}
+	}
+	return packet;
+}
+
+void Process::resume()
+{
+	assert(!m_isResumed && !isDone());
+	m_isResumed = true;
+	m_body.getHandle().resume();
+	m_isResumed = false;
+}
+
@@ -0,0 +1,433 @@
+
+#ifndef PROCESS_H
+#define PROCESS_H
+
+#include <coroutine>
+#include <deque>
+using namespace std;
+#include <boost/shared_ptr.hpp>
+#include <boost/intrusive_ptr.hpp>
+#include <boost/utility.hpp>
+
+#include "utility.hpp"
+#include "sim_time.hpp"
+#include "event.hpp"
+#include "event_pool.hpp"
+
+class Node;
+typedef boost::shared_ptr<Node> NodePtr;
+class Packet;
+typedef boost::shared_ptr<Packet> PacketPtr;
+class Process;
+class ProcessResumeEvent;
+typedef boost::intrusive_ptr<ProcessResumeEvent> ProcessResumeEventPtr;
+
+/////////////////////////////////////////////////
+// ProcessBody Class
+/////////////////////////////////////////////////
+
+/**
+ * The return type of a coroutine that is run as a Process.
+ * A protocol can be written as a single function that waits
+ * with \c co_await on the awaitables of its node (see
+ * Node::sleep() and Node::recvPacket()) rather than as a set
+ * of event handlers that keep track of where they are.
+ * The body owns the coroutine's frame, which is allocated
+ * from the EventPool.  The coroutine does not run until the
+ * Process that it is given to is started.
+ */
+class ProcessBody : boost::noncopyable {
+public:
+
+	/**
+	 * The promise of the coroutine, which links its frame
+	 * to the process that runs it.
+	 */
+	struct promise_type {
+		/// The process that runs the coroutine.
+		Process* m_process;
+
+		/// A constructor.
+		promise_type() : m_process(0) { }
+
+		/// Get the body that owns the coroutine's frame.
+		ProcessBody get_return_object()
+		{
+			return ProcessBody(
+				coroutine_handle<promise_type>::from_promise(*this));
+		}
+
+		/// The coroutine waits to be started.
+		suspend_always initial_suspend() noexcept
+		{
+			return suspend_always();
+		}
+
+		/// The frame is kept until the body is destroyed.
+		suspend_always final_suspend() noexcept
+		{
+			return suspend_always();
+		}
+
+		/// The coroutine ended.
+		void return_void() { }
+
+		/// The simulator does not use exceptions.
+		void unhandled_exception()
+		{
+			assert(false);
+		}
+
+		/// Allocate the coroutine's frame from the pool.
+		static void* operator new(size_t sizeInBytes)
+		{
+			return EventPool::instance()->allocate(sizeInBytes);
+		}
+
+		/// Return the coroutine's frame to the pool.
+		static void operator delete(void* block, size_t sizeInBytes)
+		{
+			EventPool::instance()->deallocate(block, sizeInBytes);
+		}
+	};
+
+	/// The handle of the coroutine.
+	typedef coroutine_handle<promise_type> Handle;
+
+	/// A move constructor.
+	inline ProcessBody(ProcessBody&& rhs);
+
+	/// A destructor, which destroys the coroutine's frame.
+	inline ~ProcessBody();
+
+	/**
+	 * Get the handle of the coroutine.
+	 * @return the handle, which is empty if the body was
+	 * moved.
+	 */
+	inline Handle getHandle() const;
+
+private:
+
+	/// The handle of the coroutine.
+	Handle m_handle;
+
+	/// A constructor.
+	/// @param handle the handle of the coroutine.
+	inline ProcessBody(Handle handle);
+
+};
+
+/////////////////////////////////////////////////
+// Process Class
+/////////////////////////////////////////////////
+
+/**
+ * A coroutine that runs on a node as part of the simulation.
+ * Each time the coroutine waits, the process puts its own
+ * resume event in the event queue, so waiting costs neither
+ * an Event allocation nor a Timer.  Packets are given to the
+ * process with deliverPacket() and kept in its mailbox until
+ * it waits for one; a process that is waiting for a packet is
+ * resumed right away, as an event handler would be called.
+ * The coroutine's frame is not part of the simulator's
+ * checkpoints, so processes cannot be rolled back (e.g., by
+ * Simulator::restoreState() or an optimistic
+ * ParallelSimulator).
+ */
+class Process : boost::noncopyable {
+friend class ProcessResumeEvent;
+public:
+	/// Smart pointer that clients should use.
+	typedef boost::shared_ptr<Process> ProcessPtr;
+
+	/// A destructor.
+	~Process();
+
+	/**
+	 * A factory method to ensure that all objects
+	 * are created via \c new since we are using smart pointers.
+	 * @param node the node on which the process runs.
+	 * @param body the coroutine that the process runs.
+	 */
+	static inline ProcessPtr create(NodePtr node, ProcessBody&& body);
+
+	/**
+	 * Start running the coroutine.
+	 * @param delay the time in the future at which the
+	 * coroutine starts.
+	 */
+	void start(const SimTime& delay);
+
+	/**
+	 * Check whether the coroutine has returned.
+	 * @return true if the coroutine is done.
+	 */
+	inline bool isDone() const;
+
+	/**
+	 * Give the process a packet.  If the process is waiting
+	 * for one, it is resumed before this returns.
+	 * @param packet the packet.
+	 */
+	void deliverPacket(PacketPtr packet);
+
+	/**
+	 * Get the node on which the process runs.
+	 * @return the node.
+	 */
+	inline NodePtr getNode() const;
+
+	/**
+	 * Wait until the resume event fires.
+	 * This is called when the coroutine is suspended.
+	 * @param delay the time until the event fires.
+	 */
+	void waitFor(const SimTime& delay);
+
+	/**
+	 * Wait until a packet is delivered.
+	 * This is called when the coroutine is suspended.
+	 * @param hasTimeout whether to stop waiting after a time.
+	 * @param timeout the longest time to wait.
+	 * @return false if a packet was already delivered, in
+	 * which case the coroutine is not suspended.
+	 */
+	bool waitForPacket(bool hasTimeout, const SimTime& timeout);
+
+	/**
+	 * Take the next packet from the mailbox once the
+	 * coroutine is resumed after waitForPacket().
+	 * @return the packet or an empty pointer if the wait
+	 * timed out.
+	 */
+	PacketPtr takePacket();
+
+private:
+
+	/// The node on which the process runs.
+	NodePtr m_node;
+
+	/// The coroutine.
+	ProcessBody m_body;
+
+	/// The event that resumes the coroutine.
+	ProcessResumeEventPtr m_resumeEvent;
+
+	/// The packets delivered that the coroutine has not
+	/// taken yet.
+	deque<PacketPtr> m_mailbox;
+
+	/// Whether the coroutine is waiting for a packet.
+	bool m_isWaitingForPacket;
+
+	/// Whether the coroutine is executing.
+	bool m_isResumed;
+
+	/// A constructor.
+	Process(NodePtr node, ProcessBody&& body);
+
+	/**
+	 * Run the coroutine until it next waits or returns.
+	 */
+	void resume();
+
+};
+typedef boost::shared_ptr<Process> ProcessPtr;
+
+/**
+ * The event that a Process puts in the event queue when it
+ * waits.
+ */
+class ProcessResumeEvent : public Event {
+friend class Process;
+public:
+	/// Smart pointer that clients should use.
+	typedef boost::intrusive_ptr<ProcessResumeEvent>
+		ProcessResumeEventPtr;
+
+	/**
+	 * A factory method to ensure that all objects
+	 * are created via \c new since we are using smart pointers.
+	 * @param process the process that owns the event.  A raw
+	 * pointer is used to avoid a cyclic reference.
+	 */
+	static inline ProcessResumeEventPtr create(Process* process)
+	{
+		ProcessResumeEventPtr p(new ProcessResumeEvent(process));
+		return p;
+	}
+
+	void execute()
+	{
+		if(m_process != 0) {
+			m_process->resume();
+		}
+	}
+
+protected:
+
+	/// A constructor.
+	ProcessResumeEvent(Process* process)
+		: Event(), m_process(process)
+	{
+
+	}
+
+private:
+
+	/// The process that owns the event or zero if the
+	/// process was destroyed.
+	Process* m_process;
+
+};
+
+/////////////////////////////////////////////////
+// Awaitables
+/////////////////////////////////////////////////
+
+/**
+ * Waits for a time when awaited by a process's coroutine.
+ * @see Node::sleep()
+ */
+class ProcessSleep {
+public:
+
+	/// A constructor.
+	/// @param node the node on which the process runs.
+	/// @param delay the time to wait.
+	ProcessSleep(const Node* node, const SimTime& delay)
+		: m_node(node), m_delay(delay)
+	{
+
+	}
+
+	/// The coroutine is always suspended.
+	bool await_ready() const
+	{
+		return false;
+	}
+
+	/// Put the process's resume event in the event queue.
+	void await_suspend(ProcessBody::Handle handle)
+	{
+		Process* process = handle.promise().m_process;
+		assert(process != 0 && process->getNode().get() == m_node);
+		process->waitFor(m_delay);
+	}
+
+	/// Nothing is returned.
+	void await_resume() const { }
+
+private:
+
+	/// The node on which the process runs.
+	const Node* m_node;
+
+	/// The time to wait.
+	SimTime m_delay;
+
+};
+
+/**
+ * Waits for a packet when awaited by a process's coroutine.
+ * Awaiting it gives the packet, or an empty pointer if the
+ * wait timed out.
+ * @see Node::recvPacket()
+ */
+class ProcessRecv {
+public:
+
+	/// A constructor.
+	/// @param node the node on which the process runs.
+	/// @param hasTimeout whether to stop waiting after a time.
+	/// @param timeout the longest time to wait.
+	ProcessRecv(const Node* node, bool hasTimeout, const SimTime& timeout)
+		: m_node(node), m_hasTimeout(hasTimeout), m_timeout(timeout),
+		m_process(0)
+	{
+
+	}
+
+	/// The mailbox is checked when the coroutine is suspended.
+	bool await_ready() const
+	{
+		return false;
+	}
+
+	/// Wait for a packet unless one was already delivered.
+	bool await_suspend(ProcessBody::Handle handle)
+	{
+		m_process = handle.promise().m_process;
+		assert(m_process != 0 && m_process->getNode().get() == m_node);
+		return m_process->waitForPacket(m_hasTimeout, m_timeout);
+	}
+
+	/// Take the packet.
+	PacketPtr await_resume()
+	{
+		return m_process->takePacket();
+	}
+
+private:
+
+	/// The node on which the process runs.
+	const Node* m_node;
+
+	/// Whether to stop waiting after a time.
+	bool m_hasTimeout;
+
+	/// The longest time to wait.
+	SimTime m_timeout;
+
+	/// The process that is waiting.
+	Process* m_process;
+
+};
+
+/////////////////////////////////////////////////
+// Inline Functions
+/////////////////////////////////////////////////
+
+inline ProcessBody::ProcessBody(Handle handle)
+	: m_handle(handle)
+{
+
+}
+
+inline ProcessBody::ProcessBody(ProcessBody&& rhs)
+	: m_handle(rhs.m_handle)
+{
+	rhs.m_handle = Handle();
+}
+
+inline ProcessBody::~ProcessBody()
+{
+	if(m_handle) {
+		m_handle.destroy();
+	}
+}
+
+inline ProcessBody::Handle ProcessBody::getHandle() const
+{
+	return m_handle;
+}
+
+inline ProcessPtr Process::create(NodePtr node, ProcessBody&& body)
+{
+	ProcessPtr p(new Process(node, std::move(body)));
+	return p;
+}
+
+inline bool Process::isDone() const
+{
+	return m_body.getHandle().done();
+}
+
+inline NodePtr Process::getNode() const
+{
+	return m_node;
+}
+
+#endif // PROCESS_H
+
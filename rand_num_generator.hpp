@@ -9,6 +9,7 @@ using namespace std;
 #include <boost/utility.hpp>
 
 #include "utility.hpp"
+#include "state_checkpoint.hpp"
 
 /**
  * Handles the generation of random numbers from
@@ -32,6 +33,20 @@ public:
 	 */
 	inline void setSeed(const t_uint seed);
 
+	/**
+	 * Get the seed being used.
+	 * @return the seed.
+	 */
+	inline t_uint getSeed() const;
+
+	/**
+	 * Save the state of the generator so that the numbers
+	 * drawn after the checkpoint are drawn again after it
+	 * is restored.
+	 * @param checkpoint the checkpoint being taken.
+	 */
+	inline void saveState(StateCheckpoint& checkpoint);
+
 	/**
 	 * Generate an int unformly at random from the range
 	 * [min,max].
@@ -116,6 +131,17 @@ inline void RandNumGenerator::setSeed(t_uint seed)
 	m_baseGenerator.seed(m_seed);
 }
 
+inline t_uint RandNumGenerator::getSeed() const
+{
+	return m_seed;
+}
+
+inline void RandNumGenerator::saveState(StateCheckpoint& checkpoint)
+{
+	checkpoint.save(m_seed);
+	checkpoint.save(m_baseGenerator);
+}
+
 inline int RandNumGenerator::uniformInt(const int min, const int max)
 {
 	boost::uniform_int<> uniformInt(min, max);
@@ -0,0 +1,182 @@
+
+#include <cmath>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/math/distributions/students_t.hpp>
+
+#include "replication_runner.hpp"
+
+const t_uint ReplicationRunner::m_DEFAULT_NUM_REPLICATIONS = 1;
+const t_uint ReplicationRunner::m_DEFAULT_FIRST_SEED = 1;
+const double ReplicationRunner::m_DEFAULT_CONFIDENCE_LEVEL = 0.95;
+
+ReplicationRunner::ReplicationRunner(const Scenario& scenario)
+	: m_scenario(scenario),
+	m_numReplications(m_DEFAULT_NUM_REPLICATIONS), m_numThreads(0),
+	m_firstSeed(m_DEFAULT_FIRST_SEED),
+	m_confidenceLevel(m_DEFAULT_CONFIDENCE_LEVEL),
+	m_nextReplication(0), m_elapsedSeconds(0.0)
+{
+
+}
+
+t_uint ReplicationRunner::getNumThreads() const
+{
+	t_uint numThreads = m_numThreads;
+	if(numThreads == 0) {
+		numThreads = max(boost::thread::hardware_concurrency(), 1u);
+	}
+	// There is no point in having idle workers.
+	return min(numThreads, m_numReplications);
+}
+
+void ReplicationRunner::run()
+{
+	assert(!m_scenario.empty());
+	m_nextReplication = 0;
+	m_replicationStats.clear();
+	m_replicationStats.resize(m_numReplications);
+
+	boost::posix_time::ptime startTime =
+		boost::posix_time::microsec_clock::universal_time();
+
+	boost::thread_group workers;
+	t_uint numThreads = getNumThreads();
+	for(t_uint i = 0; i < numThreads; ++i) {
+		workers.create_thread(
+			boost::bind(&ReplicationRunner::workerLoop, this));
+	}
+	workers.join_all();
+
+	boost::posix_time::time_duration elapsed =
+		boost::posix_time::microsec_clock::universal_time() - startTime;
+	m_elapsedSeconds = elapsed.total_microseconds() / 1e6;
+
+	mergeStats();
+}
+
+void ReplicationRunner::workerLoop()
+{
+	while(true) {
+		t_uint replication;
+		{
+			boost::lock_guard<boost::mutex> lock(m_mutex);
+			if(m_nextReplication >= m_numReplications) {
+				break;
+			}
+			replication = m_nextReplication++;
+		}
+		runReplication(replication);
+	}
+}
+
+void ReplicationRunner::runReplication(t_uint replication)
+{
+	SimulatorOwnerPtr simulator = Simulator::create();
+	Simulator::setInstance(simulator.get());
+	simulator->seedRandNumGenerator(m_firstSeed + replication);
+
+	LogStreamManagerPtr logStreamManager =
+		simulator->getLogStreamManager();
+	ostreamPtr discardStream(new ostream(0));
+	logStreamManager->setAllStreams(discardStream);
+	logStreamManager->setDoRecordStats(true);
+
+	m_scenario(simulator.get());
+
+	// Each replication has its own slot, so no lock is needed.
+	m_replicationStats[replication] =
+		logStreamManager->getRecordedStats();
+}
+
+void ReplicationRunner::mergeStats()
+{
+	m_mergedStats.clear();
+	for(t_uint i = 0; i < m_replicationStats.size(); ++i) {
+		const vector<LoggedStat>& stats = m_replicationStats[i];
+
+		map<pair<string,string>,t_uint> counts;
+		for(t_uint j = 0; j < stats.size(); ++j) {
+			counts[make_pair(stats[j].m_nodeId, stats[j].m_key)]++;
+		}
+
+		for(t_uint j = 0; j < stats.size(); ++j) {
+			pair<string,string> key =
+				make_pair(stats[j].m_nodeId, stats[j].m_key);
+			if(counts[key] != 1) {
+				continue;
+			}
+			istringstream valueStream(stats[j].m_value);
+			double value;
+			valueStream >> value;
+			if(valueStream.fail() || !valueStream.eof()) {
+				continue;
+			}
+			m_mergedStats[key].m_values.push_back(value);
+		}
+	}
+}
+
+void ReplicationRunner::printResults(ostream& s) const
+{
+	double replicationsPerSecond = 0.0;
+	if(m_elapsedSeconds > 0.0) {
+		replicationsPerSecond = m_numReplications / m_elapsedSeconds;
+	}
+	s << "Replications: " << m_numReplications << " (seeds " <<
+		m_firstSeed << "-" << (m_firstSeed + m_numReplications - 1) <<
+		", threads " << getNumThreads() << ", " << fixed <<
+		setprecision(3) << m_elapsedSeconds << " s, " <<
+		replicationsPerSecond << " replications/s)\n";
+
+	ostringstream ciHeader;
+	ciHeader << "ci" << setprecision(0) << fixed <<
+		(m_confidenceLevel * 100.0);
+	s << setw(8) << left << "nodeId" << setw(28) << "stat" << right <<
+		setw(6) << "n" << setw(16) << "mean" << setw(16) << "stddev" <<
+		setw(16) << ciHeader.str() << "\n";
+
+	s << setprecision(8);
+	MergedStatMap::const_iterator p;
+	for(p = m_mergedStats.begin(); p != m_mergedStats.end(); ++p) {
+		const vector<double>& values = p->second.m_values;
+		t_uint n = values.size();
+		assert(n > 0);
+
+		double sum = 0.0;
+		for(t_uint i = 0; i < n; ++i) {
+			sum += values[i];
+		}
+		double mean = sum / n;
+
+		double stddev = 0.0;
+		double halfWidth = 0.0;
+		if(n > 1) {
+			double squaredErrorSum = 0.0;
+			for(t_uint i = 0; i < n; ++i) {
+				squaredErrorSum += (values[i] - mean) * (values[i] - mean);
+			}
+			stddev = sqrt(squaredErrorSum / (n - 1));
+			boost::math::students_t distribution(n - 1);
+			double t = boost::math::quantile(distribution,
+				(1.0 + m_confidenceLevel) / 2.0);
+			halfWidth = t * stddev / sqrt(static_cast<double>(n));
+		}
+
+		string nodeId = p->first.first;
+		if(nodeId.empty()) {
+			nodeId = "global";
+		}
+		s << setw(8) << left << nodeId << setw(28) << p->first.second <<
+			right << setw(6) << n << setw(16) << mean << setw(16) <<
+			stddev << setw(16) << halfWidth << "\n";
+	}
+	s.unsetf(ios::fixed);
+	s << setprecision(6);
+}
+
@@ -0,0 +1,223 @@
+
+#ifndef REPLICATION_RUNNER_H
+#define REPLICATION_RUNNER_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+using namespace std;
+#include <boost/shared_ptr.hpp>
+#include <boost/function.hpp>
+#include <boost/utility.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "utility.hpp"
+#include "simulator.hpp"
+#include "log_stream_manager.hpp"
+
+/////////////////////////////////////////////////
+// ReplicationRunner Class
+/////////////////////////////////////////////////
+
+/**
+ * Runs independent replications of a scenario in parallel
+ * and merges their statistics.
+ * Each replication is given its own Simulator, seeded with
+ * a different seed, and the replications are handed out to
+ * a pool of worker threads.  Since simulators share no
+ * mutable state, the replications do not interact and the
+ * results do not depend on the number of threads.
+ *
+ * While a replication runs, all of its log streams are
+ * discarded and its stats items are kept in memory.  Stats
+ * that a node (or the simulation as a whole) logs exactly
+ * once per replication with a numeric value, such as
+ * \c tagsReadCount or \c missedReadTotal, are then merged
+ * across the replications into a mean, standard deviation,
+ * and confidence interval.  Stats that are logged several
+ * times per replication (e.g., one item per tag read) are
+ * not merged.
+ */
+class ReplicationRunner : boost::noncopyable {
+public:
+	/// Smart pointer that clients should use.
+	typedef boost::shared_ptr<ReplicationRunner> ReplicationRunnerPtr;
+
+	/// The function that builds a scenario in the given
+	/// simulator and runs it.  The simulator has been made
+	/// current on the calling thread and has been seeded.
+	typedef boost::function<void (SimulatorPtr)> Scenario;
+
+	/**
+	 * A factory method to ensure that all objects
+	 * are created via \c new since we are using smart pointers.
+	 * @param scenario the scenario to be replicated.
+	 */
+	static inline ReplicationRunnerPtr create(const Scenario& scenario);
+
+	/**
+	 * Set the number of replications to run.
+	 * @param numReplications the number of replications.
+	 */
+	inline void setNumReplications(t_uint numReplications);
+
+	/**
+	 * Get the number of replications to run.
+	 * @return the number of replications.
+	 */
+	inline t_uint getNumReplications() const;
+
+	/**
+	 * Set the number of worker threads.
+	 * @param numThreads the number of threads or zero to
+	 * use one thread per hardware thread of the machine.
+	 */
+	inline void setNumThreads(t_uint numThreads);
+
+	/**
+	 * Get the number of worker threads that will be used.
+	 * @return the number of threads.
+	 */
+	t_uint getNumThreads() const;
+
+	/**
+	 * Set the seed of the first replication.  Replication
+	 * \e i is seeded with <tt>firstSeed + i</tt>.
+	 * @param firstSeed the seed of the first replication.
+	 */
+	inline void setFirstSeed(t_uint firstSeed);
+
+	/**
+	 * Set the level of the confidence intervals.
+	 * @param confidenceLevel the level in (0,1).
+	 */
+	inline void setConfidenceLevel(double confidenceLevel);
+
+	/**
+	 * Run all of the replications and merge their stats.
+	 * This returns once every replication has finished.
+	 */
+	void run();
+
+	/**
+	 * Print the merged stats of the last run().
+	 * @param s the stream to print to.
+	 */
+	void printResults(ostream& s) const;
+
+private:
+
+	/// The default number of replications.
+	static const t_uint m_DEFAULT_NUM_REPLICATIONS;
+
+	/// The default seed of the first replication.
+	static const t_uint m_DEFAULT_FIRST_SEED;
+
+	/// The default level of the confidence intervals.
+	static const double m_DEFAULT_CONFIDENCE_LEVEL;
+
+	/// A stat merged across the replications.
+	struct MergedStat {
+		/// The value of the stat in each replication in
+		/// which it was logged.
+		vector<double> m_values;
+	};
+
+	/// Merged stats keyed by node ID and stat key.
+	typedef map<pair<string,string>,MergedStat> MergedStatMap;
+
+	/// The scenario being replicated.
+	Scenario m_scenario;
+
+	/// @see setNumReplications()
+	t_uint m_numReplications;
+
+	/// @see setNumThreads()
+	t_uint m_numThreads;
+
+	/// @see setFirstSeed()
+	t_uint m_firstSeed;
+
+	/// @see setConfidenceLevel()
+	double m_confidenceLevel;
+
+	/// Protects m_nextReplication.
+	boost::mutex m_mutex;
+
+	/// The next replication to be handed to a worker.
+	t_uint m_nextReplication;
+
+	/// The stats recorded by each replication.
+	vector<vector<LoggedStat> > m_replicationStats;
+
+	/// The merged stats of the last run.
+	MergedStatMap m_mergedStats;
+
+	/// The wall clock time taken by the last run.
+	double m_elapsedSeconds;
+
+	/// A constructor.
+	/// @param scenario the scenario to be replicated.
+	ReplicationRunner(const Scenario& scenario);
+
+	/**
+	 * Run replications until there are none left.
+	 * This is the body of each worker thread.
+	 */
+	void workerLoop();
+
+	/**
+	 * Run a single replication.
+	 * @param replication the index of the replication.
+	 */
+	void runReplication(t_uint replication);
+
+	/**
+	 * Merge the stats of all replications into m_mergedStats.
+	 */
+	void mergeStats();
+
+};
+typedef boost::shared_ptr<ReplicationRunner> ReplicationRunnerPtr;
+
+/////////////////////////////////////////////////
+// Inline Functions
+/////////////////////////////////////////////////
+
+inline ReplicationRunnerPtr ReplicationRunner::create(
+	const Scenario& scenario)
+{
+	ReplicationRunnerPtr p(new ReplicationRunner(scenario));
+	return p;
+}
+
+inline void ReplicationRunner::setNumReplications(t_uint numReplications)
+{
+	assert(numReplications > 0);
+	m_numReplications = numReplications;
+}
+
+inline t_uint ReplicationRunner::getNumReplications() const
+{
+	return m_numReplications;
+}
+
+inline void ReplicationRunner::setNumThreads(t_uint numThreads)
+{
+	m_numThreads = numThreads;
+}
+
+inline void ReplicationRunner::setFirstSeed(t_uint firstSeed)
+{
+	m_firstSeed = firstSeed;
+}
+
+inline void ReplicationRunner::setConfidenceLevel(double confidenceLevel)
+{
+	assert(confidenceLevel > 0.0 && confidenceLevel < 1.0);
+	m_confidenceLevel = confidenceLevel;
+}
+
+#endif // REPLICATION_RUNNER_H
+
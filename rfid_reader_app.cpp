@@ -3,6 +3,7 @@
 #include "rfid_tag_app.hpp"
 #include "node.hpp"
 #include "physical_layer.hpp"
+#include "state_checkpoint.hpp"
 
 ////////////////////////////////////////////////
 // RfidReaderApp functions
@@ -143,6 +144,30 @@ void RfidReaderApp::simulationEndHandler()
 		m_LAST_TAG_READ_LATENCY_STRING, lastTagReadLatencyStream.str());
 }
 
+void RfidReaderApp::saveState(StateCheckpoint& checkpoint)
+{
+	ApplicationLayer::saveState(checkpoint);
+	checkpoint.save(m_firstReadSentTime);
+	checkpoint.save(m_previousReadSentTime);
+	checkpoint.save(m_readTags);
+	checkpoint.save(m_lastTagRead);
+	checkpoint.save(m_readTagIds);
+	checkpoint.save(m_maxTxPower);
+	checkpoint.save(m_currentTxPowerLevel);
+}
+
+void RfidReaderApp::resetState()
+{
+	ApplicationLayer::resetState();
+	m_firstReadSentTime = SimTime(0.0);
+	m_previousReadSentTime = SimTime(0.0);
+	m_readTags.clear();
+	m_lastTagRead = make_pair(0, ReadTagData(0, 0.0, 0.0));
+	m_readTagIds.clear();
+	m_maxTxPower = 0.0;
+	m_currentTxPowerLevel = m_DEFAULT_NUM_POWER_CONTROL_LEVELS;
+}
+
 void RfidReaderApp::startHandler()
 {
 	// We will assume that the current PHY TX power is
@@ -181,7 +206,7 @@ bool RfidReaderApp::handleRecvdPacket(PacketPtr packet,
 		bool isNewTagId =
 			(m_readTagIds.find(readTagId) == m_readTagIds.end());
 		if(isNewTagId) {
-			SimTime timeRead = Simulator::instance()->currentTime();
+			SimTime timeRead = getNode()->currentTime();
 			m_lastTagRead =
 				make_pair(m_currentTxPowerLevel, ReadTagData(readTagId, 
 				timeRead, m_previousReadSentTime));
@@ -232,7 +257,7 @@ void RfidReaderApp::doNextRead()
 				nextTxPower << ", maxTxPower: " << m_maxTxPower;
 			LogStreamManager::instance()->logDebugItem(debugStream.str());
 		}
-		m_previousReadSentTime = Simulator::instance()->currentTime();
+		m_previousReadSentTime = getNode()->currentTime();
 		sendReadPacket(nextTxPower);
 	} else {
 		// Schedule the next read process.
@@ -251,7 +276,7 @@ void RfidReaderApp::doReadProcess()
 
 	assert(m_numPowerControlLevels > 0);
 
-	m_firstReadSentTime = Simulator::instance()->currentTime();
+	m_firstReadSentTime = getNode()->currentTime();
 	m_currentTxPowerLevel = 0;
 	doNextRead();
 }
@@ -266,6 +291,7 @@ void RfidReaderApp::sendResetPacket()
 	appData->setReaderId(getNodeId());
 	packetToSend->addData(Packet::DataTypes_Application, *appData);
 
+	recordActivity();
 	sendToQueue(packetToSend);
 }
 
@@ -288,6 +314,7 @@ void RfidReaderApp::sendReadPacket(double txPower)
 	packetToSend->addData(Packet::DataTypes_Application, *appData);
 
 	//sendToLayer(CommunicationLayer::Directions_Lower, packetToSend);
+	recordActivity();
 	sendToQueue(packetToSend);
 }
 
@@ -139,6 +139,17 @@ public:
 	 */
 	virtual void simulationEndHandler();
 
+	/**
+	 * Save the application's read state in a checkpoint.
+	 * @param checkpoint the checkpoint being taken.
+	 */
+	virtual void saveState(StateCheckpoint& checkpoint);
+
+	/**
+	 * Forget the tags that were read.
+	 */
+	virtual void resetState();
+
 	/**
 	 * Set the period with which the read command will be
 	 * issued.
@@ -189,6 +200,12 @@ public:
 	 */
 	inline bool getDoReset() const;
 
+	/**
+	 * Get the number of distinct tags that have been read.
+	 * @return the number of tags read.
+	 */
+	inline t_uint getNumTagsRead() const;
+
 	/**
 	 * Set the number of power control levels that the application
 	 * will use for its reads.
@@ -348,7 +365,7 @@ typedef boost::shared_ptr<RfidReaderApp> RfidReaderAppPtr;
 class RfidReaderAppReadEvent : public Event {
 public:
 	/// Smart pointer that clients should use.
-	typedef boost::shared_ptr<RfidReaderAppReadEvent> 
+	typedef boost::intrusive_ptr<RfidReaderAppReadEvent> 
 		RfidReaderAppReadEventPtr;
 
 	/**
@@ -377,7 +394,7 @@ protected:
 private:
 	RfidReaderAppPtr m_readerApp;
 };
-typedef boost::shared_ptr<RfidReaderAppReadEvent> 
+typedef boost::intrusive_ptr<RfidReaderAppReadEvent> 
 	RfidReaderAppReadEventPtr;
 
 ////////////////////////////////////////////////
@@ -399,8 +416,9 @@ inline RfidReaderAppPtr RfidReaderApp::create(NodePtr node,
 		RfidReaderAppReadEvent::create(p->thisRfidReaderApp());
 	p->m_readTimer = Timer::create(p->getNode(), readEvent);
 
-	Simulator::instance()->addSimulationEndListener(
+	p->getNode()->getSimulator()->addSimulationEndListener(
 		p->thisSimulationEndListener());
+	p->getNode()->getSimulator()->addStateSaver(p);
 
 	return p;
 }
@@ -442,11 +460,16 @@ inline SimTime RfidReaderApp::getNextReadTime() const
 	SimTime nextReadTime(0.0);
 	if(m_readTimer->isRunning()) {
 		nextReadTime = (m_readTimer->timeRemaining() + 
-			Simulator::instance()->currentTime());
+			getNode()->currentTime());
 	}
 	return nextReadTime;
 }
 
+inline t_uint RfidReaderApp::getNumTagsRead() const
+{
+	return m_readTagIds.size();
+}
+
 inline SimTime RfidReaderApp::getReadPeriod() const
 {
 	return m_readPeriod;
@@ -4,6 +4,7 @@
 #include "rfid_tag_mac.hpp"
 #include "rfid_reader_app.hpp"
 #include "log_stream_manager.hpp"
+#include "state_checkpoint.hpp"
 
 const double RfidReaderMac::m_READER_IFS = 10e-6;
 const t_uint RfidReaderMac::m_DEFAULT_NUMBER_OF_SLOTS = 10;
@@ -29,6 +30,34 @@ RfidReaderMac::~RfidReaderMac()
 
 }
 
+void RfidReaderMac::saveState(StateCheckpoint& checkpoint)
+{
+	SlottedMac::saveState(checkpoint);
+	checkpoint.save(m_doResetSlot);
+	checkpoint.save(m_resetSlotNumber);
+	checkpoint.save(m_doEntireReadCycle);
+	checkpoint.save(m_missedReadCount);
+	checkpoint.save(m_currentAppReadPacket);
+	checkpoint.save(m_nextCycleNumberOfSlots);
+	checkpoint.save(m_nextCycleTime);
+	checkpoint.save(m_winningSlotNumbers);
+	checkpoint.save(m_missedReads);
+}
+
+void RfidReaderMac::resetState()
+{
+	SlottedMac::resetState();
+	m_doResetSlot = false;
+	m_resetSlotNumber = 0;
+	m_doEntireReadCycle = false;
+	m_missedReadCount = 0;
+	m_currentAppReadPacket.reset();
+	m_nextCycleNumberOfSlots = m_DEFAULT_NUMBER_OF_SLOTS;
+	m_nextCycleTime = SimTime(m_DEFAULT_CYCLE_TIME);
+	m_winningSlotNumbers.clear();
+	m_missedReads.clear();
+}
+
 void RfidReaderMac::simulationEndHandler()
 {
 	t_uint missedReadSlotSum = 0;
@@ -170,9 +199,15 @@ void RfidReaderMac::beginSlotEvent()
 		}
 	}
 
+	// The slot timer re-arms itself for the next slot.
 	m_currentSlotNumber++;
-	assert(m_slotTimer.get() != 0);
-	m_slotTimer->reschedule(getSlotTime());
+}
+
+bool RfidReaderMac::isSlotIdle() const
+{
+	return (m_packetToTransmit.get() == 0 && m_numberOfSlots == 0 &&
+		!m_cycleTimer->isRunning() && m_missedReadCount == 0 &&
+		!m_doResetSlot && !getQueueIsBlocked());
 }
 
 void RfidReaderMac::endRequestCycleEvent()
@@ -219,6 +219,17 @@ public:
 	 */
 	virtual void simulationEndHandler();
 
+	/**
+	 * Save the MAC's read cycle in a checkpoint.
+	 * @param checkpoint the checkpoint being taken.
+	 */
+	virtual void saveState(StateCheckpoint& checkpoint);
+
+	/**
+	 * Put the MAC back to before its first read cycle.
+	 */
+	virtual void resetState();
+
 	/**
 	 * Handle a MAC packet that is received.
 	 * @param packet a pointer to the received packet.
@@ -333,6 +344,15 @@ protected:
 	 */
 	virtual void beginSlotEvent();
 
+	/**
+	 * Determine whether beginning the current slot would only
+	 * move the slot number along.  Outside of a read cycle,
+	 * a reader with nothing to send only logs that it could
+	 * not start a contention cycle.
+	 * @return true if beginSlotEvent() will be idle.
+	 */
+	virtual bool isSlotIdle() const;
+
 	/**
 	 * The function called when a request cycle ends.
 	 */
@@ -424,7 +444,7 @@ typedef boost::shared_ptr<RfidReaderMac> RfidReaderMacPtr;
 class RfidMacCycleEvent : public Event {
 public:
 	/// Smart pointer that clients should use.
-	typedef boost::shared_ptr<RfidMacCycleEvent> 
+	typedef boost::intrusive_ptr<RfidMacCycleEvent> 
 		RfidMacCycleEventPtr;
 
 	/**
@@ -454,7 +474,7 @@ protected:
 private:
 	RfidReaderMacPtr m_rfidReaderMac;
 };
-typedef boost::shared_ptr<RfidMacCycleEvent> 
+typedef boost::intrusive_ptr<RfidMacCycleEvent> 
 	RfidMacCycleEventPtr;
 
 ////////////////////////////////////////////////
@@ -474,15 +494,17 @@ inline RfidReaderMacPtr RfidReaderMac::create(NodePtr node,
 
 	SlottedMacSlotEventPtr slotEvent = 
 		SlottedMacSlotEvent::create(p->thisSlottedMac());
-	p->m_slotTimer = Timer::create(p->getNode(), slotEvent);
+	p->m_slotTimer = PeriodicTimer::create(p->getNode(), slotEvent,
+		p->getSlotTime());
 	p->m_slotTimer->start(SimTime(0.0));
 
 	RfidMacCycleEventPtr cycleEvent =
 		RfidMacCycleEvent::create(p->thisRfidReaderMac());
 	p->m_cycleTimer = Timer::create(p->getNode(), cycleEvent);
 
-	Simulator::instance()->addSimulationEndListener(
+	p->getNode()->getSimulator()->addSimulationEndListener(
 		p->thisSimulationEndListener());
+	p->getNode()->getSimulator()->addStateSaver(p);
 
 	return p;
 }
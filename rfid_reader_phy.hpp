@@ -156,8 +156,9 @@ inline RfidReaderPhyPtr RfidReaderPhy::create(
 	RfidReaderPhyPtr p(new RfidReaderPhy(node, wirelessChannelManager));
 	p->m_weakThis = p;
 	// weakThis *must* be set before this* functions are called.
-	Simulator::instance()->addSimulationEndListener(
+	p->getNode()->getSimulator()->addSimulationEndListener(
 		p->thisSimulationEndListener());
+	p->getNode()->getSimulator()->addStateSaver(p);
 	return p;
 }
 
@@ -2,6 +2,7 @@
 #include "rfid_tag_app.hpp"
 #include "rfid_reader_app.hpp"
 #include "node.hpp"
+#include "state_checkpoint.hpp"
 
 ////////////////////////////////////////////////
 // RfidTagApp functions
@@ -18,6 +19,18 @@ void RfidTagApp::simulationEndHandler()
 
 }
 
+void RfidTagApp::saveState(StateCheckpoint& checkpoint)
+{
+	ApplicationLayer::saveState(checkpoint);
+	checkpoint.save(m_replyToReads);
+}
+
+void RfidTagApp::resetState()
+{
+	ApplicationLayer::resetState();
+	m_replyToReads = true;
+}
+
 void RfidTagApp::startHandler()
 {
 
@@ -81,6 +94,7 @@ void RfidTagApp::sendIdPacket(const NodeId& destination)
 	packetToSend->addData(Packet::DataTypes_Application, *appData);
 
 	//sendToLayer(CommunicationLayer::Directions_Lower, packetToSend);
+	recordActivity();
 	sendToQueue(packetToSend);
 }
 
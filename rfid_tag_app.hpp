@@ -77,6 +77,17 @@ public:
 	 */
 	virtual void simulationEndHandler();
 
+	/**
+	 * Save the application's state in a checkpoint.
+	 * @param checkpoint the checkpoint being taken.
+	 */
+	virtual void saveState(StateCheckpoint& checkpoint);
+
+	/**
+	 * Make the application reply to reads again.
+	 */
+	virtual void resetState();
+
 	/**
 	 * Return the stream representation of the object.
 	 */
@@ -125,8 +136,9 @@ inline RfidTagAppPtr RfidTagApp::create(NodePtr node)
 	RfidTagAppPtr p(new RfidTagApp(node));
 	p->m_weakThis = p;
 	// weakThis *must* be set before the this function is called.
-	Simulator::instance()->addSimulationEndListener(
+	p->getNode()->getSimulator()->addSimulationEndListener(
 		p->thisSimulationEndListener());
+	p->getNode()->getSimulator()->addStateSaver(p);
 	return p;
 }
 
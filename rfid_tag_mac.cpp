@@ -49,9 +49,22 @@ void RfidTagMac::beginSlotEvent()
 		unblockUpperQueues();
 	}
 
+	// The slot timer re-arms itself for the next slot.
 	m_currentSlotNumber++;
-	assert(m_slotTimer.get() != 0);
-	m_slotTimer->reschedule(getSlotTime());
+}
+
+bool RfidTagMac::isSlotNodeLocal() const
+{
+	bool isCycleEnd = (m_currentSlotNumber != m_txSlotNumber &&
+		(m_numberOfSlots == 0 ||
+		m_currentSlotNumber >= (m_numberOfSlots - 1)));
+	return (!isCycleEnd || upperQueuesAreEmpty());
+}
+
+bool RfidTagMac::isSlotIdle() const
+{
+	return (m_packetToTransmit.get() == 0 && m_numberOfSlots == 0 &&
+		upperQueuesAreUnblocked() && upperQueuesAreEmpty());
 }
 
 void RfidTagMac::handleChannelBusy(PacketPtr packet)
@@ -109,7 +122,7 @@ bool RfidTagMac::handleRequestPacket(RfidReaderMacDataPtr macData,
 		// Choose a slot uniformly at random.
 		if(m_numberOfSlots > 0) {
 			RandNumGeneratorPtr rand = 
-				Simulator::instance()->getRandNumGenerator();
+				getNode()->getRandNumGenerator();
 			m_txSlotNumber = rand->uniformInt(0, m_numberOfSlots - 4);
 			assert(m_packetToTransmit.get() == 0);
 			if(m_tagApp->getReplyToReads()) {
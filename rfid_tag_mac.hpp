@@ -255,6 +255,25 @@ protected:
 	 */
 	virtual void beginSlotEvent();
 
+	/**
+	 * Determine whether beginning the current slot only
+	 * changes the state of this tag.  A slot either starts the
+	 * send timer, ends the contention cycle, or does nothing.
+	 * Ending the cycle unblocks the upper layers, which only
+	 * stays within the tag if they have no packets to send.
+	 * @return true if beginSlotEvent() will be node-local.
+	 */
+	virtual bool isSlotNodeLocal() const;
+
+	/**
+	 * Determine whether beginning the current slot would only
+	 * move the slot number along.  Outside of a contention
+	 * cycle, a tag with nothing to send only ends the cycle
+	 * again, which unblocks the upper layers.
+	 * @return true if beginSlotEvent() will be idle.
+	 */
+	virtual bool isSlotIdle() const;
+
 	/**
 	 * Handle the request packet by generating a reply packet
 	 * and choosing a packet in which to send it.
@@ -299,14 +318,14 @@ protected:
 	bool isPacketType(PacketPtr packet, 
 		RfidTagMacData::Types type) const;
 
-private:
-
-	static const bool m_DEBUG = true;
-
 	/// An internal pointer to the object to allow it
 	/// to return \c this.
 	boost::weak_ptr<RfidTagMac> m_weakThis;
 
+private:
+
+	static const bool m_DEBUG = true;
+
 };
 typedef boost::shared_ptr<RfidTagMac> RfidTagMacPtr;
 
@@ -323,11 +342,13 @@ inline RfidTagMacPtr RfidTagMac::create(NodePtr node,
 
 	SlottedMacSlotEventPtr slotEvent = 
 		SlottedMacSlotEvent::create(p->thisSlottedMac());
-	p->m_slotTimer = Timer::create(p->getNode(), slotEvent);
+	p->m_slotTimer = PeriodicTimer::create(p->getNode(), slotEvent,
+		p->getSlotTime());
 	p->m_slotTimer->start(SimTime(0.0));
 
-	Simulator::instance()->addSimulationEndListener(
+	p->getNode()->getSimulator()->addSimulationEndListener(
 		p->thisSimulationEndListener());
+	p->getNode()->getSimulator()->addStateSaver(p);
 
 	return p;
 }
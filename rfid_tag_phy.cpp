@@ -1,10 +1,12 @@
 
 #include "rfid_tag_phy.hpp"
 #include "node.hpp"
+#include "state_checkpoint.hpp"
 
 RfidTagPhy::RfidTagPhy(
 	NodePtr node, WirelessChannelManagerPtr wirelessChannelManager)
-	: PhysicalLayer(node), m_sendingChannelIsValid(false), 
+	: PhysicalLayer(node), m_sendingChannelIsValid(false),
+	m_sendingChannel(0),
 	m_allListenersChannelIsValid(false)
 {
 	m_wirelessChannelManagerPtr = wirelessChannelManager;
@@ -96,4 +98,29 @@ void RfidTagPhy::recvdErrorFreeSignal(WirelessCommSignalPtr signal,
 	setCurrentTxPower(recvdSignalStrength);
 }
 
+void RfidTagPhy::saveState(StateCheckpoint& checkpoint)
+{
+	PhysicalLayer::saveState(checkpoint);
+	// The channel manager's senders change with the sending
+	// channel, so it is restored through the same functions.
+	checkpoint.saveAction(boost::bind(&RfidTagPhy::restoreSendingChannel,
+		this, m_sendingChannelIsValid, m_sendingChannel));
+}
+
+void RfidTagPhy::resetState()
+{
+	PhysicalLayer::resetState();
+	restoreSendingChannel(false, 0);
+}
+
+void RfidTagPhy::restoreSendingChannel(bool sendingChannelIsValid,
+	t_uint sendingChannel)
+{
+	if(sendingChannelIsValid) {
+		setSendingChannel(sendingChannel);
+	} else {
+		resetSendingChannel();
+		m_sendingChannelIsValid = false;
+	}
+}
 
@@ -116,6 +116,18 @@ public:
 	virtual void recvdErrorFreeSignal(
 		WirelessCommSignalPtr signal, double recvdSignalStrength);
 
+	/**
+	 * Save the layer's state, including the channel on which
+	 * the tag is sending, in a checkpoint.
+	 * @param checkpoint the checkpoint being taken.
+	 */
+	virtual void saveState(StateCheckpoint& checkpoint);
+
+	/**
+	 * Detach from the channel on which the tag is sending.
+	 */
+	virtual void resetState();
+
 protected:
 
 	/// A constructor
@@ -148,6 +160,16 @@ private:
 	/// @see resetAllListenersChannel()
 	t_uint m_allListenersChannel;
 
+	/**
+	 * Return to the sending channel saved in a checkpoint,
+	 * attaching to or detaching from the channel manager as
+	 * needed.
+	 * @param sendingChannelIsValid whether the tag was sending.
+	 * @param sendingChannel the channel on which it was sending.
+	 */
+	void restoreSendingChannel(bool sendingChannelIsValid,
+		t_uint sendingChannel);
+
 };
 typedef boost::shared_ptr<RfidTagPhy> RfidTagPhyPtr;
 typedef boost::shared_ptr<RfidTagPhy const> ConstRfidTagPhyPtr;
@@ -162,8 +184,9 @@ inline RfidTagPhyPtr RfidTagPhy::create(
 	RfidTagPhyPtr p(new RfidTagPhy(node, wirelessChannelManager));
 	p->m_weakThis = p;
 	// weakThis *must* be set before this* functions are called.
-	Simulator::instance()->addSimulationEndListener(
+	p->getNode()->getSimulator()->addSimulationEndListener(
 		p->thisSimulationEndListener());
+	p->getNode()->getSimulator()->addStateSaver(p);
 	return p;
 }
 
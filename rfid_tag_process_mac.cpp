@@ -0,0 +1,222 @@
+
+#include <cmath>
+using namespace std;
+
+#include "rfid_tag_process_mac.hpp"
+#include "rfid_tag_app.hpp"
+#include "rfid_reader_mac.hpp"
+#include "rand_num_generator.hpp"
+#include "simulator.hpp"
+
+RfidTagProcessMac::RfidTagProcessMac(NodePtr node, RfidTagAppPtr tagApp)
+	: RfidTagMac(node, tagApp)
+{
+	m_slotPhase = getNode()->currentTime();
+}
+
+RfidTagProcessMac::~RfidTagProcessMac()
+{
+
+}
+
+void RfidTagProcessMac::beginSlotEvent()
+{
+	assert(false);
+}
+
+SimTime RfidTagProcessMac::nextSlotStart() const
+{
+	SimTime now = getNode()->currentTime();
+	double slotTime = getSlotTime().getTimeInSeconds();
+	t_ulong numSlots = 0;
+	if(now >= m_slotPhase) {
+		numSlots = static_cast<t_ulong>(floor(
+			(now - m_slotPhase).getTimeInSeconds() / slotTime));
+	}
+	// Correct for the rounding of the division.
+	while(!(now < m_slotPhase + SimTime(numSlots * slotTime))) {
+		numSlots++;
+	}
+	return (m_slotPhase + SimTime(numSlots * slotTime));
+}
+
+bool RfidTagProcessMac::isReaderPacketType(PacketPtr packet,
+	t_uint type) const
+{
+	RfidReaderMacDataPtr macData =
+		boost::dynamic_pointer_cast<RfidReaderMacData>
+		(packet->getData(Packet::DataTypes_Link));
+	return (macData.get() != 0 && macData->getType() == type);
+}
+
+ProcessBody RfidTagProcessMac::contentionProcess()
+{
+	NodePtr node = getNode();
+
+	while(true) {
+		// Outside of a contention cycle, only a REQUEST
+		// matters.
+		PacketPtr packet = co_await node->recvPacket();
+		if(!isReaderPacketType(packet, RfidReaderMacData::Types_Request)) {
+			continue;
+		}
+
+		RfidReaderMacDataPtr requestData =
+			boost::dynamic_pointer_cast<RfidReaderMacData>
+			(packet->getData(Packet::DataTypes_Link));
+		assert(requestData->getReceiverId() ==
+			NodeId::broadcastDestination());
+		// We must have at least: (1) a contention slot,
+		// (2) a slot for the SELECT to be sent by the ready,
+		// (3) a slot for the tag to reply with an app packet,
+		// (4) a slot for the reader to reply with an ACK.
+		t_uint numberOfSlots = requestData->getNumberOfSlots();
+		assert(numberOfSlots >= 4);
+		RandNumGeneratorPtr rand = node->getRandNumGenerator();
+		t_uint txSlotNumber = rand->uniformInt(0, numberOfSlots - 4);
+		PacketPtr packetToTransmit;
+		if(m_tagApp->getReplyToReads()) {
+			packetToTransmit =
+				createReplyPacket(requestData->getSenderId());
+		}
+		PacketPtr packetSent;
+
+		t_uint slotNumber = 0;
+		SimTime slotStart = nextSlotStart();
+		bool inCycle = true;
+		while(inCycle) {
+			// Handle what is delivered until the slot begins.
+			packet = co_await node->recvPacket(
+				slotStart - node->currentTime());
+			if(packet.get() != 0) {
+				if(packet == packetSent) {
+					// The packet that we sent ended the cycle.
+					inCycle = false;
+				} else if(isReaderPacketType(packet,
+						RfidReaderMacData::Types_Select)) {
+					// Another tag was selected.
+					inCycle = false;
+				} else if(isPacketType(packet,
+						RfidTagMacData::Types_Generic)) {
+					// The application's reply to our SELECT is
+					// sent in the next slot.
+					assert(packetToTransmit.get() == 0);
+					packetToTransmit = packet;
+					txSlotNumber = slotNumber;
+				}
+				// Any other packet (e.g., a REQUEST in the
+				// middle of the cycle) is ignored.
+				continue;
+			}
+
+			if(slotNumber == txSlotNumber &&
+					packetToTransmit.get() != 0) {
+				// Set the IFS delay based on the packet type.
+				double ifsDelay = m_TAG_GENERIC_IFS;
+				if(isPacketType(packetToTransmit,
+						RfidTagMacData::Types_Reply))
+					ifsDelay = m_TAG_REPLY_IFS;
+
+				co_await node->sleep(SimTime(ifsDelay));
+				packetSent = packetToTransmit;
+				packetToTransmit.reset();
+				sendToLinkLayer(CommunicationLayer::Directions_Lower,
+					packetSent);
+			} else if(slotNumber >= (numberOfSlots - 1)) {
+				// We've reached the last slot and we didn't
+				// transmit in it, so we can stop.
+				assert(packetToTransmit.get() == 0);
+				inCycle = false;
+				unblockUpperQueues();
+			}
+
+			slotNumber++;
+			slotStart += getSlotTime();
+		}
+	}
+}
+
+bool RfidTagProcessMac::handleRecvdMacPacket(PacketPtr packet,
+	t_uint sendingLayerIdx)
+{
+	RfidReaderMacDataPtr macData =
+		boost::dynamic_pointer_cast<RfidReaderMacData>
+		(packet->getData(Packet::DataTypes_Link));
+
+	bool wasSuccessful = true;
+
+	// For now, we'll only handle reader packets.
+	if(macData.get() != 0) {
+		switch(macData->getType()) {
+		case RfidReaderMacData::Types_Request:
+			m_process->deliverPacket(packet);
+			break;
+		case RfidReaderMacData::Types_Select:
+			if(macData->getReceiverId() == getNode()->getNodeId()) {
+				// If we were selected for a slot, send the packet
+				// to the upper layer.
+				wasSuccessful = sendToLinkLayer(
+					CommunicationLayer::Directions_Upper, packet);
+			} else {
+				// Otherwise, stop the contention cycle
+				unblockUpperQueues();
+				m_process->deliverPacket(packet);
+			}
+			break;
+		case RfidReaderMacData::Types_Generic:
+			if(packetIsForMe(macData)) {
+				// Just pass the packet to upper layers.
+				wasSuccessful = sendToLinkLayer(
+					CommunicationLayer::Directions_Upper, packet);
+			}
+			break;
+		case RfidReaderMacData::Types_Ack:
+			// If the ACK is received, then we stop replying
+			// until a reset packet is received.
+			if(packetIsForMe(macData))
+				m_tagApp->setReplyToReads(false);
+			break;
+		default:
+			wasSuccessful = false;
+			assert(false);
+		} // end switch
+	} // end packet is not null
+
+	return wasSuccessful;
+}
+
+bool RfidTagProcessMac::handleRecvdUpperLayerPacket(PacketPtr packet,
+	t_uint sendingLayerIdx)
+{
+	RfidTagAppDataPtr appData =
+		boost::dynamic_pointer_cast<RfidTagAppData>
+		(packet->getData(Packet::DataTypes_Application));
+
+	bool wasSuccessful = false;
+
+	// For now, we only handle application packets.
+	if(appData.get() != 0) {
+		// We'll only handle one packet at a time.
+		blockUpperQueues();
+		addGenericHeader(packet, packet->getDestination());
+		// The process sends it in the next slot.
+		m_process->deliverPacket(packet);
+	}
+	return wasSuccessful;
+}
+
+void RfidTagProcessMac::handleChannelBusy(PacketPtr packet)
+{
+	unblockUpperQueues();
+	if(isPacketType(packet, RfidTagMacData::Types_Reply))
+		m_process->deliverPacket(packet);
+}
+
+void RfidTagProcessMac::handlePacketSent(PacketPtr packet)
+{
+	if(isPacketType(packet, RfidTagMacData::Types_Generic)) {
+		unblockUpperQueues();
+		m_process->deliverPacket(packet);
+	}
+}
+
@@ -0,0 +1,154 @@
+
+#ifndef RFID_TAG_PROCESS_MAC_H
+#define RFID_TAG_PROCESS_MAC_H
+
+#include <boost/shared_ptr.hpp>
+
+#include "rfid_tag_mac.hpp"
+#include "process.hpp"
+
+class RfidReaderMacData;
+typedef boost::shared_ptr<RfidReaderMacData> RfidReaderMacDataPtr;
+
+/////////////////////////////////////////////////
+// RfidTagProcessMac Class
+/////////////////////////////////////////////////
+
+/**
+ * The slotted ALOHA protocol of RfidTagMac written as a
+ * Process.  The contention cycle is a single coroutine that
+ * waits for a REQUEST, counts the slots of the cycle, and
+ * sends in its slot, rather than a slot timer that fires in
+ * every slot and state that records where the cycle is.
+ * A tag that is not in a contention cycle has no pending
+ * events.  The packets that change the cycle (the REQUEST,
+ * the SELECT of another tag, the application's reply to
+ * being selected, and the tag's own packets once they end
+ * the cycle) are delivered to the process, while those that
+ * do not are handled as in RfidTagMac.
+ * The process is not saved in checkpoints, so the MAC does
+ * not support rolling back (e.g., warm-up forks or
+ * optimistic windows).
+ */
+class RfidTagProcessMac : public RfidTagMac {
+public:
+	/// Smart pointer that clients should use.
+	typedef boost::shared_ptr<RfidTagProcessMac> RfidTagProcessMacPtr;
+
+	/// A destructor.
+	virtual ~RfidTagProcessMac();
+
+	/**
+	 * A factory method to ensure that all objects
+	 * are created via \c new since we are using smart pointers.
+	 * @param node the node that owns this object.
+	 * @param tagApp a pointer to the application using this MAC.
+	 */
+	static inline RfidTagProcessMacPtr create(NodePtr node,
+		RfidTagAppPtr tagApp);
+
+	/**
+	 * Handle a MAC packet the is received.
+	 * @param packet a pointer to the received packet.
+	 * @param sendingLayerIdx the index of the layer that sent the
+	 * packet.
+	 * @return true if the packet was able to be handled.
+	 */
+	bool handleRecvdMacPacket(PacketPtr packet,
+		t_uint sendingLayerIdx);
+
+	/**
+	 * Handle a packet received from an upper layer.
+	 * @param packet a pointer to the received packet.
+	 * @param sendingLayerIdx the index of the layer that sent the
+	 * packet.
+	 * @return true if the packet was able to be handled.
+	 */
+	bool handleRecvdUpperLayerPacket(PacketPtr packet,
+		t_uint sendingLayerIdx);
+
+	/**
+	 * This is called when the MAC is scheduled to transmit
+	 * a packet on the channel but the channel is busy.
+	 * @param packet the packet whose transmission was
+	 * being attempted.
+	 * @see handlePacketSent()
+	 */
+	virtual void handleChannelBusy(PacketPtr packet);
+
+	/**
+	 * This is called when the MAC is scheduled to transmit
+	 * a packet on the channel and it is sent on the channel.
+	 * @param packet the packet whose transmission was being
+	 * attmpted.
+	 * @see handleChannelBusy()
+	 */
+	virtual void handlePacketSent(PacketPtr packet);
+
+protected:
+
+	/// A constructor.
+	RfidTagProcessMac(NodePtr node, RfidTagAppPtr tagApp);
+
+	/**
+	 * The MAC has no slot timer, so this is never called.
+	 */
+	virtual void beginSlotEvent();
+
+	/**
+	 * The coroutine of the contention cycles.
+	 * @return the body of the MAC's process.
+	 */
+	ProcessBody contentionProcess();
+
+	/**
+	 * Get the time at which the next slot starts.  The slots
+	 * are aligned to when the MAC was created, as the slot
+	 * timer of RfidTagMac is.
+	 * @return the start of the first slot after the current
+	 * time.
+	 */
+	SimTime nextSlotStart() const;
+
+	/**
+	 * Determine whether the packet is a reader packet of the
+	 * given type by looking at it's header.
+	 * @param packet a pointer to the packet under consideration.
+	 * @param type the type for which we are checking.
+	 * @return true if it is a reader packet of the type.
+	 */
+	bool isReaderPacketType(PacketPtr packet, t_uint type) const;
+
+private:
+
+	/// The time at which the slots are aligned.
+	SimTime m_slotPhase;
+
+	/// The process that runs the contention cycles.
+	ProcessPtr m_process;
+
+};
+typedef boost::shared_ptr<RfidTagProcessMac> RfidTagProcessMacPtr;
+
+/////////////////////////////////////////////////
+// Inline Functions
+/////////////////////////////////////////////////
+
+inline RfidTagProcessMacPtr RfidTagProcessMac::create(NodePtr node,
+	RfidTagAppPtr tagApp)
+{
+	RfidTagProcessMacPtr p(new RfidTagProcessMac(node, tagApp));
+	// weakThis *must* be set before the this* functions are called.
+	p->m_weakThis = p;
+
+	p->m_process = Process::create(p->getNode(), p->contentionProcess());
+	p->m_process->start(SimTime(0.0));
+
+	p->getNode()->getSimulator()->addSimulationEndListener(
+		p->thisSimulationEndListener());
+
+	return p;
+}
+
+#endif // RFID_TAG_PROCESS_MAC_H
+
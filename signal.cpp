@@ -2,13 +2,15 @@
 #include "signal.hpp"
 
 Signal::Signal(const Location& location, double dbStrength)
-	: m_location(location), m_dbStrength(dbStrength)
+	: m_location(location), m_locationVersion(0), m_dbStrength(dbStrength),
+	m_power(decibelsToPower(dbStrength))
 {
 
 }
 
 Signal::Signal(const Signal& rhs)
-	: m_location(rhs.m_location), m_dbStrength(rhs.m_dbStrength)
+	: m_location(rhs.m_location), m_locationVersion(rhs.m_locationVersion),
+	m_dbStrength(rhs.m_dbStrength), m_power(rhs.m_power)
 {
 
 }
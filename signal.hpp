@@ -43,12 +43,36 @@ public:
 	 */
 	inline Location getLocation() const;
 
+	/**
+	 * Set the version of the source's location when the
+	 * signal was sent.
+	 * @param locationVersion the version of the location.
+	 * @see Node::getLocationVersion()
+	 */
+	inline void setLocationVersion(t_ulong locationVersion);
+
+	/**
+	 * Get the version of the source's location when the
+	 * signal was sent.
+	 * @return the version of the location, or zero if it
+	 * is not known.
+	 * @see Node::getLocationVersion()
+	 */
+	inline t_ulong getLocationVersion() const;
+
 	/**
 	 * Get the strength in decibels of this signal.
 	 * @return the strength in decibels.
 	 */
 	inline double getDbStrength() const;
 
+	/**
+	 * Get the strength in Watts of this signal, which is
+	 * converted once when the signal is created.
+	 * @return the strength in Watts.
+	 */
+	inline double getPower() const;
+
 protected:
 
 	/// A constructor
@@ -71,10 +95,16 @@ private:
 	/// @see getLocation()
 	Location m_location;
 
+	/// @see getLocationVersion()
+	t_ulong m_locationVersion;
+
 	/// The signal strength in decibels of the signal.
 	/// @see getDbStrength()
 	double m_dbStrength;
 
+	/// @see getPower()
+	double m_power;
+
 	/// Declare private to restrict use.
 	Signal& operator= (const Signal& rhs);
 
@@ -102,11 +132,26 @@ inline Location Signal::getLocation() const
 	return m_location;
 }
 
+inline void Signal::setLocationVersion(t_ulong locationVersion)
+{
+	m_locationVersion = locationVersion;
+}
+
+inline t_ulong Signal::getLocationVersion() const
+{
+	return m_locationVersion;
+}
+
 inline double Signal::getDbStrength() const
 {
 	return m_dbStrength;
 }
 
+inline double Signal::getPower() const
+{
+	return m_power;
+}
+
 /////////////////////////////////////////////////
 // Overloaded Operators
 /////////////////////////////////////////////////
@@ -3,16 +3,40 @@
 #define SIM_TIME_H
 
 #include <iostream>
+#include <math.h>
+#include <string.h>
+#include <stdint.h>
 using namespace std;
 
 #include <boost/shared_ptr.hpp>
 
 /**
  * Defines the class for managing time in the simulator.
+ *
+ * By default, time is stored as a \c double number of seconds.
+ * If the simulator is compiled with \c SIM_TIME_INTEGER defined
+ * (e.g., <tt>make clean; make CXXDEFINES=-DSIM_TIME_INTEGER</tt>),
+ * time is instead stored as a 64-bit integer number of
+ * picoseconds.  The interface is the same in both cases, but in
+ * integer mode, values are rounded to the nearest picosecond when
+ * they are set, so sums of slot times, IFS values, and
+ * propagation delays are exact and comparisons are integer
+ * comparisons.  Times up to about 106 days can be represented.
  */
 class SimTime {
 public:
 
+#ifdef SIM_TIME_INTEGER
+	/// The internal representation of time.
+	typedef int64_t TimeType;
+#else
+	/// The internal representation of time.
+	typedef double TimeType;
+#endif
+
+	/// The number of integer ticks per second.
+	static const int64_t m_TICKS_PER_SECOND = 1000000000000LL;
+
 	/**
 	 * A constructor.
 	 * Time is set to zero by default.
@@ -95,6 +119,24 @@ public:
 	 */
 	inline bool isValid() const;
 
+	/**
+	 * Get a key that orders times the same way that the
+	 * comparison operators do.
+	 * In integer mode, this is the number of picoseconds.
+	 * Otherwise, it is the bit pattern of the (non-negative)
+	 * \c double, which sorts in the same order as the value.
+	 * @return the ordering key.
+	 */
+	inline uint64_t getOrderingKey() const;
+
+	/**
+	 * Get the time that has a given ordering key.
+	 * @param key the ordering key.
+	 * @return the time.
+	 * @see getOrderingKey()
+	 */
+	static inline SimTime fromOrderingKey(uint64_t key);
+
 	//@{
 	/// An operator for the class.
 	inline SimTime& operator+= (const SimTime& rhs);
@@ -106,7 +148,24 @@ public:
 	//@}
 
 private:
-	double m_time;
+
+	/**
+	 * Convert a number of seconds to the internal representation.
+	 * @param timeInSeconds the time in seconds.
+	 * @return the internal representation of the time.
+	 */
+	static inline TimeType fromSeconds(double timeInSeconds);
+
+	/**
+	 * Convert the internal representation to seconds.
+	 * @param time the internal representation of the time.
+	 * @return the time in seconds.
+	 */
+	static inline double toSeconds(TimeType time);
+
+	/// The time, in either seconds or picoseconds depending
+	/// on whether \c SIM_TIME_INTEGER is defined.
+	TimeType m_time;
 };
 typedef boost::shared_ptr<SimTime> SimTimePtr;
 
@@ -114,48 +173,66 @@ typedef boost::shared_ptr<SimTime> SimTimePtr;
 // Inline Functions
 /////////////////////////////////////////////////
 
+inline SimTime::TimeType SimTime::fromSeconds(double timeInSeconds)
+{
+#ifdef SIM_TIME_INTEGER
+	return llround(timeInSeconds * m_TICKS_PER_SECOND);
+#else
+	return timeInSeconds;
+#endif
+}
+
+inline double SimTime::toSeconds(TimeType time)
+{
+#ifdef SIM_TIME_INTEGER
+	return (static_cast<double>(time) / m_TICKS_PER_SECOND);
+#else
+	return time;
+#endif
+}
+
 inline void SimTime::setTimeInMicroSeconds(double timeInMicroSeconds)
 {
 	assert(timeInMicroSeconds >= 0.0);
-	m_time = (timeInMicroSeconds / 1000000.0);
+	m_time = fromSeconds(timeInMicroSeconds / 1000000.0);
 }
 
 inline void SimTime::setTimeInMilliSeconds(double timeInMilliSeconds)
 {
 	assert(timeInMilliSeconds >= 0.0);
-	m_time = (timeInMilliSeconds / 1000.0);
+	m_time = fromSeconds(timeInMilliSeconds / 1000.0);
 }
 
 inline void SimTime::setTimeInSeconds(double timeInSeconds)
 {
 	assert(timeInSeconds >= 0.0);
-	m_time = timeInSeconds;
+	m_time = fromSeconds(timeInSeconds);
 }
 
 inline void SimTime::setTimeInMinutes(double timeInMinutes)
 {
 	assert(timeInMinutes >= 0.0);
-	m_time = (60.0 * timeInMinutes);
+	m_time = fromSeconds(60.0 * timeInMinutes);
 }
 
 inline double SimTime::getTimeInMicroSeconds() const
 {
-	return (1000000.0 * m_time);
+	return (1000000.0 * toSeconds(m_time));
 }
 
 inline double SimTime::getTimeInMilliSeconds() const
 {
-	return (1000.0 * m_time);
+	return (1000.0 * toSeconds(m_time));
 }
 
 inline double SimTime::getTimeInSeconds() const
 {
-	return m_time;
+	return toSeconds(m_time);
 }
 
 inline double SimTime::getTimeInMinutes() const
 {
-	return (m_time / 60.0);
+	return (toSeconds(m_time) / 60.0);
 }
 
 inline void SimTime::setTime(double timeInSeconds) 
@@ -172,7 +249,33 @@ inline bool SimTime::isValid() const
 {
 	// Right now, our only requirement is that
 	// the time is not negative.
-	return (m_time >= 0.0);
+	return (m_time >= 0);
+}
+
+inline uint64_t SimTime::getOrderingKey() const
+{
+	assert(isValid());
+#ifdef SIM_TIME_INTEGER
+	return static_cast<uint64_t>(m_time);
+#else
+	// Adding zero turns -0.0 into 0.0 so that they
+	// have the same key.
+	double time = m_time + 0.0;
+	uint64_t key;
+	memcpy(&key, &time, sizeof(key));
+	return key;
+#endif
+}
+
+inline SimTime SimTime::fromOrderingKey(uint64_t key)
+{
+	SimTime time;
+#ifdef SIM_TIME_INTEGER
+	time.m_time = static_cast<TimeType>(key);
+#else
+	memcpy(&time.m_time, &key, sizeof(key));
+#endif
+	return time;
 }
 
 /////////////////////////////////////////////////
@@ -1,36 +1,260 @@
 
+#include <boost/bind/bind.hpp>
+
 #include "simulator.hpp"
 #include "rand_num_generator.hpp"
+#include "log_stream_manager.hpp"
+#include "parallel_simulator.hpp"
+#include "bundle_dispatcher.hpp"
 
-SimulatorPtr Simulator::m_instance;
+thread_local SimulatorPtr Simulator::m_instance;
 const double Simulator::m_SIM_START_TIME = 0.0;
+const t_ulong Simulator::m_FIRST_PACKET_UNIQUE_ID = 1;
+const EventQueue::QueueTypes Simulator::m_DEFAULT_EVENT_QUEUE_TYPE =
+	EventQueue::QueueTypes_Multiset;
+const bool Simulator::m_DEFAULT_DO_TIMER_WHEEL = true;
+const bool Simulator::m_DEFAULT_DO_EVENT_HORIZON = true;
+const string Simulator::m_STOP_CONDITION_TIME_STRING = "stopConditionTime";
+const string Simulator::m_WASTED_TIME_STRING = "wastedTime";
 
 Simulator::Simulator() 
+	: m_doTimerWheel(m_DEFAULT_DO_TIMER_WHEEL),
+	m_doEventHorizon(m_DEFAULT_DO_EVENT_HORIZON),
+	m_isDispatchingInParallel(false), m_nextSequenceNumber(0),
+	m_nextPacketUniqueId(m_FIRST_PACKET_UNIQUE_ID),
+	m_doNodeRandomStreams(false), m_parallelSimulator(0),
+	m_partitionIndex(0), m_hasInitialState(false),
+	m_initialSequenceNumber(0),
+	m_initialPacketUniqueId(m_FIRST_PACKET_UNIQUE_ID),
+	m_initialNumRecordedStats(0), m_numStateResets(0),
+	m_doStopEarly(true), m_doSkipIdleTicks(false),
+	m_isStopConditionMet(false)
 {
 	m_clock.setTime(m_SIM_START_TIME);
+	fill(m_priorityClassRanks,
+		&m_priorityClassRanks[Event::m_NUM_PRIORITY_CLASSES], 0);
 	m_randNumGeneratorPtr = RandNumGenerator::create();
+	m_eventQueue = EventQueue::create(m_DEFAULT_EVENT_QUEUE_TYPE);
+	if(m_doTimerWheel) {
+		m_eventQueue = TimerWheelEventQueue::create(m_eventQueue);
+	}
+	if(m_doEventHorizon) {
+		m_eventQueue = HorizonEventQueue::create(m_eventQueue);
+	}
+	m_logStreamManagerPtr = new LogStreamManager(this);
 }
 
 Simulator::~Simulator()
 {
+	// Release the model while this simulator is still intact
+	// since the pending events and listeners own the nodes
+	// that point back to it.
+	m_bundleDispatcher.reset();
+	m_eventQueue->clear();
+	m_simulationEndListeners.clear();
+	delete m_logStreamManagerPtr;
+	if(m_instance == this) {
+		m_instance = 0;
+	}
+}
 
+SimulatorOwnerPtr Simulator::create()
+{
+	SimulatorOwnerPtr p(new Simulator());
+	return p;
 }
 
 void Simulator::runSimulation(const SimTime& stopTime)
 {
-	while(!m_eventPtrQueue.empty()) {
-		EventPtr nextEvent = getNextEvent();
-		if(nextEvent->getFireTime() > stopTime) {
+	setInstance(this);
+#ifdef RFIDSIM_PROFILING
+	if(m_eventProfiler.get() != 0) {
+		m_eventProfiler->start();
+	}
+#endif
+	saveInitialState();
+	m_stopTime = stopTime;
+	m_eventQueue->setHorizon(stopTime);
+	m_isStopConditionMet = false;
+	bool doCheckStopConditions = !m_stopConditions.empty();
+	SimTime endTime = stopTime;
+	while(!m_eventQueue->empty()) {
+		if(m_doSkipIdleTicks && !doCheckStopConditions) {
+			skipIdleTicks(stopTime);
+		}
+		// The first event after the stop time stays pending
+		// in case the run is continued.
+		if(m_eventQueue->top()->getFireTime() > stopTime) {
+			break;
+		}
+		dispatchEvents(getNextEvent());
+		if(doCheckStopConditions && checkStopConditions()) {
+			doCheckStopConditions = false;
+			if(m_doStopEarly) {
+				endTime = m_clock;
+				break;
+			}
+		}
+	}
+	endSimulation(endTime);
+}
+
+void Simulator::logStopConditionStats() const
+{
+	ostringstream stopConditionTimeStream;
+	if(m_isStopConditionMet) {
+		stopConditionTimeStream << m_stopConditionTime;
+	} else {
+		stopConditionTimeStream << "none";
+	}
+	m_logStreamManagerPtr->logStatsItem(m_STOP_CONDITION_TIME_STRING,
+		stopConditionTimeStream.str());
+
+	ostringstream wastedTimeStream;
+	wastedTimeStream << getWastedTime();
+	m_logStreamManagerPtr->logStatsItem(m_WASTED_TIME_STRING,
+		wastedTimeStream.str());
+}
+
+void Simulator::skipIdleTicks(const SimTime& stopTime)
+{
+	while(!m_eventQueue->empty() && m_eventQueue->top()->isIdleTick()) {
+		m_idleTicks.push_back(getNextEvent());
+	}
+	if(m_idleTicks.empty()) {
+		return;
+	}
+
+	// Nothing happens until the first other event, but the
+	// ticks at the stop time are still executed.
+	SimTime resumeTime = stopTime;
+	if(!m_eventQueue->empty() &&
+			m_eventQueue->top()->getFireTime() < resumeTime) {
+		resumeTime = m_eventQueue->top()->getFireTime();
+	}
+
+	// The ticks are rescheduled in the order in which they
+	// were pending.  A tick that is not skipped keeps its
+	// sequence number.
+	for(t_ulong i = 0; i < m_idleTicks.size(); ++i) {
+		EventPtr tick = m_idleTicks[i];
+		if(tick->getFireTime() < resumeTime) {
+			tick->skipIdleTicks(resumeTime);
+			assert(tick->inEventQueue());
+		} else {
+			m_eventQueue->insert(tick);
+			tick->setInEventQueue(true);
+		}
+	}
+	m_idleTicks.clear();
+}
+
+void Simulator::runEvents(const SimTime& endTime, bool isEndInclusive)
+{
+	setInstance(this);
+	saveInitialState();
+	SimTime nextTime;
+	while(peekNextEventTime(nextTime)) {
+		bool isPastEnd = isEndInclusive ? (nextTime > endTime) :
+			(nextTime >= endTime);
+		if(isPastEnd) {
+			break;
+		}
+		dispatchEvents(getNextEvent());
+	}
+}
+
+void Simulator::dispatchBundle(EventPtr event)
+{
+	SimTime fireTime = event->getFireTime();
+	assert(m_clock <= fireTime);
+	m_clock = fireTime;
+
+	const type_info& eventType = typeid(*event);
+	m_eventBundle.add(event);
+	while(!m_eventQueue->empty()) {
+		EventPtr nextEvent = m_eventQueue->top();
+		if(nextEvent->getFireTime() > fireTime ||
+				typeid(*nextEvent) != eventType) {
 			break;
 		}
-		dispatchEvent(nextEvent);
+		m_eventQueue->pop();
+		m_eventBundle.add(nextEvent);
+	}
+
+#ifdef RFIDSIM_PROFILING
+	t_ulong queueDepth = m_eventQueue->size() + m_eventBundle.size();
+	t_ulong startTicks = EventProfiler::readTicks();
+#endif
+	if(m_bundleDispatcher.get() != 0) {
+		m_bundleDispatcher->dispatch(m_eventBundle);
+	} else {
+		event->executeBundle(m_eventBundle);
+	}
+#ifdef RFIDSIM_PROFILING
+	if(m_eventProfiler.get() != 0) {
+		m_eventProfiler->recordDispatch(eventType,
+			EventProfiler::readTicks() - startTicks, queueDepth,
+			m_eventBundle.size());
+	}
+#endif
+	m_eventBundle.clear();
+}
+
+void Simulator::bufferParallelEvent(EventPtr event, bool isTimer)
+{
+	BundleDispatcher::bufferEvent(event, isTimer);
+}
+
+bool Simulator::cancelParallelEvent(EventPtr event)
+{
+	assert(m_bundleDispatcher.get() != 0);
+	return m_bundleDispatcher->cancelEvent(event);
+}
+
+void Simulator::setNumBundleThreads(t_uint numThreads)
+{
+	assert(!m_isDispatchingInParallel);
+	m_bundleDispatcher.reset();
+	if(numThreads > 1) {
+		m_bundleDispatcher = BundleDispatcher::create(this, numThreads);
+	}
+}
+
+t_uint Simulator::getNumBundleThreads() const
+{
+	t_uint numThreads = 1;
+	if(m_bundleDispatcher.get() != 0) {
+		numThreads = m_bundleDispatcher->getNumThreads();
 	}
+	return numThreads;
+}
+
+void Simulator::endSimulation(const SimTime& stopTime)
+{
 	m_clock = stopTime;
+	if(!m_stopConditions.empty()) {
+		logStopConditionStats();
+	}
 	// Notifiy all listeners that the simulation has ended
 	for(t_uint i = 0; i < m_simulationEndListeners.size(); i++)
 		m_simulationEndListeners[i]->simulationEndHandler();
 }
 
+void Simulator::scheduleAction(SimulatorPtr destination,
+	const SimTime& fireTime, const Action& action)
+{
+	assert(destination != 0);
+	if(destination == this) {
+		scheduleEventAt(ActionEvent::create(action), fireTime);
+	} else {
+		assert(m_parallelSimulator != 0);
+		assert(destination->m_parallelSimulator == m_parallelSimulator);
+		m_parallelSimulator->postAction(m_partitionIndex,
+			destination->m_partitionIndex, fireTime, action);
+	}
+}
+
 void Simulator::seedRandNumGenerator(const t_uint seed) const
 {
 	assert(m_randNumGeneratorPtr != 0);
@@ -42,7 +266,136 @@ void Simulator::reset()
 	// Because we're using smart pointers,
 	// we don't have to worry about deleting
 	// all the objects pointed to.
-	m_eventPtrQueue.clear();
+	m_eventQueue->clear();
 	m_clock.setTime(m_SIM_START_TIME);
+	m_hasInitialState = false;
+	m_initialEntries.clear();
+}
+
+void Simulator::saveState()
+{
+	assert(m_stateCheckpoint.get() == 0);
+	m_stateCheckpoint = StateCheckpoint::create();
+
+	// Restoring runs in the reverse order, so the events are
+	// restored last in case an object's restore action
+	// touches the event queue.
+	vector<EventQueueEntry> entries;
+	m_eventQueue->getEntries(entries);
+	m_stateCheckpoint->saveAction(boost::bind(&Simulator::restoreEvents,
+		this, entries));
+	m_stateCheckpoint->save(m_clock);
+	m_stateCheckpoint->save(m_nextSequenceNumber);
+	m_stateCheckpoint->save(m_nextPacketUniqueId);
+	m_randNumGeneratorPtr->saveState(*m_stateCheckpoint);
+	m_stateCheckpoint->saveAction(boost::bind(
+		&LogStreamManager::truncateRecordedStats, m_logStreamManagerPtr,
+		m_logStreamManagerPtr->getRecordedStats().size()));
+
+	for(t_uint i = 0; i < m_stateSavers.size(); ++i) {
+		m_stateSavers[i]->saveState(*m_stateCheckpoint);
+	}
+}
+
+void Simulator::restoreState()
+{
+	assert(m_stateCheckpoint.get() != 0);
+	m_stateCheckpoint->restore();
+}
+
+void Simulator::commitState()
+{
+	m_stateCheckpoint.reset();
+}
+
+void Simulator::resetState()
+{
+	assert(m_hasInitialState);
+	assert(m_stateCheckpoint.get() == 0);
+	assert(m_parallelSimulator == 0);
+
+	// The events are put back first since the objects derive
+	// the state of their timers from them.
+	restoreEvents(m_initialEntries);
+	m_clock = m_initialClock;
+	m_nextSequenceNumber = m_initialSequenceNumber;
+	m_nextPacketUniqueId = m_initialPacketUniqueId;
+	m_logStreamManagerPtr->truncateRecordedStats(m_initialNumRecordedStats);
+	m_numStateResets++;
+
+	for(t_uint i = 0; i < m_stateSavers.size(); ++i) {
+		m_stateSavers[i]->resetState();
+	}
+}
+
+void Simulator::saveInitialState()
+{
+	if(m_hasInitialState) {
+		return;
+	}
+	m_hasInitialState = true;
+	m_eventQueue->getEntries(m_initialEntries);
+	m_initialClock = m_clock;
+	m_initialSequenceNumber = m_nextSequenceNumber;
+	m_initialPacketUniqueId = m_nextPacketUniqueId;
+	m_initialNumRecordedStats =
+		m_logStreamManagerPtr->getRecordedStats().size();
+}
+
+void Simulator::restoreEvents(const vector<EventQueueEntry>& entries)
+{
+	vector<EventQueueEntry> pendingEntries;
+	m_eventQueue->getEntries(pendingEntries);
+	for(t_uint i = 0; i < pendingEntries.size(); ++i) {
+		pendingEntries[i].m_event->setInEventQueue(false);
+	}
+	m_eventQueue->clear();
+
+	for(t_uint i = 0; i < entries.size(); ++i) {
+		EventPtr event = entries[i].m_event;
+		event->setFireTime(entries[i].getFireTime());
+		event->setOrderKey(entries[i].m_orderKey);
+		m_eventQueue->insert(event);
+		event->setInEventQueue(true);
+	}
+}
+
+void Simulator::setEventQueueType(EventQueue::QueueTypes queueType)
+{
+	assert(m_eventQueue->empty());
+	m_eventQueue = EventQueue::create(queueType);
+	if(m_doTimerWheel) {
+		m_eventQueue = TimerWheelEventQueue::create(m_eventQueue);
+	}
+	if(m_doEventHorizon) {
+		m_eventQueue = HorizonEventQueue::create(m_eventQueue);
+	}
+}
+
+void Simulator::setDoTimerWheel(bool doTimerWheel)
+{
+	m_doTimerWheel = doTimerWheel;
+	setEventQueueType(getEventQueueType());
+}
+
+void Simulator::setDoEventHorizon(bool doEventHorizon)
+{
+	m_doEventHorizon = doEventHorizon;
+	setEventQueueType(getEventQueueType());
+}
+
+void Simulator::setPriorityClassRank(Event::PriorityClasses priorityClass,
+	t_uint rank)
+{
+	assert(priorityClass < Event::m_NUM_PRIORITY_CLASSES);
+	assert(rank < Event::m_NUM_PRIORITY_RANKS);
+	m_priorityClassRanks[priorityClass] = rank;
+}
+
+void Simulator::usePriorityClasses()
+{
+	for(t_uint i = 0; i < Event::m_NUM_PRIORITY_CLASSES; ++i) {
+		setPriorityClassRank(static_cast<Event::PriorityClasses>(i), i);
+	}
 }
 
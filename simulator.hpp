@@ -185,56 +185,37 @@
 
 #include <vector>
 #include <set>
+#include <typeinfo>
 using namespace std;
 #include <boost/utility.hpp>
 #include <boost/smart_ptr.hpp>
 #include <boost/enable_shared_from_this.hpp>
+#include <boost/function.hpp>
 
 #include "utility.hpp"
 #include "sim_time.hpp"
 #include "event.hpp"
+#include "event_queue.hpp"
 #include "node.hpp"
 #include "simulation_end_listener.hpp"
+#include "state_saver.hpp"
+#include "state_checkpoint.hpp"
+#include "stop_condition.hpp"
+#include "event_profiler.hpp"
 
 class RandNumGenerator;
 typedef boost::shared_ptr<RandNumGenerator> RandNumGeneratorPtr;
 class LogStreamManager;
 typedef LogStreamManager* LogStreamManagerPtr;
-
-/////////////////////////////////////////////////
-// EventPtrComparator Class
-/////////////////////////////////////////////////
-
-/**
- * Helper class to define how Event objects are compared for use
- * with the Simulator's Event queue.
- * This is necessary since the queue contains pointers that
- * must be dereferenced before they can be compared.
- */
-class EventPtrComparator {
-public:
-	/**
-	 * Operator to prioritize event pointers since they
-	 * must be dereference before applying the less than
-	 * operator.
-	 */
-	inline bool operator() (ConstEventPtr event1, 
-		ConstEventPtr event2) const;
-};
-
-inline bool EventPtrComparator::operator() (ConstEventPtr event1, 
-	ConstEventPtr event2) const
-{
-	return *event1 < *event2;
-}
+class ParallelSimulator;
+typedef ParallelSimulator* ParallelSimulatorRawPtr;
+class BundleDispatcher;
+typedef boost::shared_ptr<BundleDispatcher> BundleDispatcherPtr;
 
 /////////////////////////////////////////////////
 // Simulator Class
 /////////////////////////////////////////////////
 
-typedef multiset<EventPtr,EventPtrComparator> EventPtrQueue;
-typedef EventPtrQueue::iterator EventPtrQueueIterator;
-
 /**
  * The main Simulator which class contains the event queues, nodes,
  * and channels.
@@ -247,12 +228,58 @@ public:
 	/// Pointer that clients should use.
 	typedef Simulator* SimulatorPtr;
 
+	/// Smart pointer that owns a simulator.
+	/// @see create()
+	typedef boost::shared_ptr<Simulator> SimulatorOwnerPtr;
+
+	/// An action that is executed as an event.
+	/// @see scheduleAction()
+	typedef boost::function<void ()> Action;
+
+	// The parallel simulator runs its partitions one window
+	// at a time.
+	friend class ParallelSimulator;
+	// The bundle dispatcher schedules the events that its
+	// threads buffer.
+	friend class BundleDispatcher;
+
+	/**
+	 * A factory method to create a new, independent simulator.
+	 * Each simulator owns its own clock, event queue, random
+	 * number generator, log streams, and ID counters, so
+	 * simulators on different threads share no mutable state.
+	 * @return a pointer that owns the new simulator.
+	 * @see setInstance()
+	 */
+	static SimulatorOwnerPtr create();
+
 	/**
-	 * The class uses the Singleton design pattern.
-	 * @return Pointer to single instance of Simulator
+	 * Get the calling thread's current simulator.
+	 * If no simulator has been made current on this thread,
+	 * a default one is created (and lives for the remainder
+	 * of the process), so single-simulation programs can
+	 * keep treating this as a Singleton.
+	 * @return pointer to the current simulator of this thread.
+	 * @see setInstance()
 	 */
 	static inline SimulatorPtr instance();
 
+	/**
+	 * Make a simulator the calling thread's current simulator.
+	 * Objects that are not tied to a node, such as packets and
+	 * the log stream manager, find their simulator through
+	 * instance(), so a scenario should be built after its
+	 * simulator is made current.  runSimulation() also makes
+	 * its simulator current.
+	 * @param simulator the simulator that will be current.
+	 * @see instance()
+	 */
+	static inline void setInstance(SimulatorPtr simulator);
+
+	/// A destructor.
+	/// Pending events and simulation end listeners are released.
+	~Simulator();
+
 	/**
 	 * Associate a node with this simulator object.
 	 * @param nodeToAdd the node that will be associated.
@@ -266,12 +293,103 @@ public:
 	 * After the simulation object is set up, this is called
 	 * to start executing the events.  The event queue is
 	 * in ascending order by the execution time of events.
+	 * This simulator becomes the calling thread's current
+	 * simulator.
+	 * The simulation ends early if one of its stop conditions
+	 * is met.
 	 * @param stopTime the time at which the simulation should
 	 * stop.
 	 * @see scheduleEvent()
+	 * @see addStopCondition()
 	 */
 	void runSimulation(const SimTime& stopTime);
 
+	/**
+	 * Add a condition that lets runSimulation() end before its
+	 * stop time.  The conditions are checked after each event
+	 * and the simulation ends as soon as any one of them is
+	 * met.  When the simulation ends, the time at which it was
+	 * met and the simulated time left before the stop time
+	 * are logged as global stats.
+	 * @param condition a pointer to the condition.
+	 * @see setDoStopEarly()
+	 * @see getWastedTime()
+	 */
+	inline void addStopCondition(StopConditionPtr condition);
+
+	/**
+	 * Set whether runSimulation() ends when a stop condition
+	 * is met.  Otherwise, it still runs to its stop time
+	 * and only records when the condition was met, which
+	 * shows how much of the run a condition would save
+	 * without changing its results.  This is true by default.
+	 * @param doStopEarly true if the simulation should end
+	 * when a stop condition is met.
+	 */
+	inline void setDoStopEarly(bool doStopEarly);
+
+	/**
+	 * Get whether runSimulation() ends when a stop condition
+	 * is met.
+	 * @return true if the simulation ends early.
+	 * @see setDoStopEarly()
+	 */
+	inline bool getDoStopEarly() const;
+
+	/**
+	 * Set whether runSimulation() skips idle ticks (see
+	 * Event::isIdleTick()).  When the events at the front of
+	 * the queue are all idle ticks, e.g., the slots of MACs
+	 * that are neither in a contention cycle nor have anything
+	 * to send, nothing happens until the first other event,
+	 * so each tick before it is skipped at once and its clock
+	 * resumes at its first tick from then on.  Clocks keep
+	 * their phase and counters, but whatever the skipped
+	 * ticks would have logged is not logged.  Ticks are not
+	 * skipped while stop conditions are checked, since they
+	 * are checked after every event.  This is false by
+	 * default.
+	 * @param doSkipIdleTicks true if idle ticks are skipped.
+	 */
+	inline void setDoSkipIdleTicks(bool doSkipIdleTicks);
+
+	/**
+	 * Get whether runSimulation() skips idle ticks.
+	 * @return true if idle ticks are skipped.
+	 * @see setDoSkipIdleTicks()
+	 */
+	inline bool getDoSkipIdleTicks() const;
+
+	/**
+	 * Get the time at which a stop condition was first met
+	 * in the last call to runSimulation().
+	 * @param stopConditionTime set to the time the condition
+	 * was met.
+	 * @return false if no stop condition was met.
+	 */
+	inline bool getStopConditionTime(SimTime& stopConditionTime) const;
+
+	/**
+	 * Get whether runSimulation() is checking its stop
+	 * conditions after each event, i.e., it has some and none
+	 * has been met yet.  An event that does the work of several
+	 * should then only do that of one per execution so that
+	 * the simulation can end between them.
+	 * @return true if the stop conditions are being checked.
+	 */
+	inline bool getDoCheckStopConditions() const;
+
+	/**
+	 * Get the simulated time between when a stop condition
+	 * was met and the stop time of the last call to
+	 * runSimulation(), i.e., the time that would be wasted by
+	 * running to the stop time.  This is useful for choosing
+	 * the stop time of a scenario.
+	 * @return the wasted time or zero if no stop condition
+	 * was met.
+	 */
+	inline SimTime getWastedTime() const;
+
 	/**
 	 * Get the current time in the simulator.
 	 * @return The current time in the simulator.
@@ -294,9 +412,88 @@ public:
 	inline bool scheduleEvent(EventPtr eventToSchedule, 
 		const SimTime& eventDelay);
 
+	/**
+	 * Add an event to the event queue at an absolute time.
+	 * @param eventToSchedule a pointer to the event being scheduled.
+	 * @param fireTime the time at which the event will fire,
+	 * which cannot be before currentTime().
+	 * @return true if event was scheduled succesfully.
+	 * @see scheduleEvent()
+	 */
+	inline bool scheduleEventAt(EventPtr eventToSchedule, 
+		const SimTime& fireTime);
+
+	/**
+	 * Take a block of sequence numbers for events that will be
+	 * scheduled later with scheduleEventInSequence().  They are
+	 * ordered among the events that fire at the same time as if
+	 * they had been scheduled now.  This cannot be called while
+	 * a bundle is dispatched in parallel.
+	 * @param numSequenceNumbers the size of the block.
+	 * @return the first sequence number of the block.
+	 */
+	inline t_ulong reserveSequenceNumbers(t_ulong numSequenceNumbers);
+
+	/**
+	 * Add an event to the event queue at an absolute time with
+	 * a sequence number from reserveSequenceNumbers().  An
+	 * event can be scheduled several times with the numbers of
+	 * one block, e.g., when it stands for the events of several
+	 * objects.
+	 * @param eventToSchedule a pointer to the event being scheduled.
+	 * @param fireTime the time at which the event will fire,
+	 * which cannot be before currentTime().
+	 * @param sequenceNumber the reserved sequence number.
+	 * @return true if event was scheduled succesfully.
+	 * @see scheduleEventAt()
+	 */
+	inline bool scheduleEventInSequence(EventPtr eventToSchedule,
+		const SimTime& fireTime, t_ulong sequenceNumber);
+
+	/**
+	 * Add the event of a Timer to the event queue.
+	 * This is the same as scheduleEvent() except that, if
+	 * the simulator uses a timer wheel, the event is kept
+	 * in the wheel until it is about to fire, which makes
+	 * starting and stopping the timer O(1).
+	 * @param eventToSchedule a pointer to the event being scheduled.
+	 * @param eventDelay how far in the future the event should be
+	 * scheduled.
+	 * @return true if event was scheduled succesfully.
+	 * @see scheduleEvent()
+	 * @see setDoTimerWheel()
+	 */
+	inline bool scheduleTimerEvent(EventPtr eventToSchedule,
+		const SimTime& eventDelay);
+
+	/**
+	 * Execute an action at an absolute time in the given
+	 * simulator.
+	 * If the destination is this simulator, the action is
+	 * simply scheduled as an event.  Otherwise, both simulators
+	 * must be partitions of the same ParallelSimulator and the
+	 * action is handed to the destination's thread, in which
+	 * case \c fireTime must be at least the parallel
+	 * simulator's lookahead after currentTime().  The action
+	 * may be executed on another thread, so it must only
+	 * refer to objects of the destination simulator or to
+	 * objects that are not modified while the simulation runs.
+	 * @param destination the simulator in which the action
+	 * will be executed.
+	 * @param fireTime the time at which the action will be
+	 * executed.
+	 * @param action the action to execute.
+	 * @see ParallelSimulator
+	 */
+	void scheduleAction(SimulatorPtr destination, const SimTime& fireTime,
+		const Action& action);
+
 	/**
 	 * Cancel an event from the event queue.
 	 * If the event pointer exists in the queue, it is removed.
+	 * The event is located through its queue handle or
+	 * ordering key, so this is at most O(log n) even when
+	 * many events share the same fire time.
 	 * @param eventToCancel a pointer to the event being cancelled.
 	 * @return true if the event was found and erased.
 	 * @see scheduleEvent()
@@ -305,20 +502,19 @@ public:
 	 */
 	inline bool cancelEvent(EventPtr eventToCancel);
 
-	/**
-	 * Set the simulator's log stream manager.
-	 * @param logStreamManager a pointer to the simulator's 
-	 * log stream manager.
-	 */
-	inline void setLogStreamManager(
-			LogStreamManagerPtr logStreamManager) const;
-
 	/**
 	 * Get a pointer to the simulator's log stream manager.
 	 * @return pointer to the simulator's log stream manager.
 	 */
 	inline LogStreamManagerPtr getLogStreamManager() const;
 
+	/**
+	 * Get a new unique ID for a packet.
+	 * IDs are unique within this simulator.
+	 * @return the packet ID.
+	 */
+	inline t_ulong nextPacketUniqueId();
+
 	/**
 	 * Seed the random number generator.
 	 * @param seed the new seed.
@@ -332,6 +528,41 @@ public:
 	 */
 	inline RandNumGeneratorPtr getRandNumGenerator() const;
 
+	/**
+	 * Set whether each node draws from its own random number
+	 * stream, seeded from this simulator's seed and the
+	 * node's ID, rather than from the simulator's stream.
+	 * The random numbers a node gets then do not depend on
+	 * the order in which the events of different nodes are
+	 * executed, which the parallel simulator requires.
+	 * @param doNodeRandomStreams true if nodes should have
+	 * their own streams.
+	 * @see Node::getRandNumGenerator()
+	 */
+	inline void setDoNodeRandomStreams(bool doNodeRandomStreams);
+
+	/**
+	 * Get whether each node draws from its own random number
+	 * stream.
+	 * @return true if nodes have their own streams.
+	 * @see setDoNodeRandomStreams()
+	 */
+	inline bool getDoNodeRandomStreams() const;
+
+	/**
+	 * Get the parallel simulator of which this simulator is
+	 * a partition.
+	 * @return the parallel simulator or zero if this simulator
+	 * is not a partition.
+	 */
+	inline ParallelSimulatorRawPtr getParallelSimulator() const;
+
+	/**
+	 * Get the index of this simulator in its parallel simulator.
+	 * @return the index of the partition.
+	 */
+	inline t_uint getPartitionIndex() const;
+
 	/**
 	 * Reset the state of the simulator to its initial state.
 	 * This clears the event queue and resets the clock to
@@ -347,14 +578,274 @@ public:
 	inline void addSimulationEndListener(
 		SimulationEndListenerPtr listener);
 
+	/**
+	 * Add an object whose state is saved in each checkpoint
+	 * so that the simulator can be rolled back to it.
+	 * @param saver a pointer to the object.
+	 * @see saveState()
+	 */
+	inline void addStateSaver(StateSaverPtr saver);
+
+	/**
+	 * Get the checkpoint to which the simulator would roll back.
+	 * Objects that save their state incrementally (i.e., just
+	 * before they first change it) add it to this checkpoint.
+	 * @return the checkpoint or an empty pointer if no state
+	 * is being saved.
+	 * @see addStateSaver()
+	 */
+	inline StateCheckpointPtr getStateCheckpoint() const;
+
+	/**
+	 * Get the ID of the checkpoint to which the simulator
+	 * would roll back.  Objects created after the checkpoint
+	 * was taken are not reachable once it is restored, so they
+	 * start out with this ID to skip saving their state.
+	 * @return the ID or zero if no state is being saved.
+	 * @see getStateCheckpoint()
+	 */
+	inline t_ulong getStateCheckpointId() const;
+
+	/**
+	 * Take a checkpoint of the simulator's state, including
+	 * its clock, its pending events, its random number
+	 * generators, and the state of each object added with
+	 * addStateSaver().  The checkpoint is kept in memory.
+	 * Several variants of a scenario can then share a warm-up
+	 * period: run the warm-up with runEvents(), take a
+	 * checkpoint, and then run each variant with
+	 * runSimulation() followed by restoreState().
+	 * The partitions of a ParallelSimulator are checkpointed
+	 * by the parallel simulator itself.
+	 * @see restoreState()
+	 * @see commitState()
+	 */
+	void saveState();
+
+	/**
+	 * Roll the simulator back to its checkpoint.  The
+	 * checkpoint is kept, so this can be done repeatedly.
+	 * Output already written to the log streams is not
+	 * taken back, but stats recorded in memory are.
+	 * @see saveState()
+	 */
+	void restoreState();
+
+	/**
+	 * Discard the checkpoint, after which the state since it
+	 * was taken can no longer be rolled back.
+	 * @see saveState()
+	 */
+	void commitState();
+
+	/**
+	 * Put the simulator back to its state when it first ran,
+	 * so that a built scenario can be run again (e.g., with a
+	 * new seed) without rebuilding its nodes.  The pending
+	 * events, clock, sequence numbers, and packet IDs are put
+	 * back to what they were when runSimulation() or
+	 * runEvents() was first called, and each object added with
+	 * addStateSaver() resets its own state in the order in
+	 * which it was added.  Each node's random number stream is
+	 * started again from the simulator's seed when it is next
+	 * used, so the simulator should be seeded after this.
+	 * As with restoreState(), stats recorded in memory are
+	 * taken back, but output written to the log streams is
+	 * not.  This cannot be done while a checkpoint is kept or
+	 * on the partitions of a ParallelSimulator.
+	 * @see getNumStateResets()
+	 */
+	void resetState();
+
+	/**
+	 * Get the number of times that resetState() was called.
+	 * @return the number of resets.
+	 */
+	inline t_ulong getNumStateResets() const;
+
+	/**
+	 * Execute the events that fire before a given time
+	 * without ending the simulation.
+	 * This simulator becomes the calling thread's current
+	 * simulator.
+	 * @param endTime the time up to which events are executed.
+	 * @param isEndInclusive true if events that fire exactly
+	 * at \c endTime should also be executed.
+	 * @see runSimulation()
+	 */
+	void runEvents(const SimTime& endTime, bool isEndInclusive);
+
+	/**
+	 * Select the implementation of the event queue.
+	 * This should be called at startup before any events
+	 * are scheduled.  The choice of implementation does not
+	 * affect the order in which events are executed.
+	 * @param queueType the type of event queue to use.
+	 * @see getEventQueueType()
+	 */
+	void setEventQueueType(EventQueue::QueueTypes queueType);
+
+	/**
+	 * Get the type of event queue in use.
+	 * @return the type of the event queue.
+	 * @see setEventQueueType()
+	 */
+	inline EventQueue::QueueTypes getEventQueueType() const;
+
+	/**
+	 * Set whether timer events are kept in a timer wheel
+	 * in front of the event queue (see TimerWheelEventQueue).
+	 * This should be called at startup before any events
+	 * are scheduled.  The wheel does not affect the order in
+	 * which events are executed.  By default, it is used.
+	 * @param doTimerWheel true if the timer wheel is used.
+	 * @see scheduleTimerEvent()
+	 */
+	void setDoTimerWheel(bool doTimerWheel);
+
+	/**
+	 * Set whether the events that fire after the stop time of
+	 * runSimulation() are kept apart from the event queue (see
+	 * HorizonEventQueue), so that they do not slow down the
+	 * queue's operations.
+	 * This should be called at startup before any events
+	 * are scheduled.  It does not affect the order in which
+	 * events are executed.  By default, they are kept apart.
+	 * @param doEventHorizon true if the events are kept apart.
+	 */
+	void setDoEventHorizon(bool doEventHorizon);
+
+	/**
+	 * Set the rank of a priority class of events (see
+	 * Event::getPriorityClass()).  Events that fire at the same
+	 * time are executed in ascending order of the ranks of their
+	 * classes and, within a rank, in the order in which they were
+	 * scheduled.  So, the order does not depend on how the
+	 * events of different classes happened to be scheduled.
+	 * By default, every class has rank zero, which orders
+	 * events only by when they were scheduled.
+	 * This should be called at startup before any events
+	 * are scheduled.
+	 * @param priorityClass the class.
+	 * @param rank the rank, which must be less than
+	 * Event::m_NUM_PRIORITY_RANKS.
+	 * @see usePriorityClasses()
+	 */
+	void setPriorityClassRank(Event::PriorityClasses priorityClass,
+		t_uint rank);
+
+	/**
+	 * Rank each priority class by its position in
+	 * Event::PriorityClasses.
+	 * @see setPriorityClassRank()
+	 */
+	void usePriorityClasses();
+
+	/**
+	 * Get the rank of a priority class of events.
+	 * @param priorityClass the class.
+	 * @return the rank.
+	 * @see setPriorityClassRank()
+	 */
+	inline t_uint getPriorityClassRank(
+		Event::PriorityClasses priorityClass) const;
+
+	/**
+	 * Set the number of threads that execute the node-local
+	 * events of a bundle (see Event::getLocalNode()) in
+	 * parallel.  The events that they schedule are buffered
+	 * per thread and then scheduled in the order in which the
+	 * bundle would have scheduled them sequentially, so the
+	 * results do not depend on the number of threads.
+	 * This should not be called while the simulation runs.
+	 * @param numThreads the number of threads, including the
+	 * simulator's own thread.  One, the default, executes
+	 * every bundle sequentially.
+	 * @see BundleDispatcher
+	 */
+	void setNumBundleThreads(t_uint numThreads);
+
+	/**
+	 * Get the number of threads that execute bundles.
+	 * @return the number of threads.
+	 * @see setNumBundleThreads()
+	 */
+	t_uint getNumBundleThreads() const;
+
+	/**
+	 * Get the dispatcher that executes bundles in parallel.
+	 * @return the dispatcher or an empty pointer if bundles
+	 * are executed sequentially.
+	 * @see setNumBundleThreads()
+	 */
+	inline BundleDispatcherPtr getBundleDispatcher() const;
+
+	/**
+	 * Get whether timer events are kept in a timer wheel.
+	 * @return true if the timer wheel is used.
+	 * @see setDoTimerWheel()
+	 */
+	inline bool getDoTimerWheel() const;
+
+	/**
+	 * Get whether the events after the stop time are kept
+	 * apart from the event queue.
+	 * @return true if they are kept apart.
+	 * @see setDoEventHorizon()
+	 */
+	inline bool getDoEventHorizon() const;
+
+	/**
+	 * Get the number of events pending in the event queue.
+	 * @return the number of pending events.
+	 */
+	inline t_ulong numPendingEvents() const;
+
+#ifdef RFIDSIM_PROFILING
+	/**
+	 * Profile the events that the simulator dispatches.
+	 * This is normally called by EventProfiler::create().
+	 * @param eventProfiler the profiler or an empty pointer
+	 * to stop profiling.
+	 */
+	inline void setEventProfiler(EventProfilerPtr eventProfiler);
+
+	/**
+	 * Get the profiler of the simulator's events.
+	 * @return the profiler or an empty pointer if events
+	 * are not profiled.
+	 */
+	inline EventProfilerPtr getEventProfiler() const;
+#endif
+
 private:
 
+	/// The type of event queue used by default.
+	static const EventQueue::QueueTypes m_DEFAULT_EVENT_QUEUE_TYPE;
+
+	/// Whether the timer wheel is used by default.
+	static const bool m_DEFAULT_DO_TIMER_WHEEL;
+
+	/// Whether the events after the stop time are kept apart
+	/// by default.
+	static const bool m_DEFAULT_DO_EVENT_HORIZON;
+
 	/// The default start time for the simulator.
 	static const double m_SIM_START_TIME;
 
-	/// The lone instance of the simulator class.
+	/// The first packet ID given out by a simulator.
+	static const t_ulong m_FIRST_PACKET_UNIQUE_ID;
+
+	//@{
+	/** String for the stats file output. */
+	static const string m_STOP_CONDITION_TIME_STRING;
+	static const string m_WASTED_TIME_STRING;
+	//@}
+
+	/// The current simulator of each thread.
 	/// @see instance()
-	static SimulatorPtr m_instance;
+	/// @see setInstance()
+	static thread_local SimulatorPtr m_instance;
 
 	/// The master clock of the simulator.
 	/// @see currentTime()
@@ -364,14 +855,51 @@ private:
 	/// @see runSimulation()
 	/// @see scheduleEvent()
 	/// @see dispatchEvent()
-	EventPtrQueue m_eventPtrQueue;
+	/// @see setEventQueueType()
+	EventQueuePtr m_eventQueue;
+
+	/// @see setDoTimerWheel()
+	bool m_doTimerWheel;
+
+	/// @see setDoEventHorizon()
+	bool m_doEventHorizon;
 
-	/// The global interface to output to log files.
-	/// @see setLogStreamManager()
+	/// The rank of each priority class.
+	/// @see setPriorityClassRank()
+	t_uint m_priorityClassRanks[Event::m_NUM_PRIORITY_CLASSES];
+
+	/// The bundle of events being dispatched.
+	/// @see dispatchBundle()
+	EventBundle m_eventBundle;
+
+	/// @see getBundleDispatcher()
+	BundleDispatcherPtr m_bundleDispatcher;
+
+	/// True while the threads of m_bundleDispatcher execute
+	/// events, during which scheduled events are buffered.
+	bool m_isDispatchingInParallel;
+
+#ifdef RFIDSIM_PROFILING
+	/// @see setEventProfiler()
+	EventProfilerPtr m_eventProfiler;
+#endif
+
+	/// The sequence number given to the next scheduled event
+	/// so that events with equal fire times are executed in
+	/// the order in which they were scheduled.
+	/// @see scheduleEvent()
+	t_ulong m_nextSequenceNumber;
+
+	/// The interface to output to log files.
+	/// This is owned by the simulator.
 	/// @see getLogStreamManager()
 	LogStreamManagerPtr m_logStreamManagerPtr;
 
-	/// The global random number generator for the simulator.
+	/// The ID given to the next packet that is created.
+	/// @see nextPacketUniqueId()
+	t_ulong m_nextPacketUniqueId;
+
+	/// The random number generator for the simulator.
 	/// @see getRandNumGenerator()
 	/// @see seedRandNumGenerator()
 	RandNumGeneratorPtr m_randNumGeneratorPtr;
@@ -381,13 +909,124 @@ private:
 	/// @see addSimulationEndListener()
 	vector<SimulationEndListenerPtr> m_simulationEndListeners;
 
+	/// @see setDoNodeRandomStreams()
+	bool m_doNodeRandomStreams;
+
+	/// @see getParallelSimulator()
+	ParallelSimulatorRawPtr m_parallelSimulator;
+
+	/// @see getPartitionIndex()
+	t_uint m_partitionIndex;
+
+	/// The objects whose state is saved in each checkpoint.
+	/// @see addStateSaver()
+	vector<StateSaverPtr> m_stateSavers;
+
+	/// @see getStateCheckpoint()
+	StateCheckpointPtr m_stateCheckpoint;
+
+	/// Whether the state that resetState() puts back was
+	/// saved, which is done when the simulator first runs.
+	bool m_hasInitialState;
+
+	/// The events that were pending when the simulator
+	/// first ran.
+	vector<EventQueueEntry> m_initialEntries;
+
+	/// The clock when the simulator first ran.
+	SimTime m_initialClock;
+
+	/// The sequence number when the simulator first ran.
+	t_ulong m_initialSequenceNumber;
+
+	/// The next packet ID when the simulator first ran.
+	t_ulong m_initialPacketUniqueId;
+
+	/// The number of stats recorded in memory when the
+	/// simulator first ran.
+	t_ulong m_initialNumRecordedStats;
+
+	/// @see getNumStateResets()
+	t_ulong m_numStateResets;
+
+	/// The conditions that can end the simulation early.
+	/// @see addStopCondition()
+	vector<StopConditionPtr> m_stopConditions;
+
+	/// @see setDoStopEarly()
+	bool m_doStopEarly;
+
+	/// @see setDoSkipIdleTicks()
+	bool m_doSkipIdleTicks;
+
+	/// The idle ticks taken out of the event queue by
+	/// skipIdleTicks().
+	vector<EventPtr> m_idleTicks;
+
+	/// Whether a stop condition was met in the current run.
+	/// @see getStopConditionTime()
+	bool m_isStopConditionMet;
+
+	/// @see getStopConditionTime()
+	SimTime m_stopConditionTime;
+
+	/// The stop time of the current run.
+	/// @see getWastedTime()
+	SimTime m_stopTime;
+
 	/// A constructor.
 	Simulator();
 
-	/// A destructor.
-	/// This is private to avoid smart pointers to this
-	/// class since it is a Singleton.
-	~Simulator();
+	/**
+	 * Replace the pending events with those that were pending
+	 * when a checkpoint was taken.
+	 * @param entries the entries of the events that were pending.
+	 */
+	void restoreEvents(const vector<EventQueueEntry>& entries);
+
+	/**
+	 * Save the state that resetState() puts back if it has
+	 * not been saved yet.
+	 */
+	void saveInitialState();
+
+	/**
+	 * Get the fire time of the next event without removing it.
+	 * @param nextTime set to the fire time of the next event.
+	 * @return false if the event queue is empty.
+	 */
+	inline bool peekNextEventTime(SimTime& nextTime);
+
+	/**
+	 * Check whether any stop condition is met and, if so,
+	 * record the time at which it was.
+	 * @return true if a stop condition is met.
+	 */
+	inline bool checkStopConditions();
+
+	/**
+	 * Skip the idle ticks at the front of the event queue
+	 * that are before the first other event.
+	 * @param stopTime the stop time of the run, after which
+	 * no ticks are skipped.
+	 * @see setDoSkipIdleTicks()
+	 */
+	void skipIdleTicks(const SimTime& stopTime);
+
+	/**
+	 * Log when a stop condition was met and the wasted time
+	 * as global stats.
+	 * @see getWastedTime()
+	 */
+	void logStopConditionStats() const;
+
+	/**
+	 * Move the clock to the stop time and notify the simulation
+	 * end listeners.
+	 * @param stopTime the time at which the simulation stops.
+	 * @see runSimulation()
+	 */
+	void endSimulation(const SimTime& stopTime);
 
 	/**
 	 * Execute an event.
@@ -400,6 +1039,61 @@ private:
 	 */
 	inline void dispatchEvent(EventPtr event);
 
+	/**
+	 * Give an event that is being scheduled its sequence
+	 * number and add it to the event queue.  While a bundle
+	 * is executed in parallel, the event is instead buffered
+	 * by the calling thread's part of the bundle.
+	 * @param event the event, whose fire time is set.
+	 * @param isTimer true if the event belongs to a timer.
+	 * @see EventQueue::insertTimer()
+	 */
+	inline void queueEvent(EventPtr event, bool isTimer);
+
+	/**
+	 * Buffer an event scheduled by a thread of the bundle
+	 * dispatcher.
+	 * @param event the event, whose fire time is set.
+	 * @param isTimer true if the event belongs to a timer.
+	 * @see BundleDispatcher::bufferEvent()
+	 */
+	void bufferParallelEvent(EventPtr event, bool isTimer);
+
+	/**
+	 * Cancel an event from a thread of the bundle dispatcher.
+	 * @param event the event, which is pending.
+	 * @return true if the event was found and removed.
+	 * @see BundleDispatcher::cancelEvent()
+	 */
+	bool cancelParallelEvent(EventPtr event);
+
+	/**
+	 * Remove a pending event from the event queue or from
+	 * the bundle being dispatched.
+	 * @param event the event, which is pending.
+	 * @return true if the event was found and removed.
+	 */
+	inline bool removeEvent(EventPtr event);
+
+	/**
+	 * Execute an event, along with the events of the same
+	 * type that fire at the same time after it if its type
+	 * can be bundled.
+	 * @param event the event taken from the queue.
+	 * @see Event::isBundled()
+	 */
+	inline void dispatchEvents(EventPtr event);
+
+	/**
+	 * Take the events of the same type that fire at the same
+	 * time as an event from the queue and execute them
+	 * together with it as a bundle.
+	 * @param event the first event of the bundle, which was
+	 * taken from the queue.
+	 * @see Event::executeBundle()
+	 */
+	void dispatchBundle(EventPtr event);
+
 	/**
 	 * Remove and return the next event on the queue.
 	 * @return pointer to next event on the queue.
@@ -409,6 +1103,7 @@ private:
 
 };
 typedef Simulator* SimulatorPtr;
+typedef boost::shared_ptr<Simulator> SimulatorOwnerPtr;
 
 /////////////////////////////////////////////////
 // Inline Functions
@@ -432,39 +1127,82 @@ inline bool Simulator::scheduleEvent(EventPtr eventToSchedule,
 	assert(eventDelay >= 0.0);
 
 	eventToSchedule->setFireTime(currentTime() + eventDelay);
-	EventPtrQueue::const_iterator insertIterator = 
-		m_eventPtrQueue.insert(eventToSchedule);
-	bool didInsert = (insertIterator != m_eventPtrQueue.end());
-	if(didInsert) {
-		eventToSchedule->setInEventQueue(true);
-	}
-	
-	return didInsert;
+	queueEvent(eventToSchedule, false);
+	eventToSchedule->setInEventQueue(true);
+
+	return true;
+
+}
+
+inline bool Simulator::scheduleEventAt(EventPtr eventToSchedule, 
+	const SimTime& fireTime)
+{
+	assert(eventToSchedule != 0);
+	assert(!eventToSchedule->inEventQueue());
+	assert(fireTime >= currentTime());
+
+	eventToSchedule->setFireTime(fireTime);
+	queueEvent(eventToSchedule, false);
+	eventToSchedule->setInEventQueue(true);
 
+	return true;
+}
+
+inline t_ulong Simulator::reserveSequenceNumbers(
+	t_ulong numSequenceNumbers)
+{
+	assert(!m_isDispatchingInParallel);
+	t_ulong firstSequenceNumber = m_nextSequenceNumber;
+	m_nextSequenceNumber += numSequenceNumbers;
+	return firstSequenceNumber;
+}
+
+inline bool Simulator::scheduleEventInSequence(EventPtr eventToSchedule,
+	const SimTime& fireTime, t_ulong sequenceNumber)
+{
+	assert(eventToSchedule != 0);
+	assert(!eventToSchedule->inEventQueue());
+	assert(fireTime >= currentTime());
+	assert(sequenceNumber < m_nextSequenceNumber);
+	assert(!m_isDispatchingInParallel);
+
+	eventToSchedule->setFireTime(fireTime);
+	eventToSchedule->setOrderKey(Event::makeOrderKey(
+		m_priorityClassRanks[eventToSchedule->getPriorityClass()],
+		sequenceNumber));
+	m_eventQueue->insert(eventToSchedule);
+	eventToSchedule->setInEventQueue(true);
+
+	return true;
+}
+
+inline bool Simulator::scheduleTimerEvent(EventPtr eventToSchedule,
+	const SimTime& eventDelay)
+{
+	assert(eventToSchedule != 0);
+	assert(!eventToSchedule->inEventQueue());
+	assert(eventDelay >= 0.0);
+
+	eventToSchedule->setFireTime(currentTime() + eventDelay);
+	queueEvent(eventToSchedule, true);
+	eventToSchedule->setInEventQueue(true);
+
+	return true;
 }
 
 inline bool Simulator::cancelEvent(EventPtr eventToCancel)
 {
 	assert(eventToCancel != 0);
 
-	// Get the range of elements that match this key (i.e.,
-	// have the same fire time).
-	pair<EventPtrQueueIterator,EventPtrQueueIterator> keyIteratorPair =
-		m_eventPtrQueue.equal_range(eventToCancel);
-		
 	bool didErase = false;
-	// If the key was not found, pair.first == pair.second
-	for(EventPtrQueueIterator keyIterator = keyIteratorPair.first;
-			keyIterator != keyIteratorPair.second; 
-			++keyIterator) {
-
-		// If we iterator finds the pointer we want to delete,
-		// then erase the element and return.
-		if(*keyIterator == eventToCancel) {
-			m_eventPtrQueue.erase(keyIterator);
+	if(eventToCancel->inEventQueue()) {
+		if(m_isDispatchingInParallel) {
+			didErase = cancelParallelEvent(eventToCancel);
+		} else {
+			didErase = removeEvent(eventToCancel);
+		}
+		if(didErase) {
 			eventToCancel->setInEventQueue(false);
-			didErase = true;
-			break;
 		}
 	}
 
@@ -477,12 +1215,71 @@ inline RandNumGeneratorPtr Simulator::getRandNumGenerator() const
 	return m_randNumGeneratorPtr;
 }
 
+inline void Simulator::setDoNodeRandomStreams(bool doNodeRandomStreams)
+{
+	m_doNodeRandomStreams = doNodeRandomStreams;
+}
+
+inline bool Simulator::getDoNodeRandomStreams() const
+{
+	return m_doNodeRandomStreams;
+}
+
+inline ParallelSimulatorRawPtr Simulator::getParallelSimulator() const
+{
+	return m_parallelSimulator;
+}
+
+inline t_uint Simulator::getPartitionIndex() const
+{
+	return m_partitionIndex;
+}
+
+inline void Simulator::addStateSaver(StateSaverPtr saver)
+{
+	assert(saver.get() != 0);
+	m_stateSavers.push_back(saver);
+}
+
+inline t_ulong Simulator::getNumStateResets() const
+{
+	return m_numStateResets;
+}
+
+inline StateCheckpointPtr Simulator::getStateCheckpoint() const
+{
+	return m_stateCheckpoint;
+}
+
+inline t_ulong Simulator::getStateCheckpointId() const
+{
+	t_ulong id = 0;
+	if(m_stateCheckpoint.get() != 0) {
+		id = m_stateCheckpoint->getId();
+	}
+	return id;
+}
+
+inline bool Simulator::peekNextEventTime(SimTime& nextTime)
+{
+	if(m_eventQueue->empty()) {
+		return false;
+	}
+	nextTime = m_eventQueue->top()->getFireTime();
+	return true;
+}
+
 inline LogStreamManagerPtr Simulator::getLogStreamManager() const
 {
 	assert(m_logStreamManagerPtr != 0);
 	return m_logStreamManagerPtr;
 }
 
+inline t_ulong Simulator::nextPacketUniqueId()
+{
+	return m_nextPacketUniqueId++;
+}
+
 inline SimulatorPtr Simulator::instance() 
 {
 	// See the Singleton design pattern for an explanation.
@@ -492,6 +1289,12 @@ inline SimulatorPtr Simulator::instance()
 	return m_instance;
 }
 
+inline void Simulator::setInstance(SimulatorPtr simulator)
+{
+	assert(simulator != 0);
+	m_instance = simulator;
+}
+
 inline void Simulator::dispatchEvent(EventPtr event)
 {
 	assert(event.get() != 0);
@@ -499,13 +1302,67 @@ inline void Simulator::dispatchEvent(EventPtr event)
 	assert(m_clock <= fireTime);
 
 	m_clock = fireTime;
+#ifdef RFIDSIM_PROFILING
+	if(m_eventProfiler.get() != 0) {
+		// The event has already been removed from the queue.
+		t_ulong queueDepth = m_eventQueue->size() + 1;
+		t_ulong startTicks = EventProfiler::readTicks();
+		event->execute();
+		m_eventProfiler->recordDispatch(typeid(*event),
+			EventProfiler::readTicks() - startTicks, queueDepth);
+		return;
+	}
+#endif
 	event->execute();
 }
 
+inline void Simulator::queueEvent(EventPtr event, bool isTimer)
+{
+	if(m_isDispatchingInParallel) {
+		bufferParallelEvent(event, isTimer);
+		return;
+	}
+
+	event->setOrderKey(Event::makeOrderKey(
+		m_priorityClassRanks[event->getPriorityClass()],
+		m_nextSequenceNumber++));
+	if(isTimer) {
+		m_eventQueue->insertTimer(event);
+	} else {
+		m_eventQueue->insert(event);
+	}
+}
+
+inline bool Simulator::removeEvent(EventPtr event)
+{
+	bool didErase = false;
+	if(event->inEventBundle()) {
+		// It will be skipped when its bundle reaches it.
+		event->setInEventBundle(false);
+		didErase = true;
+	} else {
+		didErase = m_eventQueue->remove(event);
+	}
+	return didErase;
+}
+
+inline void Simulator::dispatchEvents(EventPtr event)
+{
+	assert(event.get() != 0);
+	if(event->isBundled() && !m_eventQueue->empty()) {
+		Event* nextEvent = m_eventQueue->top().get();
+		if(!(nextEvent->getFireTime() > event->getFireTime()) &&
+				typeid(*nextEvent) == typeid(*event)) {
+			dispatchBundle(event);
+			return;
+		}
+	}
+	dispatchEvent(event);
+}
+
 inline EventPtr Simulator::getNextEvent()
 {
-	EventPtr nextEvent (*m_eventPtrQueue.begin());
-	m_eventPtrQueue.erase(m_eventPtrQueue.begin());
+	EventPtr nextEvent = m_eventQueue->pop();
 	nextEvent->setInEventQueue(false);
 	return nextEvent;
 }
@@ -516,5 +1373,108 @@ inline void Simulator::addSimulationEndListener(
 	m_simulationEndListeners.push_back(listener);
 }
 
+inline void Simulator::addStopCondition(StopConditionPtr condition)
+{
+	assert(condition.get() != 0);
+	m_stopConditions.push_back(condition);
+}
+
+inline void Simulator::setDoStopEarly(bool doStopEarly)
+{
+	m_doStopEarly = doStopEarly;
+}
+
+inline bool Simulator::getDoStopEarly() const
+{
+	return m_doStopEarly;
+}
+
+inline void Simulator::setDoSkipIdleTicks(bool doSkipIdleTicks)
+{
+	m_doSkipIdleTicks = doSkipIdleTicks;
+}
+
+inline bool Simulator::getDoSkipIdleTicks() const
+{
+	return m_doSkipIdleTicks;
+}
+
+inline bool Simulator::getStopConditionTime(
+	SimTime& stopConditionTime) const
+{
+	stopConditionTime = m_stopConditionTime;
+	return m_isStopConditionMet;
+}
+
+inline bool Simulator::getDoCheckStopConditions() const
+{
+	return !m_stopConditions.empty() && !m_isStopConditionMet;
+}
+
+inline SimTime Simulator::getWastedTime() const
+{
+	SimTime wastedTime(0.0);
+	if(m_isStopConditionMet) {
+		wastedTime = m_stopTime - m_stopConditionTime;
+	}
+	return wastedTime;
+}
+
+inline bool Simulator::checkStopConditions()
+{
+	for(t_uint i = 0; i < m_stopConditions.size(); ++i) {
+		if(m_stopConditions[i]->shouldStop(m_clock)) {
+			m_isStopConditionMet = true;
+			m_stopConditionTime = m_clock;
+			return true;
+		}
+	}
+	return false;
+}
+
+inline EventQueue::QueueTypes Simulator::getEventQueueType() const
+{
+	return m_eventQueue->getQueueType();
+}
+
+inline BundleDispatcherPtr Simulator::getBundleDispatcher() const
+{
+	return m_bundleDispatcher;
+}
+
+inline bool Simulator::getDoTimerWheel() const
+{
+	return m_doTimerWheel;
+}
+
+inline bool Simulator::getDoEventHorizon() const
+{
+	return m_doEventHorizon;
+}
+
+inline t_uint Simulator::getPriorityClassRank(
+	Event::PriorityClasses priorityClass) const
+{
+	assert(priorityClass < Event::m_NUM_PRIORITY_CLASSES);
+	return m_priorityClassRanks[priorityClass];
+}
+
+inline t_ulong Simulator::numPendingEvents() const
+{
+	return m_eventQueue->size();
+}
+
+#ifdef RFIDSIM_PROFILING
+inline void Simulator::setEventProfiler(EventProfilerPtr eventProfiler)
+{
+	m_eventProfiler = eventProfiler;
+}
+
+inline EventProfilerPtr Simulator::getEventProfiler() const
+{
+	return m_eventProfiler;
+}
+#endif
+
 #endif // SIMULATOR_H
 
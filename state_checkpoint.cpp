@@ -0,0 +1,19 @@
+
+#include "state_checkpoint.hpp"
+
+boost::atomic<t_ulong> StateCheckpoint::m_nextId(1);
+
+StateCheckpoint::StateCheckpoint(t_ulong id)
+	: m_id(id)
+{
+
+}
+
+void StateCheckpoint::restore() const
+{
+	vector<RestoreAction>::const_reverse_iterator p;
+	for(p = m_restoreActions.rbegin(); p != m_restoreActions.rend(); ++p) {
+		(*p)();
+	}
+}
+
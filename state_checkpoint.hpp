@@ -0,0 +1,152 @@
+
+#ifndef STATE_CHECKPOINT_H
+#define STATE_CHECKPOINT_H
+
+#include <vector>
+using namespace std;
+#include <boost/shared_ptr.hpp>
+#include <boost/function.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/utility.hpp>
+#include <boost/atomic.hpp>
+
+#include "utility.hpp"
+
+/////////////////////////////////////////////////
+// StateCheckpoint Class
+/////////////////////////////////////////////////
+
+/**
+ * The saved state of a simulator at one point in time.
+ * A checkpoint is a log of the values that variables had when
+ * they were saved, along with any other actions needed to
+ * undo what has happened since (e.g., detaching from a channel).
+ * Restoring the checkpoint writes the values back in the
+ * reverse order in which they were saved.  A checkpoint can
+ * be restored any number of times, since it always holds the
+ * values from when it was taken.
+ *
+ * Variables can be saved either all at once when the
+ * checkpoint is taken (see StateSaver) or incrementally just
+ * before they are first changed, in which case the saver uses
+ * getId() to tell whether it has already saved them in
+ * this checkpoint.
+ * @see Simulator::getStateCheckpoint()
+ */
+class StateCheckpoint : boost::noncopyable {
+public:
+	/// Smart pointer that clients should use.
+	typedef boost::shared_ptr<StateCheckpoint> StateCheckpointPtr;
+
+	/// An action that undoes a change to the state.
+	typedef boost::function<void ()> RestoreAction;
+
+	/**
+	 * A factory method to ensure that all objects
+	 * are created via \c new since we are using smart pointers.
+	 * The checkpoint is given a new ID.
+	 */
+	static inline StateCheckpointPtr create();
+
+	/**
+	 * Get the ID of the checkpoint.
+	 * IDs are unique across all simulators in the process
+	 * (and never zero), since objects such as packets can
+	 * move between the simulators of a ParallelSimulator.
+	 * @return the ID.
+	 */
+	inline t_ulong getId() const;
+
+	/**
+	 * Save the current value of a variable.
+	 * The variable must outlive the checkpoint.
+	 * @param variable the variable to save.
+	 */
+	template<class T>
+	inline void save(T& variable);
+
+	/**
+	 * Save an action that is executed when the checkpoint is
+	 * restored.
+	 * @param restoreAction the action.
+	 */
+	inline void saveAction(const RestoreAction& restoreAction);
+
+	/**
+	 * Get the number of values and actions saved.
+	 * @return the number of saved items.
+	 */
+	inline t_ulong getNumSavedItems() const;
+
+	/**
+	 * Restore the saved state.
+	 */
+	void restore() const;
+
+private:
+
+	/// The ID given to the next checkpoint that is created.
+	static boost::atomic<t_ulong> m_nextId;
+
+	/// @see getId()
+	t_ulong m_id;
+
+	/// The actions that restore the state, in the order in
+	/// which they were saved.
+	vector<RestoreAction> m_restoreActions;
+
+	/// A constructor.
+	/// @param id the ID of the checkpoint.
+	StateCheckpoint(t_ulong id);
+
+	/**
+	 * Write a saved value back to its variable.
+	 * @param variable the variable.
+	 * @param value the saved value.
+	 */
+	template<class T>
+	static inline void assign(T* variable, const T& value);
+
+};
+typedef boost::shared_ptr<StateCheckpoint> StateCheckpointPtr;
+
+/////////////////////////////////////////////////
+// Inline Functions
+/////////////////////////////////////////////////
+
+inline StateCheckpointPtr StateCheckpoint::create()
+{
+	StateCheckpointPtr p(new StateCheckpoint(m_nextId++));
+	return p;
+}
+
+inline t_ulong StateCheckpoint::getId() const
+{
+	return m_id;
+}
+
+template<class T>
+inline void StateCheckpoint::save(T& variable)
+{
+	m_restoreActions.push_back(boost::bind(&StateCheckpoint::assign<T>,
+		&variable, variable));
+}
+
+inline void StateCheckpoint::saveAction(const RestoreAction& restoreAction)
+{
+	m_restoreActions.push_back(restoreAction);
+}
+
+inline t_ulong StateCheckpoint::getNumSavedItems() const
+{
+	return m_restoreActions.size();
+}
+
+template<class T>
+inline void StateCheckpoint::assign(T* variable, const T& value)
+{
+	*variable = value;
+}
+
+#endif // STATE_CHECKPOINT_H
+
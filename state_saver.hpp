@@ -0,0 +1,66 @@
+
+#ifndef STATE_SAVER_H
+#define STATE_SAVER_H
+
+#include <boost/shared_ptr.hpp>
+
+class StateCheckpoint;
+
+/////////////////////////////////////////////////
+// StateSaver Interface
+/////////////////////////////////////////////////
+
+/**
+ * This is an interface for classes whose state can be
+ * rolled back by an optimistic ParallelSimulator.
+ * Each object that implements this interface \e must add
+ * itself to the simulator.  When a checkpoint is taken, the
+ * object saves each member that may change while the
+ * simulation runs; when the simulator rolls back, the
+ * checkpoint writes the saved values back.  The same members
+ * can also be put back to their initial values, so that a
+ * built scenario can be run again without being rebuilt.
+ * N.B.: This should be treated as an interface and neither
+ * state nor function definitions should be added to it.
+ * @see Simulator::addStateSaver()
+ */
+class StateSaver
+{
+public:
+
+	/// A destructor.
+	virtual ~StateSaver() {}
+
+	/**
+	 * Save the object's state in a checkpoint.
+	 * Subclasses that add state should call their
+	 * superclass's implementation.
+	 * @param checkpoint the checkpoint being taken.
+	 */
+	virtual void saveState(StateCheckpoint& checkpoint) = 0;
+
+	/**
+	 * Put each member saved by saveState() back to the value
+	 * it had before the simulation first ran.  The simulator's
+	 * pending events are put back separately, so the object
+	 * should not schedule any events.
+	 * Subclasses that add state should call their
+	 * superclass's implementation.
+	 * @see Simulator::resetState()
+	 */
+	virtual void resetState() = 0;
+
+protected:
+
+	/// A constructor.
+	StateSaver() {}
+
+private:
+	// Make the class unable to be copied
+	StateSaver(const StateSaver& rhs);
+	StateSaver& operator= (const StateSaver& rhs);
+};
+typedef boost::shared_ptr<StateSaver> StateSaverPtr;
+
+#endif // STATE_SAVER_H
+
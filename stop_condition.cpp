@@ -0,0 +1,127 @@
+
+#include <cmath>
+
+#include "stop_condition.hpp"
+#include "application_layer.hpp"
+#include "rfid_reader_app.hpp"
+
+/////////////////////////////////////////////////
+// TagsReadStopCondition functions
+/////////////////////////////////////////////////
+
+TagsReadStopCondition::TagsReadStopCondition(t_uint numTags)
+	: m_numTags(numTags)
+{
+
+}
+
+bool TagsReadStopCondition::shouldStop(const SimTime& currentTime)
+{
+	if(m_readerApps.empty()) {
+		return false;
+	}
+
+	for(t_uint i = 0; i < m_readerApps.size(); ++i) {
+		if(m_readerApps[i]->getNumTagsRead() < m_numTags) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/////////////////////////////////////////////////
+// ApplicationIdleStopCondition functions
+/////////////////////////////////////////////////
+
+ApplicationIdleStopCondition::ApplicationIdleStopCondition(
+	const SimTime& idleTime)
+	: m_idleTime(idleTime), m_nextCheckTime(0.0),
+	m_previousCheckTime(0.0)
+{
+	assert(idleTime > 0.0);
+}
+
+bool ApplicationIdleStopCondition::shouldStop(const SimTime& currentTime)
+{
+	// The simulator was restored to an earlier time.
+	if(currentTime < m_previousCheckTime) {
+		m_nextCheckTime = currentTime;
+	}
+	m_previousCheckTime = currentTime;
+
+	if(currentTime < m_nextCheckTime || m_applications.empty()) {
+		return false;
+	}
+
+	SimTime lastActivityTime(0.0);
+	for(t_uint i = 0; i < m_applications.size(); ++i) {
+		SimTime applicationActivityTime;
+		if(!m_applications[i]->getLastActivityTime(
+				applicationActivityTime)) {
+			// We cannot tell when it will start, so look
+			// again after the idle time.
+			m_nextCheckTime = currentTime + m_idleTime;
+			return false;
+		}
+		if(applicationActivityTime > lastActivityTime) {
+			lastActivityTime = applicationActivityTime;
+		}
+	}
+
+	m_nextCheckTime = lastActivityTime + m_idleTime;
+	return (currentTime >= m_nextCheckTime);
+}
+
+/////////////////////////////////////////////////
+// StatConvergenceStopCondition functions
+/////////////////////////////////////////////////
+
+StatConvergenceStopCondition::StatConvergenceStopCondition(
+	const Metric& metric, const SimTime& samplePeriod, double tolerance,
+	t_uint numStableSamples)
+	: m_metric(metric), m_samplePeriod(samplePeriod),
+	m_tolerance(tolerance), m_numStableSamples(numStableSamples)
+{
+	assert(samplePeriod > 0.0);
+	assert(tolerance >= 0.0);
+	assert(numStableSamples > 0);
+	resetSamples(SimTime(0.0));
+}
+
+void StatConvergenceStopCondition::resetSamples(const SimTime& currentTime)
+{
+	m_nextSampleTime = currentTime;
+	m_previousCheckTime = currentTime;
+	m_hasSample = false;
+	m_previousSample = 0.0;
+	m_numConsecutiveStableSamples = 0;
+}
+
+bool StatConvergenceStopCondition::shouldStop(const SimTime& currentTime)
+{
+	// The simulator was restored to an earlier time.
+	if(currentTime < m_previousCheckTime) {
+		resetSamples(currentTime);
+	}
+	m_previousCheckTime = currentTime;
+
+	if(currentTime < m_nextSampleTime) {
+		return false;
+	}
+	m_nextSampleTime = currentTime + m_samplePeriod;
+
+	double sample = m_metric();
+	if(m_hasSample) {
+		double change = fabs(sample - m_previousSample);
+		if(change <= m_tolerance * fabs(m_previousSample)) {
+			m_numConsecutiveStableSamples++;
+		} else {
+			m_numConsecutiveStableSamples = 0;
+		}
+	}
+	m_hasSample = true;
+	m_previousSample = sample;
+
+	return (m_numConsecutiveStableSamples >= m_numStableSamples);
+}
+
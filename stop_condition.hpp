@@ -0,0 +1,289 @@
+
+#ifndef STOP_CONDITION_H
+#define STOP_CONDITION_H
+
+#include <vector>
+using namespace std;
+#include <boost/shared_ptr.hpp>
+#include <boost/function.hpp>
+#include <boost/utility.hpp>
+
+#include "utility.hpp"
+#include "sim_time.hpp"
+
+class ApplicationLayer;
+typedef boost::shared_ptr<ApplicationLayer> ApplicationLayerPtr;
+class RfidReaderApp;
+typedef boost::shared_ptr<RfidReaderApp> RfidReaderAppPtr;
+
+/////////////////////////////////////////////////
+// StopCondition Class
+/////////////////////////////////////////////////
+
+/**
+ * A predicate that tells the simulator that the rest of the
+ * run would not change its results, so it can end before
+ * its stop time.
+ * The simulator checks its conditions after every event it
+ * dispatches, so shouldStop() must be cheap; conditions that
+ * need more work should only do it once in a while (e.g.,
+ * by remembering the earliest time at which they could
+ * become true).  The clock can move backwards when the
+ * simulator is restored from a checkpoint, in which case a
+ * condition should forget what it remembered.
+ * @see Simulator::addStopCondition()
+ */
+class StopCondition : boost::noncopyable {
+public:
+	/// Smart pointer that clients should use.
+	typedef boost::shared_ptr<StopCondition> StopConditionPtr;
+
+	/// A destructor.
+	virtual ~StopCondition() {}
+
+	/**
+	 * Determine whether the simulation can stop.
+	 * @param currentTime the current time in the simulator.
+	 * @return true if the simulation can stop now.
+	 */
+	virtual bool shouldStop(const SimTime& currentTime) = 0;
+
+protected:
+
+	/// A constructor.
+	StopCondition() {}
+
+};
+typedef boost::shared_ptr<StopCondition> StopConditionPtr;
+
+/**
+ * Stops the simulation once each reader has read a given
+ * number of distinct tags, e.g., all the tags in range.
+ */
+class TagsReadStopCondition : public StopCondition {
+public:
+	/// Smart pointer that clients should use.
+	typedef boost::shared_ptr<TagsReadStopCondition>
+		TagsReadStopConditionPtr;
+
+	/**
+	 * A factory method to ensure that all objects
+	 * are created via \c new since we are using smart pointers.
+	 * @param numTags the number of tags that each reader
+	 * must read.
+	 */
+	static inline TagsReadStopConditionPtr create(t_uint numTags);
+
+	/**
+	 * Add a reader that must read the tags.
+	 * @param readerApp the application of the reader.
+	 */
+	inline void addReader(RfidReaderAppPtr readerApp);
+
+	/**
+	 * Determine whether every reader has read the tags.
+	 * @param currentTime the current time in the simulator.
+	 * @return true if the simulation can stop now.
+	 */
+	virtual bool shouldStop(const SimTime& currentTime);
+
+private:
+
+	/// The number of tags that each reader must read.
+	t_uint m_numTags;
+
+	/// The readers that must read the tags.
+	vector<RfidReaderAppPtr> m_readerApps;
+
+	/// A constructor.
+	/// @param numTags the number of tags each reader must read.
+	TagsReadStopCondition(t_uint numTags);
+
+};
+typedef boost::shared_ptr<TagsReadStopCondition>
+	TagsReadStopConditionPtr;
+
+/**
+ * Stops the simulation once none of a set of applications
+ * has done anything for a given amount of time.
+ * Applications that have not started yet keep the
+ * simulation running.
+ * @see ApplicationLayer::getLastActivityTime()
+ */
+class ApplicationIdleStopCondition : public StopCondition {
+public:
+	/// Smart pointer that clients should use.
+	typedef boost::shared_ptr<ApplicationIdleStopCondition>
+		ApplicationIdleStopConditionPtr;
+
+	/**
+	 * A factory method to ensure that all objects
+	 * are created via \c new since we are using smart pointers.
+	 * @param idleTime how long the applications must be idle.
+	 */
+	static inline ApplicationIdleStopConditionPtr create(
+		const SimTime& idleTime);
+
+	/**
+	 * Add an application that must be idle.
+	 * @param application the application.
+	 */
+	inline void addApplication(ApplicationLayerPtr application);
+
+	/**
+	 * Determine whether the applications have been idle
+	 * long enough.  The applications are only looked at
+	 * when the clock reaches the earliest time at which
+	 * this could be true.
+	 * @param currentTime the current time in the simulator.
+	 * @return true if the simulation can stop now.
+	 */
+	virtual bool shouldStop(const SimTime& currentTime);
+
+private:
+
+	/// How long the applications must be idle.
+	SimTime m_idleTime;
+
+	/// The applications that must be idle.
+	vector<ApplicationLayerPtr> m_applications;
+
+	/// The time before which the applications cannot
+	/// have been idle long enough.
+	SimTime m_nextCheckTime;
+
+	/// The last time at which the condition was checked.
+	SimTime m_previousCheckTime;
+
+	/// A constructor.
+	/// @param idleTime how long the applications must be idle.
+	ApplicationIdleStopCondition(const SimTime& idleTime);
+
+};
+typedef boost::shared_ptr<ApplicationIdleStopCondition>
+	ApplicationIdleStopConditionPtr;
+
+/**
+ * Stops the simulation once a metric has stabilized.
+ * The metric is sampled periodically and is stable once a
+ * number of consecutive samples each differ from the
+ * previous one by at most a relative tolerance.
+ */
+class StatConvergenceStopCondition : public StopCondition {
+public:
+	/// Smart pointer that clients should use.
+	typedef boost::shared_ptr<StatConvergenceStopCondition>
+		StatConvergenceStopConditionPtr;
+
+	/// A function that gives the current value of the metric.
+	typedef boost::function<double ()> Metric;
+
+	/**
+	 * A factory method to ensure that all objects
+	 * are created via \c new since we are using smart pointers.
+	 * @param metric the function that gives the metric.
+	 * @param samplePeriod the time between samples.
+	 * @param tolerance the largest relative change between
+	 * samples that is considered stable.
+	 * @param numStableSamples the number of consecutive
+	 * stable samples needed to stop.
+	 */
+	static inline StatConvergenceStopConditionPtr create(
+		const Metric& metric, const SimTime& samplePeriod,
+		double tolerance, t_uint numStableSamples);
+
+	/**
+	 * Determine whether the metric has stabilized.  The
+	 * metric is only sampled once per sample period.
+	 * @param currentTime the current time in the simulator.
+	 * @return true if the simulation can stop now.
+	 */
+	virtual bool shouldStop(const SimTime& currentTime);
+
+private:
+
+	/// The function that gives the metric.
+	Metric m_metric;
+
+	/// The time between samples.
+	SimTime m_samplePeriod;
+
+	/// The largest relative change that is stable.
+	double m_tolerance;
+
+	/// The number of stable samples needed to stop.
+	t_uint m_numStableSamples;
+
+	/// The time at which the next sample is taken.
+	SimTime m_nextSampleTime;
+
+	/// The last time at which the condition was checked.
+	SimTime m_previousCheckTime;
+
+	/// Whether a sample has been taken.
+	bool m_hasSample;
+
+	/// The last sample taken.
+	double m_previousSample;
+
+	/// The number of consecutive stable samples so far.
+	t_uint m_numConsecutiveStableSamples;
+
+	/// A constructor.
+	StatConvergenceStopCondition(const Metric& metric,
+		const SimTime& samplePeriod, double tolerance,
+		t_uint numStableSamples);
+
+	/**
+	 * Forget the samples taken so far.
+	 * @param currentTime the time at which sampling starts.
+	 */
+	void resetSamples(const SimTime& currentTime);
+
+};
+typedef boost::shared_ptr<StatConvergenceStopCondition>
+	StatConvergenceStopConditionPtr;
+
+/////////////////////////////////////////////////
+// Inline Functions
+/////////////////////////////////////////////////
+
+inline TagsReadStopConditionPtr TagsReadStopCondition::create(
+	t_uint numTags)
+{
+	TagsReadStopConditionPtr p(new TagsReadStopCondition(numTags));
+	return p;
+}
+
+inline void TagsReadStopCondition::addReader(RfidReaderAppPtr readerApp)
+{
+	assert(readerApp.get() != 0);
+	m_readerApps.push_back(readerApp);
+}
+
+inline ApplicationIdleStopConditionPtr ApplicationIdleStopCondition::create(
+	const SimTime& idleTime)
+{
+	ApplicationIdleStopConditionPtr p(
+		new ApplicationIdleStopCondition(idleTime));
+	return p;
+}
+
+inline void ApplicationIdleStopCondition::addApplication(
+	ApplicationLayerPtr application)
+{
+	assert(application.get() != 0);
+	m_applications.push_back(application);
+}
+
+inline StatConvergenceStopConditionPtr StatConvergenceStopCondition::create(
+	const Metric& metric, const SimTime& samplePeriod, double tolerance,
+	t_uint numStableSamples)
+{
+	StatConvergenceStopConditionPtr p(new StatConvergenceStopCondition(
+		metric, samplePeriod, tolerance, numStableSamples));
+	return p;
+}
+
+#endif // STOP_CONDITION_H
+
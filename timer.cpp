@@ -1,4 +1,8 @@
 
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
 #include "timer.hpp"
 
 Timer::Timer(NodePtr owner, EventPtr eventOnFire) 
@@ -23,3 +27,169 @@ void Timer::setEvent(EventPtr eventOnFire)
 	m_eventOnFire = eventOnFire;
 }
 
+void Timer::saveState(StateCheckpoint& checkpoint)
+{
+	checkpoint.save(m_eventOnFire);
+}
+
+PeriodicTimer::PeriodicTimer(NodePtr owner, EventPtr eventOnFire,
+	const SimTime& period)
+	: m_owner(owner), m_eventOnFire(eventOnFire), m_period(period),
+	m_numPeriods(0), m_isRunning(false), m_isPaused(false)
+{
+	assert(owner.get() != 0);
+	assert(eventOnFire.get() != 0);
+	assert(period > 0.0);
+	m_timerEvent = PeriodicTimerEvent::create(this);
+}
+
+PeriodicTimer::~PeriodicTimer()
+{
+	// The event may outlive the timer in the event queue.
+	m_timerEvent->m_timer = 0;
+}
+
+bool PeriodicTimer::start(const SimTime& delay)
+{
+	if(m_isRunning) {
+		return false;
+	}
+
+	m_phaseTime = m_owner->currentTime() + delay;
+	m_numPeriods = 0;
+	m_isRunning = true;
+	m_isPaused = false;
+	arm();
+	return true;
+}
+
+bool PeriodicTimer::stop()
+{
+	if(!m_isRunning) {
+		return false;
+	}
+
+	if(m_timerEvent->inEventQueue()) {
+		m_owner->cancelEvent(m_timerEvent);
+	}
+	m_isRunning = false;
+	m_isPaused = false;
+	return true;
+}
+
+void PeriodicTimer::resume()
+{
+	if(!m_isPaused) {
+		return;
+	}
+	m_isPaused = false;
+
+	// If the pending firing was not skipped, it is still
+	// in the queue.
+	if(m_isRunning && !m_timerEvent->inEventQueue()) {
+		m_numPeriods = max(m_numPeriods,
+			firstFiringFrom(m_owner->currentTime()));
+		arm();
+	}
+}
+
+t_ulong PeriodicTimer::getNumFiringsBefore(const SimTime& time) const
+{
+	t_ulong numFirings = 0;
+	if(m_isRunning) {
+		t_ulong numPeriods = firstFiringFrom(time);
+		if(numPeriods > m_numPeriods) {
+			numFirings = numPeriods - m_numPeriods;
+		}
+	}
+	return numFirings;
+}
+
+SimTime PeriodicTimer::timeRemaining() const
+{
+	SimTime timeLeft(0.0);
+	if(m_isRunning && m_timerEvent->inEventQueue()) {
+		timeLeft = m_timerEvent->getFireTime() - m_owner->currentTime();
+		assert(timeLeft.isValid());
+	}
+	return timeLeft;
+}
+
+void PeriodicTimer::setPeriod(const SimTime& period)
+{
+	assert(period > 0.0);
+	// Count the following firings from the next one.
+	m_phaseTime = firingTime(m_numPeriods);
+	m_numPeriods = 0;
+	m_period = period;
+}
+
+void PeriodicTimer::saveState(StateCheckpoint& checkpoint)
+{
+	checkpoint.save(m_period);
+	checkpoint.save(m_phaseTime);
+	checkpoint.save(m_numPeriods);
+	checkpoint.save(m_isRunning);
+	checkpoint.save(m_isPaused);
+}
+
+void PeriodicTimer::resetState()
+{
+	m_isRunning = m_timerEvent->inEventQueue();
+	m_isPaused = false;
+	m_numPeriods = 0;
+	if(m_isRunning) {
+		m_phaseTime = m_timerEvent->getFireTime();
+	}
+}
+
+t_ulong PeriodicTimer::firstFiringFrom(const SimTime& time) const
+{
+	t_ulong numPeriods = 0;
+	if(time > m_phaseTime) {
+		numPeriods = static_cast<t_ulong>(ceil(
+			(time - m_phaseTime).getTimeInSeconds() /
+			m_period.getTimeInSeconds()));
+		// Correct for the rounding of the division.
+		while(numPeriods > 0 && !(firingTime(numPeriods - 1) < time)) {
+			numPeriods--;
+		}
+		while(firingTime(numPeriods) < time) {
+			numPeriods++;
+		}
+	}
+	return numPeriods;
+}
+
+void PeriodicTimer::skipIdleFirings(const SimTime& resumeTime)
+{
+	assert(m_isRunning && !m_timerEvent->inEventQueue());
+	// The event must see the firings that are skipped
+	// before the timer moves past them.
+	if(!m_isPaused) {
+		m_eventOnFire->skipIdleTicks(resumeTime);
+	}
+	m_numPeriods = max(m_numPeriods, firstFiringFrom(resumeTime));
+	arm();
+}
+
+void PeriodicTimer::arm()
+{
+	assert(!m_timerEvent->inEventQueue());
+	m_owner->scheduleEventAt(m_timerEvent, firingTime(m_numPeriods));
+}
+
+void PeriodicTimer::fire()
+{
+	if(!m_isPaused) {
+		m_eventOnFire->execute();
+	}
+
+	// The event may have stopped, paused, or restarted
+	// the timer.
+	if(m_isRunning && !m_isPaused && !m_timerEvent->inEventQueue()) {
+		m_numPeriods++;
+		arm();
+	}
+}
+
@@ -10,6 +10,7 @@ using namespace std;
 #include "node.hpp"
 #include "event.hpp"
 #include "sim_time.hpp"
+#include "state_checkpoint.hpp"
 
 /**
  * Provides an interface to control events based on timers.
@@ -108,6 +109,17 @@ public:
 	 */
 	void setEvent(const EventPtr eventOnFire);
 
+	/**
+	 * Save the timer's event in a checkpoint.  Whether the
+	 * timer is running and when it fires are part of the
+	 * simulator's pending events, so they are restored with
+	 * them.  This only needs to be called by owners that
+	 * change the event while the simulation runs.
+	 * @param checkpoint the checkpoint being taken.
+	 * @see setEvent()
+	 */
+	void saveState(StateCheckpoint& checkpoint);
+
 protected:
 
 	/// A constructor.
@@ -128,6 +140,343 @@ private:
 };
 typedef boost::shared_ptr<Timer> TimerPtr;
 
+class PeriodicTimerEvent;
+typedef boost::intrusive_ptr<PeriodicTimerEvent> PeriodicTimerEventPtr;
+
+/**
+ * A timer that fires repeatedly with a fixed period, e.g.,
+ * at the start of each slot of a slotted MAC.
+ * The timer re-arms itself after its event is executed, so
+ * the event's owner does not have to restart it.  The k-th
+ * firing is at the start time plus k periods, which keeps
+ * the firings aligned to the period without accumulating
+ * the rounding error of adding the period each time.
+ * The timer can also be paused, in which case its event is
+ * not executed but the timer keeps its phase, so that when
+ * it is resumed, it fires at the next multiple of the period.
+ */
+class PeriodicTimer : boost::noncopyable {
+friend class PeriodicTimerEvent;
+public:
+	/// Smart pointer that clients should use.
+	typedef boost::shared_ptr<PeriodicTimer> PeriodicTimerPtr;
+
+	/// A destructor.
+	~PeriodicTimer();
+
+	/**
+	 * A factory method to ensure that all objects
+	 * are created via \c new since we are using smart pointers.
+	 * @param owner the node that owns this timer.
+	 * @param eventOnFire the event that will be executed
+	 * whenever this timer fires.  The event itself is never
+	 * put in the event queue.
+	 * @param period the time between firings.
+	 */
+	static inline PeriodicTimerPtr create(NodePtr owner,
+		EventPtr eventOnFire, const SimTime& period);
+
+	/**
+	 * Starts the timer running.
+	 * @param delay the time in the future of the first firing.
+	 * Later firings are a multiple of the period after it.
+	 * @return true if the timer was not already running.
+	 * @see stop()
+	 */
+	bool start(const SimTime& delay);
+
+	/**
+	 * Stops the timer.
+	 * @return true if the timer was running.
+	 * @see start()
+	 */
+	bool stop();
+
+	/**
+	 * Pause the timer, so that its event is not executed
+	 * until it is resumed.  The timer's pending firing stays
+	 * in the event queue.
+	 * @see resume()
+	 */
+	inline void pause();
+
+	/**
+	 * Resume a paused timer.  If the timer skipped a firing
+	 * while it was paused, it fires next at the first
+	 * multiple of the period from its start that is not in
+	 * the past.
+	 * @see pause()
+	 */
+	void resume();
+
+	/**
+	 * Check if the timer is currently running.
+	 * A paused timer is still running.
+	 * @return true if the timer was started and not stopped.
+	 */
+	inline bool isRunning() const;
+
+	/**
+	 * Check if the timer is currently paused.
+	 * @return true if the timer is paused.
+	 */
+	inline bool isPaused() const;
+
+	/**
+	 * Get the time remaining until the timer next fires.
+	 * @return the time left until the next firing or zero if
+	 * the timer is not running or has no pending firing
+	 * because it is paused.
+	 */
+	SimTime timeRemaining() const;
+
+	/**
+	 * Change the time between firings.  If the timer has a
+	 * pending firing, it is not moved, and the new period
+	 * applies to the firings after it.
+	 * @param period the new time between firings.
+	 */
+	void setPeriod(const SimTime& period);
+
+	/**
+	 * Get the time between firings.
+	 * @return the period.
+	 */
+	inline SimTime getPeriod() const;
+
+	/**
+	 * Get the number of firings, from the pending one on,
+	 * that are before a given time.
+	 * @param time the time.
+	 * @return the number of firings, or zero if the timer
+	 * is not running.
+	 */
+	t_ulong getNumFiringsBefore(const SimTime& time) const;
+
+	/**
+	 * Save the timer's phase in a checkpoint.  When the
+	 * timer next fires is part of the simulator's pending
+	 * events, so it is restored with them.
+	 * @param checkpoint the checkpoint being taken.
+	 */
+	void saveState(StateCheckpoint& checkpoint);
+
+	/**
+	 * Put the timer's phase back to what it was before the
+	 * simulation first ran.  The simulator must already have
+	 * put back its pending events, which include the timer's
+	 * first firing if it was started.
+	 * @see Simulator::resetState()
+	 */
+	void resetState();
+
+protected:
+
+	/// A constructor.
+	/// @param owner the node that owns this timer.
+	/// @param eventOnFire the event that will be executed
+	/// whenever this timer fires.
+	/// @param period the time between firings.
+	PeriodicTimer(NodePtr owner, EventPtr eventOnFire,
+		const SimTime& period);
+
+private:
+
+	/// The node to which this timer belongs.
+	NodePtr m_owner;
+
+	/// The event that will be executed when the timer fires.
+	EventPtr m_eventOnFire;
+
+	/// The event that the timer puts in the event queue.
+	PeriodicTimerEventPtr m_timerEvent;
+
+	/// @see getPeriod()
+	SimTime m_period;
+
+	/// The time from which the firings are counted.
+	SimTime m_phaseTime;
+
+	/// The number of periods after m_phaseTime of the next
+	/// firing.
+	t_ulong m_numPeriods;
+
+	/// @see isRunning()
+	bool m_isRunning;
+
+	/// @see isPaused()
+	bool m_isPaused;
+
+	/**
+	 * Get the time of a firing.
+	 * @param numPeriods the number of periods after
+	 * m_phaseTime of the firing.
+	 * @return the time of the firing.
+	 */
+	inline SimTime firingTime(t_ulong numPeriods) const;
+
+	/**
+	 * Get the first firing that is not before a given time.
+	 * @param time the time.
+	 * @return the number of periods after m_phaseTime of
+	 * the firing.
+	 */
+	t_ulong firstFiringFrom(const SimTime& time) const;
+
+	/**
+	 * Get the node whose state is the only state that firing
+	 * the timer changes, if any.
+	 * @return the owner if the timer is paused or its event
+	 * is local to the owner, otherwise zero.
+	 * @see Event::getLocalNode()
+	 */
+	inline const Node* getLocalNode() const;
+
+	/**
+	 * Determine whether the pending firing would do nothing
+	 * but move the timer along.
+	 * @return true if the timer is paused or its event is an
+	 * idle tick.
+	 * @see Event::isIdleTick()
+	 */
+	inline bool isIdle() const;
+
+	/**
+	 * Get the priority class of the timer's firings.
+	 * @return the priority class of the timer's event.
+	 * @see Event::getPriorityClass()
+	 */
+	inline Event::PriorityClasses getPriorityClass() const;
+
+	/**
+	 * Skip the idle firings before a given time and put the
+	 * timer's event, which the simulator took out of the event
+	 * queue, back in it for the first firing after them.
+	 * @param resumeTime the time of the first pending event
+	 * that is not an idle tick.
+	 * @see Event::skipIdleTicks()
+	 */
+	void skipIdleFirings(const SimTime& resumeTime);
+
+	/**
+	 * Put the timer's event in the event queue for the
+	 * next firing.
+	 */
+	void arm();
+
+	/**
+	 * Called when the timer's event is executed.  This
+	 * executes the timer's event unless the timer is paused
+	 * and then re-arms the timer unless the event stopped,
+	 * paused, or restarted it.
+	 */
+	void fire();
+
+};
+typedef boost::shared_ptr<PeriodicTimer> PeriodicTimerPtr;
+
+/**
+ * The event that a PeriodicTimer puts in the event queue.
+ */
+class PeriodicTimerEvent : public Event {
+friend class PeriodicTimer;
+public:
+	/// Smart pointer that clients should use.
+	typedef boost::intrusive_ptr<PeriodicTimerEvent>
+		PeriodicTimerEventPtr;
+
+	/**
+	 * A factory method to ensure that all objects
+	 * are created via \c new since we are using smart pointers.
+	 * @param timer the timer that owns the event.  A raw
+	 * pointer is used to avoid a cyclic reference.
+	 */
+	static inline PeriodicTimerEventPtr create(PeriodicTimer* timer)
+	{
+		PeriodicTimerEventPtr p(new PeriodicTimerEvent(timer));
+		return p;
+	}
+
+	void execute()
+	{
+		if(m_timer != 0) {
+			m_timer->fire();
+		}
+	}
+
+	/// Timers that fire at the same time (e.g., the slot
+	/// timers of all the nodes) are dispatched together.
+	bool isBundled() const
+	{
+		return true;
+	}
+
+	/// The timer's firing is node-local if its event is.
+	const Node* getLocalNode() const
+	{
+		const Node* node = 0;
+		if(m_timer != 0) {
+			node = m_timer->getLocalNode();
+		}
+		return node;
+	}
+
+	/// The timer's firing is an idle tick if it is idle.
+	bool isIdleTick() const
+	{
+		return (m_timer != 0 && m_timer->isIdle());
+	}
+
+	/// Skip the timer's idle firings.
+	void skipIdleTicks(const SimTime& resumeTime)
+	{
+		assert(m_timer != 0);
+		m_timer->skipIdleFirings(resumeTime);
+	}
+
+	/// The timer's firing has the priority class of its event.
+	PriorityClasses getPriorityClass() const
+	{
+		PriorityClasses priorityClass = PriorityClasses_Default;
+		if(m_timer != 0) {
+			priorityClass = m_timer->getPriorityClass();
+		}
+		return priorityClass;
+	}
+
+	/**
+	 * Fire each timer of the bundle in turn.
+	 * @param bundle the bundle of timer events.
+	 */
+	void executeBundle(EventBundle& bundle)
+	{
+		EventPtr event;
+		while(bundle.next(event)) {
+			PeriodicTimer* timer =
+				static_cast<PeriodicTimerEvent*>(event.get())->m_timer;
+			if(timer != 0) {
+				timer->fire();
+			}
+		}
+	}
+
+protected:
+
+	/// A constructor.
+	PeriodicTimerEvent(PeriodicTimer* timer)
+		: Event(), m_timer(timer)
+	{
+
+	}
+
+private:
+
+	/// The timer that owns the event or zero if the timer
+	/// was destroyed.
+	PeriodicTimer* m_timer;
+
+};
+
 /////////////////////////////////////////////////
 // Inline Functions
 /////////////////////////////////////////////////
@@ -145,7 +494,8 @@ inline bool Timer::start(const SimTime& delay) const
 
 	bool didScheduleEvent = false;
 	if(!isRunning()) {
-		didScheduleEvent = m_owner->scheduleEvent(m_eventOnFire, delay);
+		didScheduleEvent = m_owner->scheduleTimerEvent(m_eventOnFire,
+			delay);
 	}
 	return didScheduleEvent;
 }
@@ -194,6 +544,58 @@ inline SimTime Timer::timeRemaining() const
 	return timeLeft;
 }
 
+inline PeriodicTimerPtr PeriodicTimer::create(NodePtr owner,
+	EventPtr eventOnFire, const SimTime& period)
+{
+	PeriodicTimerPtr p(new PeriodicTimer(owner, eventOnFire, period));
+	return p;
+}
+
+inline void PeriodicTimer::pause()
+{
+	assert(m_isRunning);
+	m_isPaused = true;
+}
+
+inline bool PeriodicTimer::isRunning() const
+{
+	return m_isRunning;
+}
+
+inline bool PeriodicTimer::isPaused() const
+{
+	return m_isPaused;
+}
+
+inline SimTime PeriodicTimer::getPeriod() const
+{
+	return m_period;
+}
+
+inline bool PeriodicTimer::isIdle() const
+{
+	return (m_isPaused || m_eventOnFire->isIdleTick());
+}
+
+inline Event::PriorityClasses PeriodicTimer::getPriorityClass() const
+{
+	return m_eventOnFire->getPriorityClass();
+}
+
+inline const Node* PeriodicTimer::getLocalNode() const
+{
+	const Node* node = m_owner.get();
+	if(!m_isPaused && m_eventOnFire->getLocalNode() != node) {
+		node = 0;
+	}
+	return node;
+}
+
+inline SimTime PeriodicTimer::firingTime(t_ulong numPeriods) const
+{
+	return (m_phaseTime + SimTime(numPeriods * m_period.getTimeInSeconds()));
+}
+
 /////////////////////////////////////////////////
 // Overloaded Operators
 /////////////////////////////////////////////////
@@ -1,4 +1,8 @@
 
+#include <limits>
+using namespace std;
+#include <boost/thread/locks.hpp>
+
 #include "wireless_channel.hpp"
 #include "path_loss.hpp"
 #include "fading.hpp"
@@ -6,7 +10,11 @@
 #include "log_stream_manager.hpp"
 #include "physical_layer.hpp"
 
+const t_ulong WirelessChannel::m_MAX_CACHED_LINKS = 1 << 20;
+const t_ulong WirelessChannel::m_HASH_MULTIPLIER = 11400714819323198485ul;
+
 WirelessChannel::WirelessChannel(PathLossPtr pathLossModel)
+	: m_doLinkCache(m_DEFAULT_DO_LINK_CACHE), m_isShared(false)
 {
 	assert(pathLossModel.get() != 0);
 	m_pathLossModel = pathLossModel;
@@ -14,6 +22,7 @@ WirelessChannel::WirelessChannel(PathLossPtr pathLossModel)
 
 WirelessChannel::WirelessChannel(PathLossPtr pathLossModel, 
 	FadingPtr fadingModel)
+	: m_doLinkCache(m_DEFAULT_DO_LINK_CACHE), m_isShared(false)
 {
 	assert(pathLossModel.get() != 0);
 	assert(fadingModel.get() != 0);
@@ -25,8 +34,34 @@ double WirelessChannel::getRecvdStrength(const WirelessCommSignal& signal,
 	const PhysicalLayer& receiver) const
 {
 	assert(m_pathLossModel.get() != 0);
-	double recvdStrength = 
-		m_pathLossModel->getRecvdStrength(signal, receiver);
+	double recvdStrength = 0.0;
+	bool isCached = false;
+	// Signals that were not sent by a node have no version.
+	if(m_doLinkCache && signal.getLocationVersion() != 0) {
+		boost::unique_lock<boost::mutex> lock(m_linksMutex,
+			boost::defer_lock);
+		if(m_isShared) {
+			lock.lock();
+		}
+		Link& link = getLink(signal.getLocationVersion(),
+			receiver.getLocationVersion());
+		if(!link.m_hasLinkLoss ||
+				link.m_wavelength != signal.getWavelength()) {
+			link.m_hasLinkLoss = m_pathLossModel->getLinkLoss(
+				signal.getLocation(), receiver.getLocation(),
+				signal.getWavelength(), link.m_linkLoss);
+			link.m_wavelength = signal.getWavelength();
+		}
+		if(link.m_hasLinkLoss) {
+			recvdStrength = link.m_linkLoss.getRecvdStrength(
+				signal.getPower(), signal.getTransmitterGain(),
+				receiver.getGain());
+			isCached = true;
+		}
+	}
+	if(!isCached) {
+		recvdStrength = m_pathLossModel->getRecvdStrength(signal, receiver);
+	}
 
 	double debugRecvdStrength = recvdStrength;
 
@@ -47,6 +82,59 @@ double WirelessChannel::getRecvdStrength(const WirelessCommSignal& signal,
 	return recvdStrength;
 }
 
+double WirelessChannel::getMaxSensingRange(
+	const WirelessCommSignal& signal, double receiverGain,
+	double minStrength) const
+{
+	assert(m_pathLossModel.get() != 0);
+	if(m_fadingModel.get() != 0) {
+		return numeric_limits<double>::infinity();
+	}
+	return m_pathLossModel->getMaxRange(signal, receiverGain, minStrength);
+}
+
+SimTime WirelessChannel::propagationDelay(const PhysicalLayer& sender,
+	const PhysicalLayer& receiver) const
+{
+	if(!m_doLinkCache) {
+		return Channel::propagationDelay(sender, receiver);
+	}
+
+	boost::unique_lock<boost::mutex> lock(m_linksMutex, boost::defer_lock);
+	if(m_isShared) {
+		lock.lock();
+	}
+	Link& link = getLink(sender.getLocationVersion(),
+		receiver.getLocationVersion());
+	if(!link.m_hasPropagationDelay) {
+		link.m_propagationDelay = Channel::propagationDelay(sender, receiver);
+		link.m_hasPropagationDelay = true;
+	}
+	return link.m_propagationDelay;
+}
+
+void WirelessChannel::setDoLinkCache(bool doLinkCache)
+{
+	boost::lock_guard<boost::mutex> lock(m_linksMutex);
+	m_doLinkCache = doLinkCache;
+	m_links.clear();
+}
+
+WirelessChannel::Link& WirelessChannel::getLink(t_ulong transmitterVersion,
+	t_ulong receiverVersion) const
+{
+	LinkKey key = make_pair(transmitterVersion, receiverVersion);
+	LinkMap::iterator linkIterator = m_links.find(key);
+	if(linkIterator != m_links.end()) {
+		return linkIterator->second;
+	}
+
+	if(m_links.size() >= m_MAX_CACHED_LINKS) {
+		m_links.clear();
+	}
+	return m_links[key];
+}
+
 bool WirelessChannel::signalHasError(double signalSinr,
 	const WirelessCommSignal& signal) const
 {
@@ -2,12 +2,16 @@
 #ifndef WIRELESS_CHANNEL_H
 #define WIRELESS_CHANNEL_H
 
+#include <unordered_map>
+using namespace std;
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include "channel.hpp"
+#include "path_loss.hpp"
+#include "sim_time.hpp"
+#include "utility.hpp"
 
-class PathLoss;
-typedef boost::shared_ptr<PathLoss> PathLossPtr;
 class Fading;
 typedef boost::shared_ptr<Fading> FadingPtr;
 class WirelessCommSignal;
@@ -16,6 +20,13 @@ typedef boost::shared_ptr<WirelessCommSignal> WirelessCommSignalPtr;
 /**
  * Defines the channel used for radio transmissions over
  * a wireless channel.
+ * The path loss and propagation delay of each link between
+ * two nodes are cached the first time that they are computed,
+ * so a signal that is sent again from where the last one was
+ * sent only costs a few multiplies per receiver.  Links are
+ * identified by the versions of the nodes' locations (see
+ * Node::getLocationVersion()), so a node that moves gets new
+ * links.
  */
 class WirelessChannel : public Channel {
 public:
@@ -51,6 +62,18 @@ public:
 	virtual double getRecvdStrength(const WirelessCommSignal& signal, 
 		const PhysicalLayer& receiver) const;
 
+	/**
+	 * Get the distance beyond which the signal is no stronger
+	 * than a given strength at any receiver.  With a fading
+	 * model, which may make a signal stronger, this is infinite.
+	 * @param signal the signal being transmitted.
+	 * @param receiverGain the highest gain of the receivers.
+	 * @param minStrength the strength in Watts.
+	 * @return the distance in meters.
+	 */
+	virtual double getMaxSensingRange(const WirelessCommSignal& signal,
+		double receiverGain, double minStrength) const;
+
 	/**
 	 * Computes whether or not the signal has an error each time it
 	 * is called based on some channel error model.
@@ -66,6 +89,39 @@ public:
 	virtual bool signalHasError(double signalSinr, 
 		const WirelessCommSignal& signal) const;
 
+	/**
+	 * Compute the propagation delay between two physical
+	 * layer objects, which is cached for the link.
+	 * @param sender the sending physical layer.
+	 * @param receiver the receving physical layer.
+	 * @return the propagation delay between the two objects.
+	 */
+	virtual SimTime propagationDelay(const PhysicalLayer& sender,
+		const PhysicalLayer& receiver) const;
+
+	/**
+	 * Set whether the channel is used by the simulators of a
+	 * ParallelSimulator on several threads at once, in which
+	 * case the link cache must be locked.
+	 * @param isShared true if the channel is shared.
+	 * @see WirelessChannelManager::setDoPropagateSignalStart()
+	 */
+	inline void setIsShared(bool isShared);
+
+	/**
+	 * Set whether the path loss and propagation delay of
+	 * each link are cached.
+	 * @param doLinkCache true if links should be cached.
+	 */
+	void setDoLinkCache(bool doLinkCache);
+
+	/**
+	 * Get whether the path loss and propagation delay of
+	 * each link are cached.
+	 * @return true if links are cached.
+	 */
+	inline bool getDoLinkCache() const;
+
 protected:
 
 	/**
@@ -88,9 +144,88 @@ private:
 	/// Determine when debugging info gets printed.
 	static const bool m_DEBUG_SIGNAL_STRENGTH = false;
 
+	/// The default for whether links are cached.
+	static const bool m_DEFAULT_DO_LINK_CACHE = true;
+
+	/// The most links that are cached.  The cache is cleared
+	/// when it is full, e.g., after many nodes have moved.
+	static const t_ulong m_MAX_CACHED_LINKS;
+
+	/**
+	 * The cached values of a link.
+	 */
+	struct Link {
+		/// Whether m_linkLoss is set.
+		bool m_hasLinkLoss;
+
+		/// The wavelength for which m_linkLoss was computed.
+		double m_wavelength;
+
+		/// The loss of the link.
+		PathLoss::LinkLoss m_linkLoss;
+
+		/// Whether m_propagationDelay is set.
+		bool m_hasPropagationDelay;
+
+		/// The propagation delay of the link.
+		SimTime m_propagationDelay;
+
+		/// A constructor.
+		Link() : m_hasLinkLoss(false), m_wavelength(0.0),
+			m_hasPropagationDelay(false) { }
+	};
+
+	/// The key of a link: the location versions of the
+	/// transmitter and the receiver.
+	typedef pair<t_ulong,t_ulong> LinkKey;
+
+	/**
+	 * Hashes the key of a link.
+	 */
+	struct LinkKeyHash {
+		/// Mix the two versions.
+		size_t operator() (const LinkKey& key) const
+		{
+			return hash<t_ulong>()(key.first * m_HASH_MULTIPLIER ^
+				key.second);
+		}
+	};
+
+	/// Multiplier used to spread the versions of a link's
+	/// transmitter.
+	static const t_ulong m_HASH_MULTIPLIER;
+
+	/// The cached links.
+	typedef unordered_map<LinkKey,Link,LinkKeyHash> LinkMap;
+
 	PathLossPtr m_pathLossModel;
 	FadingPtr m_fadingModel;
 
+	/// @see setDoLinkCache()
+	bool m_doLinkCache;
+
+	/// @see setIsShared()
+	bool m_isShared;
+
+	/// The cached links.
+	mutable LinkMap m_links;
+
+	/// Protects m_links if the channel is shared.
+	mutable boost::mutex m_linksMutex;
+
+	/**
+	 * Get the cached values of a link, which are added if they
+	 * are not cached.  m_linksMutex must be held if the channel
+	 * is shared.
+	 * @param transmitterVersion the location version of the
+	 * transmitter.
+	 * @param receiverVersion the location version of the
+	 * receiver.
+	 * @return the link.
+	 */
+	Link& getLink(t_ulong transmitterVersion,
+		t_ulong receiverVersion) const;
+
 };
 typedef boost::shared_ptr<WirelessChannel> WirelessChannelPtr;
 
@@ -112,6 +247,16 @@ inline WirelessChannelPtr WirelessChannel::create(
 	return p;
 }
 
+inline void WirelessChannel::setIsShared(bool isShared)
+{
+	m_isShared = isShared;
+}
+
+inline bool WirelessChannel::getDoLinkCache() const
+{
+	return m_doLinkCache;
+}
+
 /////////////////////////////////////////////////
 // Overloaded Operators
 /////////////////////////////////////////////////
@@ -1,7 +1,13 @@
 
+#include <algorithm>
+using namespace std;
+#include <boost/bind/bind.hpp>
+#include <boost/thread/locks.hpp>
+
 #include "wireless_channel_manager.hpp"
 #include "wireless_channel.hpp"
 #include "physical_layer.hpp"
+#include "listener_grid.hpp"
 #include "event.hpp"
 #include "simulator.hpp"
 
@@ -33,151 +39,447 @@ public:
 		m_channelManager->passSignalToReceiver(m_receiver, m_signal);
 	}
 
+	/// A signal ends before anything else happens at the time.
+	PriorityClasses getPriorityClass() const
+	{
+		return PriorityClasses_SignalEnd;
+	}
+
 private:
 	ConstWirelessChannelManagerPtr m_channelManager;
 	PhysicalLayerPtr m_receiver;
 	WirelessCommSignalPtr m_signal;
 };
 
-/// \var typedef boost::shared_ptr<SignalEndEvent> SignalEndEventPtr
+/// \var typedef boost::intrusive_ptr<SignalEndEvent> SignalEndEventPtr
+/// \brief Smart pointer that clients should use.
+typedef boost::intrusive_ptr<SignalEndEvent> SignalEndEventPtr;
+
+/**
+ * The event for when a signal ends at each of the listeners of
+ * a channel, which does the work of a SignalEndEvent per
+ * listener.  The ends are sorted by their times and by the
+ * sequence numbers that their own events would have had.  The
+ * event is scheduled again for each distinct end time with the
+ * sequence number of the first end at that time, so the ends
+ * are interleaved with other events exactly as if each had its
+ * own event.  Which ends are left is found from the event's
+ * fire time and sequence number, so restoring the event queue
+ * (see Simulator::saveState()) also restores the event.
+ */
+class TransmissionEndEvent : public Event {
+public:
+
+	/// A constructor
+	TransmissionEndEvent(ConstWirelessChannelManagerPtr channelManager, 
+		SimulatorPtr simulator, WirelessCommSignalPtr signal)
+		: Event(), m_channelManager(channelManager), 
+		m_simulator(simulator), m_signal(signal)
+	{
+		assert(m_channelManager.get() != 0);
+		assert(m_simulator != 0);
+		assert(m_signal.get() != 0);
+	}
+
+	/**
+	 * Add a listener at which the signal ends.
+	 * @param receiver the listener.
+	 * @param endTime the time at which the signal ends
+	 * at the listener.
+	 */
+	void addReceiver(PhysicalLayerPtr receiver, const SimTime& endTime)
+	{
+		assert(receiver.get() != 0);
+		SignalEnd signalEnd;
+		signalEnd.m_endTime = endTime;
+		signalEnd.m_sequenceNumber = m_signalEnds.size();
+		signalEnd.m_receiver = receiver;
+		m_signalEnds.push_back(signalEnd);
+	}
+
+	/**
+	 * Schedule the event for the first end.  The ends take
+	 * the sequence numbers that their events would have
+	 * taken if they had been scheduled as they were added.
+	 */
+	void schedule()
+	{
+		if(m_signalEnds.empty()) {
+			return;
+		}
+		t_ulong firstSequenceNumber = 
+			m_simulator->reserveSequenceNumbers(m_signalEnds.size());
+		for(t_ulong i = 0; i < m_signalEnds.size(); ++i) {
+			m_signalEnds[i].m_sequenceNumber += firstSequenceNumber;
+		}
+		sort(m_signalEnds.begin(), m_signalEnds.end());
+		scheduleSignalEnd(m_signalEnds[0]);
+	}
+
+	void execute()
+	{
+		SignalEnd firstSignalEnd;
+		firstSignalEnd.m_endTime = getFireTime();
+		firstSignalEnd.m_sequenceNumber = getSequenceNumber();
+		vector<SignalEnd>::const_iterator i = lower_bound(
+			m_signalEnds.begin(), m_signalEnds.end(), firstSignalEnd);
+		assert(i != m_signalEnds.end());
+		assert(i->m_sequenceNumber == firstSignalEnd.m_sequenceNumber);
+
+		// No other event has a sequence number between those of
+		// the ends, so every end at this time can be done now
+		// unless the simulation may stop after any one of them.
+		bool doOneSignalEnd = m_simulator->getDoCheckStopConditions();
+		do {
+			m_channelManager->passSignalToReceiver(i->m_receiver, m_signal);
+			++i;
+		} while(!doOneSignalEnd && i != m_signalEnds.end() &&
+			!(i->m_endTime > firstSignalEnd.m_endTime));
+
+		if(i != m_signalEnds.end()) {
+			scheduleSignalEnd(*i);
+		}
+	}
+
+	/// A signal ends before anything else happens at the time.
+	PriorityClasses getPriorityClass() const
+	{
+		return PriorityClasses_SignalEnd;
+	}
+
+private:
+
+	/**
+	 * The end of the signal at one listener.
+	 */
+	struct SignalEnd {
+		/// The time at which the signal ends.
+		SimTime m_endTime;
+
+		/// The sequence number of the end.
+		t_ulong m_sequenceNumber;
+
+		/// The listener.
+		PhysicalLayerPtr m_receiver;
+
+		/// Ends are ordered by time and then sequence number.
+		bool operator< (const SignalEnd& rhs) const
+		{
+			return m_endTime < rhs.m_endTime ||
+				(!(rhs.m_endTime < m_endTime) &&
+				m_sequenceNumber < rhs.m_sequenceNumber);
+		}
+	};
+
+	ConstWirelessChannelManagerPtr m_channelManager;
+	SimulatorPtr m_simulator;
+	WirelessCommSignalPtr m_signal;
+
+	/// The ends of the signal.
+	vector<SignalEnd> m_signalEnds;
+
+	/**
+	 * Schedule the event for an end of the signal.
+	 * @param signalEnd the end.
+	 */
+	void scheduleSignalEnd(const SignalEnd& signalEnd)
+	{
+		m_simulator->scheduleEventInSequence(EventPtr(this),
+			signalEnd.m_endTime, signalEnd.m_sequenceNumber);
+	}
+};
+
+/// \var typedef boost::intrusive_ptr<TransmissionEndEvent> TransmissionEndEventPtr
 /// \brief Smart pointer that clients should use.
-typedef boost::shared_ptr<SignalEndEvent> SignalEndEventPtr;
+typedef boost::intrusive_ptr<TransmissionEndEvent> TransmissionEndEventPtr;
 
 
 /////////////////////////////////////////////////
 // Wireless Channel Manager Implementation
 /////////////////////////////////////////////////
 
+const double WirelessChannelManager::m_RANGE_MARGIN = 1e-4;
+const double WirelessChannelManager::m_MAX_EMPTY_SLOT_FRACTION = 0.5;
+
 WirelessChannelManager::WirelessChannelManager()
+	: m_doPropagateSignalStart(false),
+	m_doListenerCulling(m_DEFAULT_DO_LISTENER_CULLING),
+	m_doAggregateSignalEnds(m_DEFAULT_DO_AGGREGATE_SIGNAL_ENDS)
 {
 
 }
 
+void WirelessChannelManager::setDoPropagateSignalStart(
+	bool doPropagateSignalStart)
+{
+	m_doPropagateSignalStart = doPropagateSignalStart;
+	for(t_uint i = 0; i < m_channelTables.size(); ++i) {
+		m_channelTables[i].m_channel->setIsShared(m_doPropagateSignalStart);
+	}
+}
+
 void WirelessChannelManager::recvSignal(PhysicalLayerPtr sender,
 	WirelessCommSignalPtr signal)
 {
 	assert(sender.get() != 0);
 	assert(signal.get() != 0);
 
-	typedef SenderChannel::const_iterator senderIterator;
-	pair<senderIterator,senderIterator> iteratorRange = 
-		m_senders.equal_range(sender);
+	// Copy the channels so that the lock is not held while
+	// the signal is sent.
+	vector<t_uint> channelIndices;
+	{
+		boost::lock_guard<boost::mutex> lock(m_physicalLayerTablesMutex);
+		t_uint physicalLayerIndex = sender->m_channelManagerIndex;
+		if(physicalLayerIndex < m_physicalLayerTables.size() &&
+				m_physicalLayerTables[physicalLayerIndex].m_physicalLayer ==
+				sender.get()) {
+			channelIndices = 
+				m_physicalLayerTables[physicalLayerIndex].m_senderChannels;
+		}
+	}
+
+	if(!m_doPropagateSignalStart) {
+		for(t_uint i = 0; i < channelIndices.size(); ++i) {
+			sendSignalOnChannel(sender, signal,
+				m_channelTables[channelIndices[i]]);
+		}
+		return;
+	}
 
-	for(senderIterator i = iteratorRange.first;
-			i != iteratorRange.second; ++i) {
-		WirelessChannelPtr channel = i->second;
-		sendSignalOnChannel(sender, signal, channel);
+	// When the signal is sent on several channels, listeners
+	// share the one signal object and so see the ID of the last
+	// channel.  The copies are made after setting it so that
+	// they behave the same.
+	if(!channelIndices.empty()) {
+		signal->setChannelId(
+			m_channelTables[channelIndices.back()].m_channelId);
+	}
+	map<SimulatorPtr,WirelessCommSignalPtr> signalCopies;
+	for(t_uint i = 0; i < channelIndices.size(); ++i) {
+		propagateSignalOnChannel(sender, signal,
+			m_channelTables[channelIndices[i]], signalCopies);
 	}
 }
 
-t_uint WirelessChannelManager::getChannelId(
-	WirelessChannelPtr channel) const
+bool WirelessChannelManager::getChannelIndex(t_uint channelId,
+	t_uint& channelIndex) const
 {
-	t_uint channelId = 0;
-	bool wasFound = false;
-	ChannelIdMap::const_iterator p;
-	for(p = m_channels.begin(); p != m_channels.end(); ++p) {
-		if(p->second == channel) {
-			// Make sure we only find this channel once.
-			assert(!wasFound);
-			wasFound = true;
-			channelId = p->first;
-		}
+	ChannelIdMap::const_iterator channelIterator = 
+		m_channels.find(channelId);
+	if(channelIterator == m_channels.end()) {
+		return false;
 	}
-	assert(wasFound);
+	channelIndex = channelIterator->second;
+	assert(channelIndex < m_channelTables.size());
+	return true;
+}
 
-	return channelId;
+WirelessChannelManager::PhysicalLayerTable& 
+WirelessChannelManager::getPhysicalLayerTable(
+	PhysicalLayerPtr physicalLayer)
+{
+	t_uint physicalLayerIndex = physicalLayer->m_channelManagerIndex;
+	if(physicalLayerIndex == PhysicalLayer::m_NO_CHANNEL_MANAGER_INDEX) {
+		physicalLayerIndex = m_physicalLayerTables.size();
+		physicalLayer->m_channelManagerIndex = physicalLayerIndex;
+		PhysicalLayerTable physicalLayerTable;
+		physicalLayerTable.m_physicalLayer = physicalLayer.get();
+		m_physicalLayerTables.push_back(physicalLayerTable);
+	}
+
+	// A layer can only be attached to the channels of one manager.
+	assert(physicalLayerIndex < m_physicalLayerTables.size());
+	assert(m_physicalLayerTables[physicalLayerIndex].m_physicalLayer ==
+		physicalLayer.get());
+	return m_physicalLayerTables[physicalLayerIndex];
 }
 
 void WirelessChannelManager::sendSignalOnChannel(
 	ConstPhysicalLayerPtr sender, WirelessCommSignalPtr signal, 
-	WirelessChannelPtr channel)
+	const ChannelTable& channelTable)
 {
 	assert(sender != 0);
 	assert(signal.get() != 0);
+
+	WirelessChannelPtr channel = channelTable.m_channel;
 	assert(channel.get() != 0);
 
-	typedef ChannelObserver::const_iterator observerIterator;
-	pair<observerIterator,observerIterator> iteratorRange = 
-		m_listeners.equal_range(channel);
+	vector<PhysicalLayerPtr> culledListeners;
+	const vector<PhysicalLayerPtr>& listeners = 
+		getListeners(*signal, channelTable, culledListeners);
 
 	SimTime signalEndTime = signal->getDuration();
 
 	// Let receivers know on which channel the signal is received.
-	signal->setChannelId(getChannelId(channel));
+	signal->setChannelId(channelTable.m_channelId);
 
-	for(observerIterator i = iteratorRange.first;
-			i != iteratorRange.second; ++i) {
+	SimulatorPtr simulator = sender->getSimulator();
+	TransmissionEndEventPtr transmissionEnd;
+	if(m_doAggregateSignalEnds) {
+		transmissionEnd = new TransmissionEndEvent(shared_from_this(),
+			simulator, signal);
+	}
+
+	for(t_ulong i = 0; i < listeners.size(); ++i) {
 
-		PhysicalLayerPtr listener = i->second;
+		const PhysicalLayerPtr& listener = listeners[i];
 
 		// Make sure that we don't calculate the receiving power
 		// for the sender.
-		if(listener != sender) {
-			// Calculate the SINR of the signal for each listener
-			// based on its location.  Add this value to a hash table.
-			double signalStrength = 
-				channel->getRecvdStrength(*signal, *listener);
-
-			if(m_DEBUG_SIGNAL_STRENGTH) {
-				ostringstream debugStream;
-				debugStream << "listener: " << listener->getNodeId() <<
-					", ss: " << signalStrength << " RXThresh: " << 
-					listener->getRxThreshold();
-				LogStreamManager::instance()->logDebugItem(debugStream.str());
-			}
-
-			// If the signal strength is sufficiently strong to 
-			// receive the signal, set it as the packet which will
-			// be received by this physical layer.
-			if(listener->captureSignal(signalStrength)) {
-				listener->setPendingSignal(signal);
-			} 
-
-			// Add the signal to the existing culmulative signal
-			// strength being received.
-			listener->addSignal(signal, signalStrength);
-
-			// We need to determine if the currently pending
-			// signal (if one exists) is still sufficiently strong
-			// after this new signal has been added.  If the
-			// currently received signal is the pending
-			// signal, this check is unnecessary since it was
-			// essentially performed via the captureSignal
-			// call above.
-			if(signal != listener->getPendingSignal() &&
-					listener->pendingSignalIsWeak()) {
-				listener->resetPendingSignal();
-			}
-
-			// This is based on the QualNet model for bit error
-			// computations.  When the signal is received or
-			// any time the interference changes, compute the
-			// probability of packet error for that interference 
-			// level.  Thus, if p_i is the probability that the packet
-			// is not in error for the i-th computation on the signal,
-			// the PER for the signal is:
-			// PER = 1 - (p_1 * p_2 * ... * p_n)
-			// where n is the number of interference changes during
-			// the packet.
-			if(listener->getPendingSignal().get() != 0 &&
-					!listener->getPendingSignalError()) {
-				listener->setPendingSignalError(
-					channel->signalHasError(
-						listener->getPendingSignalSinr(), 
-						*listener->getPendingSignal()
-					)
-				);
-			}
+		if(listener.get() != 0 && listener != sender) {
+			startSignalAtListener(listener, signal, channel);
 
 			// Schedule an event for when this signal will finish.
-			SignalEndEventPtr signalEnd(
-				new SignalEndEvent(shared_from_this(), listener, signal));
 			SimTime recvTime = signalEndTime + 
 				channel->propagationDelay(*sender, *listener);
-			Simulator::instance()->scheduleEvent(signalEnd, recvTime);
+			if(transmissionEnd.get() != 0) {
+				assert(listener->getSimulator() == simulator);
+				transmissionEnd->addReceiver(listener,
+					simulator->currentTime() + recvTime);
+			} else {
+				SignalEndEventPtr signalEnd(
+					new SignalEndEvent(shared_from_this(), listener, signal));
+				listener->scheduleEvent(signalEnd, recvTime);
+			}
+
+		}
+	}
+
+	if(transmissionEnd.get() != 0) {
+		transmissionEnd->schedule();
+	}
+}
+
+void WirelessChannelManager::propagateSignalOnChannel(
+	ConstPhysicalLayerPtr sender, WirelessCommSignalPtr signal, 
+	const ChannelTable& channelTable,
+	map<SimulatorPtr,WirelessCommSignalPtr>& signalCopies)
+{
+	assert(sender != 0);
+	assert(signal.get() != 0);
 
+	WirelessChannelPtr channel = channelTable.m_channel;
+	assert(channel.get() != 0);
+
+	vector<PhysicalLayerPtr> culledListeners;
+	const vector<PhysicalLayerPtr>& listeners = 
+		getListeners(*signal, channelTable, culledListeners);
+
+	SimulatorPtr senderSimulator = sender->getSimulator();
+	SimTime sendTime = senderSimulator->currentTime();
+	SimTime signalEndTime = signal->getDuration();
+
+	// Listeners in other simulators may run on other threads,
+	// so the listeners of each simulator get their own copy.
+	for(t_ulong i = 0; i < listeners.size(); ++i) {
+
+		const PhysicalLayerPtr& listener = listeners[i];
+		if(listener.get() == 0 || listener == sender) {
+			continue;
+		}
+
+		SimulatorPtr listenerSimulator = listener->getSimulator();
+		WirelessCommSignalPtr& signalCopy = 
+			signalCopies[listenerSimulator];
+		if(signalCopy.get() == 0) {
+			signalCopy = WirelessCommSignal::create(*signal);
 		}
+
+		SimTime propagationDelay = 
+			channel->propagationDelay(*sender, *listener);
+		SimTime startTime = sendTime + propagationDelay;
+		SimTime endTime = sendTime + (signalEndTime + propagationDelay);
+		senderSimulator->scheduleAction(listenerSimulator, startTime,
+			boost::bind(&WirelessChannelManager::startPropagatedSignal,
+			shared_from_this(), listener, signalCopy, channel, endTime));
+	}
+}
+
+const vector<PhysicalLayerPtr>& WirelessChannelManager::getListeners(
+	const WirelessCommSignal& signal, const ChannelTable& channelTable,
+	vector<PhysicalLayerPtr>& culledListeners) const
+{
+	ListenerGridPtr grid = channelTable.m_listenerGrid;
+	if(!m_doListenerCulling || grid.get() == 0) {
+		return channelTable.m_listeners;
+	}
+
+	double range = channelTable.m_channel->getMaxSensingRange(signal,
+		grid->getMaxGain(), grid->getMinSensitivity());
+	grid->getListeners(signal.getLocation(),
+		range * (1.0 + m_RANGE_MARGIN), culledListeners);
+	return culledListeners;
+}
+
+void WirelessChannelManager::startPropagatedSignal(
+	PhysicalLayerPtr listener, WirelessCommSignalPtr signal,
+	WirelessChannelPtr channel, SimTime endTime)
+{
+	startSignalAtListener(listener, signal, channel);
+
+	SignalEndEventPtr signalEnd(
+		new SignalEndEvent(shared_from_this(), listener, signal));
+	listener->getSimulator()->scheduleEventAt(signalEnd, endTime);
+}
+
+void WirelessChannelManager::startSignalAtListener(
+	PhysicalLayerPtr listener, WirelessCommSignalPtr signal,
+	WirelessChannelPtr channel)
+{
+	// Calculate the SINR of the signal for each listener
+	// based on its location.  Add this value to a hash table.
+	double signalStrength = 
+		channel->getRecvdStrength(*signal, *listener);
+
+	if(m_DEBUG_SIGNAL_STRENGTH) {
+		ostringstream debugStream;
+		debugStream << "listener: " << listener->getNodeId() <<
+			", ss: " << signalStrength << " RXThresh: " << 
+			listener->getRxThreshold();
+		LogStreamManager::instance()->logDebugItem(debugStream.str());
+	}
+
+	// If the signal strength is sufficiently strong to 
+	// receive the signal, set it as the packet which will
+	// be received by this physical layer.
+	if(listener->captureSignal(signalStrength)) {
+		listener->setPendingSignal(signal);
+	} 
+
+	// Add the signal to the existing culmulative signal
+	// strength being received.
+	listener->addSignal(signal, signalStrength);
+
+	// We need to determine if the currently pending
+	// signal (if one exists) is still sufficiently strong
+	// after this new signal has been added.  If the
+	// currently received signal is the pending
+	// signal, this check is unnecessary since it was
+	// essentially performed via the captureSignal
+	// call above.
+	if(signal != listener->getPendingSignal() &&
+			listener->pendingSignalIsWeak()) {
+		listener->resetPendingSignal();
+	}
+
+	// This is based on the QualNet model for bit error
+	// computations.  When the signal is received or
+	// any time the interference changes, compute the
+	// probability of packet error for that interference 
+	// level.  Thus, if p_i is the probability that the packet
+	// is not in error for the i-th computation on the signal,
+	// the PER for the signal is:
+	// PER = 1 - (p_1 * p_2 * ... * p_n)
+	// where n is the number of interference changes during
+	// the packet.
+	if(listener->getPendingSignal().get() != 0 &&
+			!listener->getPendingSignalError()) {
+		listener->setPendingSignalError(
+			channel->signalHasError(
+				listener->getPendingSignalSinr(), 
+				*listener->getPendingSignal()
+			)
+		);
 	}
 }
 
@@ -204,14 +506,14 @@ bool WirelessChannelManager::attachAsSender(PhysicalLayerPtr physicalLayer,
 	t_uint channelId)
 {
 	assert(physicalLayer != 0);
-	ChannelIdMap::iterator channelIterator = m_channels.find(channelId);
+	t_uint channelIndex = 0;
+	bool channelFound = getChannelIndex(channelId, channelIndex);
 
 	bool wasSuccessful = false;
-	bool channelFound = (channelIterator != m_channels.end());
 	if(channelFound) {
-		WirelessChannelPtr channel = channelIterator->second;
-		assert(channel.get() != 0);
-		m_senders.insert(make_pair(physicalLayer, channel));
+		boost::lock_guard<boost::mutex> lock(m_physicalLayerTablesMutex);
+		getPhysicalLayerTable(physicalLayer).m_senderChannels.push_back(
+			channelIndex);
 		wasSuccessful = true;
 	}
 
@@ -222,24 +524,20 @@ bool WirelessChannelManager::detachAsSender(PhysicalLayerPtr physicalLayer,
 	t_uint channelId)
 {
 	assert(physicalLayer != 0);
-	ChannelIdMap::iterator channelIterator = m_channels.find(channelId);
-	bool channelFound = (channelIterator != m_channels.end());
+	t_uint channelIndex = 0;
+	bool channelFound = getChannelIndex(channelId, channelIndex);
 
 	bool wasSuccessful = false;
 
 	if(channelFound) {
-		WirelessChannelPtr channel = channelIterator->second;
-		typedef SenderChannel::iterator senderIterator;
-		pair<senderIterator,senderIterator> iteratorRange = 
-			m_senders.equal_range(physicalLayer);
-
-		for(senderIterator i = iteratorRange.first;
-				i != iteratorRange.second; ++i) {
-			if(i->second == channel) {
-				m_senders.erase(i);
-				wasSuccessful = true;
-				break;
-			}
+		boost::lock_guard<boost::mutex> lock(m_physicalLayerTablesMutex);
+		vector<t_uint>& senderChannels = 
+			getPhysicalLayerTable(physicalLayer).m_senderChannels;
+		vector<t_uint>::iterator i = find(senderChannels.begin(),
+			senderChannels.end(), channelIndex);
+		if(i != senderChannels.end()) {
+			senderChannels.erase(i);
+			wasSuccessful = true;
 		}
 	}
 
@@ -250,14 +548,20 @@ bool WirelessChannelManager::attachAsListener(PhysicalLayerPtr physicalLayer,
 	t_uint channelId)
 {
 	assert(physicalLayer != 0);
-	ChannelIdMap::iterator channelIterator = m_channels.find(channelId);
+	t_uint channelIndex = 0;
+	bool channelFound = getChannelIndex(channelId, channelIndex);
 
 	bool wasSuccessful = false;
-	bool channelFound = (channelIterator != m_channels.end());
 	if(channelFound) {
-		WirelessChannelPtr channel = channelIterator->second;
-		assert(channel.get() != 0);
-		m_listeners.insert(make_pair(channel, physicalLayer));
+		ChannelTable& channelTable = m_channelTables[channelIndex];
+		boost::lock_guard<boost::mutex> lock(m_physicalLayerTablesMutex);
+		getPhysicalLayerTable(physicalLayer).m_listenerSlots.push_back(
+			make_pair(channelIndex, channelTable.m_listeners.size()));
+		channelTable.m_listeners.push_back(physicalLayer);
+		if(channelTable.m_listenerGrid.get() == 0) {
+			channelTable.m_listenerGrid = ListenerGrid::create();
+		}
+		channelTable.m_listenerGrid->add(physicalLayer);
 		wasSuccessful = true;
 	}
 
@@ -268,35 +572,100 @@ bool WirelessChannelManager::detachAsListener(PhysicalLayerPtr physicalLayer,
 	t_uint channelId)
 {
 	assert(physicalLayer != 0);
-	ChannelIdMap::iterator channelIterator = m_channels.find(channelId);
-	bool channelFound = (channelIterator != m_channels.end());
+	t_uint channelIndex = 0;
+	bool channelFound = getChannelIndex(channelId, channelIndex);
 
 	bool wasSuccessful = false;
 
 	if(channelFound) {
-		WirelessChannelPtr channel = channelIterator->second;
-		typedef ChannelObserver::iterator observerIterator;
-		pair<observerIterator,observerIterator> iteratorRange = 
-			m_listeners.equal_range(channel);
-
-		for(observerIterator i = iteratorRange.first;
-				i != iteratorRange.second; ++i) {
-			if(i->second == physicalLayer) {
-				m_listeners.erase(i);
+		ChannelTable& channelTable = m_channelTables[channelIndex];
+		boost::lock_guard<boost::mutex> lock(m_physicalLayerTablesMutex);
+		vector<pair<t_uint,t_ulong> >& listenerSlots = 
+			getPhysicalLayerTable(physicalLayer).m_listenerSlots;
+
+		for(t_uint i = 0; i < listenerSlots.size(); ++i) {
+			if(listenerSlots[i].first == channelIndex) {
+				t_ulong slot = listenerSlots[i].second;
+				assert(channelTable.m_listeners[slot] == physicalLayer);
+				channelTable.m_listeners[slot].reset();
+				channelTable.m_numEmptySlots++;
+				listenerSlots.erase(listenerSlots.begin() + i);
+				channelTable.m_listenerGrid->remove(physicalLayer);
 				wasSuccessful = true;
 				break;
 			}
 		}
+
+		if(channelTable.m_numEmptySlots > m_MAX_EMPTY_SLOT_FRACTION *
+				channelTable.m_listeners.size()) {
+			compactListeners(channelIndex);
+		}
 	}
 
 	return wasSuccessful;
 }
 
+void WirelessChannelManager::compactListeners(t_uint channelIndex)
+{
+	ChannelTable& channelTable = m_channelTables[channelIndex];
+	vector<PhysicalLayerPtr>& listeners = channelTable.m_listeners;
+
+	t_ulong numListeners = 0;
+	for(t_ulong slot = 0; slot < listeners.size(); ++slot) {
+		if(listeners[slot].get() == 0) {
+			continue;
+		}
+
+		// Move the listener down and point its table at the
+		// new slot.
+		vector<pair<t_uint,t_ulong> >& listenerSlots = 
+			m_physicalLayerTables[
+			listeners[slot]->m_channelManagerIndex].m_listenerSlots;
+		for(t_uint i = 0; i < listenerSlots.size(); ++i) {
+			if(listenerSlots[i].first == channelIndex &&
+					listenerSlots[i].second == slot) {
+				listenerSlots[i].second = numListeners;
+				break;
+			}
+		}
+		listeners[numListeners].swap(listeners[slot]);
+		numListeners++;
+	}
+	listeners.resize(numListeners);
+	channelTable.m_numEmptySlots = 0;
+}
+
+void WirelessChannelManager::updateListenerLocation(
+	PhysicalLayerPtr physicalLayer)
+{
+	assert(physicalLayer != 0);
+	vector<t_uint> channelIndices;
+	{
+		boost::lock_guard<boost::mutex> lock(m_physicalLayerTablesMutex);
+		const vector<pair<t_uint,t_ulong> >& listenerSlots = 
+			getPhysicalLayerTable(physicalLayer).m_listenerSlots;
+		for(t_uint i = 0; i < listenerSlots.size(); ++i) {
+			channelIndices.push_back(listenerSlots[i].first);
+		}
+	}
+
+	for(t_uint i = 0; i < channelIndices.size(); ++i) {
+		m_channelTables[channelIndices[i]].m_listenerGrid->update(
+			physicalLayer);
+	}
+}
+
 void WirelessChannelManager::addChannel(t_uint channelId, 
 	WirelessChannelPtr channel)
 {
 	assert(channel.get() != 0);
-	m_channels[channelId] = channel;
+	channel->setIsShared(m_doPropagateSignalStart);
+	ChannelTable channelTable;
+	channelTable.m_channelId = channelId;
+	channelTable.m_channel = channel;
+	channelTable.m_numEmptySlots = 0;
+	m_channels[channelId] = m_channelTables.size();
+	m_channelTables.push_back(channelTable);
 }
 
 bool WirelessChannelManager::removeChannel(t_uint channelId)
@@ -306,4 +675,45 @@ bool WirelessChannelManager::removeChannel(t_uint channelId)
 	return wasSuccessful;
 }
 
+bool WirelessChannelManager::getMinRemotePropagationDelay(
+	SimTime& minDelay) const
+{
+	vector<const PhysicalLayer*> physicalLayers;
+	{
+		boost::lock_guard<boost::mutex> lock(m_physicalLayerTablesMutex);
+		for(t_uint i = 0; i < m_physicalLayerTables.size(); ++i) {
+			const PhysicalLayerTable& physicalLayerTable = 
+				m_physicalLayerTables[i];
+			if(!physicalLayerTable.m_senderChannels.empty() ||
+					!physicalLayerTable.m_listenerSlots.empty()) {
+				physicalLayers.push_back(
+					physicalLayerTable.m_physicalLayer);
+			}
+		}
+	}
+
+	bool wasFound = false;
+	for(t_uint i = 0; i < m_channelTables.size(); ++i) {
+		const ChannelTable& channelTable = m_channelTables[i];
+		for(t_ulong j = 0; j < channelTable.m_listeners.size(); ++j) {
+			PhysicalLayerPtr listener = channelTable.m_listeners[j];
+			if(listener.get() == 0) {
+				continue;
+			}
+			for(t_uint k = 0; k < physicalLayers.size(); ++k) {
+				if(physicalLayers[k]->getSimulator() == 
+						listener->getSimulator()) {
+					continue;
+				}
+				SimTime delay = channelTable.m_channel->propagationDelay(
+					*physicalLayers[k], *listener);
+				if(!wasFound || delay < minDelay) {
+					minDelay = delay;
+					wasFound = true;
+				}
+			}
+		}
+	}
+	return wasFound;
+}
 
@@ -3,13 +3,15 @@
 #define CHANNEL_MANAGER_H
 
 #include <map>
-#include <set>
+#include <vector>
 using namespace std;
 #include <boost/shared_ptr.hpp>
 #include <boost/enable_shared_from_this.hpp>
 #include <boost/utility.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include "utility.hpp"
+#include "sim_time.hpp"
 
 class WirelessChannel;
 typedef boost::shared_ptr<WirelessChannel> WirelessChannelPtr;
@@ -24,14 +26,18 @@ class SignalListeners;
 typedef boost::shared_ptr<SignalListeners> SignalListenersPtr;
 class ListenerSignals;
 typedef boost::shared_ptr<ListenerSignals> ListenerSignalsPtr;
+class ListenerGrid;
+typedef boost::shared_ptr<ListenerGrid> ListenerGridPtr;
 
-typedef map<t_uint,WirelessChannelPtr> ChannelIdMap;
-typedef multimap<WirelessChannelPtr,PhysicalLayerPtr> ChannelObserver;
-typedef multimap<PhysicalLayerPtr,WirelessChannelPtr> SenderChannel;
+typedef map<t_uint,t_uint> ChannelIdMap;
 
 /**
  * This class manages which nodes are listening and transmitting
  * on which channels.
+ * Each channel and each physical layer is given a dense index
+ * when it is added, and the listeners of a channel are kept in
+ * one contiguous vector, so sending a signal needs no searching
+ * and walks its listeners in order.
  */
 class WirelessChannelManager : boost::noncopyable,
 	public boost::enable_shared_from_this<WirelessChannelManager> {
@@ -65,6 +71,79 @@ public:
 	void passSignalToReceiver(PhysicalLayerPtr receiver, 
 		WirelessCommSignalPtr signal) const;
 
+	/**
+	 * Set whether the start of a signal reaches each listener
+	 * after the propagation delay (as the end of the signal
+	 * does) rather than at the instant it is sent.
+	 * This is required when the listeners are spread across
+	 * the partitions of a ParallelSimulator, since the
+	 * propagation delay is the lookahead between partitions.
+	 * The listeners of each simulator then also share their
+	 * own copy of the signal, and the channels are marked as
+	 * shared (see WirelessChannel::setIsShared()).
+	 * @param doPropagateSignalStart true if the start of the
+	 * signal should be delayed.
+	 */
+	void setDoPropagateSignalStart(bool doPropagateSignalStart);
+
+	/**
+	 * Set whether a signal is only given to the listeners that
+	 * are close enough to sense it.  Listeners are found with a
+	 * ListenerGrid of each channel, and the range of the signal
+	 * is computed from the channel's path loss model with the
+	 * highest gain and lowest sensitivity of the channel's
+	 * listeners when they were attached.  A listener that is out
+	 * of range would ignore the signal anyway, so this only saves
+	 * the work (and the SignalEndEvent) for it.  Listeners must
+	 * not change their gain or thresholds while they are
+	 * attached, and one that moves must be updated with
+	 * updateListenerLocation().
+	 * @param doListenerCulling true if listeners that are out of
+	 * range should be skipped.
+	 */
+	inline void setDoListenerCulling(bool doListenerCulling);
+
+	/**
+	 * Get whether listeners that are out of range of a signal
+	 * are skipped.
+	 * @return true if listeners are culled.
+	 * @see setDoListenerCulling()
+	 */
+	inline bool getDoListenerCulling() const;
+
+	/**
+	 * Set whether the ends of a signal at all of the listeners
+	 * of a channel are handled by one TransmissionEndEvent
+	 * rather than by a SignalEndEvent per listener.  The ends
+	 * still happen at each listener's own time and in the same
+	 * order, so this does not change the results.  The signals
+	 * of a ParallelSimulator (see setDoPropagateSignalStart())
+	 * always end with a SignalEndEvent per listener.
+	 * @param doAggregateSignalEnds true if one event should
+	 * end a signal at all of the listeners.
+	 */
+	inline void setDoAggregateSignalEnds(bool doAggregateSignalEnds);
+
+	/**
+	 * Get whether the ends of a signal at the listeners of a
+	 * channel are handled by one event.
+	 * @return true if the ends are aggregated.
+	 * @see setDoAggregateSignalEnds()
+	 */
+	inline bool getDoAggregateSignalEnds() const;
+
+	/**
+	 * Get the smallest propagation delay between two physical
+	 * layers that are attached to this manager, live in
+	 * different simulators, and one of which listens on a
+	 * channel.  This is a safe lookahead for a
+	 * ParallelSimulator.  It takes time quadratic in the
+	 * number of physical layers.
+	 * @param minDelay set to the smallest delay.
+	 * @return false if no such pair exists.
+	 */
+	bool getMinRemotePropagationDelay(SimTime& minDelay) const;
+
 	/**
 	 * Add the physical layer as a sender on the given channel.
 	 * @param physicalLayer a pointer to the physical layer.
@@ -105,6 +184,15 @@ public:
 	 */
 	bool detachAsListener(PhysicalLayerPtr physicalLayer, t_uint channelId);
 
+	/**
+	 * Let the manager know that the node of a physical layer
+	 * moved (see Node::setLocation()), so that the layer is
+	 * found where it is now on the channels to which it
+	 * listens.
+	 * @param physicalLayer a pointer to the physical layer.
+	 */
+	void updateListenerLocation(PhysicalLayerPtr physicalLayer);
+
 	/**
 	 * Add the given channel to this manager with the specified ID.
 	 * If a different already exists with the specified ID, it
@@ -131,36 +219,182 @@ private:
 	/// Determine when debugging info is printed.
 	static const bool m_DEBUG_SIGNAL_STRENGTH = false;
 
-	/// A mapping of IDs to channel pointers.
+	/// The default for whether listeners are culled.
+	static const bool m_DEFAULT_DO_LISTENER_CULLING = true;
+
+	/// The default for whether the ends of a signal are
+	/// aggregated.
+	static const bool m_DEFAULT_DO_AGGREGATE_SIGNAL_ENDS = true;
+
+	/// How much the range of a signal is widened so that
+	/// rounding never culls a listener that senses it.
+	static const double m_RANGE_MARGIN;
+
+	/// Compact the listeners of a channel once more than
+	/// this fraction of its slots are empty.
+	static const double m_MAX_EMPTY_SLOT_FRACTION;
+
+	/**
+	 * The members of a channel.
+	 */
+	struct ChannelTable {
+		/// The ID with which the channel was added.
+		t_uint m_channelId;
+
+		/// The channel.
+		WirelessChannelPtr m_channel;
+
+		/// The listeners in the order in which they were
+		/// attached.  A detached listener leaves an empty slot
+		/// until the table is compacted.
+		vector<PhysicalLayerPtr> m_listeners;
+
+		/// The number of empty slots in m_listeners.
+		t_ulong m_numEmptySlots;
+
+		/// The listeners indexed by their location.
+		ListenerGridPtr m_listenerGrid;
+	};
+
+	/**
+	 * The channels of a physical layer.
+	 */
+	struct PhysicalLayerTable {
+		/// The physical layer, which is only used to check
+		/// the index that it holds.
+		const PhysicalLayer* m_physicalLayer;
+
+		/// The indices of the channels on which the layer
+		/// transmits, in the order in which they were attached.
+		vector<t_uint> m_senderChannels;
+
+		/// The index of each channel to which the layer listens
+		/// and its slot in that channel's listeners.
+		vector<pair<t_uint,t_ulong> > m_listenerSlots;
+	};
+
+	/// A mapping of IDs to channel indices.  A channel that is
+	/// replaced or removed keeps its index, so the indices held
+	/// by the physical layer tables stay valid.
 	ChannelIdMap m_channels;
 
-	/// A mapping of channels to physical layers which observe it.
-	ChannelObserver m_listeners;
+	/// The channels, by index.
+	vector<ChannelTable> m_channelTables;
+
+	/// The physical layers, by the index that each holds
+	/// (see PhysicalLayer::m_channelManagerIndex).
+	/// Tags change their sending channel while the simulation
+	/// runs, possibly from different threads, so this is
+	/// protected by m_physicalLayerTablesMutex.
+	vector<PhysicalLayerTable> m_physicalLayerTables;
 
-	/// A mapping of physical layers to the channels on which
-	/// their packets are transmitted.
-	SenderChannel m_senders;
+	/// Protects m_physicalLayerTables.
+	mutable boost::mutex m_physicalLayerTablesMutex;
+
+	/// @see setDoPropagateSignalStart()
+	bool m_doPropagateSignalStart;
+
+	/// @see setDoListenerCulling()
+	bool m_doListenerCulling;
+
+	/// @see setDoAggregateSignalEnds()
+	bool m_doAggregateSignalEnds;
+
+	/**
+	 * Get the listeners of the channel that may sense the
+	 * signal, in the order in which they were attached.
+	 * Without culling, these are the channel's own listeners,
+	 * which may include empty slots.
+	 * @param signal the signal being sent.
+	 * @param channelTable the channel on which the signal
+	 * is being sent.
+	 * @param culledListeners the vector to which the listeners
+	 * are appended if they are culled.
+	 * @return the listeners.
+	 * @see setDoListenerCulling()
+	 */
+	const vector<PhysicalLayerPtr>& getListeners(
+		const WirelessCommSignal& signal,
+		const ChannelTable& channelTable,
+		vector<PhysicalLayerPtr>& culledListeners) const;
 
 	/**
 	 * Function to control which receivers should hear
 	 * a copy of the signal when sent on the given channel.
 	 * @param sender the sender of the signal.
 	 * @param signal the signal being sent.
-	 * @param channel the channel on which the signal
+	 * @param channelTable the channel on which the signal
 	 * is being sent.
 	 */
 	void sendSignalOnChannel(ConstPhysicalLayerPtr sender, 
+		WirelessCommSignalPtr signal, const ChannelTable& channelTable);
+
+	/**
+	 * Send the signal to each listener of the channel, where
+	 * it starts after the propagation delay.
+	 * @param sender the sender of the signal.
+	 * @param signal the signal being sent.
+	 * @param channelTable the channel on which the signal
+	 * is being sent.
+	 * @param signalCopies the copy of the signal given to the
+	 * listeners in each simulator, shared by all of the channels
+	 * on which the signal is sent.
+	 * @see setDoPropagateSignalStart()
+	 */
+	void propagateSignalOnChannel(ConstPhysicalLayerPtr sender, 
+		WirelessCommSignalPtr signal, const ChannelTable& channelTable,
+		map<SimulatorPtr,WirelessCommSignalPtr>& signalCopies);
+
+	/**
+	 * The signal starts at the listener.  Its strength is added
+	 * to the listener's interference and it may become the
+	 * listener's pending signal.
+	 * @param listener the physical layer receiving the signal.
+	 * @param signal the signal being received.
+	 * @param channel the channel on which the signal is sent.
+	 */
+	void startSignalAtListener(PhysicalLayerPtr listener,
 		WirelessCommSignalPtr signal, WirelessChannelPtr channel);
 
 	/**
-	 * Does a revese look-up on the channel pointer to find
-	 * its ID (since our map is keyed by ID).
-	 * Assertions ensure that the channel is found exactly
-	 * once in the channel ID map.
-	 * @param channel a pointer to the channel being looked up.
-	 * @return the channel ID of the channel.
+	 * Start the signal at the listener and schedule its end
+	 * at an absolute time.
+	 * @param listener the physical layer receiving the signal.
+	 * @param signal the signal being received.
+	 * @param channel the channel on which the signal is sent.
+	 * @param endTime the time at which the signal ends at
+	 * the listener.
+	 * @see propagateSignalOnChannel()
+	 */
+	void startPropagatedSignal(PhysicalLayerPtr listener,
+		WirelessCommSignalPtr signal, WirelessChannelPtr channel,
+		SimTime endTime);
+
+	/**
+	 * Get the index of the channel with the given ID.
+	 * @param channelId the ID of the channel.
+	 * @param channelIndex set to the index of the channel.
+	 * @return false if there is no channel with the ID.
 	 */
-	t_uint getChannelId(WirelessChannelPtr channel) const;
+	bool getChannelIndex(t_uint channelId, t_uint& channelIndex) const;
+
+	/**
+	 * Get the table of a physical layer, which is added if the
+	 * layer does not have one yet.  m_physicalLayerTablesMutex
+	 * must be held.
+	 * @param physicalLayer a pointer to the physical layer.
+	 * @return the table of the physical layer.
+	 */
+	PhysicalLayerTable& getPhysicalLayerTable(
+		PhysicalLayerPtr physicalLayer);
+
+	/**
+	 * Remove the empty slots from a channel's listeners and
+	 * update the slots that the listeners' tables hold.
+	 * m_physicalLayerTablesMutex must be held.
+	 * @param channelIndex the index of the channel.
+	 */
+	void compactListeners(t_uint channelIndex);
 
 };
 typedef boost::shared_ptr<WirelessChannelManager> 
@@ -178,6 +412,28 @@ inline WirelessChannelManagerPtr WirelessChannelManager::create()
 	return p;
 }
 
+inline void WirelessChannelManager::setDoListenerCulling(
+	bool doListenerCulling)
+{
+	m_doListenerCulling = doListenerCulling;
+}
+
+inline bool WirelessChannelManager::getDoListenerCulling() const
+{
+	return m_doListenerCulling;
+}
+
+inline void WirelessChannelManager::setDoAggregateSignalEnds(
+	bool doAggregateSignalEnds)
+{
+	m_doAggregateSignalEnds = doAggregateSignalEnds;
+}
+
+inline bool WirelessChannelManager::getDoAggregateSignalEnds() const
+{
+	return m_doAggregateSignalEnds;
+}
+
 /////////////////////////////////////////////////
 // Overloaded Operators
 /////////////////////////////////////////////////